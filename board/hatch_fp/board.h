@@ -193,6 +193,7 @@
 #define CONFIG_FINGERPRINT_MCU
 #ifdef SECTION_IS_RW
 #define CONFIG_FP_SENSOR_FPC1025
+#define CONFIG_FP_FRAME_COMPRESSION
 /*
  * Use the malloc code only in the RW section (for the private library),
  * we cannot enable it in RO since it is not compatible with the RW verification
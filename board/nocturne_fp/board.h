@@ -119,6 +119,7 @@
 #define CONFIG_FINGERPRINT_MCU
 #ifdef SECTION_IS_RW
 #define CONFIG_FP_SENSOR_FPC1145
+#define CONFIG_FP_FRAME_COMPRESSION
 #define CONFIG_CMD_FPSENSOR_DEBUG
 /*
  * Use the malloc code only in the RW section (for the private library),
@@ -0,0 +1 @@
+void __cryptoc_stub(void){}
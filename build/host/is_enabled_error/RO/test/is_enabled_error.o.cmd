@@ -0,0 +1 @@
+ gcc -Wstrict-prototypes -Wdeclaration-after-statement -Wno-pointer-sign -DOUTDIR=build/host/is_enabled_error/ -DCHIP=host -DBOARD_TASKFILE=ec.tasklist -DBOARD=host -DCORE=host -DPROJECT=is_enabled_error -DCHIP_VARIANT= -DCHIP_FAMILY= -DBOARD_HOST= -DCHIP_HOST= -DCORE_HOST= -DCHIP_VARIANT_= -DCHIP_FAMILY_= -DFINAL_OUTDIR=build/host/is_enabled_error -DPROTOBUF_MIN_PROTOC_VERSION=0  -Iinclude  -Icore/host/include  -Iinclude/driver  -Icore/host  -Ichip/host  -Iboard/host  -Iboard/host  -Icommon  -Ifuzz  -Ipower  -Itest  -Icts/common  -Icts/  -Ibuild/host/is_enabled_error/gen  -Iprivate  -Iprivate-kandou  -Icommon  -Icommon/fpsensor  -Icommon/mock  -Icommon/vboot  -Icommon/usbc  -Idriver  -Idriver/fingerprint  -Idriver/fingerprint/fpc  -Idriver/fingerprint/fpc/bep  -Idriver/fingerprint/fpc/libfp  -Idriver/fingerprint/elan  -Idriver/led  -Idriver/temp_sensor  -Idriver/ioexpander  -Idriver/nfc  -Idriver/bc12  -Idriver/usb_mux  -Idriver/ppc  -Idriver/charger  -Idriver/tcpm  -Idriver/battery  -Idriver/retimer  -Idriver/wpc  -Ibuild/host/is_enabled_error  -Ifuzz  -Itest  -I. -DTEST_BUILD= -DTEST_TASKFILE=is_enabled_error.tasklist  -DEMU_BUILD= -DTEST_is_enabled_error= -DTEST_IS_ENABLED_ERROR=       -DTEST_HOSTTEST= -Iinclude/driver  -DSECTION_IS_= -DSECTION=  -Og -DCHROMIUM_EC= -DHAS_TASK_HOOKS= -DHAS_TASK_HOSTCMD= -DHAS_TASK_CONSOLE=  -I/tmp/cryptoc/include -fno-builtin -g  -Wall -Wundef -Werror -Werror-implicit-function-declaration -Wno-trigraphs -Wno-format-security -Wno-address-of-packed-member -fno-common -fno-strict-aliasing -fno-strict-overflow  -ffunction-sections -fshort-wchar -fno-delete-null-pointer-checks -ffat-lto-objects -fconserve-stack -MMD -MP -MF build/host/is_enabled_error/RO/test/is_enabled_error.o.d -c test/is_enabled_error.c -MT build/host/is_enabled_error/RO/test/is_enabled_error.o -o build/host/is_enabled_error/RO/test/is_enabled_error.o
@@ -18,4 +18,8 @@ chip-$(CONFIG_USB_PD_TCPC)+=usb_pd_phy.o
 
 dirs-y += chip/host/dcrypto
 
-chip-$(CONFIG_I2C)+= i2c.o
+chip-$(CONFIG_I2C)+= i2c.o i2c_emul.o
+ifeq ($(CONFIG_I2C),y)
+chip-$(CONFIG_ACCELGYRO_BMI260)+=i2c_emul_bmi260.o
+chip-$(CONFIG_USB_PD_TCPM_TCPCI)+=i2c_emul_tcpci.o
+endif
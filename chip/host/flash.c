@@ -11,6 +11,7 @@
 #include "config_chip.h"
 #include "flash.h"
 #include "persistence.h"
+#include "test_util.h"
 #include "util.h"
 
 /* This needs to be aligned to the erase bank size for NVCTR. */
@@ -36,33 +37,50 @@ static int flash_check_protect(int offset, int size)
 	return 0;
 }
 
-static void flash_set_persistent(void)
-{
-	FILE *f = get_persistent_storage("flash", "wb");
-	int sz;
+/* Mapping of the persistent storage of the flash */
+static char *flash_storage;
 
-	ASSERT(f != NULL);
+/* Snapshot of the flash, see test_flash_snapshot() */
+static char flash_snapshot[CONFIG_FLASH_SIZE];
+static uint8_t flash_snapshot_protect[PHYSICAL_BANKS];
 
-	sz = fwrite(__host_flash, sizeof(__host_flash), 1, f);
-	ASSERT(sz == 1);
-
-	release_persistent_storage(f);
+static void flash_set_persistent(void)
+{
+	memcpy(flash_storage, __host_flash, sizeof(__host_flash));
 }
 
 static void flash_get_persistent(void)
 {
-	FILE *f = get_persistent_storage("flash", "rb");
+	int created;
+
+	if (!flash_storage) {
+		flash_storage = map_persistent_storage(
+			"flash", sizeof(__host_flash), &created);
+		ASSERT(flash_storage != NULL);
 
-	if (f == NULL) {
-		fprintf(stderr,
-			"No flash storage found. Initializing to 0xff.\n");
-		memset(__host_flash, 0xff, sizeof(__host_flash));
-		return;
+		if (created) {
+			fprintf(stderr, "No flash storage found. "
+				"Initializing to 0xff.\n");
+			memset(flash_storage, 0xff, sizeof(__host_flash));
+		}
 	}
 
-	fread(__host_flash, sizeof(__host_flash), 1, f);
+	memcpy(__host_flash, flash_storage, sizeof(__host_flash));
+}
+
+void test_flash_snapshot(void)
+{
+	memcpy(flash_snapshot, __host_flash, sizeof(__host_flash));
+	memcpy(flash_snapshot_protect, __host_flash_protect,
+	       sizeof(__host_flash_protect));
+}
 
-	release_persistent_storage(f);
+void test_flash_restore(void)
+{
+	memcpy(__host_flash, flash_snapshot, sizeof(__host_flash));
+	memcpy(__host_flash_protect, flash_snapshot_protect,
+	       sizeof(__host_flash_protect));
+	flash_set_persistent();
 }
 
 int flash_physical_write(int offset, int size, const char *data)
@@ -7,6 +7,7 @@
 
 #include "hooks.h"
 #include "i2c.h"
+#include "i2c_emul.h"
 #include "i2c_private.h"
 #include "link_defs.h"
 #include "test_util.h"
@@ -82,10 +83,17 @@ int chip_i2c_xfer(const int port, const uint16_t slave_addr_flags,
 		  uint8_t *in, int in_size, int flags)
 {
 	const struct test_i2c_xfer *p;
+	struct i2c_emul *emul;
 	int rv;
 
 	if (test_check_detached(port, slave_addr_flags))
 		return EC_ERROR_UNKNOWN;
+
+	emul = i2c_emul_find(port, slave_addr_flags);
+	if (emul)
+		return i2c_emul_xfer(emul, out, out_size, in, in_size, flags);
+
+	i2c_emul_bus_delay(port, out_size, in_size);
 	for (p = __test_i2c_xfer; p < __test_i2c_xfer_end; ++p) {
 		rv = p->routine(port, slave_addr_flags,
 				out, out_size,
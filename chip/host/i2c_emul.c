@@ -0,0 +1,228 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * I2C device emulators for host tests.
+ */
+
+#include "common.h"
+#include "i2c.h"
+#include "i2c_emul.h"
+#include "timer.h"
+#include "util.h"
+
+static struct i2c_emul *emul_list;
+
+static struct {
+	uint8_t enable;
+	int overhead_us;
+} bus_timing[I2C_PORT_COUNT];
+
+int i2c_emul_register(struct i2c_emul *emul)
+{
+	if (i2c_emul_find(emul->port, emul->addr_flags))
+		return EC_ERROR_BUSY;
+
+	i2c_emul_reset_stats(emul);
+	emul->next = emul_list;
+	emul_list = emul;
+
+	return EC_SUCCESS;
+}
+
+void i2c_emul_unregister(struct i2c_emul *emul)
+{
+	struct i2c_emul **p;
+
+	for (p = &emul_list; *p; p = &(*p)->next)
+		if (*p == emul) {
+			*p = emul->next;
+			break;
+		}
+}
+
+void i2c_emul_reset_stats(struct i2c_emul *emul)
+{
+	memset(&emul->stats, 0, sizeof(emul->stats));
+}
+
+struct i2c_emul *i2c_emul_find(int port, uint16_t addr_flags)
+{
+	struct i2c_emul *emul;
+
+	for (emul = emul_list; emul; emul = emul->next)
+		if (emul->port == port && emul->addr_flags == addr_flags)
+			return emul;
+
+	return NULL;
+}
+
+void i2c_emul_set_bus_timing(int port, int enable, int overhead_us)
+{
+	if (port < 0 || port >= ARRAY_SIZE(bus_timing))
+		return;
+
+	bus_timing[port].enable = enable;
+	bus_timing[port].overhead_us = overhead_us;
+}
+
+int i2c_emul_bus_delay(int port, int out_size, int in_size)
+{
+	const struct i2c_port_t *i2c_port;
+	int bytes = out_size + in_size;
+	int us;
+
+	if (port < 0 || port >= ARRAY_SIZE(bus_timing) ||
+	    !bus_timing[port].enable)
+		return 0;
+
+	i2c_port = get_i2c_port(port);
+	if (!i2c_port || !i2c_port->kbps)
+		return 0;
+
+	/* Address byte of the write phase, and of the (repeated) start. */
+	if (out_size)
+		bytes++;
+	if (in_size)
+		bytes++;
+
+	us = bus_timing[port].overhead_us + bytes * 9 * 1000 / i2c_port->kbps;
+	udelay(us);
+
+	return us;
+}
+
+int i2c_emul_xfer(struct i2c_emul *emul, const uint8_t *out, int out_size,
+		  uint8_t *in, int in_size, int flags)
+{
+	emul->stats.xfers++;
+	emul->stats.bytes_out += out_size;
+	emul->stats.bytes_in += in_size;
+	emul->stats.bus_time_us += i2c_emul_bus_delay(emul->port, out_size,
+						      in_size);
+
+	return emul->xfer(emul, out, out_size, in, in_size, flags);
+}
+
+/*****************************************************************************/
+/* Register map emulator */
+
+static uint8_t *regs_ptr(struct i2c_emul_regs *r, int reg, int offset)
+{
+	int idx = reg * r->stride + offset;
+
+	if (idx < 0 || idx >= r->size)
+		return NULL;
+
+	return &r->regs[idx];
+}
+
+static int regs_read(struct i2c_emul_regs *r, uint8_t *val)
+{
+	uint8_t *p;
+	int rv;
+
+	if (r->read_byte) {
+		rv = r->read_byte(r, r->reg, r->offset, val);
+		if (rv != EC_ERROR_UNIMPLEMENTED) {
+			r->offset++;
+			return rv;
+		}
+	}
+
+	p = regs_ptr(r, r->reg, r->offset);
+	if (!p)
+		return EC_ERROR_UNKNOWN;
+
+	*val = *p;
+	r->offset++;
+
+	return EC_SUCCESS;
+}
+
+static int regs_write(struct i2c_emul_regs *r, uint8_t val)
+{
+	uint8_t *p;
+	int rv;
+
+	if (r->write_byte) {
+		rv = r->write_byte(r, r->reg, r->offset, val);
+		if (rv != EC_ERROR_UNIMPLEMENTED) {
+			r->offset++;
+			return rv;
+		}
+	}
+
+	p = regs_ptr(r, r->reg, r->offset);
+	if (!p)
+		return EC_ERROR_UNKNOWN;
+
+	*p = val;
+	r->offset++;
+
+	return EC_SUCCESS;
+}
+
+int i2c_emul_regs_xfer(struct i2c_emul *emul, const uint8_t *out,
+		       int out_size, uint8_t *in, int in_size, int flags)
+{
+	struct i2c_emul_regs *r = (struct i2c_emul_regs *)emul;
+	int i = 0;
+	int rv;
+
+	if (out_size && (flags & I2C_XFER_START)) {
+		r->reg = out[0];
+		r->offset = 0;
+		i = 1;
+	}
+
+	for (; i < out_size; i++) {
+		rv = regs_write(r, out[i]);
+		if (rv)
+			return rv;
+	}
+
+	for (i = 0; i < in_size; i++) {
+		rv = regs_read(r, &in[i]);
+		if (rv)
+			return rv;
+	}
+
+	return EC_SUCCESS;
+}
+
+uint8_t i2c_emul_regs_get8(struct i2c_emul_regs *r, int reg)
+{
+	uint8_t *p = regs_ptr(r, reg, 0);
+
+	return p ? *p : 0;
+}
+
+void i2c_emul_regs_set8(struct i2c_emul_regs *r, int reg, uint8_t val)
+{
+	uint8_t *p = regs_ptr(r, reg, 0);
+
+	if (p)
+		*p = val;
+}
+
+uint16_t i2c_emul_regs_get16(struct i2c_emul_regs *r, int reg)
+{
+	uint8_t *p = regs_ptr(r, reg, 0);
+
+	if (!p || !regs_ptr(r, reg, 1))
+		return 0;
+
+	return p[0] | (p[1] << 8);
+}
+
+void i2c_emul_regs_set16(struct i2c_emul_regs *r, int reg, uint16_t val)
+{
+	uint8_t *p = regs_ptr(r, reg, 0);
+
+	if (!p || !regs_ptr(r, reg, 1))
+		return;
+
+	p[0] = val & 0xff;
+	p[1] = val >> 8;
+}
@@ -0,0 +1,165 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * I2C device emulators for host tests.
+ *
+ * An emulator answers the transfers addressed to one device, so a real
+ * driver can run unmodified against it. Emulators take precedence over the
+ * routines declared with DECLARE_TEST_I2C_XFER(), and count the transfers
+ * they serve so tests can check the bus usage of a driver.
+ */
+
+#ifndef __CROS_EC_I2C_EMUL_H
+#define __CROS_EC_I2C_EMUL_H
+
+#include "common.h"
+#include "stdint.h"
+
+struct i2c_emul_stats {
+	/* Number of transfers addressed to the device */
+	uint32_t xfers;
+	/* Bytes written to and read from the device */
+	uint32_t bytes_out;
+	uint32_t bytes_in;
+	/* Bus time, when bus timing is enabled on the port */
+	uint32_t bus_time_us;
+};
+
+struct i2c_emul {
+	int port;
+	uint16_t addr_flags;
+
+	/**
+	 * Serve a transfer, with the same arguments as chip_i2c_xfer().
+	 *
+	 * @param emul Emulator the transfer is addressed to.
+	 * @return EC_SUCCESS, or an error to fail the transfer.
+	 */
+	int (*xfer)(struct i2c_emul *emul, const uint8_t *out, int out_size,
+		    uint8_t *in, int in_size, int flags);
+
+	struct i2c_emul_stats stats;
+
+	/* Private: next registered emulator */
+	struct i2c_emul *next;
+};
+
+/**
+ * Attach an emulator to the bus. Its statistics are cleared.
+ *
+ * @return EC_SUCCESS, or EC_ERROR_BUSY if another emulator already answers
+ * the same port and address.
+ */
+int i2c_emul_register(struct i2c_emul *emul);
+
+/**
+ * Detach an emulator from the bus.
+ */
+void i2c_emul_unregister(struct i2c_emul *emul);
+
+/**
+ * Clear the statistics of an emulator.
+ */
+void i2c_emul_reset_stats(struct i2c_emul *emul);
+
+/**
+ * Emulate the duration of the transfers of a port.
+ *
+ * Each transfer then takes @overhead_us plus 9 bit times per byte, including
+ * the address bytes, at the speed of the port in i2c_ports[]. Time is spent
+ * with udelay(), so the calling task keeps the CPU like with a real
+ * controller.
+ *
+ * @param port Port to configure.
+ * @param enable Non-zero to enable the timing, 0 for instant transfers.
+ * @param overhead_us Fixed cost of each transfer.
+ */
+void i2c_emul_set_bus_timing(int port, int enable, int overhead_us);
+
+/**
+ * Find the emulator answering a device.
+ *
+ * @return The emulator, or NULL if none is registered for the device.
+ */
+struct i2c_emul *i2c_emul_find(int port, uint16_t addr_flags);
+
+/**
+ * Serve a transfer with an emulator, updating its statistics.
+ */
+int i2c_emul_xfer(struct i2c_emul *emul, const uint8_t *out, int out_size,
+		  uint8_t *in, int in_size, int flags);
+
+/**
+ * Spend the bus time of a transfer, see i2c_emul_set_bus_timing().
+ *
+ * @return The duration of the transfer in us, 0 if timing is disabled.
+ */
+int i2c_emul_bus_delay(int port, int out_size, int in_size);
+
+/*
+ * Register map emulator.
+ *
+ * The first byte written by a transfer starting with I2C_XFER_START selects
+ * a register. Following bytes are written to, or read from, the register
+ * map from the selected register onward, so multi-byte registers are little
+ * endian. Registers are @stride bytes apart: 1 for byte addressed devices
+ * such as a TCPC or an IMU, 2 for SMBus devices with word registers such as
+ * a smart battery or a charger.
+ */
+struct i2c_emul_regs {
+	struct i2c_emul emul;
+
+	/* Register map, of @size bytes */
+	uint8_t *regs;
+	int size;
+	int stride;
+
+	/**
+	 * Optional hooks to emulate FIFOs, clear on read or write one to
+	 * clear registers. Called for each byte of a transfer.
+	 *
+	 * @param r Emulator.
+	 * @param reg Register selected by the transfer.
+	 * @param offset Index of the byte from the start of @reg.
+	 * @param val Byte to read, or written.
+	 * @return EC_SUCCESS if handled, EC_ERROR_UNIMPLEMENTED to access the
+	 * register map, or an error to fail the transfer.
+	 */
+	int (*read_byte)(struct i2c_emul_regs *r, int reg, int offset,
+			 uint8_t *val);
+	int (*write_byte)(struct i2c_emul_regs *r, int reg, int offset,
+			  uint8_t val);
+
+	/* Private: register selected by the last transfer, and position */
+	int reg;
+	int offset;
+};
+
+/**
+ * Serve a transfer with a register map, for i2c_emul.xfer.
+ */
+int i2c_emul_regs_xfer(struct i2c_emul *emul, const uint8_t *out,
+		       int out_size, uint8_t *in, int in_size, int flags);
+
+#define I2C_EMUL_REGS(_port, _addr_flags, _regs, _stride)		\
+	{								\
+		.emul = {						\
+			.port = (_port),				\
+			.addr_flags = (_addr_flags),			\
+			.xfer = i2c_emul_regs_xfer,			\
+		},							\
+		.regs = (_regs),					\
+		.size = sizeof(_regs),					\
+		.stride = (_stride),					\
+	}
+
+/**
+ * Access a register of the map, as the device would see it.
+ */
+uint8_t i2c_emul_regs_get8(struct i2c_emul_regs *r, int reg);
+void i2c_emul_regs_set8(struct i2c_emul_regs *r, int reg, uint8_t val);
+uint16_t i2c_emul_regs_get16(struct i2c_emul_regs *r, int reg);
+void i2c_emul_regs_set16(struct i2c_emul_regs *r, int reg, uint16_t val);
+
+#endif /* __CROS_EC_I2C_EMUL_H */
@@ -0,0 +1,169 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * BMI260 IMU emulator for host tests.
+ */
+
+#include "common.h"
+#include "driver/accelgyro_bmi260.h"
+#include "i2c_emul_bmi260.h"
+#include "util.h"
+
+/* Value read from an empty FIFO: an empty frame header */
+#define BMI260_EMUL_FIFO_EMPTY 0x80
+
+static int fifo_level(struct i2c_emul_bmi260 *b)
+{
+	return b->fifo_len - b->fifo_pos;
+}
+
+static void update_fifo(struct i2c_emul_bmi260 *b)
+{
+	int level = fifo_level(b);
+
+	b->map[BMI260_FIFO_LENGTH_0] = level & 0xff;
+	b->map[BMI260_FIFO_LENGTH_1] = level >> 8;
+}
+
+static void flush_fifo(struct i2c_emul_bmi260 *b)
+{
+	b->fifo_len = 0;
+	b->fifo_pos = 0;
+	update_fifo(b);
+}
+
+static int bmi260_emul_read_byte(struct i2c_emul_regs *r, int reg, int offset,
+				 uint8_t *val)
+{
+	struct i2c_emul_bmi260 *b = (struct i2c_emul_bmi260 *)r;
+	int idx = reg + offset;
+
+	/* The FIFO data register does not auto-increment. */
+	if (reg == BMI260_FIFO_DATA) {
+		if (fifo_level(b))
+			*val = b->fifo[b->fifo_pos++];
+		else
+			*val = BMI260_EMUL_FIFO_EMPTY;
+		update_fifo(b);
+		return EC_SUCCESS;
+	}
+
+	switch (idx) {
+	case BMI260_INT_STATUS_0:
+	case BMI260_INT_STATUS_1:
+		*val = b->map[idx];
+		b->map[idx] = 0;
+		return EC_SUCCESS;
+	}
+
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+static void load_config(struct i2c_emul_bmi260 *b, int offset, uint8_t val)
+{
+	/* INIT_ADDR is in words: 4 bits in INIT_ADDR_0, 8 in INIT_ADDR_1 */
+	int pos = ((b->map[BMI260_INIT_ADDR_0] & 0xf) |
+		   (b->map[BMI260_INIT_ADDR_1] << 4)) * 2 + offset;
+
+	if (pos >= b->config_size || b->config[pos] != val)
+		b->config_err = 1;
+	else
+		b->config_loaded++;
+}
+
+static int bmi260_emul_write_byte(struct i2c_emul_regs *r, int reg,
+				  int offset, uint8_t val)
+{
+	struct i2c_emul_bmi260 *b = (struct i2c_emul_bmi260 *)r;
+	int idx = reg + offset;
+
+	if (reg == BMI260_INIT_DATA) {
+		load_config(b, offset, val);
+		return EC_SUCCESS;
+	}
+
+	switch (idx) {
+	case BMI260_CHIP_ID:
+	case BMI260_INT_STATUS_0:
+	case BMI260_INT_STATUS_1:
+	case BMI260_INTERNAL_STATUS:
+	case BMI260_FIFO_LENGTH_0:
+	case BMI260_FIFO_LENGTH_1:
+		/* Read only */
+		return EC_SUCCESS;
+	case BMI260_INIT_CTRL:
+		b->map[idx] = val;
+		if (val & 1)
+			b->map[BMI260_INTERNAL_STATUS] =
+				b->config_loaded == b->config_size &&
+				!b->config_err ? BMI260_INIT_OK :
+						 BMI260_INIT_ERR;
+		else
+			b->config_loaded = b->config_err = 0;
+		return EC_SUCCESS;
+	case BMI260_CMD_REG:
+		if (val == BMI260_CMD_SOFT_RESET)
+			i2c_emul_bmi260_reset(b);
+		else if (val == BMI260_CMD_FIFO_FLUSH)
+			flush_fifo(b);
+		return EC_SUCCESS;
+	}
+
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+void i2c_emul_bmi260_init(struct i2c_emul_bmi260 *b, int port,
+			  uint16_t addr_flags, const uint8_t *config,
+			  int config_size)
+{
+	memset(b, 0, sizeof(*b));
+	b->regs.emul.port = port;
+	b->regs.emul.addr_flags = addr_flags;
+	b->regs.emul.xfer = i2c_emul_regs_xfer;
+	b->regs.regs = b->map;
+	b->regs.size = sizeof(b->map);
+	b->regs.stride = 1;
+	b->regs.read_byte = bmi260_emul_read_byte;
+	b->regs.write_byte = bmi260_emul_write_byte;
+	b->config = config;
+	b->config_size = config_size;
+
+	i2c_emul_bmi260_reset(b);
+}
+
+void i2c_emul_bmi260_reset(struct i2c_emul_bmi260 *b)
+{
+	memset(b->map, 0, sizeof(b->map));
+	b->map[BMI260_CHIP_ID] = BMI260_CHIP_ID_MAJOR;
+	/* Advanced power save and FIFO self wake-up enabled */
+	b->map[BMI260_PWR_CONF] = 0x03;
+	b->config_loaded = 0;
+	b->config_err = 0;
+	flush_fifo(b);
+}
+
+int i2c_emul_bmi260_push_fifo(struct i2c_emul_bmi260 *b,
+			      const uint8_t *data, int len)
+{
+	int level = fifo_level(b);
+	int wtm = b->map[BMI260_FIFO_WTM_0] |
+		  (b->map[BMI260_FIFO_WTM_1] << 8);
+
+	if (level + len > sizeof(b->fifo))
+		return EC_ERROR_OVERFLOW;
+
+	memmove(b->fifo, b->fifo + b->fifo_pos, level);
+	memcpy(b->fifo + level, data, len);
+	b->fifo_pos = 0;
+	b->fifo_len = level + len;
+	update_fifo(b);
+
+	/* The interrupts fire as the FIFO fills, not while it drains */
+	if (wtm && level < wtm && b->fifo_len >= wtm)
+		b->map[BMI260_INT_STATUS_1] |= BMI260_FWM_INT >> 8;
+	if (b->fifo_len == sizeof(b->fifo))
+		b->map[BMI260_INT_STATUS_1] |= BMI260_FFULL_INT >> 8;
+
+	return EC_SUCCESS;
+}
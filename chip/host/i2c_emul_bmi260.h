@@ -0,0 +1,66 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * BMI260 IMU emulator for host tests.
+ */
+
+#ifndef __CROS_EC_I2C_EMUL_BMI260_H
+#define __CROS_EC_I2C_EMUL_BMI260_H
+
+#include "i2c_emul.h"
+
+#define I2C_EMUL_BMI260_FIFO_SIZE 256
+
+/*
+ * Register map of a BMI260, answering the bmi260 driver like a real chip:
+ * - The configuration file written through INIT_DATA is checked against
+ *   @config, and INTERNAL_STATUS reports whether the load succeeded once
+ *   INIT_CTRL is set.
+ * - FIFO_DATA drains a FIFO filled by the test, FIFO_LENGTH follows it, and
+ *   the watermark and full interrupts are raised in INT_STATUS.
+ * - INT_STATUS is clear on read.
+ * - CMD performs a soft reset or a FIFO flush.
+ */
+struct i2c_emul_bmi260 {
+	struct i2c_emul_regs regs;
+	uint8_t map[128];
+
+	/* Configuration file the driver has to load */
+	const uint8_t *config;
+	int config_size;
+	/* Bytes of the configuration loaded, and whether one was wrong */
+	int config_loaded;
+	int config_err;
+
+	uint8_t fifo[I2C_EMUL_BMI260_FIFO_SIZE];
+	int fifo_len;
+	int fifo_pos;
+};
+
+/**
+ * Set up an emulator for a BMI260, and reset it. It still has to be attached
+ * to the bus with i2c_emul_register().
+ *
+ * @param config Configuration file expected from the driver.
+ * @param config_size Size of @config in bytes.
+ */
+void i2c_emul_bmi260_init(struct i2c_emul_bmi260 *b, int port,
+			  uint16_t addr_flags, const uint8_t *config,
+			  int config_size);
+
+/**
+ * Reset the BMI260 like a soft reset: the configuration file is lost and
+ * the FIFO is flushed.
+ */
+void i2c_emul_bmi260_reset(struct i2c_emul_bmi260 *b);
+
+/**
+ * Add frames to the FIFO, raising the FIFO interrupts.
+ *
+ * @return EC_SUCCESS, or EC_ERROR_OVERFLOW if the frames do not fit.
+ */
+int i2c_emul_bmi260_push_fifo(struct i2c_emul_bmi260 *b,
+			      const uint8_t *data, int len);
+
+#endif /* __CROS_EC_I2C_EMUL_BMI260_H */
@@ -0,0 +1,208 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * TCPCI TCPC emulator for host tests.
+ */
+
+#include "common.h"
+#include "i2c_emul_tcpci.h"
+#include "tcpm/tcpci.h"
+#include "util.h"
+
+/* VENDOR_ID, PRODUCT_ID and DEVICE_ID, kept across resets */
+#define TCPCI_EMUL_ID_SIZE TCPC_REG_TC_REV
+
+/* RECEIVE_DETECT.EnableHardReset */
+#define TCPCI_EMUL_RX_DETECT_HRST BIT(5)
+
+static int tcpci_emul_read_byte(struct i2c_emul_regs *r, int reg, int offset,
+				uint8_t *val)
+{
+	struct i2c_emul_tcpci *t = (struct i2c_emul_tcpci *)r;
+
+	/* RX_BUFFER is read in one go from its base address */
+	if (reg != TCPC_REG_RX_BUFFER)
+		return EC_ERROR_UNIMPLEMENTED;
+
+	if (!t->rx_cnt || offset >= I2C_EMUL_TCPCI_MSG_SIZE)
+		*val = 0;
+	else
+		*val = t->rx[t->rx_head][offset];
+
+	return EC_SUCCESS;
+}
+
+static int tcpci_emul_write_byte(struct i2c_emul_regs *r, int reg, int offset,
+				 uint8_t val)
+{
+	struct i2c_emul_tcpci *t = (struct i2c_emul_tcpci *)r;
+	int idx = reg + offset;
+
+	if (reg == TCPC_REG_TX_BUFFER) {
+		if (offset >= sizeof(t->tx))
+			return EC_ERROR_OVERFLOW;
+		t->tx[offset] = val;
+		return EC_SUCCESS;
+	}
+
+	if (idx < TCPCI_EMUL_ID_SIZE)
+		/* Read only */
+		return EC_SUCCESS;
+
+	switch (idx) {
+	case TCPC_REG_ALERT:
+		/* Clearing the RX status pops the message that was read */
+		if ((val & TCPC_REG_ALERT_RX_STATUS) && t->rx_cnt) {
+			t->rx_head = (t->rx_head + 1) % I2C_EMUL_TCPCI_RX_DEPTH;
+			t->rx_cnt--;
+			if (t->rx_cnt)
+				val &= ~TCPC_REG_ALERT_RX_STATUS;
+		}
+		/* fallthrough */
+	case TCPC_REG_ALERT + 1:
+	case TCPC_REG_FAULT_STATUS:
+	case TCPC_REG_ALERT_EXT:
+		/* Write one to clear */
+		t->map[idx] &= ~val;
+		return EC_SUCCESS;
+	case TCPC_REG_CC_STATUS:
+	case TCPC_REG_POWER_STATUS:
+	case TCPC_REG_EXT_STATUS:
+		/* Read only */
+		return EC_SUCCESS;
+	case TCPC_REG_ROLE_CTRL:
+	case TCPC_REG_COMMAND:
+		t->map[idx] = val;
+		if (t->ops && t->ops->control)
+			t->ops->control(t, idx, val);
+		return EC_SUCCESS;
+	case TCPC_REG_TRANSMIT:
+		t->map[idx] = val;
+		if (t->ops && t->ops->transmit)
+			t->ops->transmit(t, val);
+		return EC_SUCCESS;
+	}
+
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+void i2c_emul_tcpci_init(struct i2c_emul_tcpci *t, int port,
+			 uint16_t addr_flags,
+			 const struct i2c_emul_tcpci_ops *ops)
+{
+	memset(t, 0, sizeof(*t));
+	t->regs.emul.port = port;
+	t->regs.emul.addr_flags = addr_flags;
+	t->regs.emul.xfer = i2c_emul_regs_xfer;
+	t->regs.regs = t->map;
+	t->regs.size = sizeof(t->map);
+	t->regs.stride = 1;
+	t->regs.read_byte = tcpci_emul_read_byte;
+	t->regs.write_byte = tcpci_emul_write_byte;
+	t->ops = ops;
+
+	i2c_emul_tcpci_reset(t);
+}
+
+void i2c_emul_tcpci_reset(struct i2c_emul_tcpci *t)
+{
+	struct i2c_emul_regs *r = &t->regs;
+
+	memset(t->map + TCPCI_EMUL_ID_SIZE, 0,
+	       sizeof(t->map) - TCPCI_EMUL_ID_SIZE);
+	t->rx_head = 0;
+	t->rx_cnt = 0;
+
+	/* Type-C 1.3, PD 3.0 version 1.2, TCPCI 2.0 version 1.1 */
+	i2c_emul_regs_set16(r, TCPC_REG_TC_REV, 0x0013);
+	i2c_emul_regs_set16(r, TCPC_REG_PD_REV, 0x3012);
+	i2c_emul_regs_set16(r, TCPC_REG_PD_INT_REV, 0x2011);
+	i2c_emul_regs_set16(r, TCPC_REG_ALERT_MASK, 0x7fff);
+	t->map[TCPC_REG_POWER_STATUS_MASK] = 0xff;
+	t->map[TCPC_REG_FAULT_STATUS_MASK] = 0xff;
+	t->map[TCPC_REG_EXT_STATUS_MASK] = 0x01;
+	t->map[TCPC_REG_ALERT_EXTENDED_MASK] = 0x07;
+	t->map[TCPC_REG_CONFIG_STD_OUTPUT] =
+		TCPC_REG_CONFIG_STD_OUTPUT_AUDIO_CONN_N |
+		TCPC_REG_CONFIG_STD_OUTPUT_DBG_ACC_CONN_N;
+	t->map[TCPC_REG_POWER_CTRL] =
+		TCPC_REG_POWER_CTRL_VOLT_ALARM_DIS |
+		TCPC_REG_POWER_CTRL_VBUS_VOL_MONITOR_DIS;
+	i2c_emul_regs_set16(r, TCPC_REG_DEV_CAP_1,
+			    TCPC_REG_DEV_CAP_1_SOURCE_VBUS |
+			    TCPC_REG_DEV_CAP_1_SINK_VBUS |
+			    TCPC_REG_DEV_CAP_1_PWRROLE_SRC_SNK_DRP |
+			    TCPC_REG_DEV_CAP_1_SRC_RESISTOR_RP_3P0_1P5_DEF);
+	/* Rd on both CC lines, Rp default */
+	t->map[TCPC_REG_ROLE_CTRL] = 0x4a;
+	t->map[TCPC_REG_MSG_HDR_INFO] = 0x04;
+}
+
+void i2c_emul_tcpci_alert(struct i2c_emul_tcpci *t, uint16_t alert)
+{
+	i2c_emul_regs_set16(&t->regs, TCPC_REG_ALERT,
+			    i2c_emul_regs_get16(&t->regs, TCPC_REG_ALERT) |
+			    alert);
+
+	if (t->ops && t->ops->alert)
+		t->ops->alert(t);
+}
+
+void i2c_emul_tcpci_set_status(struct i2c_emul_tcpci *t, int reg,
+			       uint8_t val)
+{
+	uint8_t changed = t->map[reg] ^ val;
+
+	t->map[reg] = val;
+
+	switch (reg) {
+	case TCPC_REG_CC_STATUS:
+		if (changed)
+			i2c_emul_tcpci_alert(t, TCPC_REG_ALERT_CC_STATUS);
+		break;
+	case TCPC_REG_POWER_STATUS:
+		if (changed & t->map[TCPC_REG_POWER_STATUS_MASK])
+			i2c_emul_tcpci_alert(t, TCPC_REG_ALERT_POWER_STATUS);
+		break;
+	case TCPC_REG_EXT_STATUS:
+		if (changed & t->map[TCPC_REG_EXT_STATUS_MASK])
+			i2c_emul_tcpci_alert(t, TCPC_REG_ALERT_EXT_STATUS);
+		break;
+	}
+}
+
+int i2c_emul_tcpci_receive(struct i2c_emul_tcpci *t, int type,
+			   const uint8_t *msg, int len)
+{
+	uint8_t *buf;
+
+	if (!(t->map[TCPC_REG_RX_DETECT] & BIT(type)) ||
+	    t->rx_cnt == I2C_EMUL_TCPCI_RX_DEPTH)
+		return EC_ERROR_BUSY;
+	if (len + 2 > I2C_EMUL_TCPCI_MSG_SIZE)
+		return EC_ERROR_OVERFLOW;
+
+	buf = t->rx[(t->rx_head + t->rx_cnt) % I2C_EMUL_TCPCI_RX_DEPTH];
+	memset(buf, 0, I2C_EMUL_TCPCI_MSG_SIZE);
+	/* The readable byte count includes the frame type */
+	buf[0] = len + 1;
+	buf[1] = type;
+	memcpy(&buf[2], msg, len);
+	t->rx_cnt++;
+
+	i2c_emul_tcpci_alert(t, TCPC_REG_ALERT_RX_STATUS);
+
+	return EC_SUCCESS;
+}
+
+int i2c_emul_tcpci_receive_hard_reset(struct i2c_emul_tcpci *t)
+{
+	if (!(t->map[TCPC_REG_RX_DETECT] & TCPCI_EMUL_RX_DETECT_HRST))
+		return EC_ERROR_BUSY;
+
+	t->rx_cnt = 0;
+	i2c_emul_tcpci_alert(t, TCPC_REG_ALERT_RX_HARD_RST);
+
+	return EC_SUCCESS;
+}
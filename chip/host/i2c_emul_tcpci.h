@@ -0,0 +1,114 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * TCPCI TCPC emulator for host tests.
+ */
+
+#ifndef __CROS_EC_I2C_EMUL_TCPCI_H
+#define __CROS_EC_I2C_EMUL_TCPCI_H
+
+#include "i2c_emul.h"
+
+/* Readable byte count, frame type, header and 7 data objects */
+#define I2C_EMUL_TCPCI_MSG_SIZE 32
+/* TCPCI allows the TCPC to buffer up to three received messages */
+#define I2C_EMUL_TCPCI_RX_DEPTH 3
+
+struct i2c_emul_tcpci;
+
+/*
+ * What happens on the wire is left to the test: the emulator calls these
+ * once the TCPM has written a register acting on the CC lines or on the
+ * bus. All of them are optional.
+ */
+struct i2c_emul_tcpci_ops {
+	/* ROLE_CONTROL or COMMAND was written */
+	void (*control)(struct i2c_emul_tcpci *t, int reg, uint8_t val);
+	/*
+	 * TRANSMIT was written, with the message in @tx. The test completes
+	 * the transmission by raising the TX alerts.
+	 */
+	void (*transmit)(struct i2c_emul_tcpci *t, uint8_t transmit);
+	/* Alert bits were raised */
+	void (*alert)(struct i2c_emul_tcpci *t);
+};
+
+/*
+ * Register map of a TCPCI TCPC, answering the tcpci driver like a real
+ * chip:
+ * - ALERT, ALERT_EXTENDED and FAULT_STATUS are write one to clear, and
+ *   clearing ALERT.ReceiveSOPMessageStatus pops the message read from
+ *   RX_BUFFER.
+ * - The identification and status registers are read only, tests change
+ *   the status with i2c_emul_tcpci_set_status().
+ * - ROLE_CONTROL, COMMAND and TRANSMIT are passed on to @ops.
+ * The registers reset to the values of a TCPCI 2.0 TCPC able to source and
+ * sink VBUS, and to toggle.
+ */
+struct i2c_emul_tcpci {
+	struct i2c_emul_regs regs;
+	uint8_t map[256];
+
+	const struct i2c_emul_tcpci_ops *ops;
+
+	/* TX_BUFFER: byte count, header and data */
+	uint8_t tx[I2C_EMUL_TCPCI_MSG_SIZE];
+	/* Received messages, as read from RX_BUFFER */
+	uint8_t rx[I2C_EMUL_TCPCI_RX_DEPTH][I2C_EMUL_TCPCI_MSG_SIZE];
+	int rx_head;
+	int rx_cnt;
+};
+
+/**
+ * Set up an emulator for a TCPC, and reset it. It still has to be attached
+ * to the bus with i2c_emul_register().
+ */
+void i2c_emul_tcpci_init(struct i2c_emul_tcpci *t, int port,
+			 uint16_t addr_flags,
+			 const struct i2c_emul_tcpci_ops *ops);
+
+/**
+ * Reset the TCPC registers to their power on values, and drop the received
+ * messages. VENDOR_ID, PRODUCT_ID and DEVICE_ID are kept, tests set them
+ * after i2c_emul_tcpci_init().
+ */
+void i2c_emul_tcpci_reset(struct i2c_emul_tcpci *t);
+
+/**
+ * Raise alert bits.
+ */
+void i2c_emul_tcpci_alert(struct i2c_emul_tcpci *t, uint16_t alert);
+
+/**
+ * Change a read only status register. The matching alert is raised if the
+ * value changes, and for the power and extended status, if a changed bit is
+ * not masked.
+ *
+ * @param reg TCPC_REG_CC_STATUS, TCPC_REG_POWER_STATUS or
+ * TCPC_REG_EXT_STATUS.
+ */
+void i2c_emul_tcpci_set_status(struct i2c_emul_tcpci *t, int reg,
+			       uint8_t val);
+
+/**
+ * Receive a message, raising ALERT.ReceiveSOPMessageStatus.
+ *
+ * @param type Frame type, TCPC_TX_SOP...
+ * @param msg Header and data.
+ * @param len Size of @msg in bytes.
+ * @return EC_SUCCESS, EC_ERROR_BUSY if the TCPC does not listen to @type or
+ * has no room left, EC_ERROR_OVERFLOW if the message is too long.
+ */
+int i2c_emul_tcpci_receive(struct i2c_emul_tcpci *t, int type,
+			   const uint8_t *msg, int len);
+
+/**
+ * Receive a hard reset, raising ALERT.ReceivedHardReset.
+ *
+ * @return EC_SUCCESS, or EC_ERROR_BUSY if the TCPC does not listen to hard
+ * resets.
+ */
+int i2c_emul_tcpci_receive_hard_reset(struct i2c_emul_tcpci *t);
+
+#endif /* __CROS_EC_I2C_EMUL_TCPCI_H */
@@ -5,10 +5,67 @@
 
 /* Persistence module for emulator */
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <linux/limits.h>
-#include <unistd.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define STORAGE_DIR "/dev/shm/"
+
+/* Set in the environment of the emulator exec'ing itself to reboot */
+#define REBOOT_ENV "EC_PERSIST_REBOOT"
+
+/*
+ * Name prefix of the persistent storage of this executable, and of this
+ * instance of it.
+ */
+static char exe_prefix[PATH_MAX];
+static char instance_prefix[PATH_MAX];
+
+/* Remove the storage of the instances of this executable which are gone */
+static void remove_stale_storage(int all_of_this_instance)
+{
+	DIR *dir = opendir(STORAGE_DIR);
+	struct dirent *ent;
+	size_t len = strlen(exe_prefix);
+	char path[PATH_MAX];
+	char *end;
+	long pid;
+
+	if (!dir)
+		return;
+
+	while ((ent = readdir(dir)) != NULL) {
+		if (strncmp(ent->d_name, exe_prefix, len))
+			continue;
+
+		pid = strtol(ent->d_name + len, &end, 10);
+		if (*end != '_')
+			continue;
+		if (pid == getpid()) {
+			if (!all_of_this_instance)
+				continue;
+		} else if (pid <= 0 || !kill(pid, 0) || errno != ESRCH) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), STORAGE_DIR "%s", ent->d_name);
+		unlink(path);
+	}
+
+	closedir(dir);
+}
+
+static void remove_instance_storage(void)
+{
+	remove_stale_storage(1);
+}
 
 static void get_storage_path(char *out)
 {
@@ -16,32 +73,64 @@ static void get_storage_path(char *out)
 	int sz;
 	char *current;
 
-	sz = readlink("/proc/self/exe", buf, PATH_MAX - 1);
-	buf[sz] = '\0';
+	if (!instance_prefix[0]) {
+		sz = readlink("/proc/self/exe", buf, PATH_MAX - 1);
+		buf[sz] = '\0';
+
+		/*
+		 * replace / by underscores in the path to get the shared
+		 * memory name
+		 */
+		current = strchr(buf, '/');
+		while (current) {
+			*current = '_';
+			current = strchr(current, '/');
+		}
 
-	/* replace / by underscores in the path to get the shared memory name */
-	current = strchr(buf, '/');
-	while (current) {
-		*current = '_';
-		current = strchr(current, '/');
+		/*
+		 * Each instance has its own storage, so that tests can run in
+		 * parallel.  The pid is kept when the emulator reboots, by
+		 * exec'ing itself, so the storage persists across reboots.
+		 * It is removed on exit, and left over storage of instances
+		 * which were killed is removed on start. On a cold start, that
+		 * includes storage left with our pid, by a gone instance which
+		 * had it before.
+		 */
+		snprintf(exe_prefix, PATH_MAX - 1, "EC_persist_%s_", buf);
+		snprintf(instance_prefix, PATH_MAX - 1, "%s%d", exe_prefix,
+			 getpid());
+		remove_stale_storage(!getenv(REBOOT_ENV));
+		unsetenv(REBOOT_ENV);
+		atexit(remove_instance_storage);
 	}
 
-	snprintf(out, PATH_MAX - 1, "/dev/shm/EC_persist_%s", buf);
+	snprintf(out, PATH_MAX - 1, STORAGE_DIR "%s", instance_prefix);
 	out[PATH_MAX - 1] = '\0';
 }
 
-FILE *get_persistent_storage(const char *tag, const char *mode)
+static void get_tag_path(const char *tag, char *path)
 {
 	char buf[PATH_MAX];
-	char path[PATH_MAX];
 
 	/*
 	 * The persistent storage with tag 'foo' for test 'bar' would
-	 * be named 'bar_persist_foo'
+	 * be named 'bar_<pid>_foo'
 	 */
 	get_storage_path(buf);
 	snprintf(path, PATH_MAX - 1, "%s_%s", buf, tag);
 	path[PATH_MAX - 1] = '\0';
+}
+
+void keep_persistent_storage_on_exec(void)
+{
+	setenv(REBOOT_ENV, "1", 1);
+}
+
+FILE *get_persistent_storage(const char *tag, const char *mode)
+{
+	char path[PATH_MAX];
+
+	get_tag_path(tag, path);
 
 	return fopen(path, mode);
 }
@@ -53,12 +142,35 @@ void release_persistent_storage(FILE *ps)
 
 void remove_persistent_storage(const char *tag)
 {
-	char buf[PATH_MAX];
 	char path[PATH_MAX];
 
-	get_storage_path(buf);
-	snprintf(path, PATH_MAX - 1, "%s_%s", buf, tag);
-	path[PATH_MAX - 1] = '\0';
+	get_tag_path(tag, path);
 
 	unlink(path);
 }
+
+void *map_persistent_storage(const char *tag, size_t size, int *created)
+{
+	char path[PATH_MAX];
+	void *ptr;
+	int fd;
+
+	get_tag_path(tag, path);
+
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	*created = fd >= 0;
+	if (fd < 0)
+		fd = open(path, O_RDWR);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, size)) {
+		close(fd);
+		return NULL;
+	}
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	return ptr == MAP_FAILED ? NULL : ptr;
+}
@@ -8,6 +8,7 @@
 #ifndef __CROS_EC_PERSISTENCE_H
 #define __CROS_EC_PERSISTENCE_H
 
+#include <stddef.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -20,6 +21,23 @@ void release_persistent_storage(FILE *ps);
 
 void remove_persistent_storage(const char *tag);
 
+/*
+ * Keep the persistent storage of this instance for the emulator exec'ing
+ * itself to reboot.  Any other start, even with the same pid, begins with
+ * empty storage.
+ */
+void keep_persistent_storage_on_exec(void);
+
+/*
+ * Map size bytes of the persistent storage with tag, shared with the
+ * storage so that writes to the mapping persist.  The storage is created
+ * zero-filled if it does not exist yet, which *created is set to tell.
+ * The mapping is kept until the emulator exits or reboots.
+ *
+ * Returns NULL on failure.
+ */
+void *map_persistent_storage(const char *tag, size_t size, int *created);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,7 @@
 
 #include "console.h"
 #include "host_test.h"
+#include "persistence.h"
 #include "reboot.h"
 #include "test_util.h"
 
@@ -25,6 +26,7 @@ void emulator_reboot(void)
 {
 	char *argv[] = {strdup(__get_prog_name()), NULL};
 	emulator_flush();
+	keep_persistent_storage_on_exec();
 	execv(__get_prog_name(), argv);
 	while (1)
 		;
@@ -111,6 +111,19 @@ void uart_write_char(char c)
 	fflush(stdout);
 }
 
+__override int uart_write_buf(const char *buf, int len)
+{
+	int i;
+
+	if (capture_enabled)
+		for (i = 0; i < len; i++)
+			test_capture_char(buf[i]);
+	fwrite(buf, 1, len, stdout);
+	fflush(stdout);
+
+	return len;
+}
+
 int uart_read_char(void)
 {
 	char ret;
@@ -90,6 +90,22 @@ void uart_write_char(char c)
 	MEC1322_UART_TB = c;
 }
 
+__override int uart_write_buf(const char *buf, int len)
+{
+	int i;
+
+	if (!uart_tx_ready())
+		return 0;
+
+	/* Fill the room left since the transmit FIFO was last empty */
+	len = MIN(len, TX_FIFO_SIZE - tx_fifo_used);
+	for (i = 0; i < len; i++)
+		MEC1322_UART_TB = buf[i];
+	tx_fifo_used = (tx_fifo_used + len) % TX_FIFO_SIZE;
+
+	return len;
+}
+
 int uart_read_char(void)
 {
 	return MEC1322_UART_RB;
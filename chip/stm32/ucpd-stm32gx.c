@@ -1082,7 +1082,7 @@ void stm32gx_ucpd1_irq(void)
 
 	/* Check for CC events, set event to wake PD task */
 	if (sr & (STM32_UCPD_SR_TYPECEVT1 | STM32_UCPD_SR_TYPECEVT2)) {
-		task_set_event(PD_PORT_TO_TASK_ID(port), PD_EVENT_CC);
+		pd_task_set_event(port, PD_EVENT_CC);
 #ifdef CONFIG_STM32G4_UCPD_DEBUG
 		ucpd_sr_cc_event = sr;
 		hook_call_deferred(&ucpd_cc_change_notify_data, 0);
@@ -1173,7 +1173,7 @@ void stm32gx_ucpd1_irq(void)
 	if (sr & STM32_UCPD_SR_RXHRSTDET) {
 		/* hard reset received */
 		pd_execute_hard_reset(port);
-		task_set_event(PD_PORT_TO_TASK_ID(port), TASK_EVENT_WAKE);
+		pd_task_wake(port);
 		hook_call_deferred(&ucpd_hard_reset_rx_log_data, 0);
 	}
 
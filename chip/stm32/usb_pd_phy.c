@@ -303,6 +303,7 @@ static void tx_dma_done(void *data)
 	pd_tx_disable(port, polarity);
 
 #if defined(CONFIG_COMMON_RUNTIME) && defined(CONFIG_DMA_DEFAULT_HANDLERS)
+	/* Wake pd_tx_done(), which blocks the PD task itself */
 	task_set_event(PD_PORT_TO_TASK_ID(port), TASK_EVENT_DMA_TC);
 #endif
 }
@@ -456,7 +457,7 @@ void pd_rx_handler(void)
 #ifdef CONFIG_USB_CTVPD
 	/* Charge-Through Side detach event */
 	if (pending & EXTI_COMP2_MASK) {
-		task_wake(PD_PORT_TO_TASK_ID(0));
+		pd_task_wake(0);
 		/* Clear interrupt */
 		STM32_EXTI_PR = EXTI_COMP2_MASK;
 		pending &= ~EXTI_COMP2_MASK;
@@ -10,6 +10,7 @@
 #include "lid_switch.h"
 #include "math_util.h"
 #include "motion_sense_fifo.h"
+#include "stream_stats.h"
 #include "timer.h"
 
 /* Console output macros */
@@ -21,56 +22,38 @@ static struct motion_sensor_t *body_sensor =
 	&motion_sensors[CONFIG_BODY_DETECTION_SENSOR];
 
 static int window_size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
+/* Duration of the variance window, may be changed by the board at runtime. */
+static int window_duration_ms = 1000;
+/* Number of samples per second at the current ODR. */
+static int samples_per_sec = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
 static uint64_t var_threshold_scaled, confidence_delta_scaled;
 static int stationary_timeframe;
 
-static int history_idx;
 static enum body_detect_states motion_state = BODY_DETECTION_OFF_BODY;
 
-static bool history_initialized;
 static bool body_detect_enable;
 STATIC_IF(CONFIG_ACCEL_SPOOF_MODE) bool spoof_enable;
 
-static struct body_detect_motion_data
-{
-	int history[CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE]; /* acceleration */
-	int sum;              /* sum(history) */
-	uint64_t n2_variance; /* n^2 * var(history) */
-} data[2]; /* motion data for X-axis and Y-axis */
-
-/*
- * This function will update new variance and new sum according to incoming
- * value, previous value, previous sum and previous variance.
- * In order to prevent inaccuracy, we use integer to calculate instead of float
- *
- * n: window size
- * x: data in the old window
- * x': data in the new window
- * x_0: oldest value in the window, will be replaced by x_n
- * x_n: new coming value
- *
- * n^2 * var(x') = n^2 * var(x) + (x_n - x_0) *
- *                 (n * (x_n + x_0) - sum(x') - sum(x))
- */
-static void update_motion_data(struct body_detect_motion_data *x, int x_n)
-{
-	const int n = window_size;
-	const int x_0 = x->history[history_idx];
-	const int sum_diff = x_n - x_0;
-	const int new_sum = x->sum + sum_diff;
-
-	x->n2_variance += sum_diff *
-			  ((int64_t)n * (x_n + x_0) - new_sum - x->sum);
-	x->sum = new_sum;
-	x->history[history_idx] = x_n;
-}
+/* acceleration history for X-axis and Y-axis */
+static int16_t history[2][CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE];
+static struct stream_window data[2] = {
+	[X] = {
+		.history = history[X],
+		.capacity = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE,
+		.size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE,
+	},
+	[Y] = {
+		.history = history[Y],
+		.capacity = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE,
+		.size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE,
+	},
+};
 
 /* Update motion data of X, Y with new sensor data. */
 static void update_motion_variance(void)
 {
-	update_motion_data(&data[X], body_sensor->xyz[X]);
-	update_motion_data(&data[Y], body_sensor->xyz[Y]);
-	history_idx = (history_idx + 1 >= window_size) ? 0 : history_idx + 1;
+	stream_window_update(&data[X], body_sensor->xyz[X]);
+	stream_window_update(&data[Y], body_sensor->xyz[Y]);
 }
 
 /* return Var(X) + Var(Y) */
@@ -124,16 +107,18 @@ enum body_detect_states body_detect_get_state(void)
 	return motion_state;
 }
 
-/* Determine window size for 1 second by sensor data rate. */
+/* Determine window size for window_duration_ms by sensor data rate. */
 static void determine_window_size(int odr)
 {
-	window_size = odr / 1000;
+	samples_per_sec = MAX(odr / 1000, 1);
+	window_size = (int64_t)odr * window_duration_ms / 1000000;
 	/* Normally, window_size should not exceed MAX_WINDOW_SIZE. */
 	if (window_size > CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE) {
-		/* This will cause window size not enough for 1 second */
+		/* This will cause window size not enough for the duration */
 		CPRINTS("ODR exceeds CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE");
-		window_size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
 	}
+	window_size = stream_window_reset(&data[X], window_size);
+	stream_window_reset(&data[Y], window_size);
 }
 
 /* Determine variance threshold scale by range and resolution. */
@@ -184,13 +169,10 @@ void body_detect_reset(void)
 	 */
 	if (odr == 0)
 		return;
+	/* initialize motion data and state */
 	determine_window_size(odr);
 	determine_threshold_scale(body_sensor->current_range,
 				  resolution, rms_noise);
-	/* initialize motion data and state */
-	memset(data, 0, sizeof(data));
-	history_idx = 0;
-	history_initialized = 0;
 }
 
 void body_detect(void)
@@ -202,11 +184,8 @@ void body_detect(void)
 		return;
 
 	update_motion_variance();
-	if (!history_initialized) {
-		if (history_idx == window_size - 1)
-			history_initialized = 1;
+	if (!stream_window_full(&data[X]))
 		return;
-	}
 
 	motion_var = get_motion_variance();
 	motion_confidence = calculate_motion_confidence(motion_var);
@@ -221,8 +200,8 @@ void body_detect(void)
 		if (motion_confidence >= CONFIG_BODY_DETECTION_OFF_BODY_CON)
 			stationary_timeframe = 0;
 		/* if no motion for enough time, change state to off_body */
-		if (stationary_timeframe >=
-		    CONFIG_BODY_DETECTION_STATIONARY_DURATION * window_size)
+		if (stationary_timeframe >= samples_per_sec *
+		    CONFIG_BODY_DETECTION_STATIONARY_DURATION)
 			body_detect_change_state(BODY_DETECTION_OFF_BODY,
 						 false);
 		break;
@@ -240,6 +219,17 @@ int body_detect_get_enable(void)
 	return body_detect_enable;
 }
 
+void body_detect_set_window_duration(int duration_ms)
+{
+	window_duration_ms = MAX(duration_ms, 1);
+	body_detect_reset();
+}
+
+int body_detect_get_window_duration(void)
+{
+	return window_duration_ms;
+}
+
 #ifdef CONFIG_ACCEL_SPOOF_MODE
 void body_detect_set_spoof(int enable)
 {
@@ -19,6 +19,7 @@ common-$(CONFIG_ACCELGYRO_LSM6DS0)+=math_util.o
 common-$(CONFIG_ACCELGYRO_LSM6DSM)+=math_util.o
 common-$(CONFIG_ACCELGYRO_LSM6DSO)+=math_util.o
 common-$(CONFIG_ACCEL_FIFO)+=motion_sense_fifo.o
+common-$(CONFIG_ACCEL_READ_PLAN)+=motion_sense_read_plan.o
 common-$(CONFIG_ACCEL_BMA255)+=math_util.o
 common-$(CONFIG_ACCEL_LIS2DW12)+=math_util.o
 common-$(CONFIG_ACCEL_LIS2DH)+=math_util.o
@@ -44,7 +45,7 @@ common-$(CONFIG_BATTERY)+=battery.o
 common-$(CONFIG_BATTERY_FUEL_GAUGE)+=battery_fuel_gauge.o
 common-$(CONFIG_BLUETOOTH_LE)+=bluetooth_le.o
 common-$(CONFIG_BLUETOOTH_LE_STACK)+=btle_hci_controller.o btle_ll.o
-common-$(CONFIG_BODY_DETECTION)+=body_detection.o
+common-$(CONFIG_BODY_DETECTION)+=body_detection.o stream_stats.o
 common-$(CONFIG_CAPSENSE)+=capsense.o
 common-$(CONFIG_CEC)+=cec.o
 common-$(CONFIG_CROS_BOARD_INFO)+=cbi.o
@@ -83,10 +84,12 @@ common-$(CONFIG_HOSTCMD_GET_UPTIME_INFO)+=uptime.o
 common-$(CONFIG_HOSTCMD_PD)+=host_command_controller.o
 common-$(CONFIG_HOSTCMD_REGULATOR)+=regulator.o
 common-$(CONFIG_HOSTCMD_RTC)+=rtc.o
+common-$(CONFIG_I2C_ASYNC)+=i2c_async.o
 common-$(CONFIG_I2C_DEBUG)+=i2c_trace.o
 common-$(CONFIG_I2C_HID_TOUCHPAD)+=i2c_hid_touchpad.o
 common-$(CONFIG_I2C_CONTROLLER)+=i2c_controller.o
 common-$(CONFIG_I2C_PERIPHERAL)+=i2c_peripheral.o
+common-$(CONFIG_I2C_REG_CACHE)+=i2c_reg_cache.o
 common-$(CONFIG_I2C_BITBANG)+=i2c_bitbang.o
 common-$(CONFIG_I2C_VIRTUAL_BATTERY)+=virtual_battery.o
 common-$(CONFIG_INDUCTIVE_CHARGING)+=inductive_charging.o
@@ -124,7 +127,8 @@ common-$(CONFIG_RWSIG_TYPE_RWSIG)+=vboot/vb21_lib.o
 common-$(CONFIG_MATH_UTIL)+=math_util.o
 common-$(CONFIG_ONLINE_CALIB)+=stillness_detector.o kasa.o math_util.o \
 	mat44.o vec3.o newton_fit.o accel_cal.o online_calibration.o \
-	mkbp_event.o mag_cal.o math_util.o mat33.o gyro_cal.o gyro_still_det.o
+	mkbp_event.o mag_cal.o math_util.o mat33.o gyro_cal.o gyro_still_det.o \
+	stream_stats.o
 common-$(CONFIG_SHA1)+= sha1.o
 ifeq ($(CONFIG_SHA256),y)
 # use the standard software SHA256 lib if the chip cannot support SHA256
@@ -6,6 +6,8 @@
 /* Console output module for Chrome EC */
 
 #include "console.h"
+#include "link_defs.h"
+#include "timer.h"
 #include "uart.h"
 #include "usb_console.h"
 #include "util.h"
@@ -78,7 +80,7 @@ int cprintf(enum console_channel channel, const char *format, ...)
 	return rv1 == EC_SUCCESS ? rv2 : rv1;
 }
 
-int cprints(enum console_channel channel, const char *format, ...)
+int (cprints)(enum console_channel channel, const char *format, ...)
 {
 	int r, rv;
 	va_list args;
@@ -107,6 +109,157 @@ int cprints(enum console_channel channel, const char *format, ...)
 	return r ? r : rv;
 }
 
+#ifdef CONFIG_CONSOLE_TOKENIZED
+/*
+ * A tokenized record is printed as a line of '$' and the base64 of:
+ *
+ *   token		varint
+ *   time		zigzag varint, in us
+ *   arguments		for each argument, in order:
+ *     integer, pointer	zigzag varint
+ *     %pT		zigzag varint of the time, 0 for PRINTF_TIMESTAMP_NOW
+ *     %s, %ph		varint length, then the bytes
+ *     %pb		zigzag varints of the value and the digit count
+ *
+ * The token is the offset of the format string in .tokenized_fmt, shifted
+ * left by one, with bit 0 set in RW. Records are cut short when they do not
+ * fit.
+ */
+#define TOKENIZED_RECORD_MAX 96
+/* Longest string or hex buffer in a record */
+#define TOKENIZED_BYTES_MAX 32
+
+BUILD_ASSERT(TOKENIZED_TYPE_SHIFT(TOKENIZED_MAX_ARGS) <= 32);
+
+struct tokenized_record {
+	uint8_t data[TOKENIZED_RECORD_MAX];
+	int len;
+	int truncated;
+};
+
+static void put_varint(struct tokenized_record *r, uint64_t v)
+{
+	do {
+		if (r->len == sizeof(r->data)) {
+			r->truncated = 1;
+			return;
+		}
+		r->data[r->len++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+		v >>= 7;
+	} while (v);
+}
+
+static void put_int(struct tokenized_record *r, int64_t v)
+{
+	put_varint(r, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void put_bytes(struct tokenized_record *r, const void *data, int len)
+{
+	len = MIN(len, TOKENIZED_BYTES_MAX);
+	put_varint(r, len);
+	if (len > sizeof(r->data) - r->len) {
+		r->truncated = 1;
+		len = sizeof(r->data) - r->len;
+	}
+	memcpy(r->data + r->len, data, len);
+	r->len += len;
+}
+
+/* Returns the end of the output */
+static char *base64_encode(char *dest, const uint8_t *src, int len)
+{
+	static const char digits[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+		"0123456789+/";
+	uint32_t v;
+	int i;
+
+	for (i = 0; i < len; i += 3) {
+		v = src[i] << 16;
+		if (i + 1 < len)
+			v |= src[i + 1] << 8;
+		if (i + 2 < len)
+			v |= src[i + 2];
+		*dest++ = digits[v >> 18];
+		*dest++ = digits[(v >> 12) & 0x3f];
+		*dest++ = i + 1 < len ? digits[(v >> 6) & 0x3f] : '=';
+		*dest++ = i + 2 < len ? digits[v & 0x3f] : '=';
+	}
+	return dest;
+}
+
+int cprints_tokenized(enum console_channel channel, const char *format,
+		      uint32_t types, ...)
+{
+	struct tokenized_record r = { .len = 0 };
+	/* '$', base64, newline and terminator */
+	char line[1 + DIV_ROUND_UP(TOKENIZED_RECORD_MAX, 3) * 4 + 2];
+	char *end;
+	int count = types & 0xf;
+	const struct hex_buffer_params *hex;
+	const struct binary_print_params *bin;
+	const uint64_t *time;
+	const char *str;
+	va_list args;
+	int rv;
+	int i;
+
+#ifdef CONFIG_CONSOLE_CHANNEL
+	/* Filter out inactive channels */
+	if (!(CC_MASK(channel) & channel_mask))
+		return EC_SUCCESS;
+#endif
+
+	put_varint(&r, (format - __tokenized_fmt_start) << 1 |
+		       IS_ENABLED(SECTION_IS_RW));
+	put_int(&r, get_time().val);
+
+	va_start(args, types);
+	for (i = 0; i < count; i++) {
+		switch ((types >> TOKENIZED_TYPE_SHIFT(count - 1 - i)) & 7) {
+		case TOKENIZED_ARG_32:
+			put_int(&r, va_arg(args, int));
+			break;
+		case TOKENIZED_ARG_64:
+			put_int(&r, va_arg(args, int64_t));
+			break;
+		case TOKENIZED_ARG_STR:
+			str = va_arg(args, const char *);
+			if (str == NULL)
+				str = "(NULL)";
+			put_bytes(&r, str, strlen(str));
+			break;
+		case TOKENIZED_ARG_PTR:
+			put_int(&r, (uintptr_t)va_arg(args, void *));
+			break;
+		case TOKENIZED_ARG_TIME:
+			time = va_arg(args, const uint64_t *);
+			put_int(&r, time ? *time : 0);
+			break;
+		case TOKENIZED_ARG_HEX:
+			hex = va_arg(args, const struct hex_buffer_params *);
+			put_bytes(&r, hex->buffer, hex->size);
+			break;
+		case TOKENIZED_ARG_BIN:
+			bin = va_arg(args, const struct binary_print_params *);
+			put_int(&r, bin->value);
+			put_int(&r, bin->count);
+			break;
+		}
+	}
+	va_end(args);
+
+	line[0] = '$';
+	end = base64_encode(line + 1, r.data, r.len);
+	*end++ = '\n';
+	*end = '\0';
+
+	rv = cputs(channel, line);
+	return rv ? rv : (r.truncated ? EC_ERROR_OVERFLOW : EC_SUCCESS);
+}
+#endif /* CONFIG_CONSOLE_TOKENIZED */
+
 void cflush(void)
 {
 	uart_flush_output();
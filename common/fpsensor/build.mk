@@ -11,3 +11,4 @@ all-obj-$(HAS_TASK_FPSENSOR)+=$(_fpsensor_dir)fpsensor_state.o
 all-obj-$(HAS_TASK_FPSENSOR)+=$(_fpsensor_dir)fpsensor_crypto.o
 all-obj-$(HAS_TASK_FPSENSOR)+=$(_fpsensor_dir)fpsensor.o
 all-obj-$(HAS_TASK_CONSOLE)+=$(_fpsensor_dir)fpsensor_detect_strings.o
+all-obj-$(CONFIG_FP_FRAME_COMPRESSION)+=$(_fpsensor_dir)fpsensor_frame_codec.o
@@ -12,6 +12,7 @@
 #include "fpsensor.h"
 #include "fpsensor_crypto.h"
 #include "fpsensor_detect.h"
+#include "fpsensor_frame_codec.h"
 #include "fpsensor_private.h"
 #include "fpsensor_state.h"
 #include "gpio.h"
@@ -375,6 +376,35 @@ int validate_fp_buffer_offset(const uint32_t buffer_size, const uint32_t offset,
 	return EC_SUCCESS;
 }
 
+#ifdef CONFIG_FP_FRAME_COMPRESSION
+static enum ec_status fp_frame_encoded(struct host_cmd_handler_args *args,
+				       uint32_t offset, uint32_t size)
+{
+	struct ec_response_fp_frame_v1 *r = args->response;
+	size_t max, len, used;
+
+	if (args->response_max <= sizeof(*r))
+		return EC_RES_INVALID_PARAM;
+	max = args->response_max - sizeof(*r);
+
+	len = fp_frame_encode(fp_buffer + offset, size, r->data, max, &used);
+	r->encoding = FP_FRAME_ENCODING_DELTA_RLE;
+
+	/* Noisy pixels can take more room encoded than as they are */
+	if (used < MIN(size, max)) {
+		used = MIN(size, max);
+		memcpy(r->data, fp_buffer + offset, used);
+		len = used;
+		r->encoding = FP_FRAME_ENCODING_RAW;
+	}
+
+	r->size = used;
+	memset(r->reserved, 0, sizeof(r->reserved));
+	args->response_size = sizeof(*r) + len;
+	return EC_RES_SUCCESS;
+}
+#endif /* CONFIG_FP_FRAME_COMPRESSION */
+
 static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 {
 	const struct ec_params_fp_frame *params = args->params;
@@ -387,7 +417,8 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 	struct ec_fp_template_encryption_metadata *enc_info;
 	int ret;
 
-	if (size > args->response_max)
+	/* Version 1 returns as much of size as fits in the response */
+	if (args->version == 0 && size > args->response_max)
 		return EC_RES_INVALID_PARAM;
 
 	if (idx == FP_FRAME_INDEX_RAW_IMAGE) {
@@ -402,12 +433,19 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 		if (ret != EC_SUCCESS)
 			return EC_RES_INVALID_PARAM;
 
+#ifdef CONFIG_FP_FRAME_COMPRESSION
+		if (args->version == 1)
+			return fp_frame_encoded(args, offset, size);
+#endif
+
 		memcpy(out, fp_buffer + offset, size);
 		args->response_size = size;
 		return EC_RES_SUCCESS;
 	}
 
 	/* The host requested a template. */
+	if (args->version != 0)
+		return EC_RES_INVALID_PARAM;
 
 	/* Templates are numbered from 1 in this host request. */
 	fgr = idx - FP_FRAME_INDEX_TEMPLATE;
@@ -495,7 +533,12 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 
 	return EC_RES_SUCCESS;
 }
+#ifdef CONFIG_FP_FRAME_COMPRESSION
+DECLARE_HOST_COMMAND(EC_CMD_FP_FRAME, fp_command_frame,
+		     EC_VER_MASK(0) | EC_VER_MASK(1));
+#else
 DECLARE_HOST_COMMAND(EC_CMD_FP_FRAME, fp_command_frame, EC_VER_MASK(0));
+#endif
 
 static enum ec_status fp_command_stats(struct host_cmd_handler_args *args)
 {
@@ -0,0 +1,176 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Lossless encoding of 8-bit grayscale fingerprint frames.
+ *
+ * Each pixel is coded as its difference with the previous pixel (with 0 for
+ * the first one), and the differences are coded in runs with a one byte
+ * header:
+ *
+ *   0x00-0x3f: header + 1 differences follow, one per byte
+ *   0x40-0x7f: header - 0x3f bytes follow, each holding two differences in
+ *              [-8, 7], the first one in the high nibble
+ *   0x80-0xff: the next byte is a difference repeated (header & 0x7f) + 3
+ *              times
+ *
+ * Fingerprint frames are mostly made of small differences between
+ * neighbouring pixels, and of flat areas where no finger touches the sensor.
+ */
+
+#include "common.h"
+#include "fpsensor_frame_codec.h"
+
+#define HDR_LITERAL 0x00
+#define HDR_NIBBLE 0x40
+#define HDR_REPEAT 0x80
+
+#define LITERAL_MAX 64
+/* In bytes, i.e. pairs of differences */
+#define NIBBLE_MAX 64
+/* Shorter runs of differences that fit in a nibble are not worth a header */
+#define NIBBLE_MIN 2
+#define REPEAT_MIN 3
+#define REPEAT_MAX (0x7f + REPEAT_MIN)
+
+static inline size_t min_size(size_t a, size_t b)
+{
+	return a < b ? a : b;
+}
+
+static inline uint8_t diff(const uint8_t *src, size_t i)
+{
+	return src[i] - (i ? src[i - 1] : 0);
+}
+
+static inline int fits_nibble(uint8_t d)
+{
+	return (uint8_t)(d + 8) < 16;
+}
+
+/* Number of identical differences from i, up to max */
+static size_t repeat_len(const uint8_t *src, size_t i, size_t n, size_t max)
+{
+	uint8_t d = diff(src, i);
+	size_t len = 1;
+
+	while (i + len < n && len < max && diff(src, i + len) == d)
+		len++;
+
+	return len;
+}
+
+/*
+ * Number of differences from i that fit in a nibble, up to max, stopping
+ * where a repeat starts.
+ */
+static size_t nibble_len(const uint8_t *src, size_t i, size_t n, size_t max)
+{
+	size_t len = 0;
+
+	while (i + len < n && len < max && fits_nibble(diff(src, i + len)) &&
+	       repeat_len(src, i + len, n, REPEAT_MIN) < REPEAT_MIN)
+		len++;
+
+	return len;
+}
+
+/* Number of differences from i, up to max, stopping where a run starts */
+static size_t literal_len(const uint8_t *src, size_t i, size_t n, size_t max)
+{
+	size_t len = 1;
+
+	while (i + len < n && len < max &&
+	       repeat_len(src, i + len, n, REPEAT_MIN) < REPEAT_MIN &&
+	       nibble_len(src, i + len, n, 2 * NIBBLE_MIN) < 2 * NIBBLE_MIN)
+		len++;
+
+	return len;
+}
+
+size_t fp_frame_encode(const uint8_t *src, size_t src_size,
+		       uint8_t *dst, size_t dst_size, size_t *src_used)
+{
+	size_t i = 0;
+	size_t o = 0;
+	size_t len;
+	size_t k;
+
+	/* Each run needs a header and at least one byte */
+	while (i < src_size && o + 2 <= dst_size) {
+		len = repeat_len(src, i, src_size, REPEAT_MAX);
+		if (len >= REPEAT_MIN) {
+			dst[o++] = HDR_REPEAT | (len - REPEAT_MIN);
+			dst[o++] = diff(src, i);
+			i += len;
+			continue;
+		}
+
+		len = nibble_len(src, i, src_size, 2 * NIBBLE_MAX) / 2;
+		len = min_size(len, dst_size - o - 1);
+		if (len >= NIBBLE_MIN) {
+			dst[o++] = HDR_NIBBLE | (len - 1);
+			for (k = 0; k < len; k++, i += 2)
+				dst[o++] = (diff(src, i) << 4) |
+					   (diff(src, i + 1) & 0xf);
+			continue;
+		}
+
+		len = literal_len(src, i, src_size, LITERAL_MAX);
+		len = min_size(len, dst_size - o - 1);
+		dst[o++] = HDR_LITERAL | (len - 1);
+		for (k = 0; k < len; k++, i++)
+			dst[o++] = diff(src, i);
+	}
+
+	*src_used = i;
+	return o;
+}
+
+int fp_frame_decode(const uint8_t *src, size_t src_size,
+		    uint8_t *dst, size_t dst_size)
+{
+	uint8_t pixel = 0;
+	uint8_t hdr, d;
+	size_t i = 0;
+	size_t o = 0;
+	size_t len;
+
+	while (i < src_size) {
+		hdr = src[i++];
+
+		if (hdr & HDR_REPEAT) {
+			len = (hdr & 0x7f) + REPEAT_MIN;
+			if (i >= src_size || len > dst_size - o)
+				return -1;
+			d = src[i++];
+			while (len--) {
+				pixel += d;
+				dst[o++] = pixel;
+			}
+		} else if (hdr & HDR_NIBBLE) {
+			len = (hdr & 0x3f) + 1;
+			if (len > src_size - i || 2 * len > dst_size - o)
+				return -1;
+			while (len--) {
+				/* Sign extend each nibble */
+				pixel += (int8_t)src[i] >> 4;
+				dst[o++] = pixel;
+				pixel += (int8_t)(src[i++] << 4) >> 4;
+				dst[o++] = pixel;
+			}
+		} else {
+			len = hdr + 1;
+			if (len > src_size - i || len > dst_size - o)
+				return -1;
+			while (len--) {
+				pixel += src[i++];
+				dst[o++] = pixel;
+			}
+		}
+	}
+
+	return o;
+}
@@ -0,0 +1,246 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Asynchronous I2C transaction queue */
+
+#include "common.h"
+#include "i2c.h"
+#include "panic.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+#ifndef CONFIG_I2C_BITBANG
+#define I2C_BITBANG_PORT_COUNT 0
+#endif
+
+#define I2C_ASYNC_PORT_COUNT (I2C_PORT_COUNT + I2C_BITBANG_PORT_COUNT)
+
+/* Pending transactions of each port, in submission order. */
+static struct i2c_async_xfer *queue_head[I2C_ASYNC_PORT_COUNT];
+static struct i2c_async_xfer *queue_tail[I2C_ASYNC_PORT_COUNT];
+
+/* Transaction running on each port, until its completion is notified. */
+static struct i2c_async_xfer *volatile port_xfer[I2C_ASYNC_PORT_COUNT];
+
+/* Held by the port task while it runs a transaction, until notified. */
+static mutex_t port_run_lock[I2C_ASYNC_PORT_COUNT];
+
+/* Task serving each port, see i2c_async_task(). */
+static task_id_t port_task[I2C_ASYNC_PORT_COUNT] = {
+	[0 ... I2C_ASYNC_PORT_COUNT - 1] = TASK_ID_INVALID,
+};
+
+/* Unlink a queued transaction. Must be called with interrupts locked. */
+static void i2c_async_unlink(struct i2c_async_xfer *xfer)
+{
+	const int port = xfer->port;
+	struct i2c_async_xfer **prev = &queue_head[port];
+	struct i2c_async_xfer *last = NULL;
+
+	while (*prev != xfer) {
+		last = *prev;
+		prev = &last->next;
+	}
+
+	*prev = xfer->next;
+	if (queue_tail[port] == xfer)
+		queue_tail[port] = last;
+}
+
+/* Drop a transaction which did not reach the bus yet. */
+static int i2c_async_drop(struct i2c_async_xfer *xfer)
+{
+	uint32_t key = irq_lock();
+	int queued = xfer->queued;
+
+	if (queued) {
+		i2c_async_unlink(xfer);
+		xfer->queued = 0;
+	}
+
+	irq_unlock(key);
+	return queued;
+}
+
+static struct i2c_async_xfer *i2c_async_pop(int port)
+{
+	struct i2c_async_xfer *xfer;
+	uint32_t key = irq_lock();
+
+	xfer = queue_head[port];
+	if (xfer) {
+		i2c_async_unlink(xfer);
+		xfer->queued = 0;
+		port_xfer[port] = xfer;
+	}
+
+	irq_unlock(key);
+	return xfer;
+}
+
+static void i2c_async_run(int port)
+{
+	struct i2c_async_xfer *xfer;
+	task_id_t task;
+	uint32_t event;
+	int i, rv = EC_SUCCESS;
+
+	/*
+	 * Take the port before the transaction: while another user holds the
+	 * bus, the transaction stays queued and can still be cancelled.
+	 */
+	mutex_lock(&port_run_lock[port]);
+	i2c_lock(port, 1);
+	xfer = i2c_async_pop(port);
+	for (i = 0; xfer && i < xfer->count && rv == EC_SUCCESS; i++) {
+		const struct i2c_async_msg *msg = &xfer->msgs[i];
+
+		rv = i2c_xfer_unlocked(port, msg->addr_flags,
+				       msg->out, msg->out_size,
+				       msg->in, msg->in_size, I2C_XFER_SINGLE);
+	}
+	i2c_lock(port, 0);
+
+	if (xfer) {
+		/* From here, done() may queue the transaction again. */
+		task = xfer->task;
+		event = xfer->event;
+		xfer->rv = rv;
+
+		if (xfer->done)
+			xfer->done(xfer);
+		port_xfer[port] = NULL;
+		if (event)
+			task_set_event(task, event);
+	}
+	mutex_unlock(&port_run_lock[port]);
+}
+
+/* Queued, or running until its completion is notified. */
+static int i2c_async_is_busy(struct i2c_async_xfer *xfer)
+{
+	return xfer->queued || port_xfer[xfer->port] == xfer;
+}
+
+void i2c_async_task(void *u)
+{
+	const int port = (intptr_t)u;
+	uint32_t key;
+
+	ASSERT(port >= 0 && port < I2C_ASYNC_PORT_COUNT);
+
+	/* Transactions queued before the task started are run right away. */
+	key = irq_lock();
+	port_task[port] = task_get_current();
+	irq_unlock(key);
+
+	while (1) {
+		while (queue_head[port])
+			i2c_async_run(port);
+
+		task_wait_event(-1);
+	}
+}
+
+int i2c_xfer_async(struct i2c_async_xfer *xfer)
+{
+	const int port = xfer->port;
+	task_id_t task;
+	uint32_t key;
+
+	if (port < 0 || port >= I2C_ASYNC_PORT_COUNT)
+		return EC_ERROR_INVAL;
+
+	key = irq_lock();
+	/* done() runs in the port task, and may queue the transaction again */
+	if (xfer->queued || (port_xfer[port] == xfer &&
+			     task_get_current() != port_task[port])) {
+		irq_unlock(key);
+		return EC_ERROR_BUSY;
+	}
+
+	xfer->queued = 1;
+	xfer->next = NULL;
+	if (queue_tail[port])
+		queue_tail[port]->next = xfer;
+	else
+		queue_head[port] = xfer;
+	queue_tail[port] = xfer;
+	task = port_task[port];
+	irq_unlock(key);
+
+	if (task != TASK_ID_INVALID)
+		task_wake(task);
+	return EC_SUCCESS;
+}
+
+int i2c_xfer_async_cancel(struct i2c_async_xfer *xfer)
+{
+	if (xfer->port < 0 || xfer->port >= I2C_ASYNC_PORT_COUNT)
+		return EC_ERROR_INVAL;
+
+	if (i2c_async_drop(xfer))
+		return EC_SUCCESS;
+
+	/*
+	 * Already on the bus: the controller driver bounds the transfer, wait
+	 * for it and for done() to let go of the transaction.
+	 */
+	if (port_xfer[xfer->port] == xfer) {
+		mutex_lock(&port_run_lock[xfer->port]);
+		mutex_unlock(&port_run_lock[xfer->port]);
+	}
+
+	return EC_ERROR_BUSY;
+}
+
+int i2c_xfer_async_wait(struct i2c_async_xfer *xfer, int timeout_us)
+{
+	const uint64_t deadline = get_time().val + timeout_us;
+	int64_t remaining;
+	uint32_t evt = 0;
+	int busy;
+
+	if (!xfer->event || xfer->port < 0 ||
+	    xfer->port >= I2C_ASYNC_PORT_COUNT)
+		return EC_ERROR_INVAL;
+
+	/*
+	 * Blocking the HOOK task would hold every hook and deferred routine,
+	 * and the port task would wait for itself.
+	 */
+	ASSERT(task_get_current() != TASK_ID_HOOKS);
+	ASSERT(task_get_current() != port_task[xfer->port]);
+
+	while (1) {
+		/*
+		 * The port task sets the event right after the transaction
+		 * stops being busy. Return once the event is consumed as well:
+		 * left set, it would end the next wait on it early.
+		 */
+		busy = i2c_async_is_busy(xfer);
+		if (!busy && (evt & xfer->event))
+			break;
+
+		remaining = deadline - get_time().val;
+		if (remaining <= 0) {
+			if (!busy)
+				break;
+			/* Dropped before reaching the bus, nothing to notify */
+			if (i2c_async_drop(xfer))
+				return EC_ERROR_TIMEOUT;
+			/*
+			 * Once on the bus, the transaction is left to end,
+			 * within the bound of the controller driver.
+			 */
+			remaining = -1;
+		}
+
+		evt = task_wait_event_mask(xfer->event, remaining);
+	}
+
+	return xfer->rv;
+}
@@ -15,6 +15,7 @@
 #include "i2c.h"
 #include "i2c_bitbang.h"
 #include "i2c_private.h"
+#include "i2c_reg_cache.h"
 #include "system.h"
 #include "task.h"
 #include "usb_pd.h"
@@ -48,7 +49,14 @@
 #define I2C_BITBANG_PORT_COUNT 0
 #endif
 
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+static mutex_t port_mutex[I2C_CONTROLLER_COUNT + I2C_BITBANG_PORT_COUNT] = {
+	[0 ... (I2C_CONTROLLER_COUNT + I2C_BITBANG_PORT_COUNT - 1)] =
+		MUTEX_PRIO_INHERIT_INIT,
+};
+#else
 static mutex_t port_mutex[I2C_CONTROLLER_COUNT + I2C_BITBANG_PORT_COUNT];
+#endif
 /* A bitmap of the controllers which are currently servicing a request. */
 static uint32_t i2c_port_active_list;
 BUILD_ASSERT(ARRAY_SIZE(port_mutex) < 32);
@@ -185,6 +193,78 @@ static int i2c_xfer_no_retry(const int port,
 }
 #endif /* CONFIG_I2C_XFER_LARGE_TRANSFER */
 
+#ifdef CONFIG_I2C_STATS
+static struct ec_response_i2c_stats i2c_stats[ARRAY_SIZE(port_protected)];
+/* Time at which each port was locked. */
+static uint32_t i2c_lock_start[ARRAY_SIZE(port_protected)];
+
+static void i2c_stats_lock(int port, int lock)
+{
+	struct ec_response_i2c_stats *st;
+
+	if (port < 0 || port >= ARRAY_SIZE(i2c_stats))
+		return;
+
+	st = &i2c_stats[port];
+	if (lock) {
+		i2c_lock_start[port] = get_time().le.lo;
+		st->lock_count++;
+	} else {
+		st->lock_time_us += get_time().le.lo - i2c_lock_start[port];
+	}
+}
+
+/* Called with the port locked. */
+static void i2c_stats_xfer(int port, uint16_t addr_flags,
+			   int out_size, int in_size,
+			   int ret, int retries, uint32_t duration)
+{
+	struct ec_response_i2c_stats *st;
+	struct ec_i2c_stats_addr *a = NULL;
+	int i;
+
+	if (port < 0 || port >= ARRAY_SIZE(i2c_stats))
+		return;
+
+	st = &i2c_stats[port];
+	st->xfers++;
+	st->bytes_out += out_size;
+	st->bytes_in += in_size;
+	st->retries += retries;
+	st->xfer_time_us += duration;
+	if (ret)
+		st->errors++;
+
+	i = duration ? MIN(__fls(duration) + 1,
+			   EC_I2C_STATS_HIST_BUCKETS - 1) : 0;
+	st->hist[i]++;
+
+	addr_flags = I2C_STRIP_FLAGS(addr_flags);
+	for (i = 0; i < st->addr_count; i++) {
+		if (st->addrs[i].addr_flags == addr_flags) {
+			a = &st->addrs[i];
+			break;
+		}
+	}
+	if (!a && st->addr_count < EC_I2C_STATS_MAX_ADDRS) {
+		a = &st->addrs[st->addr_count++];
+		a->addr_flags = addr_flags;
+	}
+	if (!a)
+		return;
+
+	a->xfers++;
+	a->bytes += out_size + in_size;
+	if (ret)
+		a->errors++;
+}
+#else
+static inline void i2c_stats_lock(int port, int lock) {}
+static inline void i2c_stats_xfer(int port, uint16_t addr_flags,
+				  int out_size, int in_size,
+				  int ret, int retries, uint32_t duration) {}
+#endif /* CONFIG_I2C_STATS */
+
 int i2c_xfer_unlocked(const int port,
 		      const uint16_t addr_flags,
 		      const uint8_t *out, int out_size,
@@ -193,12 +273,17 @@ int i2c_xfer_unlocked(const int port,
 	int i;
 	int ret = EC_SUCCESS;
 	uint16_t no_pec_af = addr_flags & ~I2C_FLAG_PEC;
+	uint32_t start = IS_ENABLED(CONFIG_I2C_STATS) ? get_time().le.lo : 0;
 
 	if (!i2c_port_is_locked(port)) {
 		CPUTS("Access I2C without lock!");
 		return EC_ERROR_INVAL;
 	}
 
+	if (IS_ENABLED(CONFIG_I2C_REG_CACHE))
+		i2c_reg_cache_xfer(port, addr_flags, out, out_size, in_size,
+				   flags);
+
 	for (i = 0; i <= CONFIG_I2C_NACK_RETRY_COUNT; i++) {
 #ifdef CONFIG_ZEPHYR
 		struct i2c_msg msg[2];
@@ -252,6 +337,11 @@ int i2c_xfer_unlocked(const int port,
 		if (ret != EC_ERROR_BUSY)
 			break;
 	}
+
+	if (IS_ENABLED(CONFIG_I2C_STATS))
+		i2c_stats_xfer(port, no_pec_af, out_size, in_size, ret,
+			       MIN(i, CONFIG_I2C_NACK_RETRY_COUNT),
+			       get_time().le.lo - start);
 	return ret;
 }
 
@@ -273,6 +363,9 @@ int i2c_xfer(const int port,
 
 void i2c_lock(int port, int lock)
 {
+	/* Count the time per port, before it is mapped to its controller. */
+	const int stats_port = port;
+
 #ifdef CONFIG_I2C_MULTI_PORT_CONTROLLER
 	/* Lock the controller, not the port */
 	port = i2c_port_to_controller(port);
@@ -293,8 +386,14 @@ void i2c_lock(int port, int lock)
 		disable_sleep(SLEEP_MASK_I2C_CONTROLLER);
 
 		irq_unlock(irq_lock_key);
+
+		i2c_stats_lock(stats_port, 1);
 	} else {
-		uint32_t irq_lock_key = irq_lock();
+		uint32_t irq_lock_key;
+
+		i2c_stats_lock(stats_port, 0);
+
+		irq_lock_key = irq_lock();
 
 		i2c_port_active_list &= ~BIT(port);
 		/* Once there is no i2c port active, enable sleep bit of i2c. */
@@ -495,6 +594,14 @@ int i2c_read8(const int port,
 	uint8_t reg = offset;
 	uint8_t buf;
 
+	if (IS_ENABLED(CONFIG_I2C_REG_CACHE)) {
+		struct i2c_reg_cache *cache =
+			i2c_reg_cache_find(port, addr_flags, offset);
+
+		if (cache)
+			return i2c_reg_cache_read8(cache, offset, data);
+	}
+
 	reg = offset;
 
 	rv = platform_ec_i2c_read(port, addr_flags, reg, &buf,
@@ -511,6 +618,14 @@ int i2c_write8(const int port,
 {
 	uint8_t buf[2];
 
+	if (IS_ENABLED(CONFIG_I2C_REG_CACHE)) {
+		struct i2c_reg_cache *cache =
+			i2c_reg_cache_find(port, addr_flags, offset);
+
+		if (cache)
+			return i2c_reg_cache_write8(cache, offset, data);
+	}
+
 	buf[0] = offset;
 	buf[1] = data;
 
@@ -1276,6 +1391,30 @@ static enum ec_status i2c_command_passthru(struct host_cmd_handler_args *args)
 }
 DECLARE_HOST_COMMAND(EC_CMD_I2C_PASSTHRU, i2c_command_passthru, EC_VER_MASK(0));
 
+#ifdef CONFIG_I2C_STATS
+static enum ec_status i2c_command_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_i2c_stats *params = args->params;
+	struct ec_response_i2c_stats *resp = args->response;
+	uint32_t irq_lock_key;
+
+	if (params->port >= ARRAY_SIZE(i2c_stats))
+		return EC_RES_INVALID_PARAM;
+
+	irq_lock_key = irq_lock();
+	memcpy(resp, &i2c_stats[params->port], sizeof(*resp));
+	if (params->flags & EC_I2C_STATS_FLAG_RESET)
+		memset(&i2c_stats[params->port], 0, sizeof(*resp));
+	irq_unlock(irq_lock_key);
+
+	resp->port_count = ARRAY_SIZE(i2c_stats);
+	args->response_size = sizeof(*resp);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_I2C_STATS, i2c_command_stats, EC_VER_MASK(0));
+#endif /* CONFIG_I2C_STATS */
+
 static void i2c_passthru_protect_port(uint32_t port)
 {
 	if (port < ARRAY_SIZE(port_protected))
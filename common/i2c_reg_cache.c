@@ -0,0 +1,206 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* I2C register cache for slow-changing device registers */
+
+#include "common.h"
+#include "console.h"
+#include "i2c.h"
+#include "i2c_reg_cache.h"
+#include "task.h"
+#include "util.h"
+
+/* Set in an entry once the register value is known. */
+#define I2C_REG_CACHE_VALID BIT(8)
+
+static struct i2c_reg_cache *caches;
+
+static int same_device(const struct i2c_reg_cache *cache, int port,
+		       uint16_t addr_flags)
+{
+	return cache->port == port &&
+	       I2C_STRIP_FLAGS(cache->addr_flags) ==
+	       I2C_STRIP_FLAGS(addr_flags);
+}
+
+/* Return the entry of a register, or -1 if it is volatile. */
+static int reg_index(const struct i2c_reg_cache *cache, int offset)
+{
+	int i, base = 0;
+
+	for (i = 0; i < cache->range_count; i++) {
+		const struct i2c_reg_cache_range *r = &cache->ranges[i];
+
+		if (offset >= r->first && offset <= r->last)
+			return base + offset - r->first;
+		base += r->last - r->first + 1;
+	}
+	return -1;
+}
+
+void i2c_reg_cache_invalidate(struct i2c_reg_cache *cache)
+{
+	memset(cache->entries, 0, cache->entry_count * sizeof(uint16_t));
+}
+
+int i2c_reg_cache_register(struct i2c_reg_cache *cache)
+{
+	struct i2c_reg_cache *c;
+	int i, size = 0;
+	uint32_t key;
+
+	if (I2C_USE_PEC(cache->addr_flags))
+		return EC_ERROR_UNIMPLEMENTED;
+
+	for (i = 0; i < cache->range_count; i++) {
+		if (cache->ranges[i].last < cache->ranges[i].first)
+			return EC_ERROR_INVAL;
+		size += cache->ranges[i].last - cache->ranges[i].first + 1;
+	}
+	if (size > cache->entry_count)
+		return EC_ERROR_INVAL;
+
+	i2c_reg_cache_invalidate(cache);
+	cache->hits = 0;
+	cache->misses = 0;
+
+	key = irq_lock();
+	for (c = caches; c; c = c->next)
+		if (c == cache)
+			break;
+	if (!c) {
+		cache->next = caches;
+		caches = cache;
+	}
+	irq_unlock(key);
+
+	return EC_SUCCESS;
+}
+
+struct i2c_reg_cache *i2c_reg_cache_find(int port, uint16_t addr_flags,
+					 int offset)
+{
+	struct i2c_reg_cache *cache;
+
+	for (cache = caches; cache; cache = cache->next)
+		if (same_device(cache, port, addr_flags) &&
+		    reg_index(cache, offset) >= 0)
+			return cache;
+	return NULL;
+}
+
+/*
+ * The cache is only accessed with the port locked, so a value read from the
+ * device cannot overwrite a newer value written by another task.
+ */
+int i2c_reg_cache_read8(struct i2c_reg_cache *cache, int offset, int *data)
+{
+	uint16_t *entry = &cache->entries[reg_index(cache, offset)];
+	uint8_t reg = offset;
+	uint8_t buf;
+	int rv;
+
+	i2c_lock(cache->port, 1);
+	if (*entry & I2C_REG_CACHE_VALID) {
+		*data = *entry & 0xff;
+		cache->hits++;
+		i2c_lock(cache->port, 0);
+		return EC_SUCCESS;
+	}
+
+	cache->misses++;
+	rv = i2c_xfer_unlocked(cache->port, cache->addr_flags, &reg, 1,
+			       &buf, 1, I2C_XFER_SINGLE);
+	if (rv == EC_SUCCESS) {
+		*entry = buf | I2C_REG_CACHE_VALID;
+		*data = buf;
+	}
+	i2c_lock(cache->port, 0);
+
+	return rv;
+}
+
+int i2c_reg_cache_write8(struct i2c_reg_cache *cache, int offset, int data)
+{
+	uint16_t *entry = &cache->entries[reg_index(cache, offset)];
+	uint8_t buf[2] = { offset, data };
+	int rv;
+
+	i2c_lock(cache->port, 1);
+	rv = i2c_xfer_unlocked(cache->port, cache->addr_flags, buf,
+			       sizeof(buf), NULL, 0, I2C_XFER_SINGLE);
+	/* On error the register content is unknown: leave it invalid. */
+	if (rv == EC_SUCCESS)
+		*entry = buf[1] | I2C_REG_CACHE_VALID;
+	i2c_lock(cache->port, 0);
+
+	return rv;
+}
+
+void i2c_reg_cache_xfer(int port, uint16_t addr_flags,
+			const uint8_t *out, int out_size, int in_size,
+			int flags)
+{
+	struct i2c_reg_cache *cache;
+	int reg, idx;
+
+	/* Reads only send the register address, then continue or read. */
+	if (out_size == 0 || (out_size == 1 && (flags & I2C_XFER_START) &&
+			      (in_size || !(flags & I2C_XFER_STOP))))
+		return;
+
+	for (cache = caches; cache; cache = cache->next) {
+		if (!same_device(cache, port, addr_flags))
+			continue;
+
+		/*
+		 * Continuation of a write, or a single byte command: the
+		 * registers are unknown.
+		 */
+		if (!(flags & I2C_XFER_START) || out_size == 1) {
+			i2c_reg_cache_invalidate(cache);
+			continue;
+		}
+
+		for (reg = out[0]; reg < out[0] + out_size - 1; reg++) {
+			idx = reg_index(cache, reg & 0xff);
+			if (idx >= 0)
+				cache->entries[idx] = 0;
+		}
+	}
+}
+
+static int command_i2ccache(int argc, char **argv)
+{
+	struct i2c_reg_cache *cache;
+	uint32_t total;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+
+		for (cache = caches; cache; cache = cache->next) {
+			i2c_lock(cache->port, 1);
+			i2c_reg_cache_invalidate(cache);
+			cache->hits = 0;
+			cache->misses = 0;
+			i2c_lock(cache->port, 0);
+		}
+		return EC_SUCCESS;
+	}
+
+	ccputs("Port Addr     Hits   Misses Rate\n");
+	for (cache = caches; cache; cache = cache->next) {
+		total = cache->hits + cache->misses;
+		ccprintf("%4d 0x%02x %8u %8u %3u%%\n", cache->port,
+			 I2C_STRIP_FLAGS(cache->addr_flags),
+			 cache->hits, cache->misses,
+			 total ? (uint32_t)(100ULL * cache->hits / total) : 0);
+	}
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(i2ccache, command_i2ccache,
+			"[clear]",
+			"Print or reset the I2C register cache statistics");
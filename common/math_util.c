@@ -35,7 +35,7 @@ BUILD_ASSERT(ARRAY_SIZE(cos_lut) == COSINE_LUT_SIZE);
 
 fp_t arc_cos(fp_t x)
 {
-	int i;
+	int lo = 1, hi = COSINE_LUT_SIZE - 1, i;
 
 	/* Cap x if out of range. */
 	if (x < FLOAT_TO_FP(-1.0))
@@ -44,28 +44,24 @@ fp_t arc_cos(fp_t x)
 		x = FLOAT_TO_FP(1.0);
 
 	/*
-	 * Increment through lookup table to find index and then linearly
-	 * interpolate for precision.
+	 * The table is decreasing: binary search the first entry lower than
+	 * or equal to x, and then linearly interpolate with the previous one
+	 * for precision. Such an entry always exists because x is clipped to
+	 * [-1, 1], the range of cos_lut[].
 	 */
-	/* TODO(crosbug.com/p/25600): Optimize with binary search. */
-	for (i = 0; i < COSINE_LUT_SIZE-1; i++) {
-		if (x >= cos_lut[i+1]) {
-			const fp_t interp = fp_div(cos_lut[i] - x,
-						   cos_lut[i] - cos_lut[i + 1]);
-
-			return fp_mul(INT_TO_FP(COSINE_LUT_INCR_DEG),
-				      INT_TO_FP(i) + interp);
-		}
-	}
+	while (lo < hi) {
+		const int mid = (lo + hi) / 2;
 
-	/*
-	 * Shouldn't be possible to get here because inputs are clipped to
-	 * [-1, 1] and the cos_lut[] table goes over the same range. If we
-	 * are here, throw an assert.
-	 */
-	ASSERT(0);
+		if (x >= cos_lut[mid])
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	i = lo - 1;
 
-	return 0;
+	return fp_mul(INT_TO_FP(COSINE_LUT_INCR_DEG),
+		      INT_TO_FP(i) + fp_div(cos_lut[i] - x,
+					    cos_lut[i] - cos_lut[i + 1]));
 }
 
 /**
@@ -24,6 +24,9 @@
 /* Public API for controlling/inspecting this mock */
 struct mock_tcpc_ctrl mock_tcpc;
 
+/* Only port 0 is controlled by the mock, other ports stay unattached */
+#define MOCK_TCPC_PORT 0
+
 void mock_tcpc_reset(void)
 {
 	/* Reset all control values to 0. See also build assert below */
@@ -47,6 +50,12 @@ static int mock_release(int port)
 static int mock_get_cc(int port, enum tcpc_cc_voltage_status *cc1,
 		       enum tcpc_cc_voltage_status *cc2)
 {
+	if (port != MOCK_TCPC_PORT) {
+		*cc1 = TYPEC_CC_VOLT_OPEN;
+		*cc2 = TYPEC_CC_VOLT_OPEN;
+		return EC_SUCCESS;
+	}
+
 	*cc1 = mock_tcpc.cc1;
 	*cc2 = mock_tcpc.cc2;
 	return EC_SUCCESS;
@@ -54,6 +63,9 @@ static int mock_get_cc(int port, enum tcpc_cc_voltage_status *cc1,
 
 static bool mock_check_vbus_level(int port, enum vbus_level level)
 {
+	if (port != MOCK_TCPC_PORT)
+		return level != VBUS_PRESENT;
+
 	if (level == VBUS_PRESENT)
 		return mock_tcpc.vbus_level;
 	else if (level == VBUS_SAFE0V || level == VBUS_REMOVED)
@@ -71,6 +83,9 @@ static bool mock_check_vbus_level(int port, enum vbus_level level)
 
 static int mock_select_rp_value(int port, int rp)
 {
+	if (port != MOCK_TCPC_PORT)
+		return EC_SUCCESS;
+
 	mock_tcpc.last.rp = rp;
 
 	if (!mock_tcpc.should_print_call)
@@ -83,6 +98,9 @@ static int mock_select_rp_value(int port, int rp)
 
 static int mock_set_cc(int port, int pull)
 {
+	if (port != MOCK_TCPC_PORT)
+		return EC_SUCCESS;
+
 	mock_tcpc.last.cc = pull;
 
 	if (mock_tcpc.callbacks.set_cc)
@@ -98,6 +116,9 @@ static int mock_set_cc(int port, int pull)
 
 static int mock_set_polarity(int port, enum tcpc_cc_polarity polarity)
 {
+	if (port != MOCK_TCPC_PORT)
+		return EC_SUCCESS;
+
 	mock_tcpc.last.polarity = polarity;
 
 	if (!mock_tcpc.should_print_call)
@@ -116,6 +137,9 @@ static int mock_set_vconn(int port, int enable)
 
 static int mock_set_msg_header(int port, int power_role, int data_role)
 {
+	if (port != MOCK_TCPC_PORT)
+		return EC_SUCCESS;
+
 	++mock_tcpc.num_calls_to_set_header;
 
 	mock_tcpc.last.power_role = power_role;
@@ -157,6 +181,9 @@ void mock_tcpc_discharge_vbus(int port, int enable)
 
 __maybe_unused static int mock_drp_toggle(int port)
 {
+	if (port != MOCK_TCPC_PORT)
+		return EC_SUCCESS;
+
 	/* Only set the time the first time this is called. */
 	if (mock_tcpc.first_call_to_enable_auto_toggle == 0)
 		mock_tcpc.first_call_to_enable_auto_toggle = get_time().val;
@@ -541,6 +541,9 @@ int tcpci_i2c_xfer(int port, uint16_t addr_flags,
 			print_header("RX", UINT16_FROM_BYTE_ARRAY_LE(
 						rx_buffer, 2));
 			rx_pos = -1;
+		} else if (flags & I2C_XFER_STOP) {
+			/* The TCPC may stop before the end of the buffer */
+			rx_pos = 0;
 		}
 		return EC_SUCCESS;
 	}
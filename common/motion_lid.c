@@ -281,6 +281,20 @@ static void motion_lid_set_dptf_profile(int reliable)
 
 #endif /* MOTION_LID_SET_DPTF_PROFILE */
 
+/*
+ * Feed a lid angle evaluation to the tablet mode and DPTF profile debouncers.
+ */
+static void motion_lid_update_modes(int reliable)
+{
+#ifdef CONFIG_TABLET_MODE
+	if (board_is_lid_angle_tablet_mode())
+		motion_lid_set_tablet_mode(reliable);
+
+	if (IS_ENABLED(MOTION_LID_SET_DPTF_PROFILE))
+		motion_lid_set_dptf_profile(reliable);
+#endif
+}
+
 /**
  * Calculate the lid angle using two acceleration vectors, one recorded in
  * the base and one in the lid.
@@ -466,11 +480,7 @@ end_calculate_lid_angle:
 	 */
 	*lid_angle = FP_TO_INT(last_lid_angle_fp + FLOAT_TO_FP(0.5));
 
-	if (board_is_lid_angle_tablet_mode())
-		motion_lid_set_tablet_mode(reliable);
-
-	if (IS_ENABLED(MOTION_LID_SET_DPTF_PROFILE))
-		motion_lid_set_dptf_profile(reliable);
+	motion_lid_update_modes(reliable);
 #else    /* CONFIG_TABLET_MODE */
 end_calculate_lid_angle:
 	if (reliable)
@@ -487,15 +497,78 @@ int motion_lid_get_angle(void)
 		return LID_ANGLE_UNRELIABLE;
 }
 
+#ifdef CONFIG_LID_ANGLE_GATE_MG
+#define LID_ANGLE_GATE_DELTA \
+	(CONFIG_LID_ANGLE_GATE_MG * MOTION_SCALING_FACTOR / 1000)
+
+/* Vectors, scaled by their range, used by the last computation. */
+static intv3_t gate_base, gate_lid;
+static int gate_lid_open = -1;
+
+/**
+ * Check if the vectors moved since the last computation.
+ *
+ * @return 1 if no axis moved by more than LID_ANGLE_GATE_DELTA and the lid
+ * switch did not change, in which case the last angle is still valid.
+ * Otherwise remember the new vectors and return 0.
+ */
+static int lid_angle_gate_is_stable(void)
+{
+	intv3_t base, lid;
+	int i, lid_open, stable = 1;
+
+	for (i = X; i <= Z; i++) {
+		base[i] = accel_base->xyz[i] * accel_base->current_range;
+		lid[i] = accel_lid->xyz[i] * accel_lid->current_range;
+		if (ABS(base[i] - gate_base[i]) > LID_ANGLE_GATE_DELTA ||
+		    ABS(lid[i] - gate_lid[i]) > LID_ANGLE_GATE_DELTA)
+			stable = 0;
+	}
+
+	/* The lid switch is part of the reliability checks. */
+	lid_open = IS_ENABLED(CONFIG_TABLET_MODE) ? lid_is_open() : 0;
+	if (lid_open != gate_lid_open)
+		stable = 0;
+
+	if (!stable) {
+		memcpy(gate_base, base, sizeof(intv3_t));
+		memcpy(gate_lid, lid, sizeof(intv3_t));
+		gate_lid_open = lid_open;
+	}
+	return stable;
+}
+#else
+static int lid_angle_gate_is_stable(void)
+{
+	return 0;
+}
+#endif /* CONFIG_LID_ANGLE_GATE_MG */
+
+/* Number of lid angle evaluations, computed or reused by the gate. */
+static uint32_t lid_angle_computed, lid_angle_skipped;
+
+void motion_lid_get_calc_count(uint32_t *computed, uint32_t *skipped)
+{
+	*computed = lid_angle_computed;
+	*skipped = lid_angle_skipped;
+}
+
 /*
  * Calculate lid angle and massage the results
  */
 void motion_lid_calc(void)
 {
-	/* Calculate angle of lid accel. */
-	lid_angle_is_reliable = calculate_lid_angle(
-			accel_base->xyz, accel_lid->xyz,
-			&lid_angle_deg);
+	if (lid_angle_gate_is_stable()) {
+		/* Same angle as last time, only run the debouncers. */
+		lid_angle_skipped++;
+		motion_lid_update_modes(lid_angle_is_reliable);
+	} else {
+		/* Calculate angle of lid accel. */
+		lid_angle_computed++;
+		lid_angle_is_reliable = calculate_lid_angle(
+				accel_base->xyz, accel_lid->xyz,
+				&lid_angle_deg);
+	}
 
 	if (IS_ENABLED(CONFIG_LID_ANGLE_UPDATE))
 		lid_angle_update(motion_lid_get_angle());
@@ -21,6 +21,7 @@
 #include "mkbp_event.h"
 #include "motion_sense.h"
 #include "motion_sense_fifo.h"
+#include "motion_sense_read_plan.h"
 #include "motion_lid.h"
 #include "motion_orientation.h"
 #include "online_calibration.h"
@@ -92,6 +93,16 @@ static inline int motion_sensor_in_forced_mode(
 #endif
 }
 
+/*
+ * Whether the sensor waits for a threshold interrupt instead of being polled
+ * at its collection rate.
+ */
+static inline int motion_sensor_threshold_armed(
+		const struct motion_sensor_t *sensor)
+{
+	return IS_ENABLED(CONFIG_ACCEL_INTERRUPTS) && sensor->threshold_armed;
+}
+
 /* Minimal amount of time since last collection before triggering a new one */
 static inline int motion_sensor_time_to_read(const timestamp_t *ts,
 		const struct motion_sensor_t *sensor)
@@ -99,6 +110,10 @@ static inline int motion_sensor_time_to_read(const timestamp_t *ts,
 	if (sensor->collection_rate == 0)
 		return 0;
 
+	/* Nothing to read until the sensor reports a threshold crossing. */
+	if (motion_sensor_threshold_armed(sensor))
+		return 0;
+
 	/*
 	 * If the time is within the min motion interval (3 ms) go ahead and
 	 * read from the sensor
@@ -107,6 +122,30 @@ static inline int motion_sensor_time_to_read(const timestamp_t *ts,
 			  sensor->next_collection - motion_min_interval);
 }
 
+/*
+ * Program the interrupt window around the last reading, the sensor is not
+ * polled anymore until its value leaves the window.
+ */
+static void motion_sense_arm_threshold(struct motion_sensor_t *sensor)
+{
+	int value = sensor->raw_xyz[X];
+	int delta = MAX((int64_t)value * sensor->threshold_window / 100, 1);
+
+	if (sensor->drv->set_threshold(sensor, MAX(value - delta, 0),
+				       value + delta) == EC_SUCCESS)
+		sensor->threshold_armed = 1;
+}
+
+/* Mask the threshold interrupt and go back to polling the sensor. */
+static void motion_sense_disarm_threshold(struct motion_sensor_t *sensor)
+{
+	if (!motion_sensor_threshold_armed(sensor))
+		return;
+
+	sensor->threshold_armed = 0;
+	sensor->drv->set_threshold(sensor, 0, INT32_MAX);
+}
+
 static enum sensor_config motion_sense_get_ec_config(void)
 {
 	switch (sensor_active) {
@@ -152,6 +191,9 @@ int motion_sense_set_data_rate(struct motion_sensor_t *sensor)
 	}
 	roundup = !!(sensor->config[config_id].odr & ROUND_UP_FLAG);
 
+	/* Re-arm the threshold window from a reading at the new rate. */
+	motion_sense_disarm_threshold(sensor);
+
 	ret = sensor->drv->set_data_rate(sensor, odr, roundup);
 	if (ret)
 		return ret;
@@ -411,6 +453,7 @@ static void motion_sense_switch_sensor_rate(void)
 				 */
 				mutex_lock(&g_sensor_mutex);
 				sensor->collection_rate = 0;
+				motion_sense_disarm_threshold(sensor);
 				mutex_unlock(&g_sensor_mutex);
 				sensor->state = SENSOR_NOT_INITIALIZED;
 			}
@@ -620,10 +663,44 @@ static int motion_sense_read(struct motion_sensor_t *sensor)
 	    (sensor->flags & MOTIONSENSE_FLAG_IN_SPOOF_MODE))
 		return EC_SUCCESS;
 
+	/* Use the data fetched in burst at the beginning of the loop. */
+	if (IS_ENABLED(CONFIG_ACCEL_READ_PLAN)) {
+		int ret = motion_sense_read_plan_decode(sensor,
+							sensor->raw_xyz);
+
+		if (ret != EC_ERROR_NOT_HANDLED)
+			return ret;
+	}
+
 	/* Otherwise, read all raw X,Y,Z accelerations. */
 	return sensor->drv->read(sensor, sensor->raw_xyz);
 }
 
+/*
+ * Mask of the sensors motion_sense_process() is about to poll, so their data
+ * can be fetched together.
+ */
+static uint32_t motion_sense_read_plan_mask(const timestamp_t *ts)
+{
+	uint32_t mask = 0;
+	int i;
+
+	for (i = 0; i < motion_sensor_count; i++) {
+		const struct motion_sensor_t *sensor = &motion_sensors[i];
+
+		if (!SENSOR_ACTIVE(sensor) ||
+		    sensor->state != SENSOR_INITIALIZED ||
+		    !motion_sensor_in_forced_mode(sensor) ||
+		    !motion_sensor_time_to_read(ts, sensor))
+			continue;
+		if (IS_ENABLED(CONFIG_ACCEL_SPOOF_MODE) &&
+		    (sensor->flags & MOTIONSENSE_FLAG_IN_SPOOF_MODE))
+			continue;
+		mask |= BIT(i);
+	}
+	return mask;
+}
+
 
 static inline void increment_sensor_collection(struct motion_sensor_t *sensor,
 					       const timestamp_t *ts)
@@ -706,13 +783,27 @@ static int motion_sense_process(struct motion_sensor_t *sensor,
 	    ((*event & TASK_EVENT_MOTION_INTERRUPT_MASK || is_odr_pending) &&
 	     (sensor->drv->irq_handler != NULL))) {
 		ret = sensor->drv->irq_handler(sensor, event);
-		if (ret == EC_SUCCESS)
+		if (ret == EC_SUCCESS && sensor->drv->set_threshold) {
+			/*
+			 * Value left the window: nothing was read yet, read
+			 * the new one now.
+			 */
+			motion_sense_disarm_threshold(sensor);
+			sensor->next_collection = ts->le.lo;
+		} else if (ret == EC_SUCCESS) {
 			has_data_read = 1;
+		}
 	}
 	if (motion_sensor_in_forced_mode(sensor)) {
 		if (motion_sensor_time_to_read(ts, sensor)) {
 			ret = motion_sense_read(sensor);
 			increment_sensor_collection(sensor, ts);
+			if (IS_ENABLED(CONFIG_ACCEL_INTERRUPTS) &&
+			    sensor->threshold_window &&
+			    sensor->drv->set_threshold &&
+			    !(sensor->flags & MOTIONSENSE_FLAG_IN_SPOOF_MODE) &&
+			    (ret == EC_SUCCESS || ret == EC_ERROR_UNCHANGED))
+				motion_sense_arm_threshold(sensor);
 		} else {
 			ret = EC_ERROR_BUSY;
 		}
@@ -878,6 +969,9 @@ void motion_sense_task(void *u)
 
 	while (1) {
 		ts_begin_task = get_time();
+		if (IS_ENABLED(CONFIG_ACCEL_READ_PLAN))
+			motion_sense_read_plan_fetch(
+				motion_sense_read_plan_mask(&ts_begin_task));
 		for (i = 0; i < motion_sensor_count; ++i) {
 
 			sensor = &motion_sensors[i];
@@ -970,7 +1064,8 @@ void motion_sense_task(void *u)
 			struct motion_sensor_t *sensor = &motion_sensors[i];
 
 			if (!motion_sensor_in_forced_mode(sensor) ||
-			   sensor->collection_rate == 0)
+			   sensor->collection_rate == 0 ||
+			   motion_sensor_threshold_armed(sensor))
 				continue;
 
 			time_diff = time_until(ts_end_task.le.lo,
@@ -1107,6 +1202,10 @@ static enum ec_status host_cmd_motion_sense(struct host_cmd_handler_args *args)
 			    sensor->drv->read_temp)
 				out->info_4.flags |=
 					MOTION_SENSE_CMD_INFO_FLAG_ONLINE_CALIB;
+			if (IS_ENABLED(CONFIG_ACCEL_INTERRUPTS) &&
+			    sensor->drv->set_threshold)
+				out->info_4.flags |=
+					MOTION_SENSE_CMD_INFO_FLAG_THRESHOLD;
 			args->response_size = sizeof(out->info_4);
 		}
 		break;
@@ -1190,6 +1289,36 @@ static enum ec_status host_cmd_motion_sense(struct host_cmd_handler_args *args)
 		args->response_size = sizeof(out->sensor_range);
 		break;
 
+	case MOTIONSENSE_CMD_THRESHOLD_WINDOW:
+		/* Verify sensor number is valid. */
+		sensor = host_sensor_id_to_real_sensor(
+				in->threshold_window.sensor_num);
+		if (sensor == NULL)
+			return EC_RES_INVALID_PARAM;
+		/* Set new window if the data arg has a value. */
+		if (in->threshold_window.window != EC_MOTION_SENSE_NO_VALUE) {
+			if (!IS_ENABLED(CONFIG_ACCEL_INTERRUPTS) ||
+			    !sensor->drv->set_threshold ||
+			    !motion_sensor_in_forced_mode(sensor))
+				return EC_RES_INVALID_COMMAND;
+
+			if (in->threshold_window.window < 0 ||
+			    in->threshold_window.window > 100)
+				return EC_RES_INVALID_PARAM;
+
+			sensor->threshold_window = in->threshold_window.window;
+
+			/* Let the motion sense task re-arm the sensor. */
+			atomic_or(&odr_event_required,
+				  BIT(sensor - motion_sensors));
+			task_set_event(TASK_ID_MOTIONSENSE,
+				       TASK_EVENT_MOTION_ODR_CHANGE);
+		}
+
+		out->threshold_window.ret = sensor->threshold_window;
+		args->response_size = sizeof(out->threshold_window);
+		break;
+
 	case MOTIONSENSE_CMD_SENSOR_OFFSET:
 		/* Verify sensor number is valid. */
 		sensor = host_sensor_id_to_real_sensor(
@@ -1782,6 +1911,14 @@ static int command_display_accel_info(int argc, char **argv)
 		}
 	}
 
+	if (IS_ENABLED(CONFIG_LID_ANGLE)) {
+		uint32_t computed, skipped;
+
+		motion_lid_get_calc_count(&computed, &skipped);
+		ccprintf("\nlid angle: %u computed, %u skipped\n",
+			 computed, skipped);
+	}
+
 	/* First argument is on/off whether to display accel data. */
 	if (argc > 1) {
 		if (!parse_bool(argv[1], &val))
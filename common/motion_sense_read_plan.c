@@ -0,0 +1,142 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Batched register reads for polled motion sensors. */
+
+#include "accelgyro.h"
+#include "common.h"
+#include "i2c.h"
+#include "motion_sense.h"
+#include "motion_sense_read_plan.h"
+#include "task.h"
+#include "util.h"
+
+/* Register blocks declared by the sensors for the current task loop. */
+static struct motion_read_plan plans[MAX_MOTION_SENSORS];
+
+/* Data fetched for each sensor, valid when its bit is set in plan_ready. */
+static uint8_t plan_data[MAX_MOTION_SENSORS][MOTION_READ_PLAN_MAX_LEN];
+static uint32_t plan_ready;
+
+static uint32_t plan_transfers;
+static uint32_t plan_reads;
+
+static int same_device(const struct motion_sensor_t *a,
+		       const struct motion_sensor_t *b)
+{
+	return a->port == b->port &&
+	       a->i2c_spi_addr_flags == b->i2c_spi_addr_flags;
+}
+
+/*
+ * Read the block of sensor @first, merged with the blocks of the sensors in
+ * @todo it overlaps or touches. Registers in the gap between two blocks are
+ * never read: they may have side effects, like popping a FIFO.
+ *
+ * Return the mask of the sensors covered by the transfer.
+ */
+static uint32_t read_plan_burst(int first, uint32_t todo)
+{
+	const struct motion_sensor_t *s = &motion_sensors[first];
+	uint8_t buf[MOTION_READ_PLAN_MAX_LEN];
+	uint32_t burst = BIT(first);
+	int start = plans[first].reg;
+	int end = start + plans[first].len;
+	int i, grown, ret;
+	uint8_t reg;
+
+	do {
+		grown = 0;
+		for (i = first + 1; i < motion_sensor_count; i++) {
+			const struct motion_read_plan *p = &plans[i];
+			int p_end = p->reg + p->len;
+
+			if (!(todo & BIT(i)) || (burst & BIT(i)) ||
+			    !same_device(s, &motion_sensors[i]))
+				continue;
+			if (p->reg > end || p_end < start)
+				continue;
+			if (MAX(end, p_end) - MIN(start, p->reg) >
+			    MOTION_READ_PLAN_MAX_LEN)
+				continue;
+
+			start = MIN(start, p->reg);
+			end = MAX(end, p_end);
+			burst |= BIT(i);
+			grown = 1;
+		}
+	} while (grown);
+
+	reg = start;
+	ret = i2c_xfer_unlocked(s->port, s->i2c_spi_addr_flags,
+				&reg, 1, buf, end - start, I2C_XFER_SINGLE);
+	plan_transfers++;
+	if (ret != EC_SUCCESS)
+		return burst;
+
+	for (i = first; i < motion_sensor_count; i++) {
+		if (!(burst & BIT(i)))
+			continue;
+		memcpy(plan_data[i], &buf[plans[i].reg - start], plans[i].len);
+		plan_ready |= BIT(i);
+	}
+	return burst;
+}
+
+void motion_sense_read_plan_fetch(uint32_t sensor_mask)
+{
+	uint32_t todo = 0;
+	int i, j, port;
+
+	ASSERT(task_get_current() == TASK_ID_MOTIONSENSE);
+
+	/* Data from a previous loop is stale. */
+	plan_ready = 0;
+
+	for (i = 0; i < motion_sensor_count; i++) {
+		const struct motion_sensor_t *s = &motion_sensors[i];
+
+		if (!(sensor_mask & BIT(i)) || !s->drv->get_read_plan ||
+		    SLAVE_IS_SPI(s->i2c_spi_addr_flags))
+			continue;
+		if (s->drv->get_read_plan(s, &plans[i]) != EC_SUCCESS ||
+		    plans[i].len == 0 ||
+		    plans[i].len > MOTION_READ_PLAN_MAX_LEN)
+			continue;
+		todo |= BIT(i);
+	}
+
+	for (i = 0; i < motion_sensor_count && todo; i++) {
+		if (!(todo & BIT(i)))
+			continue;
+
+		/* Serve every sensor of this port under a single lock. */
+		port = motion_sensors[i].port;
+		i2c_lock(port, 1);
+		for (j = i; j < motion_sensor_count; j++) {
+			if ((todo & BIT(j)) && motion_sensors[j].port == port)
+				todo &= ~read_plan_burst(j, todo);
+		}
+		i2c_lock(port, 0);
+	}
+}
+
+int motion_sense_read_plan_decode(struct motion_sensor_t *s, intv3_t v)
+{
+	const int i = s - motion_sensors;
+
+	if (!(plan_ready & BIT(i)))
+		return EC_ERROR_NOT_HANDLED;
+
+	plan_ready &= ~BIT(i);
+	plan_reads++;
+	return s->drv->decode_read_plan(s, plan_data[i], v);
+}
+
+void motion_sense_read_plan_get_stats(uint32_t *transfers, uint32_t *reads)
+{
+	*transfers = plan_transfers;
+	*reads = plan_reads;
+}
@@ -31,6 +31,68 @@ static inline int divmod(uint32_t *n, int d)
 }
 #endif
 
+#ifndef NO_UINT64_SUPPORT
+/* "00" to "99", so decimal numbers are converted two digits at a time */
+static const char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+#endif
+
+/* Powers of ten which fit in 32 bits, for the fixed-point digits */
+static const uint32_t powers_of_ten[] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+	1000000000,
+};
+
+/**
+ * Convert a 32-bit number to decimal, working backwards from the end of a
+ * buffer.
+ *
+ * @param end		End of the digits in the buffer
+ * @param v		Number to convert
+ * @param min_digits	Minimum number of digits, padded with leading zeros
+ *
+ * @return The first digit in the buffer.
+ */
+static char *print_dec32(char *end, uint32_t v, int min_digits)
+{
+	char *p = end;
+
+#ifndef NO_UINT64_SUPPORT
+	while (v >= 100) {
+		const char *pair = digit_pairs + 2 * (v % 100);
+
+		v /= 100;
+		*(--p) = pair[1];
+		*(--p) = pair[0];
+	}
+	if (v >= 10) {
+		*(--p) = digit_pairs[2 * v + 1];
+		*(--p) = digit_pairs[2 * v];
+	} else {
+		*(--p) = '0' + v;
+	}
+#else
+	do {
+		*(--p) = '0' + v % 10;
+		v /= 10;
+	} while (v);
+#endif
+
+	while (end - p < min_digits)
+		*(--p) = '0';
+
+	return p;
+}
+
 /**
  * Convert the lowest nibble of a number to hex
  *
@@ -58,15 +120,42 @@ static int hexdigit(int c)
 #define PF_64BIT	BIT(3)  /* Number is 64-bit */
 #endif
 
+/*
+ * Where vfnprintf() sends its output. addstr is optional, for the callers
+ * which can take a run of characters at once.
+ */
+struct printf_output {
+	int (*addchar)(void *context, int c);
+	int (*addstr)(void *context, const char *str, int len);
+	void *context;
+};
+
+/*
+ * Send a run of characters.
+ * Returns 0 on success or 1 if the output is full.
+ */
+static int addstr(const struct printf_output *out, const char *str, int len)
+{
+	if (out->addstr)
+		return out->addstr(out->context, str, len);
+
+	for (; len > 0; len--)
+		if (out->addchar(out->context, *str++))
+			return 1;
+
+	return 0;
+}
+
 /*
  * Print the buffer as a string of bytes in hex.
  * Returns 0 on success or an error on failure.
  */
-static int print_hex_buffer(int (*addchar)(void *context, int c),
-			    void *context, const char *vstr, int precision,
-			    int pad_width, int flags)
+static int print_hex_buffer(const struct printf_output *out, const char *vstr,
+			    int precision, int pad_width, int flags)
 
 {
+	int (*addchar)(void *context, int c) = out->addchar;
+	void *context = out->context;
 
 	/*
 	 * Divide pad_width instead of multiplying precision to avoid overflow
@@ -100,9 +189,11 @@ static int print_hex_buffer(int (*addchar)(void *context, int c),
 	return EC_SUCCESS;
 }
 
-int vfnprintf(int (*addchar)(void *context, int c), void *context,
-	      const char *format, va_list args)
+static int print_formatted(const struct printf_output *out, const char *format,
+			   va_list args)
 {
+	int (*addchar)(void *context, int c) = out->addchar;
+	void *context = out->context;
 	/*
 	 * Longest uint64 in decimal = 20
 	 * Longest uint32 in binary  = 32
@@ -120,9 +211,13 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 		int c = *format++;
 		char sign = 0;
 
-		/* Copy normal characters */
+		/* Copy normal characters, up to the next format */
 		if (c != '%') {
-			if (addchar(context, c))
+			const char *run = format - 1;
+
+			while (*format && *format != '%')
+				format++;
+			if (addstr(out, run, format - run))
 				return EC_ERROR_OVERFLOW;
 			continue;
 		}
@@ -298,8 +393,7 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 						ptrval;
 					int rc;
 
-					rc = print_hex_buffer(addchar,
-							      context,
+					rc = print_hex_buffer(out,
 							      hexbuf->buffer,
 							      hexbuf->size,
 							      0,
@@ -397,24 +491,43 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 
 			/*
 			 * Handle digits to right of decimal for fixed point
-			 * numbers.
+			 * numbers. Up to 9 digits, which covers timestamps,
+			 * take a single division.
 			 */
-			for (vlen = 0; vlen < precision; vlen++)
-				*(--vstr) = '0' + divmod(&v, 10);
+			if (precision > 0 &&
+			    precision < (int)ARRAY_SIZE(powers_of_ten)) {
+				int frac = divmod(&v, powers_of_ten[precision]);
+
+				vstr = print_dec32(vstr, frac, precision);
+			} else {
+				for (vlen = 0; vlen < precision; vlen++)
+					*(--vstr) = '0' + divmod(&v, 10);
+			}
 			if (precision >= 0)
 				*(--vstr) = '.';
 
-			if (!v)
-				*(--vstr) = '0';
-
-			while (v) {
-				int digit = divmod(&v, base);
-				if (digit < 10)
-					*(--vstr) = '0' + digit;
-				else if (c == 'X')
-					*(--vstr) = 'A' + digit - 10;
-				else
-					*(--vstr) = 'a' + digit - 10;
+			if (base == 10) {
+#ifndef NO_UINT64_SUPPORT
+				/* Split into runs of 9 digits, in 32 bits */
+				while (v > UINT32_MAX) {
+					int low = divmod(&v, 1000000000);
+
+					vstr = print_dec32(vstr, low, 9);
+				}
+#endif
+				vstr = print_dec32(vstr, v, 1);
+			} else {
+				/* Base 16 or 2 */
+				int shift = base == 16 ? 4 : 1;
+				char a = c == 'X' ? 'A' : 'a';
+
+				do {
+					int digit = v & (base - 1);
+
+					v >>= shift;
+					*(--vstr) = digit < 10 ? '0' + digit :
+								 a + digit - 10;
+				} while (v);
 			}
 
 			if (sign)
@@ -449,9 +562,8 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 				return EC_ERROR_OVERFLOW;
 			vlen++;
 		}
-		while (--precision >= 0 && *vstr)
-			if (addchar(context, *vstr++))
-				return EC_ERROR_OVERFLOW;
+		if (addstr(out, vstr, strnlen(vstr, precision)))
+			return EC_ERROR_OVERFLOW;
 		while (vlen < pad_width && flags & PF_LEFT) {
 			if (addchar(context, ' '))
 				return EC_ERROR_OVERFLOW;
@@ -463,6 +575,25 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 	return EC_SUCCESS;
 }
 
+int vfnprintf(int (*addchar)(void *context, int c), void *context,
+	      const char *format, va_list args)
+{
+	return vfnprintf_str(addchar, NULL, context, format, args);
+}
+
+int vfnprintf_str(int (*addchar)(void *context, int c),
+		  int (*addstr)(void *context, const char *str, int len),
+		  void *context, const char *format, va_list args)
+{
+	const struct printf_output out = {
+		.addchar = addchar,
+		.addstr = addstr,
+		.context = context,
+	};
+
+	return print_formatted(&out, format, args);
+}
+
 /*
  * These symbols are already defined by the Zephyr OS kernel, and we
  * don't want to use the EC implementation.
@@ -494,6 +625,25 @@ static int snprintf_addchar(void *context, int c)
 	return 0;
 }
 
+/**
+ * Add a run of characters to the string context.
+ *
+ * @param context	Context receiving the characters
+ * @param str		Characters to add
+ * @param len		Number of characters
+ * @return 0 if all added, 1 if some dropped because no space.
+ */
+static int snprintf_addstr(void *context, const char *str, int len)
+{
+	struct snprintf_context *ctx = (struct snprintf_context *)context;
+	int n = MIN(len, ctx->size);
+
+	memcpy(ctx->str, str, n);
+	ctx->str += n;
+	ctx->size -= n;
+	return n < len;
+}
+
 int snprintf(char *str, int size, const char *format, ...)
 {
 	va_list args;
@@ -509,6 +659,11 @@ int snprintf(char *str, int size, const char *format, ...)
 int vsnprintf(char *str, int size, const char *format, va_list args)
 {
 	struct snprintf_context ctx;
+	const struct printf_output out = {
+		.addchar = snprintf_addchar,
+		.addstr = snprintf_addstr,
+		.context = &ctx,
+	};
 	int rv;
 
 	if (!str || !format || size <= 0)
@@ -517,7 +672,7 @@ int vsnprintf(char *str, int size, const char *format, va_list args)
 	ctx.str = str;
 	ctx.size = size - 1;  /* Reserve space for terminating '\0' */
 
-	rv = vfnprintf(snprintf_addchar, &ctx, format, args);
+	rv = print_formatted(&out, format, args);
 
 	/* Terminate string */
 	*ctx.str = '\0';
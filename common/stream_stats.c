@@ -0,0 +1,121 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Streaming mean/variance helpers shared by the motion detectors. */
+
+#include "stream_stats.h"
+#include "util.h"
+
+void stream_stats_reset(struct stream_stats *s, fp_t shift)
+{
+	s->count = 0;
+	s->shift = shift;
+	s->sum = INT_TO_FP(0);
+	s->sum_sq = INT_TO_FP(0);
+}
+
+void stream_stats_update(struct stream_stats *s, fp_t x)
+{
+	fp_t delta = x - s->shift;
+
+	/* Saturate instead of rolling over, see still_det_update(). */
+	if (s->count < UINT32_MAX)
+		s->count++;
+
+	s->sum += delta;
+	s->sum_sq += fp_sq(delta);
+}
+
+fp_t stream_stats_mean(const struct stream_stats *s)
+{
+	if (s->count == 0)
+		return s->shift;
+
+	return s->shift +
+	       fp_mul(s->sum, fp_div(INT_TO_FP(1), INT_TO_FP(s->count)));
+}
+
+static fp_t compute_variance(const struct stream_stats *s, uint32_t denom)
+{
+	fp_t shifted_mean =
+		fp_mul(s->sum, fp_div(INT_TO_FP(1), INT_TO_FP(s->count)));
+
+	/* (sum((x - shift)^2) - sum(x - shift)^2 / n) / denom */
+	return fp_mul(s->sum_sq - fp_mul(shifted_mean, s->sum),
+		      fp_div(INT_TO_FP(1), INT_TO_FP(denom)));
+}
+
+fp_t stream_stats_variance(const struct stream_stats *s)
+{
+	if (s->count == 0)
+		return INT_TO_FP(0);
+
+	return compute_variance(s, s->count);
+}
+
+fp_t stream_stats_sample_variance(const struct stream_stats *s)
+{
+	if (s->count < 2)
+		return INT_TO_FP(0);
+
+	return compute_variance(s, s->count - 1);
+}
+
+void stream_window_init(struct stream_window *w, int16_t *history,
+			uint16_t capacity)
+{
+	w->history = history;
+	w->capacity = capacity;
+	stream_window_reset(w, capacity);
+}
+
+int stream_window_reset(struct stream_window *w, int size)
+{
+	w->size = MAX(1, MIN(size, w->capacity));
+	w->idx = 0;
+	w->count = 0;
+	w->sum = 0;
+	w->n2_variance = 0;
+	memset(w->history, 0, w->size * sizeof(*w->history));
+
+	return w->size;
+}
+
+/*
+ * Update the variance and the sum according to the incoming value, the
+ * evicted value, the previous sum and the previous variance.
+ * In order to prevent inaccuracy, we use integer to calculate instead of float
+ *
+ * n: window size
+ * x: data in the old window
+ * x': data in the new window
+ * x_0: oldest value in the window, will be replaced by x_n
+ * x_n: new coming value
+ *
+ * n^2 * var(x') = n^2 * var(x) + (x_n - x_0) *
+ *                 (n * (x_n + x_0) - sum(x') - sum(x))
+ */
+void stream_window_update(struct stream_window *w, int x)
+{
+	const int n = w->size;
+	const int x_n = MAX(INT16_MIN, MIN(x, INT16_MAX));
+	const int x_0 = w->history[w->idx];
+	const int sum_diff = x_n - x_0;
+	const int32_t new_sum = w->sum + sum_diff;
+
+	w->n2_variance += (int64_t)sum_diff *
+			  ((int64_t)n * (x_n + x_0) - new_sum - w->sum);
+	w->sum = new_sum;
+	w->history[w->idx] = x_n;
+
+	w->idx = (w->idx + 1 >= n) ? 0 : w->idx + 1;
+	if (w->count < n)
+		w->count++;
+}
+
+uint64_t stream_window_variance(const struct stream_window *w)
+{
+	return w->n2_variance / w->size / w->size;
+}
@@ -12,6 +12,7 @@
 #include "hooks.h"
 #include "host_command.h"
 #include "link_defs.h"
+#include "mkbp_event.h"
 #include "printf.h"
 #include "system.h"
 #include "task.h"
@@ -54,6 +55,53 @@ static int tx_last_snapshot_head;
 static int tx_next_snapshot_head;
 static int tx_checksum __preserved_logs(tx_checksum);
 
+#ifdef CONFIG_CONSOLE_ENABLE_READ_V2
+/*
+ * Sequence number of the next byte written to tx_buf. It stays congruent to
+ * tx_buf_head, so the byte with sequence number seq is at
+ * tx_buf[seq % CONFIG_UART_TX_BUF_SIZE] until it is overwritten.
+ */
+static volatile uint32_t tx_seq;
+/* Sequence number of the oldest byte written since the buffer was reset */
+static uint32_t tx_seq_first;
+#ifdef CONFIG_MKBP_EVENT
+/* Send EC_MKBP_EVENT_CONSOLE_DATA once tx_seq reaches this */
+static uint32_t tx_seq_watermark;
+static int tx_watermark_armed;
+#endif
+#endif /* CONFIG_CONSOLE_ENABLE_READ_V2 */
+
+#ifdef CONFIG_UART_STATS
+static struct {
+	/* Bytes written to the UART */
+	uint32_t written;
+	/*
+	 * Writes cut short by a full buffer; each stops at the first
+	 * character which does not fit.
+	 */
+	uint32_t dropped;
+	/* Calls to uart_process_input/output(), and the time spent in them */
+	uint32_t calls;
+	uint32_t time_us;
+	uint32_t max_us;
+} uart_stats;
+
+static void uart_stats_time(uint32_t start)
+{
+	uint32_t t = get_time().le.lo - start;
+
+	uart_stats.calls++;
+	uart_stats.time_us += t;
+	uart_stats.max_us = MAX(uart_stats.max_us, t);
+}
+#define UART_STATS_ADD(field, n) (uart_stats.field += (n))
+#define UART_STATS_START() get_time().le.lo
+#else
+static inline void uart_stats_time(uint32_t start) {}
+#define UART_STATS_ADD(field, n)
+#define UART_STATS_START() 0
+#endif /* CONFIG_UART_STATS */
+
 static int uart_buffer_calc_checksum(void)
 {
 	return tx_buf_head ^ tx_buf_tail;
@@ -69,7 +117,25 @@ void uart_init_buffer(void)
 		tx_buf_tail = 0;
 		tx_checksum = 0;
 	}
+
+#ifdef CONFIG_CONSOLE_ENABLE_READ_V2
+	/*
+	 * Preserved logs are readable, but not the rest of the buffer; the
+	 * unused bytes are zero and skipped by the reads.
+	 */
+	tx_seq = tx_buf_head;
+	tx_seq_first = tx_buf_head == tx_buf_tail && !tx_buf_head ?
+		       tx_seq : tx_seq - (CONFIG_UART_TX_BUF_SIZE - 1);
+#endif
+}
+
+#if defined(CONFIG_CONSOLE_ENABLE_READ_V2) && defined(CONFIG_MKBP_EVENT)
+static void console_data_event(void)
+{
+	mkbp_send_event(EC_MKBP_EVENT_CONSOLE_DATA);
 }
+DECLARE_DEFERRED(console_data_event);
+#endif
 
 /**
  * Put a single character into the transmit buffer.
@@ -91,8 +157,10 @@ static int __tx_char_raw(void *context, int c)
 #else
 
 	tx_buf_next = TX_BUF_NEXT(tx_buf_head);
-	if (tx_buf_next == tx_buf_tail)
+	if (tx_buf_next == tx_buf_tail) {
+		UART_STATS_ADD(dropped, 1);
 		return 1;
+	}
 
 	/*
 	 * If we do a READ_RECENT, the buffer may have wrapped around, and
@@ -112,6 +180,17 @@ static int __tx_char_raw(void *context, int c)
 	tx_buf[tx_buf_head] = c;
 	tx_buf_head = tx_buf_next;
 
+#ifdef CONFIG_CONSOLE_ENABLE_READ_V2
+	tx_seq++;
+#ifdef CONFIG_MKBP_EVENT
+	/* Sending the event may print, so leave the output path first */
+	if (tx_watermark_armed && tx_seq == tx_seq_watermark) {
+		tx_watermark_armed = 0;
+		hook_call_deferred(&console_data_event_data, 0);
+	}
+#endif
+#endif
+
 	if (IS_ENABLED(CONFIG_PRESERVE_LOGS))
 		tx_checksum = uart_buffer_calc_checksum();
 #endif
@@ -126,6 +205,25 @@ static int __tx_char(void *context, int c)
 	return __tx_char_raw(context, c);
 }
 
+/**
+ * Put a run of characters into the transmit buffer, translating '\n' to
+ * '\r\n'.
+ *
+ * @param context	Context; ignored.
+ * @param str		Characters to write.
+ * @param len		Number of characters.
+ * @return 0 if all characters were transmitted, 1 if some were dropped.
+ */
+static int __tx_str(void *context, const char *str, int len)
+{
+	for (; len > 0; len--) {
+		if (__tx_char(context, *str++))
+			return 1;
+	}
+
+	return 0;
+}
+
 #ifdef CONFIG_UART_TX_DMA
 
 /**
@@ -150,6 +248,7 @@ void uart_process_output(void)
 	if (tx_dma_in_progress) {
 		tx_buf_tail = (tx_buf_tail + tx_dma_in_progress) &
 			(CONFIG_UART_TX_BUF_SIZE - 1);
+		UART_STATS_ADD(written, tx_dma_in_progress);
 		tx_dma_in_progress = 0;
 
 		if (IS_ENABLED(CONFIG_PRESERVE_LOGS))
@@ -174,20 +273,46 @@ void uart_process_output(void)
 
 #else /* !CONFIG_UART_TX_DMA */
 
+__overridable int uart_write_buf(const char *buf, int len)
+{
+	int n;
+
+	for (n = 0; n < len && uart_tx_ready(); n++)
+		uart_write_char(buf[n]);
+
+	return n;
+}
+
 void uart_process_output(void)
 {
-	/* Copy output from buffer until TX fifo full or output buffer empty */
-	while (uart_tx_ready() && (tx_buf_head != tx_buf_tail)) {
-		uart_write_char(tx_buf[tx_buf_tail]);
-		tx_buf_tail = TX_BUF_NEXT(tx_buf_tail);
+	uint32_t start = UART_STATS_START();
+	int head, len, written;
+
+	/*
+	 * Copy output from buffer until TX fifo full or output buffer empty,
+	 * a contiguous run of the buffer at a time.
+	 */
+	while ((head = tx_buf_head) != tx_buf_tail) {
+		len = (head > tx_buf_tail ? head : CONFIG_UART_TX_BUF_SIZE) -
+		      tx_buf_tail;
+		written = uart_write_buf((const char *)(tx_buf + tx_buf_tail),
+					 len);
+		tx_buf_tail = (tx_buf_tail + written) &
+			(CONFIG_UART_TX_BUF_SIZE - 1);
+		UART_STATS_ADD(written, written);
 
 		if (IS_ENABLED(CONFIG_PRESERVE_LOGS))
 			tx_checksum = uart_buffer_calc_checksum();
+
+		if (written < len)
+			break;
 	}
 
 	/* If output buffer is empty, disable transmit interrupt */
 	if (tx_buf_tail == tx_buf_head)
 		uart_tx_stop();
+
+	uart_stats_time(start);
 }
 
 #endif /* !CONFIG_UART_TX_DMA */
@@ -230,6 +355,7 @@ DECLARE_HOOK(HOOK_TICK, uart_process_input, HOOK_PRIO_DEFAULT);
 
 void uart_process_input(void)
 {
+	uint32_t start = UART_STATS_START();
 	int got_input = 0;
 
 	/* Copy input from buffer until RX fifo empty */
@@ -253,6 +379,8 @@ void uart_process_input(void)
 
 	if (got_input)
 		console_has_input();
+
+	uart_stats_time(start);
 }
 
 void uart_clear_input(void)
@@ -291,15 +419,12 @@ int uart_puts(const char *outstr)
 int uart_put(const char *out, int len)
 {
 	/* Put all characters in the output buffer */
-	while (len--) {
-		if (__tx_char(NULL, *out++) != 0)
-			break;
-	}
+	int rv = __tx_str(NULL, out, len);
 
 	uart_tx_start();
 
 	/* Successful if we consumed all output */
-	return len ? EC_ERROR_OVERFLOW : EC_SUCCESS;
+	return rv ? EC_ERROR_OVERFLOW : EC_SUCCESS;
 }
 
 int uart_put_raw(const char *out, int len)
@@ -318,7 +443,7 @@ int uart_put_raw(const char *out, int len)
 
 int uart_vprintf(const char *format, va_list args)
 {
-	int rv = vfnprintf(__tx_char, NULL, format, args);
+	int rv = vfnprintf_str(__tx_char, __tx_str, NULL, format, args);
 
 	uart_tx_start();
 
@@ -402,6 +527,74 @@ static void uart_rx_dma_init(void)
 DECLARE_HOOK(HOOK_INIT, uart_rx_dma_init, HOOK_PRIO_DEFAULT);
 #endif
 
+#ifdef CONFIG_CONSOLE_ENABLE_READ_V2
+int uart_console_read_seq(uint32_t seq, char *dest, uint16_t dest_size,
+			  uint16_t *write_count, uint32_t *first_seq,
+			  uint32_t *next_seq)
+{
+	uint32_t head = tx_seq;
+	uint32_t oldest = head - MIN(head - tx_seq_first,
+				     CONFIG_UART_TX_BUF_SIZE - 1);
+	int retry = 1;
+	char c;
+
+	/* Start from the oldest byte if the reader fell behind, or rebooted */
+	if ((int32_t)(seq - oldest) < 0 || (int32_t)(head - seq) < 0)
+		seq = oldest;
+
+	do {
+		*first_seq = seq;
+		*write_count = 0;
+		while (seq != head && *write_count < dest_size) {
+			/* Skip the unused bytes of the buffer */
+			c = tx_buf[seq & (CONFIG_UART_TX_BUF_SIZE - 1)];
+			if (c)
+				dest[(*write_count)++] = c;
+			seq++;
+		}
+
+		/*
+		 * The output may have wrapped around the buffer while it was
+		 * copied; read again from the new oldest byte once.
+		 */
+		oldest = tx_seq - (CONFIG_UART_TX_BUF_SIZE - 1);
+		if ((int32_t)(*first_seq - oldest) >= 0)
+			break;
+		seq = oldest;
+	} while (retry--);
+
+	*next_seq = seq;
+	return EC_RES_SUCCESS;
+}
+
+#ifdef CONFIG_MKBP_EVENT
+void uart_console_set_watermark(uint32_t seq, uint32_t watermark)
+{
+	if (!watermark) {
+		tx_watermark_armed = 0;
+		return;
+	}
+
+	tx_seq_watermark = seq + watermark;
+	tx_watermark_armed = 1;
+	/* The output may already be past the watermark */
+	if ((int32_t)(tx_seq - tx_seq_watermark) >= 0) {
+		tx_watermark_armed = 0;
+		hook_call_deferred(&console_data_event_data, 0);
+	}
+}
+
+static int console_get_next_event(uint8_t *out)
+{
+	uint32_t head = tx_seq;
+
+	memcpy(out, &head, sizeof(head));
+	return sizeof(head);
+}
+DECLARE_EVENT_SOURCE(EC_MKBP_EVENT_CONSOLE_DATA, console_get_next_event);
+#endif /* CONFIG_MKBP_EVENT */
+#endif /* CONFIG_CONSOLE_ENABLE_READ_V2 */
+
 /*****************************************************************************/
 /* Host commands */
 
@@ -439,6 +632,25 @@ host_command_console_read(struct host_cmd_handler_args *args)
 				(char *)args->response,
 				args->response_max,
 				&args->response_size);
+#endif
+#ifdef CONFIG_CONSOLE_ENABLE_READ_V2
+	} else if (args->version == 2) {
+		const struct ec_params_console_read_v2 *p = args->params;
+		struct ec_response_console_read_v2 *r = args->response;
+		uint16_t count;
+
+		if (args->response_max < sizeof(*r))
+			return EC_RES_INVALID_PARAM;
+
+		uart_console_read_seq(p->seq, r->data,
+				      args->response_max - sizeof(*r),
+				      &count, &r->seq, &r->next_seq);
+		r->head_seq = tx_seq;
+		args->response_size = sizeof(*r) + count;
+#ifdef CONFIG_MKBP_EVENT
+		uart_console_set_watermark(r->next_seq, p->watermark);
+#endif
+		return EC_RES_SUCCESS;
 #endif
 	}
 	return EC_RES_INVALID_PARAM;
@@ -448,6 +660,9 @@ DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ,
 		     EC_VER_MASK(0)
 #ifdef CONFIG_CONSOLE_ENABLE_READ_V1
 		     | EC_VER_MASK(1)
+#endif
+#ifdef CONFIG_CONSOLE_ENABLE_READ_V2
+		     | EC_VER_MASK(2)
 #endif
 		     );
 
@@ -522,3 +737,31 @@ int uart_console_read_buffer(uint8_t type,
 
 	return EC_RES_SUCCESS;
 }
+
+#ifdef CONFIG_UART_STATS
+static int command_uart_stats(int argc, char **argv)
+{
+	uint32_t written = uart_stats.written;
+	uint32_t dropped = uart_stats.dropped;
+	uint32_t calls = uart_stats.calls;
+	uint32_t time_us = uart_stats.time_us;
+	uint32_t max_us = uart_stats.max_us;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "reset"))
+			return EC_ERROR_PARAM1;
+		memset(&uart_stats, 0, sizeof(uart_stats));
+		return EC_SUCCESS;
+	}
+
+	ccprintf("Written: %u bytes\n", written);
+	ccprintf("Dropped: %u writes\n", dropped);
+	ccprintf("IRQ:     %u calls, %u us (max %u us)\n", calls, time_us,
+		 max_us);
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(uartstats, command_uart_stats,
+			     "[reset]",
+			     "Print UART output statistics");
+#endif /* CONFIG_UART_STATS */
@@ -78,7 +78,7 @@ void usb_charger_vbus_change(int port, int vbus_level)
 #if (defined(CONFIG_USB_PD_VBUS_DETECT_CHARGER) \
 	|| defined(CONFIG_USB_PD_VBUS_DETECT_PPC))
 	/* USB PD task */
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 #endif
 }
 
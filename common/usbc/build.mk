@@ -30,6 +30,7 @@ all-obj-$(CONFIG_USB_CTVPD)+=$(_usbc_dir)usb_pe_ctvpd_sm.o
 all-obj-$(CONFIG_USB_DRP_ACC_TRYSRC)+=$(_usbc_dir)usb_pe_drp_sm.o
 all-obj-$(CONFIG_USB_DRP_ACC_TRYSRC)+=$(_usbc_dir)usb_pd_dpm.o
 all-obj-$(CONFIG_USB_DRP_ACC_TRYSRC)+=$(_usbc_dir)dp_alt_mode.o
+all-obj-$(CONFIG_USB_PD_DISCOVERY_CACHE)+=$(_usbc_dir)usb_pd_disc_cache.o
 all-obj-$(CONFIG_USB_PD_TBT_COMPAT_MODE)+=$(_usbc_dir)tbt_alt_mode.o
 all-obj-$(CONFIG_USB_PD_USB4)+=$(_usbc_dir)usb_mode.o
 all-obj-$(CONFIG_CMD_PD)+=$(_usbc_dir)usb_pd_console.o
@@ -41,3 +42,4 @@ endif # CONFIG_USB_PD_TCPMV2
 # For testing
 all-obj-$(CONFIG_TEST_USB_PE_SM)+=$(_usbc_dir)usb_pe_drp_sm.o
 all-obj-$(CONFIG_TEST_SM)+=$(_usbc_dir)usb_sm.o
+all-obj-$(CONFIG_TEST_USB_PD_DISC_CACHE)+=$(_usbc_dir)usb_pd_disc_cache.o
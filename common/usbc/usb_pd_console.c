@@ -10,6 +10,7 @@
 #include "usb_prl_sm.h"
 #include "usb_tc_sm.h"
 #include "usb_pd.h"
+#include "usb_sm.h"
 #include "util.h"
 
 test_export_static int command_pd(int argc, char **argv)
@@ -58,6 +59,21 @@ test_export_static int command_pd(int argc, char **argv)
 	} else if (!strcasecmp(argv[1], "version")) {
 		ccprintf("%d\n", PD_STACK_VERSION);
 		return EC_SUCCESS;
+	} else if (IS_ENABLED(CONFIG_USB_SM_STATS) &&
+		   !strcasecmp(argv[1], "smstats")) {
+		if (argc >= 3) {
+			if (strcasecmp(argv[2], "clear"))
+				return EC_ERROR_PARAM2;
+			usb_sm_clear_stats();
+			return EC_SUCCESS;
+		}
+
+		usb_sm_print_port_stats();
+		tc_print_sm_stats();
+		if (IS_ENABLED(CONFIG_USB_PRL_SM))
+			prl_print_sm_stats();
+		pe_print_sm_stats();
+		return EC_SUCCESS;
 	}
 
 	/* command: pd <port> <subcmd> [args] */
@@ -181,6 +197,9 @@ test_export_static int command_pd(int argc, char **argv)
 DECLARE_CONSOLE_COMMAND(pd, command_pd,
 	 "version"
 	 "\ndump [0|1|2|3]"
+#ifdef CONFIG_USB_SM_STATS
+	 "\nsmstats [clear]"
+#endif
 #ifdef CONFIG_USB_PD_TRY_SRC
 	"\ntrysrc [0|1|2]"
 #endif
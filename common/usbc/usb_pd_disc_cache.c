@@ -0,0 +1,408 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Cache of the SVIDs and modes discovered for port partners and cable plugs
+ */
+
+#include "common.h"
+#include "console.h"
+#include "crc8.h"
+#include "hooks.h"
+#include "system.h"
+#include "usb_pd.h"
+#include "usb_pd_disc_cache.h"
+#include "util.h"
+
+/* The unit test builds the cache without the PD stack */
+#if defined(CONFIG_COMMON_RUNTIME) && defined(CONFIG_USB_POWER_DELIVERY)
+#define CPRINTS(format, args...) cprints(CC_USBPD, format, ## args)
+#else
+#define CPRINTS(format, args...)
+#endif
+
+/* Partners with more SVIDs are not cached */
+#define DISC_CACHE_SVID_MAX 4
+
+#define DISC_CACHE_SYSJUMP_TAG 0x4430 /* "D0", one tag per entry */
+#define DISC_CACHE_SYSJUMP_VERSION 2
+
+/* Identity of a partner or cable plug */
+struct disc_cache_key {
+	uint32_t xid;
+	uint16_t vid;
+	uint16_t pid;
+	uint16_t bcd_device;
+	uint16_t type;
+};
+
+struct disc_cache_entry {
+	/* Value of use_count when last used, 0 for a free entry */
+	uint32_t last_used;
+	struct disc_cache_key key;
+	enum pd_discovery_state svids_discovery;
+	int svid_cnt;
+	struct svid_mode_data svids[DISC_CACHE_SVID_MAX];
+};
+
+/* Entry preserved across a sysjump */
+struct disc_cache_jump_tag {
+	struct disc_cache_entry entry;
+	/* CRC8 of entry */
+	uint8_t crc;
+};
+
+/* A jump tag holds less than 255 bytes */
+BUILD_ASSERT(sizeof(struct disc_cache_jump_tag) < 255);
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+BUILD_ASSERT(CONFIG_USB_PD_DISCOVERY_CACHE_SIZE <= 10);
+#endif
+
+static struct disc_cache_entry cache[CONFIG_USB_PD_DISCOVERY_CACHE_SIZE];
+static uint32_t use_count;
+static struct pd_disc_cache_stats stats;
+
+/* What to do with the discovery of a port, once complete */
+enum disc_cache_state {
+	DISC_CACHE_NONE = 0,	/* Not cacheable, or already stored */
+	DISC_CACHE_MISS,	/* Store in the cache */
+	DISC_CACHE_RESTORED,	/* Restored from the cache, not revalidated */
+	DISC_CACHE_REVALIDATING,/* Compare with the cache */
+};
+
+static enum disc_cache_state
+	port_state[CONFIG_USB_PD_PORT_MAX_COUNT][DISCOVERY_TYPE_COUNT];
+
+/*
+ * SVIDs and modes discovered again while revalidating, one type at a time per
+ * port. The restored ones stay in place until revalidation completes.
+ */
+static struct pd_discovery revalidation[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+static bool disc_cache_get_key(enum tcpm_transmit_type type,
+			       const struct pd_discovery *disc,
+			       struct disc_cache_key *key)
+{
+	/* The key needs the ID Header, Cert Stat and Product VDOs */
+	if (disc->identity_discovery != PD_DISC_COMPLETE ||
+	    disc->identity_cnt < 3)
+		return false;
+
+	memset(key, 0, sizeof(*key));
+	key->vid = disc->identity.idh.usb_vendor_id;
+	key->pid = disc->identity.product.product_id;
+	key->bcd_device = disc->identity.product.bcd_device;
+	key->xid = disc->identity.cert.xid;
+	key->type = type;
+
+	/* Without a VID, unrelated partners would share an entry */
+	return key->vid != 0;
+}
+
+static struct disc_cache_entry *disc_cache_find(
+		const struct disc_cache_key *key)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++)
+		if (cache[i].last_used &&
+		    !memcmp(&cache[i].key, key, sizeof(*key)))
+			return &cache[i];
+
+	return NULL;
+}
+
+/* Returns a free entry, or the least recently used one */
+static struct disc_cache_entry *disc_cache_alloc(void)
+{
+	struct disc_cache_entry *lru = &cache[0];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!cache[i].last_used)
+			return &cache[i];
+		if (cache[i].last_used < lru->last_used)
+			lru = &cache[i];
+	}
+
+	stats.evictions++;
+	return lru;
+}
+
+static void disc_cache_touch(struct disc_cache_entry *entry)
+{
+	entry->last_used = ++use_count;
+}
+
+static bool disc_cache_matches(const struct disc_cache_entry *entry,
+			       const struct pd_discovery *disc)
+{
+	int i;
+
+	if (entry->svids_discovery != disc->svids_discovery ||
+	    entry->svid_cnt != disc->svid_cnt)
+		return false;
+
+	for (i = 0; i < entry->svid_cnt; i++) {
+		const struct svid_mode_data *a = &entry->svids[i];
+		const struct svid_mode_data *b = &disc->svids[i];
+
+		if (a->svid != b->svid || a->discovery != b->discovery ||
+		    a->mode_cnt != b->mode_cnt ||
+		    memcmp(a->mode_vdo, b->mode_vdo,
+			   a->mode_cnt * sizeof(uint32_t)))
+			return false;
+	}
+
+	return true;
+}
+
+static void disc_cache_store(struct disc_cache_entry *entry,
+			     const struct disc_cache_key *key,
+			     const struct pd_discovery *disc)
+{
+	entry->key = *key;
+	entry->svids_discovery = disc->svids_discovery;
+	entry->svid_cnt = disc->svid_cnt;
+	memcpy(entry->svids, disc->svids,
+	       disc->svid_cnt * sizeof(struct svid_mode_data));
+	disc_cache_touch(entry);
+}
+
+bool pd_disc_cache_restore(int port, enum tcpm_transmit_type type,
+			   struct pd_discovery *disc)
+{
+	struct disc_cache_key key;
+	struct disc_cache_entry *entry;
+
+	port_state[port][type] = DISC_CACHE_NONE;
+
+	if (!disc_cache_get_key(type, disc, &key))
+		return false;
+
+	entry = disc_cache_find(&key);
+	if (!entry) {
+		stats.misses++;
+		port_state[port][type] = DISC_CACHE_MISS;
+		return false;
+	}
+
+	stats.hits++;
+	disc_cache_touch(entry);
+
+	disc->svids_discovery = entry->svids_discovery;
+	disc->svid_cnt = entry->svid_cnt;
+	memcpy(disc->svids, entry->svids,
+	       entry->svid_cnt * sizeof(struct svid_mode_data));
+	/* Mode discovery walks the SVIDs in order, and is done */
+	disc->svid_idx = entry->svid_cnt;
+
+	port_state[port][type] = DISC_CACHE_RESTORED;
+	return true;
+}
+
+bool pd_disc_cache_revalidate(int port, enum tcpm_transmit_type type,
+			      const struct pd_discovery *disc)
+{
+	struct pd_discovery *scratch = &revalidation[port];
+	enum tcpm_transmit_type other;
+
+	if (port_state[port][type] != DISC_CACHE_RESTORED)
+		return false;
+
+	for (other = TCPC_TX_SOP; other < DISCOVERY_TYPE_COUNT; other++)
+		if (port_state[port][other] == DISC_CACHE_REVALIDATING)
+			return false;
+
+	/* Keep the identity, and discover the SVIDs and modes again */
+	scratch->identity = disc->identity;
+	scratch->identity_cnt = disc->identity_cnt;
+	scratch->identity_discovery = disc->identity_discovery;
+	scratch->svids_discovery = PD_DISC_NEEDED;
+	scratch->svid_cnt = 0;
+	scratch->svid_idx = 0;
+	memset(scratch->svids, 0, sizeof(scratch->svids));
+
+	port_state[port][type] = DISC_CACHE_REVALIDATING;
+	return true;
+}
+
+struct pd_discovery *pd_disc_cache_get_revalidation(int port,
+		enum tcpm_transmit_type type)
+{
+	if (port_state[port][type] != DISC_CACHE_REVALIDATING)
+		return NULL;
+
+	return &revalidation[port];
+}
+
+bool pd_disc_cache_is_pending(int port, enum tcpm_transmit_type type)
+{
+	return port_state[port][type] != DISC_CACHE_NONE;
+}
+
+bool pd_disc_cache_is_revalidating(int port, enum tcpm_transmit_type type)
+{
+	return port_state[port][type] == DISC_CACHE_REVALIDATING;
+}
+
+bool pd_disc_cache_update(int port, enum tcpm_transmit_type type,
+			  struct pd_discovery *disc)
+{
+	enum disc_cache_state state = port_state[port][type];
+	const struct pd_discovery *found = disc;
+	struct disc_cache_key key;
+	struct disc_cache_entry *entry;
+	bool stale = false;
+
+	if (state != DISC_CACHE_MISS && state != DISC_CACHE_REVALIDATING)
+		return false;
+
+	port_state[port][type] = DISC_CACHE_NONE;
+
+	if (state == DISC_CACHE_REVALIDATING) {
+		found = &revalidation[port];
+
+		/*
+		 * Copy over the restored SVIDs and modes in place: alternate
+		 * modes entered from them keep pointers to their
+		 * svid_mode_data.
+		 */
+		disc->svids_discovery = found->svids_discovery;
+		disc->svid_cnt = found->svid_cnt;
+		disc->svid_idx = found->svid_idx;
+		memcpy(disc->svids, found->svids, sizeof(disc->svids));
+	}
+
+	if (!disc_cache_get_key(type, found, &key))
+		return false;
+
+	entry = disc_cache_find(&key);
+	if (entry && state == DISC_CACHE_REVALIDATING &&
+	    !disc_cache_matches(entry, found)) {
+		CPRINTS("C%d: Cached discovery of %04x:%04x is stale",
+			port, key.vid, key.pid);
+		stats.stale++;
+		stale = true;
+	}
+
+	if (found->svid_cnt > DISC_CACHE_SVID_MAX) {
+		/* Too big to cache; a stale entry must not be used again */
+		if (entry)
+			entry->last_used = 0;
+		return stale;
+	}
+
+	if (!entry)
+		entry = disc_cache_alloc();
+	disc_cache_store(entry, &key, found);
+
+	return stale;
+}
+
+void pd_disc_cache_init_port(int port)
+{
+	memset(port_state[port], 0, sizeof(port_state[port]));
+}
+
+void pd_disc_cache_clear(void)
+{
+	memset(cache, 0, sizeof(cache));
+	memset(&stats, 0, sizeof(stats));
+	use_count = 0;
+}
+
+void pd_disc_cache_get_stats(struct pd_disc_cache_stats *out)
+{
+	*out = stats;
+}
+
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+static void disc_cache_preserve(void)
+{
+	struct disc_cache_jump_tag tag;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!cache[i].last_used)
+			continue;
+
+		memset(&tag, 0, sizeof(tag));
+		tag.entry = cache[i];
+		tag.crc = cros_crc8((const uint8_t *)&tag.entry,
+				    sizeof(tag.entry));
+		system_add_jump_tag(DISC_CACHE_SYSJUMP_TAG + i,
+				    DISC_CACHE_SYSJUMP_VERSION,
+				    sizeof(tag), &tag);
+	}
+}
+DECLARE_HOOK(HOOK_SYSJUMP, disc_cache_preserve, HOOK_PRIO_DEFAULT);
+
+static void disc_cache_init(void)
+{
+	const struct disc_cache_jump_tag *prev;
+	int version, size, i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		prev = (const struct disc_cache_jump_tag *)system_get_jump_tag(
+				DISC_CACHE_SYSJUMP_TAG + i, &version, &size);
+		if (!prev || version != DISC_CACHE_SYSJUMP_VERSION ||
+		    size != sizeof(*prev))
+			continue;
+
+		/* Entries restored in the wrong place would be used as is */
+		if (prev->crc != cros_crc8((const uint8_t *)&prev->entry,
+					   sizeof(prev->entry)) ||
+		    !prev->entry.last_used || !prev->entry.key.vid ||
+		    prev->entry.svid_cnt > DISC_CACHE_SVID_MAX ||
+		    prev->entry.key.type >= DISCOVERY_TYPE_COUNT) {
+			CPRINTS("Dropping discovery cache entry %d", i);
+			continue;
+		}
+
+		cache[i] = prev->entry;
+		use_count = MAX(use_count, cache[i].last_used);
+	}
+}
+DECLARE_HOOK(HOOK_INIT, disc_cache_init, HOOK_PRIO_DEFAULT);
+#endif /* CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP */
+
+#ifdef CONFIG_CMD_USB_PD_DISC_CACHE
+static int command_pdcache(int argc, char **argv)
+{
+	int i, j;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		pd_disc_cache_clear();
+		return EC_SUCCESS;
+	}
+
+	ccprintf("hits %u misses %u stale %u evictions %u\n",
+		 stats.hits, stats.misses, stats.stale, stats.evictions);
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		const struct disc_cache_entry *entry = &cache[i];
+
+		if (!entry->last_used)
+			continue;
+
+		ccprintf("%d: %s %04x:%04x bcd %04x xid %08x SVIDs",
+			 i, entry->key.type == TCPC_TX_SOP ? "SOP " : "SOP'",
+			 entry->key.vid, entry->key.pid,
+			 entry->key.bcd_device, entry->key.xid);
+		for (j = 0; j < entry->svid_cnt; j++)
+			ccprintf(" %04x/%d", entry->svids[j].svid,
+				 entry->svids[j].mode_cnt);
+		ccprintf("\n");
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(pdcache, command_pdcache,
+			"[clear]",
+			"Show or clear the USB PD discovery cache");
+#endif /* CONFIG_CMD_USB_PD_DISC_CACHE */
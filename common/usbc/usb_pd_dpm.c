@@ -91,6 +91,11 @@ static void dpm_set_mode_entry_done(int port)
 			DPM_FLAG_ENTER_USB4);
 }
 
+bool dpm_is_mode_entry_done(int port)
+{
+	return !!DPM_CHK_FLAG(port, DPM_FLAG_MODE_ENTRY_DONE);
+}
+
 void dpm_set_mode_exit_request(int port)
 {
 	DPM_SET_FLAG(port, DPM_FLAG_EXIT_REQUEST);
@@ -20,6 +20,7 @@
 #include "usb_common.h"
 #include "usb_dp_alt_mode.h"
 #include "usb_mode.h"
+#include "usb_pd_disc_cache.h"
 #include "usb_pd_dpm.h"
 #include "usb_pd.h"
 #include "usb_pd_tcpm.h"
@@ -581,6 +582,8 @@ static struct policy_engine {
 
 	/* Partner type to send */
 	enum tcpm_transmit_type tx_type;
+	/* VDM requests revalidate the discovery cache for tx_type */
+	bool disc_cache_revalidation;
 
 	/* VDM - used to send information to shared VDM Request state */
 	uint32_t vdm_cnt;
@@ -938,7 +941,7 @@ void pe_message_received(int port)
 	assert(port == TASK_ID_TO_PD_PORT(task_get_current()));
 
 	PE_SET_FLAG(port, PE_FLAGS_MSG_RECEIVED);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void pe_hard_reset_sent(int port)
@@ -978,7 +981,7 @@ void pe_got_hard_reset(int port)
 void pd_got_frs_signal(int port)
 {
 	PE_SET_FLAG(port, PE_FLAGS_FAST_ROLE_SWAP_SIGNALED);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 /*
@@ -1267,7 +1270,7 @@ void pe_report_error(int port, enum pe_error e, enum tcpm_transmit_type type)
 			    get_state_pe(port) == PE_PRS_SNK_SRC_SEND_SWAP)
 			) {
 		PE_SET_FLAG(port, PE_FLAGS_PROTOCOL_ERROR);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 		return;
 	}
 
@@ -1394,7 +1397,7 @@ void pe_message_sent(int port)
 	assert(port == TASK_ID_TO_PD_PORT(task_get_current()));
 
 	PE_SET_FLAG(port, PE_FLAGS_TX_COMPLETE);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void pd_send_vdm(int port, uint32_t vid, int cmd, const uint32_t *data,
@@ -1411,7 +1414,7 @@ void pd_send_vdm(int port, uint32_t vid, int cmd, const uint32_t *data,
 
 	pe[port].vdm_cnt = count + 1;
 
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 static void pe_handle_detach(void)
@@ -1680,6 +1683,90 @@ static bool port_try_vconn_swap(int port)
 	return false;
 }
 
+/*
+ * Restore the SVIDs and modes of a partner or cable plug from the discovery
+ * cache once its identity is discovered, so the DPM can enter modes without
+ * waiting for Discover SVIDs and Discover Modes.
+ */
+static void pe_disc_cache_restore(int port, enum tcpm_transmit_type type)
+{
+	if (!IS_ENABLED(CONFIG_USB_PD_DISCOVERY_CACHE))
+		return;
+
+	if (pd_get_identity_discovery(port, type) != PD_DISC_COMPLETE)
+		return;
+
+	if (pd_disc_cache_restore(port, type, &pe[port].discovery[type]))
+		pe_notify_event(port, type == TCPC_TX_SOP ?
+				PD_STATUS_EVENT_SOP_DISC_DONE :
+				PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
+}
+
+/*
+ * Keep the discovery cache up to date from PE_SNK_Ready or PE_SRC_Ready: store
+ * the discovery of a new partner or cable plug once complete, and, as a DFP,
+ * discover the SVIDs and modes of a cached one again once the DPM is done with
+ * mode entry.
+ *
+ * Return indicates whether set_state was called, in which case the calling
+ * function should return as well.
+ */
+static bool pe_disc_cache_run(int port)
+{
+	enum tcpm_transmit_type type;
+
+	if (!IS_ENABLED(CONFIG_USB_PD_DISCOVERY_CACHE))
+		return false;
+
+	for (type = TCPC_TX_SOP; type < DISCOVERY_TYPE_COUNT; type++) {
+		struct pd_discovery *disc = &pe[port].discovery[type];
+
+		if (!pd_disc_cache_is_pending(port, type))
+			continue;
+
+		/* A UFP cannot discover; keep the restored data until then */
+		if (pe[port].data_role == PD_ROLE_DFP &&
+		    dpm_is_mode_entry_done(port))
+			pd_disc_cache_revalidate(port, type, disc);
+
+		if (pd_disc_cache_is_revalidating(port, type)) {
+			if (pe[port].data_role != PD_ROLE_DFP ||
+			    (type == TCPC_TX_SOP &&
+			     !pe_can_send_sop_vdm(port, CMD_DISCOVER_SVID)))
+				continue;
+
+			/* Discover into the copy from the cache */
+			pe[port].tx_type = type;
+			pe[port].disc_cache_revalidation = true;
+			if (pd_get_svids_discovery(port, type) ==
+					PD_DISC_NEEDED) {
+				set_state_pe(port, PE_INIT_VDM_SVIDS_REQUEST);
+				return true;
+			} else if (pd_get_modes_discovery(port, type) ==
+					PD_DISC_NEEDED) {
+				set_state_pe(port, PE_INIT_VDM_MODES_REQUEST);
+				return true;
+			}
+			pe[port].disc_cache_revalidation = false;
+		} else if (pd_get_svids_discovery(port, type) ==
+				PD_DISC_NEEDED ||
+			   pd_get_modes_discovery(port, type) ==
+				PD_DISC_NEEDED) {
+			continue;
+		}
+
+		/*
+		 * Modes entered from stale data may not match the partner
+		 * anymore; start over with what was just discovered.
+		 */
+		if (pd_disc_cache_update(port, type, disc) &&
+		    PE_CHK_FLAG(port, PE_FLAGS_MODAL_OPERATION))
+			pd_dpm_request(port, DPM_REQUEST_HARD_RESET_SEND);
+	}
+
+	return false;
+}
+
 /*
  * Run discovery at our leisure from PE_SNK_Ready or PE_SRC_Ready, after
  * attempting to get into the desired default policy of DFP/Vconn source
@@ -1692,6 +1779,9 @@ __maybe_unused static bool pe_attempt_port_discovery(int port)
 	if (!IS_ENABLED(CONFIG_USB_PD_ALT_MODE_DFP))
 		assert(0);
 
+	if (pe_disc_cache_run(port))
+		return true;
+
 	/*
 	 * DONE set once modal entry is successful, discovery completes, or
 	 * discovery results in a NAK
@@ -5184,6 +5274,7 @@ static void pe_vdm_identity_request_cbl_run(int port)
 	case VDM_RESULT_ACK:
 		/* PE_INIT_PORT_VDM_Identity_ACKed embedded here */
 		dfp_consume_identity(port, sop, cnt, payload);
+		pe_disc_cache_restore(port, sop);
 
 		/*
 		 * Note: If port partner runs PD 2.0, we must use PD 2.0 to
@@ -5327,6 +5418,7 @@ static void pe_init_port_vdm_identity_request_run(int port)
 
 		/* PE_INIT_PORT_VDM_Identity_ACKed embedded here */
 		dfp_consume_identity(port, sop, cnt, payload);
+		pe_disc_cache_restore(port, sop);
 
 		break;
 		}
@@ -5455,6 +5547,8 @@ static void pe_init_vdm_svids_request_exit(int port)
 		pe_notify_event(port, pe[port].tx_type == TCPC_TX_SOP ?
 				PD_STATUS_EVENT_SOP_DISC_DONE :
 				PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
+
+	pe[port].disc_cache_revalidation = false;
 }
 
 /**
@@ -5566,6 +5660,8 @@ static void pe_init_vdm_modes_request_exit(int port)
 				PD_STATUS_EVENT_SOP_DISC_DONE :
 				PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
 
+	pe[port].disc_cache_revalidation = false;
+
 }
 
 /**
@@ -6567,6 +6663,9 @@ void pd_dfp_discovery_init(int port)
 	memset(pe[port].discovery, 0, sizeof(pe[port].discovery));
 	memset(pe[port].partner_amodes, 0, sizeof(pe[port].partner_amodes));
 
+	if (IS_ENABLED(CONFIG_USB_PD_DISCOVERY_CACHE))
+		pd_disc_cache_init_port(port);
+
 	/* Reset the DPM and DP modules to enable alternate mode entry. */
 	dpm_init(port);
 	dp_init(port);
@@ -6604,6 +6703,21 @@ __maybe_unused struct pd_discovery *pd_get_am_discovery(int port,
 	ASSERT(type < DISCOVERY_TYPE_COUNT);
 
 	atomic_or(&task_access[port][type], BIT(task_get_current()));
+
+	/*
+	 * The VDM requests that revalidate the discovery cache work on its
+	 * copy; everything else keeps reading the restored discovery.
+	 */
+	if (IS_ENABLED(CONFIG_USB_PD_DISCOVERY_CACHE) &&
+	    pe[port].disc_cache_revalidation && type == pe[port].tx_type &&
+	    task_get_current() == PD_PORT_TO_TASK_ID(port)) {
+		struct pd_discovery *disc =
+			pd_disc_cache_get_revalidation(port, type);
+
+		if (disc)
+			return disc;
+	}
+
 	return &pe[port].discovery[type];
 }
 
@@ -6957,6 +7071,14 @@ static const struct usb_state pe_states[] = {
 #endif /* CONFIG_USB_PD_REV30 */
 };
 
+#ifdef CONFIG_USB_SM_STATS
+void pe_print_sm_stats(void)
+{
+	usb_sm_print_stats("PE", pe_states, ARRAY_SIZE(pe_states),
+			   pe_state_names, ARRAY_SIZE(pe_state_names));
+}
+#endif
+
 #ifdef TEST_BUILD
 /* TODO(b/173791979): Unit tests shouldn't need to access internal states */
 const struct test_sm_data test_pe_sm_data[] = {
@@ -527,7 +527,7 @@ void pd_execute_hard_reset(int port)
 
 	PRL_HR_SET_FLAG(port, PRL_FLAGS_PORT_PARTNER_HARD_RESET);
 	set_state_prl_hr(port, PRL_HR_RESET_LAYER);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void prl_execute_hard_reset(int port)
@@ -538,7 +538,7 @@ void prl_execute_hard_reset(int port)
 
 	PRL_HR_SET_FLAG(port, PRL_FLAGS_PE_HARD_RESET);
 	set_state_prl_hr(port, PRL_HR_RESET_LAYER);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 int prl_is_running(int port)
@@ -572,6 +572,7 @@ static void prl_init(int port)
 
 	for (i = 0; i < NUM_SOP_STAR_TYPES; i++) {
 		prl_rx[port].msg_id[i] = -1;
+		tcpm_reset_rx_msg_id(port, i);
 		prl_tx[port].msg_id_counter[i] = 0;
 	}
 
@@ -613,7 +614,7 @@ void prl_set_debug_level(enum debug_level debug_level)
 void prl_hard_reset_complete(int port)
 {
 	PRL_HR_SET_FLAG(port, PRL_FLAGS_HARD_RESET_COMPLETE);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void prl_send_ctrl_msg(int port,
@@ -633,7 +634,7 @@ void prl_send_ctrl_msg(int port,
 	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
 #endif /* CONFIG_USB_PD_REV30 */
 
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void prl_send_data_msg(int port,
@@ -652,7 +653,7 @@ void prl_send_data_msg(int port,
 	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
 #endif /* CONFIG_USB_PD_REV30 */
 
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 #ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
@@ -665,7 +666,7 @@ void prl_send_ext_data_msg(int port,
 	pdmsg[port].ext = 1;
 
 	TCH_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 #endif /* CONFIG_USB_PD_EXTENDED_MESSAGES */
 
@@ -688,7 +689,7 @@ void prl_reset_soft(int port)
 	local_state[port] = SM_INIT;
 
 	/* Ensure we process the reset quickly */
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void prl_reset(int port)
@@ -697,7 +698,7 @@ void prl_reset(int port)
 	local_state[port] = SM_INIT;
 
 	/* Ensure we process the reset quickly */
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void prl_run(int port, int evt, int en)
@@ -1019,6 +1020,7 @@ static void prl_tx_layer_reset_for_transmit_entry(const int port)
 		 * clear the MessageID here.
 		 */
 		prl_rx[port].msg_id[pdmsg[port].xmit_type] = -1;
+		tcpm_reset_rx_msg_id(port, pdmsg[port].xmit_type);
 	}
 }
 
@@ -1118,7 +1120,7 @@ static void prl_tx_wait_for_phy_response_run(const int port)
 		 * This event reduces the time of informing the policy engine of
 		 * the transmission by one state machine cycle
 		 */
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 		set_state_prl_tx(port, PRL_TX_WAIT_FOR_MESSAGE_REQUEST);
 	} else if (get_time().val > prl_tx[port].tcpc_tx_timeout ||
 		   prl_tx[port].xmit_status == TCPC_TX_COMPLETE_FAILED ||
@@ -1268,6 +1270,7 @@ static void prl_hr_reset_layer_entry(const int port)
 	/* Hard reset resets messageIDCounters for all TX types */
 	for (i = 0; i < NUM_SOP_STAR_TYPES; i++) {
 		prl_rx[port].msg_id[i] = -1;
+		tcpm_reset_rx_msg_id(port, i);
 		prl_tx[port].msg_id_counter[i] = 0;
 	}
 
@@ -1572,7 +1575,7 @@ static void rch_requesting_chunk_entry(const int port)
 	pdmsg[port].data_objs = 1;
 	pdmsg[port].ext = 1;
 	PRL_TX_SET_FLAG(port, PRL_FLAGS_MSG_XMIT);
-	task_set_event(PD_PORT_TO_TASK_ID(port), PD_EVENT_TX);
+	pd_task_set_event(port, PD_EVENT_TX);
 }
 
 static void rch_requesting_chunk_run(const int port)
@@ -2086,6 +2089,7 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 		prl_tx[port].msg_id_counter[prl_rx[port].sop] = 0;
 		/* Clear stored MessageID value */
 		prl_rx[port].msg_id[prl_rx[port].sop] = -1;
+		tcpm_reset_rx_msg_id(port, prl_rx[port].sop);
 
 		/* Soft Reset occurred */
 		set_state_prl_tx(port, PRL_TX_PHY_LAYER_RESET);
@@ -2182,7 +2186,7 @@ static void prl_rx_wait_for_phy_message(const int port, int evt)
 		pe_message_received(port);
 	}
 
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 /* All necessary Protocol Transmit States (Section 6.11.2.2) */
@@ -2312,6 +2316,22 @@ __maybe_unused static const struct usb_state tch_states[] = {
 #endif
 };
 
+#ifdef CONFIG_USB_SM_STATS
+void prl_print_sm_stats(void)
+{
+	usb_sm_print_stats("PRL TX", prl_tx_states, ARRAY_SIZE(prl_tx_states),
+			   prl_tx_state_names, ARRAY_SIZE(prl_tx_state_names));
+	usb_sm_print_stats("PRL HR", prl_hr_states, ARRAY_SIZE(prl_hr_states),
+			   prl_hr_state_names, ARRAY_SIZE(prl_hr_state_names));
+#ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
+	usb_sm_print_stats("RCH", rch_states, ARRAY_SIZE(rch_states),
+			   rch_state_names, ARRAY_SIZE(rch_state_names));
+	usb_sm_print_stats("TCH", tch_states, ARRAY_SIZE(tch_states),
+			   tch_state_names, ARRAY_SIZE(tch_state_names));
+#endif /* CONFIG_USB_PD_EXTENDED_MESSAGES */
+}
+#endif /* CONFIG_USB_SM_STATS */
+
 #ifdef TEST_BUILD
 
 const struct test_sm_data test_prl_sm_data[] = {
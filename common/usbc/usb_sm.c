@@ -7,6 +7,7 @@
 #include "console.h"
 #include "stdbool.h"
 #include "task.h"
+#include "timer.h"
 #include "usb_pd.h"
 #include "usb_sm.h"
 #include "util.h"
@@ -29,86 +30,168 @@ struct internal_ctx {
 BUILD_ASSERT(sizeof(struct internal_ctx) ==
 	     member_size(struct sm_ctx, internal));
 
-/* Gets the first shared parent state between a and b (inclusive) */
-static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
+/*
+ * Fill path with the ancestors of state, from the outermost parent down to
+ * state itself.
+ *
+ * @return the depth of state, 0 for NULL.
+ */
+static int get_state_path(usb_state_ptr state,
+			  usb_state_ptr path[USB_SM_MAX_DEPTH])
 {
-	const usb_state_ptr orig_b = b;
-
-	/* There are no common ancestors */
-	if (b == NULL)
-		return NULL;
-
-	/* This assumes that both A and B are NULL terminated without cycles */
-	while (a != NULL) {
-		/* We found a match return */
-		if (a == b)
-			return a;
-
-		/*
-		 * Otherwise, increment b down the list for comparison until we
-		 * run out, then increment a and start over on b for comparison
-		 */
-		if (b->parent == NULL) {
-			a = a->parent;
-			b = orig_b;
-		} else {
-			b = b->parent;
+	usb_state_ptr s;
+	int depth = 0;
+	int i;
+
+	for (s = state; s != NULL; s = s->parent)
+		depth++;
+
+	ASSERT(depth <= USB_SM_MAX_DEPTH);
+	depth = MIN(depth, USB_SM_MAX_DEPTH);
+
+	for (s = state, i = depth; i > 0; s = s->parent)
+		path[--i] = s;
+
+	return depth;
+}
+
+#ifdef CONFIG_USB_SM_STATS
+/* Per state statistics, in an open addressing table keyed by state. */
+struct state_stats {
+	usb_state_ptr state;
+	uint32_t entries;
+	uint32_t time_us;
+};
+
+#define STATE_STATS_SLOTS 256
+BUILD_ASSERT(POWER_OF_TWO(STATE_STATS_SLOTS));
+
+static struct state_stats state_stats[STATE_STATS_SLOTS];
+static uint32_t state_stats_dropped;
+
+static struct {
+	uint32_t transitions;
+	uint32_t time_us;
+	uint32_t max_us;
+} port_stats[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+static struct state_stats *get_state_stats(usb_state_ptr state)
+{
+	/* States are consecutive in arrays, so their index hashes well. */
+	uint32_t slot = (uintptr_t)state / sizeof(struct usb_state);
+	int i;
+
+	for (i = 0; i < STATE_STATS_SLOTS; i++, slot++) {
+		struct state_stats *st =
+			&state_stats[slot & (STATE_STATS_SLOTS - 1)];
+
+		if (st->state == state)
+			return st;
+		if (st->state == NULL) {
+			st->state = state;
+			return st;
 		}
 	}
 
+	state_stats_dropped++;
 	return NULL;
 }
 
-/*
- * Call all entry functions of parents before children. If set_state is called
- * during one of the entry functions, then do not call any remaining entry
- * functions.
- */
-static void call_entry_functions(const int port,
-			       struct internal_ctx *const internal,
-			       const usb_state_ptr stop,
-			       const usb_state_ptr current)
+static void call_state_function(const int port, usb_state_ptr state,
+				state_execution func, bool entry)
 {
-	if (current == stop)
-		return;
+	struct state_stats *st = get_state_stats(state);
+	timestamp_t start = get_time();
 
-	call_entry_functions(port, internal, stop, current->parent);
+	if (func)
+		func(port);
 
-	/*
-	 * If the previous entry function called set_state, then don't enter
-	 * remaining states.
-	 */
-	if (!internal->enter)
+	if (st) {
+		st->entries += entry;
+		st->time_us += time_since32(start);
+	}
+}
+
+static void update_port_stats(const int port, timestamp_t start)
+{
+	uint32_t t = time_since32(start);
+
+	if (port < 0 || port >= ARRAY_SIZE(port_stats))
 		return;
 
-	/* Track the latest state that was entered, so we can exit properly. */
-	internal->last_entered = current;
-	if (current->entry)
-		current->entry(port);
+	port_stats[port].transitions++;
+	port_stats[port].time_us += t;
+	port_stats[port].max_us = MAX(port_stats[port].max_us, t);
 }
 
-/*
- * Call all exit functions of children before parents. Note set_state is ignored
- * during an exit function.
- */
-static void call_exit_functions(const int port, const usb_state_ptr stop,
-			      const usb_state_ptr current)
+void usb_sm_clear_stats(void)
 {
-	if (current == stop)
-		return;
+	memset(state_stats, 0, sizeof(state_stats));
+	memset(port_stats, 0, sizeof(port_stats));
+	state_stats_dropped = 0;
+}
 
-	if (current->exit)
-		current->exit(port);
+void usb_sm_print_port_stats(void)
+{
+	int port;
 
-	call_exit_functions(port, stop, current->parent);
+	ccprintf("Port  Transitions  Time(us)  Max(us)\n");
+	for (port = 0; port < ARRAY_SIZE(port_stats); port++)
+		ccprintf("C%d    %11d  %8d  %7d\n", port,
+			 port_stats[port].transitions,
+			 port_stats[port].time_us,
+			 port_stats[port].max_us);
+	if (state_stats_dropped)
+		ccprintf("%d state updates dropped\n", state_stats_dropped);
 }
 
+void usb_sm_print_stats(const char *label, usb_state_ptr base, int count,
+			const char * const *names, int names_size)
+{
+	int i, slot;
+
+	ccprintf("%-24s %7s  %8s\n", label, "Entries", "Time(us)");
+	for (i = 0; i < count; i++) {
+		const struct state_stats *st = NULL;
+
+		for (slot = 0; slot < STATE_STATS_SLOTS; slot++)
+			if (state_stats[slot].state == &base[i]) {
+				st = &state_stats[slot];
+				break;
+			}
+		if (!st)
+			continue;
+
+		if (names && i < names_size && names[i])
+			ccprintf("%-24s", names[i]);
+		else
+			ccprintf("%-24d", i);
+		ccprintf(" %7d  %8d\n", st->entries, st->time_us);
+		cflush();
+	}
+}
+#else
+static inline void call_state_function(const int port, usb_state_ptr state,
+				       state_execution func, bool entry)
+{
+	if (func)
+		func(port);
+}
+
+static inline void update_port_stats(const int port, timestamp_t start)
+{
+}
+#endif /* CONFIG_USB_SM_STATS */
+
 void set_state(const int port, struct sm_ctx *const ctx,
 	       const usb_state_ptr new_state)
 {
 	struct internal_ctx * const internal = (void *) ctx->internal;
 	usb_state_ptr last_state;
-	usb_state_ptr shared_parent;
+	usb_state_ptr last_path[USB_SM_MAX_DEPTH];
+	usb_state_ptr new_path[USB_SM_MAX_DEPTH];
+	int last_depth, new_depth, shared, i;
+	timestamp_t start = { .val = 0 };
 
 	/*
 	 * It does not make sense to call set_state in an exit phase of a state
@@ -121,6 +204,9 @@ void set_state(const int port, struct sm_ctx *const ctx,
 		return;
 	}
 
+	if (IS_ENABLED(CONFIG_USB_SM_STATS))
+		start = get_time();
+
 	/*
 	 * Determine the last state that was entered. Normally it is current,
 	 * but we could have called set_state within an entry phase, so we
@@ -128,26 +214,44 @@ void set_state(const int port, struct sm_ctx *const ctx,
 	 */
 	last_state = internal->enter ? internal->last_entered : ctx->current;
 
-	/* We don't exit and re-enter shared parent states */
-	shared_parent = shared_parent_state(last_state, new_state);
+	/*
+	 * We don't exit and re-enter shared parent states: they are the
+	 * common prefix of both paths from the outermost parent.
+	 */
+	last_depth = get_state_path(last_state, last_path);
+	new_depth = get_state_path(new_state, new_path);
+	for (shared = 0; shared < MIN(last_depth, new_depth); shared++)
+		if (last_path[shared] != new_path[shared])
+			break;
 
 	/*
-	 * Exit all of the non-common states from the last state.
+	 * Exit all of the non-common states from the last state, children
+	 * before parents.
 	 */
 	internal->exit = true;
-	call_exit_functions(port, shared_parent, last_state);
+	for (i = last_depth - 1; i >= shared; i--)
+		call_state_function(port, last_path[i], last_path[i]->exit,
+				    false);
 	internal->exit = false;
 
 	ctx->previous = ctx->current;
 	ctx->current = new_state;
 
 	/*
-	 * Enter all new non-common states. last_entered will contain the last
-	 * state that successfully entered before another set_state was called.
+	 * Enter all new non-common states, parents before children.
+	 * last_entered will contain the last state that successfully entered
+	 * before another set_state was called. If set_state is called during
+	 * one of the entry functions, then do not call any remaining entry
+	 * functions.
 	 */
 	internal->last_entered = NULL;
 	internal->enter = true;
-	call_entry_functions(port, internal, shared_parent, ctx->current);
+	for (i = shared; i < new_depth && internal->enter; i++) {
+		/* Track the latest state that was entered, to exit properly. */
+		internal->last_entered = new_path[i];
+		call_state_function(port, new_path[i], new_path[i]->entry,
+				    true);
+	}
 	/*
 	 * Setting enter to false ensures that all pending entry calls will be
 	 * skipped (in the case of a parent state calling set_state, which means
@@ -161,42 +265,30 @@ void set_state(const int port, struct sm_ctx *const ctx,
 	 */
 	internal->running = false;
 
+	if (IS_ENABLED(CONFIG_USB_SM_STATS))
+		update_port_stats(port, start);
+
 	/*
 	 * Since we are changing states, we want to ensure that we process the
 	 * next state's run method as soon as we can to ensure that we don't
 	 * delay important processing until the next task interval.
 	 */
 	if (IS_ENABLED(HAS_TASK_PD_C0))
-		task_wake(PD_PORT_TO_TASK_ID(port));
-}
-
-/*
- * Call all run functions of children before parents. If set_state is called
- * during one of the entry functions, then do not call any remaining entry
- * functions.
- */
-static void call_run_functions(const int port,
-			     const struct internal_ctx *const internal,
-			     const usb_state_ptr current)
-{
-	if (!current)
-		return;
-
-	/* If set_state is called during run, don't call remain functions. */
-	if (!internal->running)
-		return;
-
-	if (current->run)
-		current->run(port);
-
-	call_run_functions(port, internal, current->parent);
+		pd_task_wake(port);
 }
 
 void run_state(const int port, struct sm_ctx *const ctx)
 {
 	struct internal_ctx * const internal = (void *) ctx->internal;
+	usb_state_ptr s;
 
+	/*
+	 * Call all run functions of children before parents. If set_state is
+	 * called during one of the run functions, then do not call any
+	 * remaining run functions.
+	 */
 	internal->running = true;
-	call_run_functions(port, internal, ctx->current);
+	for (s = ctx->current; s != NULL && internal->running; s = s->parent)
+		call_state_function(port, s, s->run, false);
 	internal->running = false;
 }
@@ -549,7 +549,7 @@ void pd_request_source_voltage(int port, int mv)
 		else
 			pd_dpm_request(port, DPM_REQUEST_PR_SWAP);
 
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -562,7 +562,7 @@ void pd_set_external_voltage_limit(int port, int mv)
 		if (get_state_tc(port) == TC_ATTACHED_SNK)
 			pd_dpm_request(port, DPM_REQUEST_NEW_POWER_LEVEL);
 
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -697,7 +697,7 @@ static inline void pd_set_dual_role_and_event(int port,
 		pd_update_try_source();
 
 	if (event != 0)
-		task_set_event(PD_PORT_TO_TASK_ID(port), event);
+		pd_task_set_event(port, event);
 }
 
 void pd_set_dual_role(int port, enum pd_dual_role_states state)
@@ -719,7 +719,7 @@ void pd_request_data_swap(int port)
 	 */
 	if (IS_ATTACHED_SRC(port) || IS_ATTACHED_SNK(port)) {
 		TC_SET_FLAG(port, TC_FLAGS_REQUEST_DR_SWAP);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -856,7 +856,7 @@ void tc_prs_src_snk_assert_rd(int port)
 		 * DebugAccessory.SNK assert Rd
 		 */
 		TC_SET_FLAG(port, TC_FLAGS_REQUEST_PR_SWAP);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -872,7 +872,7 @@ void tc_prs_snk_src_assert_rp(int port)
 		 * UnorientedDebugAccessory.SRC to assert Rp
 		 */
 		TC_SET_FLAG(port, TC_FLAGS_REQUEST_PR_SWAP);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -893,7 +893,7 @@ void tc_prs_snk_src_assert_rp(int port)
 void tc_hard_reset_request(int port)
 {
 	TC_SET_FLAG(port, TC_FLAGS_HARD_RESET_REQUESTED);
-	task_wake(PD_PORT_TO_TASK_ID(port));
+	pd_task_wake(port);
 }
 
 void tc_disc_ident_in_progress(int port)
@@ -1012,7 +1012,7 @@ void pd_set_suspend(int port, int suspend)
 		if (PD_PORT_TO_TASK_ID(port) == task_get_current())
 			return;
 
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 
 		/* Sleep this task if we are not suspended */
 		while (pd_is_port_enabled(port)) {
@@ -1025,7 +1025,7 @@ void pd_set_suspend(int port, int suspend)
 		}
 	} else {
 		TC_CLR_FLAG(port, TC_FLAGS_SUSPEND);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -1411,14 +1411,13 @@ void tc_state_init(int port)
 {
 	enum usb_tc_state first_state;
 
-	/* For test builds, replicate static initialization */
+	/*
+	 * For test builds, replicate static initialization. Only this port is
+	 * reset: the other ports may already be running.
+	 */
 	if (IS_ENABLED(TEST_BUILD)) {
-		int i;
-
-		for (i = 0; i < CONFIG_USB_PD_PORT_MAX_COUNT; ++i) {
-			memset(&tc[i], 0, sizeof(tc[i]));
-			drp_state[i] = CONFIG_USB_PD_INITIAL_DRP_STATE;
-		}
+		memset(&tc[port], 0, sizeof(tc[port]));
+		drp_state[port] = CONFIG_USB_PD_INITIAL_DRP_STATE;
 	}
 
 	/* If port is not available, there is nothing to initialize */
@@ -1772,7 +1771,7 @@ void pd_request_vconn_swap_off(int port)
 	if (get_state_tc(port) == TC_ATTACHED_SRC ||
 			get_state_tc(port) == TC_ATTACHED_SNK) {
 		TC_SET_FLAG(port, TC_FLAGS_REQUEST_VC_SWAP_OFF);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -1781,7 +1780,7 @@ void pd_request_vconn_swap_on(int port)
 	if (get_state_tc(port) == TC_ATTACHED_SRC ||
 			get_state_tc(port) == TC_ATTACHED_SNK) {
 		TC_SET_FLAG(port, TC_FLAGS_REQUEST_VC_SWAP_ON);
-		task_wake(PD_PORT_TO_TASK_ID(port));
+		pd_task_wake(port);
 	}
 }
 
@@ -1850,7 +1849,7 @@ void pd_wait_exit_low_power(int port)
 	if (!TC_CHK_FLAG(port, TC_FLAGS_LPM_ENGAGED))
 		return;
 
-	if (port == TASK_ID_TO_PD_PORT(task_get_current())) {
+	if (PD_PORT_TO_TASK_ID(port) == task_get_current()) {
 		if (!TC_CHK_FLAG(port, TC_FLAGS_LPM_TRANSITION))
 			reset_device_and_notify(port);
 	} else {
@@ -1865,7 +1864,7 @@ void pd_wait_exit_low_power(int port)
 		 * happen much, but it if starts occurring, we can add a guard
 		 * to prevent/reduce it.
 		 */
-		task_set_event(PD_PORT_TO_TASK_ID(port), PD_EVENT_TCPC_RESET);
+		pd_task_set_event(port, PD_EVENT_TCPC_RESET);
 		task_wait_event_mask(TASK_EVENT_PD_AWAKE, -1);
 	}
 }
@@ -1876,11 +1875,10 @@ void pd_wait_exit_low_power(int port)
  */
 void pd_device_accessed(int port)
 {
-	if (port == TASK_ID_TO_PD_PORT(task_get_current()))
+	if (PD_PORT_TO_TASK_ID(port) == task_get_current())
 		handle_device_access(port);
 	else
-		task_set_event(PD_PORT_TO_TASK_ID(port),
-			       PD_EVENT_DEVICE_ACCESSED);
+		pd_task_set_event(port, PD_EVENT_DEVICE_ACCESSED);
 }
 
 /*
@@ -1967,12 +1965,19 @@ static void tc_disabled_run(const int port)
 	 */
 	if (!TC_CHK_FLAG(port, TC_FLAGS_SUSPEND))
 		set_state_tc(port, TC_UNATTACHED_SNK);
+	else if (IS_ENABLED(CONFIG_USB_PD_SINGLE_TASK))
+		/* Don't block the other ports sharing the PD task */
+		tc_pause_event_loop(port);
 
-	task_wait_event(-1);
+	if (!IS_ENABLED(CONFIG_USB_PD_SINGLE_TASK))
+		task_wait_event(-1);
 }
 
 static void tc_disabled_exit(const int port)
 {
+	if (IS_ENABLED(CONFIG_USB_PD_SINGLE_TASK))
+		tc_start_event_loop(port);
+
 	if (!IS_ENABLED(CONFIG_USB_PD_TCPC)) {
 		if (tcpm_init(port) != 0) {
 			CPRINTS("C%d: TCPC restart failed!", port);
@@ -3750,6 +3755,14 @@ static const struct usb_state tc_states[] = {
 #endif
 };
 
+#ifdef CONFIG_USB_SM_STATS
+void tc_print_sm_stats(void)
+{
+	usb_sm_print_stats("TC", tc_states, ARRAY_SIZE(tc_states),
+			   tc_state_names, ARRAY_SIZE(tc_state_names));
+}
+#endif
+
 #if defined(TEST_BUILD) && defined(USB_PD_DEBUG_LABELS)
 const struct test_sm_data test_tc_sm_data[] = {
 	{
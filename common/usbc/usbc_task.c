@@ -3,6 +3,7 @@
  * found in the LICENSE file.
  */
 
+#include "atomic.h"
 #include "battery.h"
 #include "battery_smart.h"
 #include "board.h"
@@ -52,7 +53,7 @@ void tc_start_event_loop(int port)
 	 */
 	if (paused[port]) {
 		paused[port] = 0;
-		task_set_event(PD_PORT_TO_TASK_ID(port), TASK_EVENT_WAKE);
+		pd_task_wake(port);
 	}
 }
 
@@ -73,21 +74,8 @@ static void pd_task_init(int port)
 		schedule_deferred_pd_interrupt(port);
 }
 
-static bool pd_task_loop(int port)
+static void pd_task_run(int port, uint32_t evt)
 {
-	/* wait for next event/packet or timeout expiration */
-	const uint32_t evt =
-		task_wait_event(paused[port]
-					? -1
-					: USBC_EVENT_TIMEOUT);
-
-	/*
-	 * Re-use TASK_EVENT_RESET_DONE in tests to restart the USB task
-	 * if this code is running in a unit test.
-	 */
-	if (IS_ENABLED(TEST_BUILD) && (evt & TASK_EVENT_RESET_DONE))
-		return false;
-
 	/* handle events that affect the state machine as a whole */
 	if (IS_ENABLED(CONFIG_USB_TYPEC_SM))
 		tc_event_check(port, evt);
@@ -110,6 +98,133 @@ static bool pd_task_loop(int port)
 	/* Run TypeC state machine */
 	if (IS_ENABLED(CONFIG_USB_TYPEC_SM))
 		tc_run(port);
+}
+
+#ifdef CONFIG_USB_PD_SINGLE_TASK
+/* Events pending for each port, and port run by the PD task */
+static atomic_t port_events[CONFIG_USB_PD_PORT_MAX_COUNT];
+static int task_port;
+
+/* Deadline of the loop timeout of each port */
+static uint64_t next_run[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+int pd_task_get_port(void)
+{
+	return task_port;
+}
+
+void pd_task_set_event(int port, uint32_t event)
+{
+	atomic_or(&port_events[port], event);
+	task_set_event(TASK_ID_PD_C0, PD_EVENT_PORT);
+}
+
+/*
+ * Time before the next port must run: 0 if a port has events or its timeout
+ * expired, -1 if all the ports are paused.
+ */
+static int pd_task_timeout(int port_count, uint64_t now)
+{
+	int timeout = -1;
+	int port;
+
+	for (port = 0; port < port_count; port++) {
+		if (port_events[port])
+			return 0;
+		if (paused[port])
+			continue;
+		if (next_run[port] <= now)
+			return 0;
+		if (timeout < 0 || next_run[port] - now < timeout)
+			timeout = next_run[port] - now;
+	}
+
+	return timeout;
+}
+
+static bool pd_task_loop(int port_count)
+{
+	uint64_t now = get_time().val;
+	int timeout = pd_task_timeout(port_count, now);
+	uint32_t task_evt;
+	int port;
+
+	/* wait for next event/packet or earliest timeout expiration */
+	if (timeout)
+		task_evt = task_wait_event(timeout);
+	else
+		task_evt = atomic_clear(task_get_event_bitmap(TASK_ID_PD_C0));
+
+	/*
+	 * Re-use TASK_EVENT_RESET_DONE in tests to restart the USB task
+	 * if this code is running in a unit test.
+	 */
+	if (IS_ENABLED(TEST_BUILD) && (task_evt & TASK_EVENT_RESET_DONE))
+		return false;
+
+	/*
+	 * Port events go through pd_task_set_event(). Anything set on the task
+	 * itself doesn't say which port it is for, so hand it to every port,
+	 * including plain wakes.
+	 */
+	task_evt &= ~(PD_EVENT_PORT | TASK_EVENT_TIMER);
+	if (task_evt)
+		for (port = 0; port < port_count; port++)
+			atomic_or(&port_events[port], task_evt);
+
+	now = get_time().val;
+	for (port = 0; port < port_count; port++) {
+		uint32_t evt;
+
+		if (!port_events[port] && (paused[port] || next_run[port] > now))
+			continue;
+
+		evt = atomic_clear(&port_events[port]);
+		if (next_run[port] <= now)
+			evt |= TASK_EVENT_TIMER;
+
+		task_port = port;
+		pd_task_run(port, evt);
+		next_run[port] = get_time().val + USBC_EVENT_TIMEOUT;
+	}
+
+	return true;
+}
+
+void pd_task(void *u)
+{
+	const int port_count = board_get_usb_pd_port_count();
+	int port;
+
+	while (1) {
+		for (port = 0; port < port_count; port++) {
+			task_port = port;
+			port_events[port] = 0;
+			next_run[port] = 0;
+			pd_task_init(port);
+		}
+
+		while (pd_task_loop(port_count))
+			continue;
+	}
+}
+#else
+static bool pd_task_loop(int port)
+{
+	/* wait for next event/packet or timeout expiration */
+	const uint32_t evt =
+		task_wait_event(paused[port]
+					? -1
+					: USBC_EVENT_TIMEOUT);
+
+	/*
+	 * Re-use TASK_EVENT_RESET_DONE in tests to restart the USB task
+	 * if this code is running in a unit test.
+	 */
+	if (IS_ENABLED(TEST_BUILD) && (evt & TASK_EVENT_RESET_DONE))
+		return false;
+
+	pd_task_run(port, evt);
 
 	return true;
 }
@@ -137,3 +252,4 @@ void pd_task(void *u)
 			continue;
 	}
 }
+#endif /* CONFIG_USB_PD_SINGLE_TASK */
@@ -212,6 +212,50 @@ static uint32_t tasks_enabled = BIT(TASK_ID_HOOKS) | BIT(TASK_ID_IDLE);
 
 static int start_called;  /* Has task swapping started */
 
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+/* Bitmap of the tasks blocked on a priority inheritance mutex */
+static uint32_t tasks_mutex_waiting;
+/* Mutex each task of tasks_mutex_waiting is blocked on */
+static struct mutex *task_mutex_wait[TASK_ID_COUNT];
+
+/**
+ * Pick the task to run among the ready ones.
+ *
+ * A task blocked on a priority inheritance mutex lends its priority to the
+ * owner of the mutex, following the chain of owners if the owner is itself
+ * blocked on another mutex. If no owner of the chain can run, the next
+ * candidate is tried, down to the idle task which is always ready.
+ */
+static task_id_t task_pick_next(uint32_t ready)
+{
+	uint32_t candidates = ready | (tasks_mutex_waiting & tasks_enabled);
+
+	while (candidates) {
+		task_id_t id = __fls(candidates);
+		int depth;
+
+		candidates &= ~BIT(id);
+		for (depth = 0; depth < TASK_ID_COUNT && !(ready & BIT(id));
+		     depth++) {
+			struct mutex *mtx = task_mutex_wait[id];
+
+			if (!(tasks_mutex_waiting & BIT(id)) || !mtx->owner)
+				break;
+			id = __fls(mtx->owner);
+		}
+		if (ready & BIT(id))
+			return id;
+	}
+
+	return TASK_ID_IDLE;
+}
+#else
+static inline task_id_t task_pick_next(uint32_t ready)
+{
+	return __fls(ready);
+}
+#endif
+
 static inline task_ *__task_id_to_ptr(task_id_t id)
 {
 	return tasks + id;
@@ -316,7 +360,7 @@ void svc_handler(int desched, task_id_t resched)
 	tasks_ready |= 1 << resched;
 
 	ASSERT(tasks_ready & tasks_enabled);
-	next = __task_id_to_ptr(__fls(tasks_ready & tasks_enabled));
+	next = __task_id_to_ptr(task_pick_next(tasks_ready & tasks_enabled));
 
 #ifdef CONFIG_TASK_PROFILING
 	/* Track time in interrupts */
@@ -886,12 +930,25 @@ void mutex_lock(struct mutex *mtx)
 		 * "value" is equals to 1 if the store conditional failed,
 		 * 2 if somebody else owns the mutex, 0 else.
 		 */
-		if (value == 2)
+		if (value == 2) {
 			/* Contention on the mutex */
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+			if (mtx->prio_inherit) {
+				task_mutex_wait[task_get_current()] = mtx;
+				atomic_or(&tasks_mutex_waiting, id);
+			}
+#endif
 			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+			atomic_clear_bits(&tasks_mutex_waiting, id);
+#endif
+		}
 	} while (value);
 
 	atomic_clear_bits(&mtx->waiters, id);
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	mtx->owner = id;
+#endif
 }
 
 void mutex_unlock(struct mutex *mtx)
@@ -905,6 +962,9 @@ void mutex_unlock(struct mutex *mtx)
 	 */
 	interrupt_disable();
 	waiters = mtx->waiters;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	mtx->owner = 0;
+#endif
 	mtx->lock = 0;
 	interrupt_enable();
 
@@ -15,6 +15,10 @@
 #include "timer.h"
 #include "util.h"
 
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+#error "CONFIG_TASK_PRIORITY_INHERITANCE not supported on this core"
+#endif
+
 typedef union {
 	struct {
 		/*
@@ -23,6 +23,11 @@ pthread_t task_get_thread(task_id_t tskid);
  */
 task_id_t task_get_running(void);
 
+/**
+ * Returns the number of times the scheduler resumed the task since boot.
+ */
+uint32_t task_get_wake_count(task_id_t tskid);
+
 /**
  * Initializes the interrupt semaphore and associates a signal handler with
  * SIGNAL_INTERRUPT.
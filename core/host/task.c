@@ -31,6 +31,12 @@ struct emu_task_t {
 	uint32_t event;
 	timestamp_t wake_time;
 	uint8_t started;
+	/* Number of times the task was resumed */
+	uint32_t wake_count;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	/* Priority inheritance mutex the task is blocked on */
+	struct mutex *mutex_wait;
+#endif
 };
 
 struct task_args {
@@ -269,16 +275,30 @@ void mutex_lock(struct mutex *mtx)
 			value = 1;
 		}
 
-		if (!value)
+		if (!value) {
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+			if (mtx->prio_inherit)
+				tasks[task_get_current()].mutex_wait = mtx;
+#endif
 			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+			tasks[task_get_current()].mutex_wait = NULL;
+#endif
+		}
 	} while (!value);
 
 	mtx->waiters &= ~id;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	mtx->owner = id;
+#endif
 }
 
 void mutex_unlock(struct mutex *mtx)
 {
 	int v;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	mtx->owner = 0;
+#endif
 	mtx->lock = 0;
 
 	for (v = 31; v >= 0; --v)
@@ -299,6 +319,11 @@ task_id_t task_get_running(void)
 	return running_task_id;
 }
 
+uint32_t task_get_wake_count(task_id_t tskid)
+{
+	return tasks[tskid].wake_count;
+}
+
 void task_print_list(void)
 {
 	int i;
@@ -411,9 +436,42 @@ int task_start_called(void)
 	return task_started;
 }
 
+static int task_runnable(int i, timestamp_t now)
+{
+	/* Only tasks with spawned threads are valid to be resumed. */
+	return tasks[i].thread &&
+	       (tasks[i].event || now.val >= tasks[i].wake_time.val);
+}
+
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+/*
+ * Follow the chain of owners of the mutexes task i is blocked on, and return
+ * the first runnable one, or -1 if none can run.
+ */
+static int task_mutex_owner(int i, timestamp_t now)
+{
+	int depth;
+
+	for (depth = 0; depth < TASK_ID_COUNT; depth++) {
+		struct mutex *mtx = tasks[i].mutex_wait;
+
+		if (!mtx || !mtx->owner)
+			return -1;
+		i = __fls(mtx->owner);
+		if (task_runnable(i, now))
+			return i;
+	}
+
+	return -1;
+}
+#endif
+
 void task_scheduler(void)
 {
 	int i;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	int owner;
+#endif
 	timestamp_t now;
 
 	task_started = 1;
@@ -422,15 +480,16 @@ void task_scheduler(void)
 		now = get_time();
 		i = TASK_ID_COUNT - 1;
 		while (i >= 0) {
-			/*
-			 * Only tasks with spawned threads are valid to be
-			 * resumed.
-			 */
-			if (tasks[i].thread) {
-				if (tasks[i].event ||
-				    now.val >= tasks[i].wake_time.val)
-					break;
+			if (task_runnable(i, now))
+				break;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+			/* Run the owner of the mutex at our priority. */
+			owner = task_mutex_owner(i, now);
+			if (owner >= 0) {
+				i = owner;
+				break;
 			}
+#endif
 			--i;
 		}
 		if (i < 0)
@@ -442,6 +501,7 @@ void task_scheduler(void)
 		tasks[i].wake_time.val = ~0ull;
 		running_task_id = i;
 		tasks[i].started = 1;
+		tasks[i].wake_count++;
 		pthread_cond_signal(&tasks[i].resume);
 		pthread_cond_wait(&scheduler_cond, &run_lock);
 	}
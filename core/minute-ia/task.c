@@ -24,6 +24,10 @@
 #include "interrupts.h"
 #include "hpet.h"
 
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+#error "CONFIG_TASK_PRIORITY_INHERITANCE not supported on this core"
+#endif
+
 /* Console output macros */
 #define CPUTS(outstr) cputs(CC_SYSTEM, outstr)
 #define CPRINTF(format, args...) cprintf(CC_SYSTEM, format, ## args)
@@ -14,6 +14,10 @@
 #include "timer.h"
 #include "util.h"
 
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+#error "CONFIG_TASK_PRIORITY_INHERITANCE not supported on this core"
+#endif
+
 typedef struct {
 	/*
 	 * Note that sp must be the first element in the task struct
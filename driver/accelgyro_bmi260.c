@@ -433,7 +433,8 @@ static int bmi_config_load(const struct motion_sensor_t *s)
 			 * init_rom region isn't memory mapped. Copy the
 			 * data through a RAM buffer.
 			 */
-			ret = init_rom_copy((int)&g_bmi260_config_tbin[i], len,
+			ret = init_rom_copy(
+				(int)(uintptr_t)&g_bmi260_config_tbin[i], len,
 				bmi_ram_buffer);
 			if (ret)
 				break;
@@ -412,6 +412,41 @@ static int read(const struct motion_sensor_t *s, intv3_t v)
 	return EC_SUCCESS;
 }
 
+#ifdef CONFIG_ACCEL_READ_PLAN
+/*
+ * Read from the status register up to the sensor output registers: the accel
+ * and gyro blocks start at the same address, so both sensors are served by
+ * one transaction.
+ */
+static int get_read_plan(const struct motion_sensor_t *s,
+			 struct motion_read_plan *plan)
+{
+	plan->reg = LSM6DSO_STATUS_REG;
+	plan->len = get_xyz_reg(s->type) + OUT_XYZ_SIZE - LSM6DSO_STATUS_REG;
+
+	return EC_SUCCESS;
+}
+
+static int decode_read_plan(const struct motion_sensor_t *s,
+			    const uint8_t *data, intv3_t v)
+{
+	const uint8_t mask = (s->type == MOTIONSENSE_TYPE_ACCEL) ?
+		LSM6DSO_STS_XLDA_MASK : LSM6DSO_STS_GDA_MASK;
+
+	/* Same as read(): keep the previous data when no new sample. */
+	if (!(data[0] & mask)) {
+		if (v != s->raw_xyz)
+			memcpy(v, s->raw_xyz, sizeof(s->raw_xyz));
+
+		return EC_SUCCESS;
+	}
+
+	st_normalize(s, v, &data[get_xyz_reg(s->type) - LSM6DSO_STATUS_REG]);
+
+	return EC_SUCCESS;
+}
+#endif /* CONFIG_ACCEL_READ_PLAN */
+
 static int init(struct motion_sensor_t *s)
 {
 	int ret = 0, tmp;
@@ -488,4 +523,8 @@ const struct accelgyro_drv lsm6dso_drv = {
 #ifdef CONFIG_ACCEL_INTERRUPTS
 	.irq_handler = irq_handler,
 #endif /* CONFIG_ACCEL_INTERRUPTS */
+#ifdef CONFIG_ACCEL_READ_PLAN
+	.get_read_plan = get_read_plan,
+	.decode_read_plan = decode_read_plan,
+#endif /* CONFIG_ACCEL_READ_PLAN */
 };
@@ -106,6 +106,7 @@ struct i2c_stress_test_dev opt3001_i2c_stress_test_dev = {
 #else  /* HAS_TASK_ALS */
 #include "accelgyro.h"
 #include "math_util.h"
+#include "task.h"
 
 /**
  *  Read register from OPT3001 light sensor.
@@ -256,6 +257,92 @@ static int opt3001_get_offset(const struct motion_sensor_t *s,
 	*temp = EC_MOTION_SENSE_INVALID_CALIB_TEMP;
 	return EC_SUCCESS;
 }
+#ifdef CONFIG_ALS_OPT3001_INT_EVENT
+/**
+ * Convert a value returned by opt3001_read_lux() back to the 1/100 lux unit
+ * of the sensor, undoing the offset and scale calibration.
+ */
+static int opt3001_lux_to_raw(const struct motion_sensor_t *s, int lux)
+{
+	struct opt3001_drv_data_t *drv_data = OPT3001_GET_DATA(s);
+	int64_t coef = drv_data->scale * 10000 + drv_data->uscale;
+	int64_t raw;
+
+	if (coef <= 0)
+		return 0;
+
+	raw = (int64_t)lux * 100 * 10000 / coef - drv_data->offset * 100;
+	return MAX(0, MIN(raw, OPT3001_LIMIT_MANTISSA_MASK <<
+				OPT3001_LIMIT_EXP_MAX));
+}
+
+/**
+ * Encode 1/100 lux in the exponent/mantissa format of the limit registers,
+ * using the smallest exponent that fits to keep the best precision.
+ */
+static int opt3001_encode_limit(int raw, int roundup)
+{
+	int exp = 0;
+
+	while (exp < OPT3001_LIMIT_EXP_MAX &&
+	       raw > (OPT3001_LIMIT_MANTISSA_MASK << exp))
+		exp++;
+
+	if (roundup)
+		raw = DIV_ROUND_UP(raw, 1 << exp);
+	else
+		raw >>= exp;
+
+	return (exp << OPT3001_LIMIT_EXP_OFFSET) | raw;
+}
+
+static int opt3001_set_threshold(const struct motion_sensor_t *s,
+				 int low, int high)
+{
+	int ret;
+
+	ret = opt3001_i2c_write(s->port, s->i2c_spi_addr_flags,
+				OPT3001_REG_INT_LIMIT_LSB,
+				opt3001_encode_limit(opt3001_lux_to_raw(s, low),
+						     0));
+	if (ret)
+		return ret;
+
+	return opt3001_i2c_write(s->port, s->i2c_spi_addr_flags,
+				 OPT3001_REG_INT_LIMIT_MSB,
+				 opt3001_encode_limit(opt3001_lux_to_raw(s, high),
+						      1));
+}
+
+void opt3001_interrupt(enum gpio_signal signal)
+{
+	task_set_event(TASK_ID_MOTIONSENSE, CONFIG_ALS_OPT3001_INT_EVENT);
+}
+
+/**
+ * Bottom half of the interrupt: the comparator is latched, reading the
+ * configuration register clears the flags and releases the INT pin.
+ */
+static int opt3001_irq_handler(struct motion_sensor_t *s, uint32_t *event)
+{
+	int ret;
+	int data;
+
+	if (!(*event & CONFIG_ALS_OPT3001_INT_EVENT))
+		return EC_ERROR_NOT_HANDLED;
+
+	ret = opt3001_i2c_read(s->port, s->i2c_spi_addr_flags,
+			       OPT3001_REG_CONFIGURE, &data);
+	if (ret)
+		return ret;
+
+	if (!(data & (OPT3001_FLAG_HIGH | OPT3001_FLAG_LOW)))
+		return EC_ERROR_NOT_HANDLED;
+
+	return EC_SUCCESS;
+}
+#endif  /* CONFIG_ALS_OPT3001_INT_EVENT */
+
 /**
  * Initialise OPT3001 light sensor.
  */
@@ -299,6 +386,10 @@ const struct accelgyro_drv opt3001_drv = {
 	.get_offset = opt3001_get_offset,
 	.set_data_rate = opt3001_set_data_rate,
 	.get_data_rate = opt3001_get_data_rate,
+#ifdef CONFIG_ALS_OPT3001_INT_EVENT
+	.irq_handler = opt3001_irq_handler,
+	.set_threshold = opt3001_set_threshold,
+#endif
 };
 
 #ifdef CONFIG_CMD_I2C_STRESS_TEST_ALS
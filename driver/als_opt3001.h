@@ -21,14 +21,20 @@
 #define OPT3001_RANGE_MASK			0x0fff
 #define OPT3001_MODE_OFFSET			9
 #define OPT3001_MODE_MASK			0xf9ff
+#define OPT3001_FLAG_HIGH			BIT(6)
+#define OPT3001_FLAG_LOW			BIT(5)
 enum opt3001_mode {
 	OPT3001_MODE_SUSPEND,
 	OPT3001_MODE_FORCED,
 	OPT3001_MODE_CONTINUOUS,
 };
 
+/* Low and high limits, in the same format as OPT3001_REG_RESULT */
 #define OPT3001_REG_INT_LIMIT_LSB	0x02
 #define OPT3001_REG_INT_LIMIT_MSB	0x03
+#define OPT3001_LIMIT_EXP_OFFSET		12
+#define OPT3001_LIMIT_EXP_MAX			0xb
+#define OPT3001_LIMIT_MANTISSA_MASK		0x0fff
 #define OPT3001_REG_MAN_ID		0x7e
 #define OPT3001_REG_DEV_ID		0x7f
 
@@ -62,6 +68,10 @@ struct opt3001_drv_data_t {
 };
 
 extern const struct accelgyro_drv opt3001_drv;
+
+#ifdef CONFIG_ALS_OPT3001_INT_EVENT
+void opt3001_interrupt(enum gpio_signal signal);
+#endif
 #endif
 
 #ifdef CONFIG_CMD_I2C_STRESS_TEST_ALS
@@ -15,7 +15,9 @@
 #endif
 #else
 /* These values are used by the host (emulator) tests. */
+#ifndef FP_SENSOR_IMAGE_SIZE
 #define FP_SENSOR_IMAGE_SIZE 0
+#endif
 #define FP_SENSOR_RES_X 0
 #define FP_SENSOR_RES_Y 0
 #define FP_ALGORITHM_TEMPLATE_SIZE 0
@@ -422,18 +422,18 @@ int anx7447_set_power_supply_ready(int port)
 		count++;
 	}
 
-	return tcpc_write(port, TCPC_REG_COMMAND, 0x77);
+	return tcpci_write_command(port, 0x77);
 }
 #endif /* CONFIG_USB_PD_VBUS_DETECT_TCPC */
 
 int anx7447_power_supply_reset(int port)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, 0x66);
+	return tcpci_write_command(port, 0x66);
 }
 
 int anx7447_board_charging_enable(int port, int enable)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, enable ? 0x55 : 0x44);
+	return tcpci_write_command(port, enable ? 0x55 : 0x44);
 }
 
 static void anx7447_tcpc_alert(int port)
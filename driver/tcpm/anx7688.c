@@ -119,17 +119,17 @@ int anx7688_update_hpd(int port, int level, int irq)
 
 int anx7688_enable_cable_detection(int port)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, 0xff);
+	return tcpci_write_command(port, 0xff);
 }
 
 int anx7688_set_power_supply_ready(int port)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, 0x77);
+	return tcpci_write_command(port, 0x77);
 }
 
 int anx7688_power_supply_reset(int port)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, 0x66);
+	return tcpci_write_command(port, 0x66);
 }
 
 static void anx7688_tcpc_alert(int port)
@@ -19,7 +19,7 @@
 
 int fusb307_power_supply_reset(int port)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, 0x66);
+	return tcpci_write_command(port, 0x66);
 }
 
 static int fusb307_tcpm_init(int port)
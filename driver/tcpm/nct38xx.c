@@ -72,8 +72,7 @@ static int nct38xx_init(int port)
 	}
 
 	/* Start VBus monitor */
-	rv = tcpc_write(port, TCPC_REG_COMMAND,
-			TCPC_REG_COMMAND_ENABLE_VBUS_DETECT);
+	rv = tcpci_write_command(port, TCPC_REG_COMMAND_ENABLE_VBUS_DETECT);
 	if (rv)
 		return rv;
 
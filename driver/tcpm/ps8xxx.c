@@ -407,8 +407,8 @@ static int ps8xxx_tcpc_drp_toggle(int port)
 			opposite_pull);
 
 		/* Set Look4Connection command */
-		rv |= tcpc_write(port, TCPC_REG_COMMAND,
-				 TCPC_REG_COMMAND_LOOK4CONNECTION);
+		rv |= tcpci_write_command(port,
+					   TCPC_REG_COMMAND_LOOK4CONNECTION);
 
 		return rv;
 	} else {
@@ -118,8 +118,7 @@ int raa489000_init(int port)
 		CPRINTS("c%d: failed to enable ADCs", port);
 
 	/* Enable Vbus detection */
-	rv = tcpc_write(port, TCPC_REG_COMMAND,
-			TCPC_REG_COMMAND_ENABLE_VBUS_DETECT);
+	rv = tcpci_write_command(port, TCPC_REG_COMMAND_ENABLE_VBUS_DETECT);
 	if (rv)
 		CPRINTS("c%d: failed to enable vbus detect cmd", port);
 
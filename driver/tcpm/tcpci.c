@@ -10,6 +10,7 @@
 #include "compile_time_macros.h"
 #include "console.h"
 #include "ec_commands.h"
+#include "i2c_reg_cache.h"
 #include "ps8xxx.h"
 #include "task.h"
 #include "tcpm/tcpci.h"
@@ -34,6 +35,46 @@ STATIC_IF(CONFIG_USB_PD_DECODE_SOP)
 	((_flags & TCPC_FLAGS_TCPCI_REV2_0) && \
 		!(_flags & TCPC_FLAGS_TCPCI_REV2_0_NO_VSAFE0V))
 
+#ifdef CONFIG_I2C_REG_CACHE
+/*
+ * Registers only written by the TCPM. POWER_STATUS_MASK and ALERT_MASK are
+ * left out, they are read to detect a TCPC reset.
+ */
+static const struct i2c_reg_cache_range tcpci_cached_regs[] = {
+	{ TCPC_REG_FAULT_STATUS_MASK, TCPC_REG_POWER_CTRL },
+	{ TCPC_REG_MSG_HDR_INFO, TCPC_REG_MSG_HDR_INFO },
+};
+#define TCPCI_CACHED_REG_COUNT \
+	(TCPC_REG_POWER_CTRL - TCPC_REG_FAULT_STATUS_MASK + 2)
+
+static uint16_t tcpci_reg_cache_entries[CONFIG_USB_PD_PORT_MAX_COUNT]
+				       [TCPCI_CACHED_REG_COUNT];
+static struct i2c_reg_cache tcpci_reg_cache[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+/* Start caching the registers of a TCPC, dropping any previous values. */
+static void tcpci_reg_cache_init(int port)
+{
+	struct i2c_reg_cache *cache = &tcpci_reg_cache[port];
+
+	cache->port = tcpc_config[port].i2c_info.port;
+	cache->addr_flags = tcpc_config[port].i2c_info.addr_flags;
+	cache->ranges = tcpci_cached_regs;
+	cache->range_count = ARRAY_SIZE(tcpci_cached_regs);
+	cache->entries = tcpci_reg_cache_entries[port];
+	cache->entry_count = TCPCI_CACHED_REG_COUNT;
+	i2c_reg_cache_register(cache);
+}
+
+static void tcpci_reg_cache_invalidate(int port)
+{
+	if (tcpci_reg_cache[port].entries)
+		i2c_reg_cache_invalidate(&tcpci_reg_cache[port]);
+}
+#else
+static inline void tcpci_reg_cache_init(int port) {}
+static inline void tcpci_reg_cache_invalidate(int port) {}
+#endif /* CONFIG_I2C_REG_CACHE */
+
 /****************************************************************************
  * TCPCI DEBUG Helpers
  */
@@ -284,6 +325,19 @@ int tcpc_update16(int port, int reg,
 
 #endif /* CONFIG_USB_PD_TCPC_LOW_POWER */
 
+int tcpci_write_command(int port, int cmd)
+{
+	int rv = tcpc_write(port, TCPC_REG_COMMAND, cmd);
+
+	/*
+	 * A command may change any register. The write carries the register
+	 * address, so the cache cannot tell it from a plain register write.
+	 */
+	tcpci_reg_cache_invalidate(port);
+
+	return rv;
+}
+
 /*
  * TCPCI maintains and uses cached values for the RP and
  * last used PULL values.  Since TCPC drivers are allowed
@@ -549,8 +603,7 @@ int tcpci_tcpc_drp_toggle(int port)
 		return rv;
 
 	/* Set Look4Connection command */
-	rv = tcpc_write(port, TCPC_REG_COMMAND,
-			TCPC_REG_COMMAND_LOOK4CONNECTION);
+	rv = tcpci_write_command(port, TCPC_REG_COMMAND_LOOK4CONNECTION);
 
 	return rv;
 }
@@ -559,7 +612,7 @@ int tcpci_tcpc_drp_toggle(int port)
 #ifdef CONFIG_USB_PD_TCPC_LOW_POWER
 int tcpci_enter_low_power_mode(int port)
 {
-	return tcpc_write(port, TCPC_REG_COMMAND, TCPC_REG_COMMAND_I2CIDLE);
+	return tcpci_write_command(port, TCPC_REG_COMMAND_I2CIDLE);
 }
 #endif
 
@@ -591,7 +644,7 @@ int tcpci_tcpm_set_snk_ctrl(int port, int enable)
 	int cmd = enable ? TCPC_REG_COMMAND_SNK_CTRL_HIGH :
 		TCPC_REG_COMMAND_SNK_CTRL_LOW;
 
-	return tcpc_write(port, TCPC_REG_COMMAND, cmd);
+	return tcpci_write_command(port, cmd);
 }
 
 int tcpci_tcpm_get_src_ctrl(int port, bool *sourcing)
@@ -612,7 +665,7 @@ int tcpci_tcpm_set_src_ctrl(int port, int enable)
 	int cmd = enable ? TCPC_REG_COMMAND_SRC_CTRL_HIGH :
 		TCPC_REG_COMMAND_SRC_CTRL_LOW;
 
-	return tcpc_write(port, TCPC_REG_COMMAND, cmd);
+	return tcpci_write_command(port, cmd);
 }
 #endif
 
@@ -733,8 +786,92 @@ struct cached_tcpm_message {
 	uint32_t payload[7];
 };
 
-static int tcpci_rev2_0_tcpm_get_message_raw(int port, uint32_t *payload,
-					     int *head)
+#ifdef CONFIG_USB_PD_TCPCI_RX_FAST_PATH
+/* MessageID of the last message received for each SOP* type, or -1 */
+static int8_t rx_msg_id[CONFIG_USB_PD_PORT_MAX_COUNT][NUM_SOP_STAR_TYPES];
+static struct tcpci_rx_stats rx_stats[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+void tcpm_reset_rx_msg_id(int port, enum tcpm_transmit_type sop)
+{
+	if (sop < NUM_SOP_STAR_TYPES)
+		rx_msg_id[port][sop] = -1;
+}
+
+static void reset_rx_msg_ids(int port)
+{
+	int sop;
+
+	for (sop = 0; sop < NUM_SOP_STAR_TYPES; sop++)
+		tcpm_reset_rx_msg_id(port, sop);
+}
+
+/*
+ * Check if a message is a retry of the last one, sent again because our
+ * GoodCRC was lost, from its header alone. This is the same check as the
+ * protocol layer does, which still has the final say.
+ */
+static bool rx_is_repeat(int port, int head)
+{
+	enum tcpm_transmit_type sop = PD_HEADER_GET_SOP(head);
+	int8_t msg_id = PD_HEADER_ID(head);
+
+	if (sop >= NUM_SOP_STAR_TYPES)
+		return false;
+
+	/* Soft Reset restarts the MessageID sequence */
+	if (PD_HEADER_CNT(head) == 0 &&
+	    PD_HEADER_TYPE(head) == PD_CTRL_SOFT_RESET) {
+		rx_msg_id[port][sop] = -1;
+		return false;
+	}
+
+	/* Leave messages from the partner to its cable to the protocol layer */
+	if (sop != TCPC_TX_SOP && PD_HEADER_PROLE(head) == PD_PLUG_FROM_DFP_UFP)
+		return false;
+
+	if (rx_msg_id[port][sop] == msg_id)
+		return true;
+
+	rx_msg_id[port][sop] = msg_id;
+	return false;
+}
+
+void tcpci_get_rx_stats(int port, struct tcpci_rx_stats *stats)
+{
+	*stats = rx_stats[port];
+}
+
+static int command_tcpci_rx(int argc, char **argv)
+{
+	int port;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		memset(rx_stats, 0, sizeof(rx_stats));
+		return EC_SUCCESS;
+	}
+
+	for (port = 0; port < board_get_usb_pd_port_count(); port++)
+		ccprintf("C%d: processed %u dropped %u\n", port,
+			 rx_stats[port].processed, rx_stats[port].dropped);
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(tcpcirx, command_tcpci_rx, "[clear]",
+			"Print or clear TCPCI RX message counters");
+#else
+static inline void reset_rx_msg_ids(int port) { }
+static inline bool rx_is_repeat(int port, int head) { return false; }
+#endif /* CONFIG_USB_PD_TCPCI_RX_FAST_PATH */
+
+/*
+ * Read the RX buffer of the TCPC. When @repeat is not NULL, a message
+ * repeating the last one is dropped as soon as its header is read, and
+ * *@repeat is set. @clear alert bits are cleared along with the RX status.
+ */
+static int tcpci_rev2_0_read_message(int port, uint32_t *payload, int *head,
+				     bool *repeat, int clear)
 {
 	int rv = 0, cnt, reg = TCPC_REG_RX_BUFFER;
 	int frm;
@@ -773,6 +910,12 @@ static int tcpci_rev2_0_tcpm_get_message_raw(int port, uint32_t *payload,
 	*head &= 0x0000ffff;
 	*head |= PD_HEADER_SOP(frm);
 
+	/* Only read enough of a repeat to end the transfer */
+	if (repeat && !rv && rx_is_repeat(port, *head)) {
+		*repeat = true;
+		cnt = MIN(cnt, 1);
+	}
+
 	/* Execute read and I2C_XFER_STOP, even if header read failed */
 	if (cnt > 0) {
 		tcpc_xfer_unlocked(port, NULL, 0, (uint8_t *)payload, cnt,
@@ -781,8 +924,12 @@ static int tcpci_rev2_0_tcpm_get_message_raw(int port, uint32_t *payload,
 
 clear:
 	tcpc_lock(port, 0);
-	/* Read complete, clear RX status alert bit */
-	tcpc_write16(port, TCPC_REG_ALERT, TCPC_REG_ALERT_RX_STATUS);
+	/*
+	 * Read complete, clear RX status alert bit. The other bits are only
+	 * cleared along with a message read, the caller handles them then.
+	 */
+	tcpc_write16(port, TCPC_REG_ALERT,
+		     TCPC_REG_ALERT_RX_STATUS | (rv ? 0 : clear));
 
 	if (rv)
 		return EC_ERROR_UNKNOWN;
@@ -790,8 +937,14 @@ clear:
 	return EC_SUCCESS;
 }
 
-static int tcpci_rev1_0_tcpm_get_message_raw(int port, uint32_t *payload,
+static int tcpci_rev2_0_tcpm_get_message_raw(int port, uint32_t *payload,
 					     int *head)
+{
+	return tcpci_rev2_0_read_message(port, payload, head, NULL, 0);
+}
+
+static int tcpci_rev1_0_read_message(int port, uint32_t *payload, int *head,
+				     bool *repeat, int clear)
 {
 	int rv, cnt, reg = TCPC_REG_RX_DATA;
 	int frm;
@@ -825,17 +978,28 @@ static int tcpci_rev1_0_tcpm_get_message_raw(int port, uint32_t *payload,
 		*head |= PD_HEADER_SOP(frm);
 	}
 
-	if (rv == EC_SUCCESS && cnt > 0) {
+	if (repeat && rv == EC_SUCCESS && rx_is_repeat(port, *head))
+		*repeat = true;
+	else if (rv == EC_SUCCESS && cnt > 0)
 		tcpc_read_block(port, reg, (uint8_t *)payload, cnt);
-	}
 
 clear:
-	/* Read complete, clear RX status alert bit */
-	tcpc_write16(port, TCPC_REG_ALERT, TCPC_REG_ALERT_RX_STATUS);
+	/*
+	 * Read complete, clear RX status alert bit. The other bits are only
+	 * cleared along with a message read, the caller handles them then.
+	 */
+	tcpc_write16(port, TCPC_REG_ALERT,
+		     TCPC_REG_ALERT_RX_STATUS | (rv ? 0 : clear));
 
 	return rv;
 }
 
+static int tcpci_rev1_0_tcpm_get_message_raw(int port, uint32_t *payload,
+					     int *head)
+{
+	return tcpci_rev1_0_read_message(port, payload, head, NULL, 0);
+}
+
 int tcpci_tcpm_get_message_raw(int port, uint32_t *payload, int *head)
 {
 	if (tcpc_config[port].flags & TCPC_FLAGS_TCPCI_REV2_0)
@@ -844,6 +1008,17 @@ int tcpci_tcpm_get_message_raw(int port, uint32_t *payload, int *head)
 	return tcpci_rev1_0_tcpm_get_message_raw(port, payload, head);
 }
 
+/*
+ * The RX fast path is only for TCPCs read with the generic TCPCI routine,
+ * not for drivers with their own get_message_raw.
+ */
+static bool rx_fast_path(int port)
+{
+	return IS_ENABLED(CONFIG_USB_PD_TCPCI_RX_FAST_PATH) &&
+	       tcpc_config[port].drv->get_message_raw ==
+			&tcpci_tcpm_get_message_raw;
+}
+
 /* Cache depth needs to be power of 2 */
 /* TODO: Keep track of the high water mark */
 #define CACHE_DEPTH BIT(3)
@@ -864,10 +1039,16 @@ struct queue {
 };
 static struct queue cached_messages[CONFIG_USB_PD_PORT_MAX_COUNT];
 
-/* Note this method can be called from an interrupt context. */
-int tcpm_enqueue_message(const int port)
+/*
+ * Read a message into the cache. @queued is only given on the RX fast path:
+ * repeated messages are then dropped, @clear alert bits are cleared along with
+ * the RX status when the message could be read, and *@queued is set instead of
+ * waking the PD task.
+ */
+static int enqueue_message(const int port, int clear, bool *queued)
 {
 	int rv;
+	bool repeat = false;
 	struct queue *const q = &cached_messages[port];
 	struct cached_tcpm_message *const head =
 		&q->buffer[q->head & CACHE_DEPTH_MASK];
@@ -879,23 +1060,47 @@ int tcpm_enqueue_message(const int port)
 
 	/* Blank any old message, just in case. */
 	memset(head, 0, sizeof(*head));
-	/* Call the raw driver without caching */
-	rv = tcpc_config[port].drv->get_message_raw(port, head->payload,
-						    &head->header);
+	if (queued && tcpc_config[port].flags & TCPC_FLAGS_TCPCI_REV2_0)
+		rv = tcpci_rev2_0_read_message(port, head->payload,
+					       &head->header, &repeat, clear);
+	else if (queued)
+		rv = tcpci_rev1_0_read_message(port, head->payload,
+					       &head->header, &repeat, clear);
+	else
+		/* Call the raw driver without caching */
+		rv = tcpc_config[port].drv->get_message_raw(port,
+				head->payload, &head->header);
 	if (rv) {
 		CPRINTS("C%d: Could not retrieve RX message (%d)", port, rv);
 		return rv;
 	}
 
+#ifdef CONFIG_USB_PD_TCPCI_RX_FAST_PATH
+	if (repeat) {
+		rx_stats[port].dropped++;
+		return EC_SUCCESS;
+	}
+	rx_stats[port].processed++;
+#endif
+
 	/* Increment atomically to ensure get_message_raw happens-before */
 	atomic_add(&q->head, 1);
 
 	/* Wake PD task up so it can process incoming RX messages */
-	task_set_event(PD_PORT_TO_TASK_ID(port), TASK_EVENT_WAKE);
+	if (queued)
+		*queued = true;
+	else
+		pd_task_set_event(port, TASK_EVENT_WAKE);
 
 	return EC_SUCCESS;
 }
 
+/* Note this method can be called from an interrupt context. */
+int tcpm_enqueue_message(const int port)
+{
+	return enqueue_message(port, 0, NULL);
+}
+
 int tcpm_has_pending_message(const int port)
 {
 	const struct queue *const q = &cached_messages[port];
@@ -1137,6 +1342,9 @@ void tcpci_tcpc_alert(int port)
 	int alert = 0;
 	int alert_ext = 0;
 	int failed_attempts;
+	int clear, cleared = 0;
+	int tx_handled;
+	bool queued = false;
 	uint32_t pd_event = 0;
 
 	/* Read the Alert register from the TCPC */
@@ -1169,12 +1377,35 @@ void tcpci_tcpc_alert(int port)
 		pd_transmit_complete(port, alert & TCPC_REG_ALERT_TX_SUCCESS ?
 					   TCPC_TX_COMPLETE_SUCCESS :
 					   TCPC_TX_COMPLETE_FAILED);
+	/* TX complete bits still set in the TCPC but already handled */
+	tx_handled = alert & TCPC_REG_ALERT_TX_COMPLETE;
 
 	/* Pull all RX messages from TCPC into EC memory */
 	failed_attempts = 0;
 	while (alert & TCPC_REG_ALERT_RX_STATUS) {
-		if (tcpm_enqueue_message(port))
+		if (rx_fast_path(port)) {
+			/*
+			 * Clear the other alert bits along with the first RX
+			 * status, instead of with a write of their own below.
+			 * The extended alerts must be cleared first, and
+			 * faults are cleared with the fault status. A new TX
+			 * complete is left for the end, with the bits seen
+			 * after the last alert read.
+			 */
+			clear = alert & ~(TCPC_REG_ALERT_RX_STATUS |
+					  TCPC_REG_ALERT_RX_BUF_OVF |
+					  TCPC_REG_ALERT_ALERT_EXT |
+					  TCPC_REG_ALERT_FAULT);
+			clear &= ~(TCPC_REG_ALERT_TX_COMPLETE & ~tx_handled);
+			if (enqueue_message(port, clear, &queued)) {
+				++failed_attempts;
+			} else {
+				cleared |= clear;
+				tx_handled &= ~clear;
+			}
+		} else if (tcpm_enqueue_message(port)) {
 			++failed_attempts;
+		}
 		if (tcpm_alert_status(port, &alert))
 			++failed_attempts;
 
@@ -1185,11 +1416,13 @@ void tcpci_tcpc_alert(int port)
 			/*
 			 * The port is in a bad state, we don't want to consume
 			 * all EC resources so suspend the port for a little
-			 * while.
+			 * while. The bits already cleared with the messages
+			 * are still handled below.
 			 */
 			pd_set_suspend(port, 1);
 			pd_deferred_resume(port);
-			return;
+			alert = 0;
+			break;
 		}
 	}
 
@@ -1202,6 +1435,17 @@ void tcpci_tcpc_alert(int port)
 	if (alert)
 		tcpc_write16(port, TCPC_REG_ALERT, alert);
 
+	/* A transmission which completed while reading the messages */
+	if (alert & TCPC_REG_ALERT_TX_COMPLETE & ~tx_handled)
+		pd_transmit_complete(port, alert & TCPC_REG_ALERT_TX_SUCCESS ?
+					   TCPC_TX_COMPLETE_SUCCESS :
+					   TCPC_TX_COMPLETE_FAILED);
+
+	/* Handle the bits cleared with the RX status as well */
+	alert |= cleared;
+	if (queued)
+		pd_event |= TASK_EVENT_WAKE;
+
 	if (alert & TCPC_REG_ALERT_CC_STATUS) {
 		if (IS_ENABLED(CONFIG_USB_PD_DUAL_ROLE_AUTO_TOGGLE)) {
 			enum tcpc_cc_voltage_status cc1;
@@ -1263,7 +1507,7 @@ void tcpci_tcpc_alert(int port)
 	 * the next I2C transaction to the TCPC will cause it to wake again.
 	 */
 	if (pd_event)
-		task_set_event(PD_PORT_TO_TASK_ID(port), pd_event);
+		pd_task_set_event(port, pd_event);
 }
 
 /*
@@ -1346,6 +1590,9 @@ int tcpci_tcpm_release(int port)
 	error = tcpc_write16(port, TCPC_REG_ALERT, 0xffff);
 	if (error)
 		return error;
+	reset_rx_msg_ids(port);
+	/* The TCPC may be powered off or reset before the next init */
+	tcpci_reg_cache_invalidate(port);
 
 	return EC_SUCCESS;
 }
@@ -1366,6 +1613,9 @@ int tcpci_tcpm_init(int port)
 	if (port >= board_get_usb_pd_port_count())
 		return EC_ERROR_INVAL;
 
+	/* The TCPC was reset, or is being set up for the first time */
+	tcpci_reg_cache_init(port);
+
 	while (1) {
 		error = tcpci_tcpm_get_power_status(port, &power_status);
 		/*
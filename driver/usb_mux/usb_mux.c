@@ -387,6 +387,10 @@ static enum ec_status hc_usb_pd_mux_ack(struct host_cmd_handler_args *args)
 	if (!IS_ENABLED(CONFIG_USB_MUX_AP_ACK_REQUEST))
 		return EC_RES_INVALID_COMMAND;
 
+	/*
+	 * The PD task waits for this one itself, with task_wait_event_mask()
+	 * in virtual_set_mux(), so it is not a port event.
+	 */
 	task_set_event(PD_PORT_TO_TASK_ID(p->port), PD_EVENT_AP_MUX_DONE);
 
 	return EC_RES_SUCCESS;
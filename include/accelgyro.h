@@ -19,6 +19,12 @@
 #define MOTION_SCALING_FACTOR (1 << 15)
 #define MOTION_ONE_G (9.80665f)
 
+/* Register block read at each sample, see get_read_plan(). */
+struct motion_read_plan {
+	uint8_t reg;
+	uint8_t len;
+};
+
 struct accelgyro_drv {
 	/**
 	 * Initialize accelerometers.
@@ -161,6 +167,42 @@ struct accelgyro_drv {
 	 * Get the root mean square of current noise (ug/mdps) in the sensor.
 	 */
 	int (*get_rms_noise)(const struct motion_sensor_t *s);
+
+	/**
+	 * Program the interrupt window of a light or proximity sensor.
+	 * The sensor interrupts the EC, through irq_handler, when a reading
+	 * falls outside [low, high]. irq_handler only reports the crossing,
+	 * the new value is collected by read().
+	 * @s Pointer to sensor data.
+	 * @low Lower bound, in the unit returned by read().
+	 * @high Upper bound, in the unit returned by read().
+	 *
+	 * Passing 0 and INT32_MAX masks the interrupt.
+	 */
+	int (*set_threshold)(const struct motion_sensor_t *s,
+			     int low, int high);
+
+	/**
+	 * Declare the registers needed to produce one sample, so the motion
+	 * sense task can fetch the data of several sensors in one burst.
+	 * The block must be safe to read back to back with the blocks of the
+	 * other sensors of the chip.
+	 * @s Pointer to sensor data.
+	 * @plan Register block to fill.
+	 * @return EC_SUCCESS if successful, non-zero to use read() instead.
+	 */
+	int (*get_read_plan)(const struct motion_sensor_t *s,
+			     struct motion_read_plan *plan);
+
+	/**
+	 * Convert the block declared by get_read_plan() into a sample,
+	 * with the same semantics as read().
+	 * @s Pointer to sensor data.
+	 * @data Content of the registers of the plan.
+	 * @v Vector to store the sample.
+	 */
+	int (*decode_read_plan)(const struct motion_sensor_t *s,
+				const uint8_t *data, intv3_t v);
 };
 
 /* Index values for rgb_calibration_t.coeff array */
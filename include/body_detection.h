@@ -30,6 +30,16 @@ void body_detect_set_enable(int enable);
 /* get enable state of body detection */
 int body_detect_get_enable(void);
 
+/*
+ * Set the duration of the variance window (default 1 second). The window is
+ * limited to CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE samples, which bounds the
+ * RAM used for the history. This resets the detector.
+ */
+void body_detect_set_window_duration(int duration_ms);
+
+/* get the duration of the variance window in ms */
+int body_detect_get_window_duration(void);
+
 void body_detect_set_spoof(int enable);
 bool body_detect_get_spoof(void);
 
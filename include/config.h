@@ -68,6 +68,12 @@
  */
 #undef CONFIG_ACCEL_FORCE_MODE_MASK
 
+/*
+ * Fetch the data of the polled sensors with one I2C transaction per register
+ * block, using the read plans declared by their drivers.
+ */
+#undef CONFIG_ACCEL_READ_PLAN
+
 /* Enable accelerometer interrupts. */
 #undef CONFIG_ACCEL_INTERRUPTS
 
@@ -351,6 +357,7 @@
 #undef CONFIG_ACCEL_LSM6DSO_INT_EVENT
 #undef CONFIG_ACCEL_LIS2DS_INT_EVENT
 #undef CONFIG_ACCEL_LIS2DW12_INT_EVENT
+#undef CONFIG_ALS_OPT3001_INT_EVENT
 #undef CONFIG_ALS_SI114X_INT_EVENT
 #undef CONFIG_ALS_TCS3400_INT_EVENT
 
@@ -1394,6 +1401,7 @@
 #undef  CONFIG_CMD_USART_INFO
 #define CONFIG_CMD_USBMUX
 #undef  CONFIG_CMD_USB_PD_CABLE
+#define CONFIG_CMD_USB_PD_DISC_CACHE
 #undef  CONFIG_CMD_USB_PD_PE
 #define CONFIG_CMD_WAITMS
 #undef  CONFIG_CMD_AP_RESET_LOG
@@ -1505,6 +1513,13 @@
  */
 #define CONFIG_CONSOLE_ENABLE_READ_V1
 
+/*
+ * Enable EC_CMD_CONSOLE_READ V2, which reads the console output incrementally
+ * from a sequence number, and with CONFIG_MKBP_EVENT, lets the host wait for
+ * new output with EC_MKBP_EVENT_CONSOLE_DATA.
+ */
+#undef CONFIG_CONSOLE_ENABLE_READ_V2
+
 /*
  * Number of entries in console history buffer.
  *
@@ -1515,6 +1530,13 @@
 /* Max length of a single line of input */
 #define CONFIG_CONSOLE_INPUT_LINE_SIZE 80
 
+/*
+ * Print cprints() output as binary records, with the format strings left out
+ * of the image. util/ec3po/detokenizer.py turns the records back into text
+ * with the ELF files of the image. cprintf() and cputs() still print text.
+ */
+#undef CONFIG_CONSOLE_TOKENIZED
+
 /* Enable verbose output to UART console and extra timestamp print precision. */
 #define CONFIG_CONSOLE_VERBOSE
 
@@ -1849,6 +1871,12 @@
 #undef CONFIG_FP_SENSOR_ELAN80
 #undef CONFIG_FP_SENSOR_ELAN515
 
+/*
+ * Support version 1 of EC_CMD_FP_FRAME, which returns the raw image
+ * compressed, to speed up its transfer to the host.
+ */
+#undef CONFIG_FP_FRAME_COMPRESSION
+
 /*****************************************************************************/
 
 /* Include a flashmap in the compiled firmware image */
@@ -2039,6 +2067,13 @@
 /* Do we want to detect the lid angle? */
 #undef CONFIG_LID_ANGLE
 
+/*
+ * Skip the lid angle computation while no axis of the base and lid vectors
+ * moved by more than this value, in mg, since the last computation. The
+ * previous angle is reused instead.
+ */
+#undef CONFIG_LID_ANGLE_GATE_MG
+
 /* Which sensor is located on the base? */
 #undef CONFIG_LID_ANGLE_SENSOR_BASE
 /* Which sensor is located on the lid? */
@@ -2350,6 +2385,13 @@
  */
 #undef CONFIG_I2C_CONTROLLER
 
+/*
+ * Support queuing I2C transactions with i2c_xfer_async(). Transactions are
+ * run by an i2c_async_task() per port, declared in the board task list, so
+ * the submitting task can keep going meanwhile.
+ */
+#undef CONFIG_I2C_ASYNC
+
 /* EC uses an I2C peripheral interface */
 #undef CONFIG_I2C_PERIPHERAL
 
@@ -2404,6 +2446,22 @@
  */
 #undef CONFIG_I2C_UPDATE_IF_CHANGED
 
+/*
+ * Keep per-port I2C counters: transfers, bytes, errors and NACK retries, time
+ * holding the port lock, a histogram of the transfer durations and per-device
+ * counters. They are read with EC_CMD_I2C_STATS ("ectool i2cstats").
+ */
+#undef CONFIG_I2C_STATS
+
+/*
+ * Support caching the registers of I2C devices, see i2c_reg_cache.h. Drivers
+ * opt in by registering the registers that only change when the EC writes
+ * them, so i2c_read8() of these is served from memory and read-modify-write
+ * sequences cost a single write. TCPCI TCPCs cache their control and mask
+ * registers from tcpci_tcpm_init().
+ */
+#undef CONFIG_I2C_REG_CACHE
+
 /*
  * Packet error checking support for SMBus.
  *
@@ -3655,6 +3713,18 @@
  */
 #undef CONFIG_TASK_RESET_LIST
 
+/*
+ * Let the owner of a mutex initialized with MUTEX_PRIO_INHERIT_INIT run at the
+ * priority of the highest priority task waiting for it, so that a medium
+ * priority task cannot delay the waiter indefinitely. The I2C port locks use
+ * it, which bounds the time a PD task waits for a bus held by a low priority
+ * task.
+ *
+ * Only supported by the cortex-m and host cores, the others fail to build
+ * with it.
+ */
+#undef CONFIG_TASK_PRIORITY_INHERITANCE
+
 /*
  * Enable task profiling.
  *
@@ -3888,6 +3958,13 @@
 /* Use DMA for UART output */
 #undef CONFIG_UART_TX_DMA
 
+/*
+ * Count the bytes of UART output written, the writes cut short because the
+ * transmit buffer was full, and the time spent moving data in the UART
+ * interrupt, for the "uartstats" console command.
+ */
+#undef CONFIG_UART_STATS
+
 /* The DMA channel for UART.  If not defined, default to UART1. */
 #undef CONFIG_UART_TX_DMA_CH
 #undef CONFIG_UART_RX_DMA_CH
@@ -3968,6 +4045,22 @@
 #define CONFIG_USB_PRL_SM
 #define CONFIG_USB_PE_SM
 
+/*
+ * Count the entries and the time spent in each state of the TCPMv2 state
+ * machines, and the transitions of each port, for the "pd smstats" console
+ * command. Costs about 3KB of RAM.
+ */
+#undef CONFIG_USB_SM_STATS
+
+/*
+ * Run the TCPMv2 state machines of all the ports from a single task, PD_C0,
+ * instead of one PD_C<n> task per port. Saves the stacks of the other PD
+ * tasks. Events are kept per port, and each port runs when it has events or
+ * when its own loop timeout expires. Only the PD_C0 task should be declared
+ * in the board task list.
+ */
+#undef CONFIG_USB_PD_SINGLE_TASK
+
 /* Enables PD Console commands */
 #define CONFIG_USB_PD_CONSOLE_CMD
 
@@ -3980,6 +4073,27 @@
 /* Support for USB PD alternate mode of Downward Facing Port */
 #undef CONFIG_USB_PD_ALT_MODE_DFP
 
+/*
+ * Cache the SVIDs and modes discovered for the last port partners and cable
+ * plugs, keyed by the VID, PID, XID and bcdDevice of their Discover Identity
+ * ACK. When a known partner reconnects, the TCPMv2 PE skips Discover SVIDs and
+ * Discover Modes so the DPM can enter alternate modes right away, then, as a
+ * DFP, discovers them again once mode entry is done to check the cached data.
+ * Revalidation uses a struct pd_discovery per port, so the restored data stays
+ * readable meanwhile.
+ * Requires CONFIG_USB_PD_TCPMV2 and CONFIG_USB_PD_ALT_MODE_DFP.
+ */
+#undef CONFIG_USB_PD_DISCOVERY_CACHE
+
+/* Number of partners and cable plugs kept in the discovery cache */
+#define CONFIG_USB_PD_DISCOVERY_CACHE_SIZE 4
+
+/*
+ * Preserve the discovery cache across a jump between images. Each entry is
+ * stored with a CRC8, and dropped if it does not match. Selects CONFIG_CRC8.
+ */
+#undef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+
 /*
  * Do not enter USB PD alternate modes or USB4 automatically. Wait for the AP to
  * direct the EC to enter a mode. This requires AP software support.
@@ -4251,6 +4365,15 @@
 /* Enable runtime config the TCPC */
 #undef CONFIG_USB_PD_TCPC_RUNTIME_CONFIG
 
+/*
+ * Read RX messages from TCPCI TCPCs with fewer I2C transfers. A message
+ * repeating the MessageID of the last one is dropped after its header is
+ * read, without waking the PD task, and the other alert bits are cleared
+ * along with the RX status. Use "tcpcirx" to print the counters. The
+ * protocol layer must call tcpm_reset_rx_msg_id(), as TCPMv2 does.
+ */
+#undef CONFIG_USB_PD_TCPCI_RX_FAST_PATH
+
 /*
  * Choose one of the following TCPMs (type-C port manager) to manage TCPC. The
  * TCPM stub is used to make direct function calls to TCPC when TCPC is on
@@ -4971,6 +5094,9 @@
 /* Define to enable USB State Machine framework. */
 #undef CONFIG_TEST_SM
 
+/* Define to build the USB PD discovery cache on its own. */
+#undef CONFIG_TEST_USB_PD_DISC_CACHE
+
 /*
  * This build is not a complete platform/ec based EC, but instead
  * using the platform/ec zephyr module.
@@ -5882,6 +6008,11 @@
 #define CONFIG_CRC8
 #endif
 
+/* The discovery cache checks the entries it gets back after a sysjump */
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+#define CONFIG_CRC8
+#endif
+
 #if defined(CONFIG_ONLINE_CALIB) && !defined(CONFIG_FPU)
 #error "Online calibration requires CONFIG_FPU"
 #endif
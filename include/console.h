@@ -135,6 +135,105 @@ int cprintf(enum console_channel channel, const char *format, ...);
 __attribute__((__format__(__printf__, 2, 3)))
 int cprints(enum console_channel channel, const char *format, ...);
 
+#if defined(CONFIG_CONSOLE_TOKENIZED) && !defined(__cplusplus)
+/*
+ * Tokenized cprints(): the format string goes to the .tokenized_fmt section,
+ * which is not part of the image, and the EC prints a record of the offset of
+ * the string in that section (its token), the time, and the arguments. See
+ * util/ec3po/detokenizer.py to turn the records back into text.
+ *
+ * The type of each argument is found at build time, so that the EC can
+ * encode them without the format string.
+ */
+enum tokenized_arg_type {
+	TOKENIZED_ARG_32,	/* Integer of up to 32 bits */
+	TOKENIZED_ARG_64,	/* 64-bit integer */
+	TOKENIZED_ARG_STR,	/* char * */
+	TOKENIZED_ARG_PTR,	/* Any other pointer */
+	TOKENIZED_ARG_TIME,	/* uint64_t * for %pT */
+	TOKENIZED_ARG_HEX,	/* HEX_BUF() for %ph */
+	TOKENIZED_ARG_BIN,	/* BINARY_VALUE() for %pb */
+};
+
+/* The argument count takes 4 bits, then each type 3 bits */
+#define TOKENIZED_MAX_ARGS 9
+#define TOKENIZED_TYPE_SHIFT(i) (4 + 3 * (i))
+
+#define TOKENIZED_ARG(x, i) ((uint32_t)_Generic((x),			\
+	char *: TOKENIZED_ARG_STR,					\
+	const char *: TOKENIZED_ARG_STR,				\
+	void *: TOKENIZED_ARG_PTR,					\
+	const void *: TOKENIZED_ARG_PTR,				\
+	uint64_t *: TOKENIZED_ARG_TIME,					\
+	const uint64_t *: TOKENIZED_ARG_TIME,				\
+	struct hex_buffer_params *: TOKENIZED_ARG_HEX,			\
+	const struct hex_buffer_params *: TOKENIZED_ARG_HEX,		\
+	struct binary_print_params *: TOKENIZED_ARG_BIN,		\
+	const struct binary_print_params *: TOKENIZED_ARG_BIN,		\
+	default: sizeof((x) + 0) > sizeof(uint32_t) ?			\
+		TOKENIZED_ARG_64 : TOKENIZED_ARG_32)			\
+	<< TOKENIZED_TYPE_SHIFT(i))
+
+#define TOKENIZED_NARGS(args...)					\
+	_TOKENIZED_NARGS(, ## args, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _TOKENIZED_NARGS(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10,	\
+			 n, ...) n
+
+#define _TOKENIZED_TYPES_0()	0
+#define _TOKENIZED_TYPES_1(a)	TOKENIZED_ARG(a, 0)
+#define _TOKENIZED_TYPES_2(a, args...)					\
+	(TOKENIZED_ARG(a, 1) | _TOKENIZED_TYPES_1(args))
+#define _TOKENIZED_TYPES_3(a, args...)					\
+	(TOKENIZED_ARG(a, 2) | _TOKENIZED_TYPES_2(args))
+#define _TOKENIZED_TYPES_4(a, args...)					\
+	(TOKENIZED_ARG(a, 3) | _TOKENIZED_TYPES_3(args))
+#define _TOKENIZED_TYPES_5(a, args...)					\
+	(TOKENIZED_ARG(a, 4) | _TOKENIZED_TYPES_4(args))
+#define _TOKENIZED_TYPES_6(a, args...)					\
+	(TOKENIZED_ARG(a, 5) | _TOKENIZED_TYPES_5(args))
+#define _TOKENIZED_TYPES_7(a, args...)					\
+	(TOKENIZED_ARG(a, 6) | _TOKENIZED_TYPES_6(args))
+#define _TOKENIZED_TYPES_8(a, args...)					\
+	(TOKENIZED_ARG(a, 7) | _TOKENIZED_TYPES_7(args))
+#define _TOKENIZED_TYPES_9(a, args...)					\
+	(TOKENIZED_ARG(a, 8) | _TOKENIZED_TYPES_8(args))
+
+/*
+ * Argument count and types, in a constant. The types are numbered from the
+ * last argument, so that each macro above only needs its own count.
+ */
+#define TOKENIZED_TYPES(args...)					\
+	(TOKENIZED_NARGS(args) |					\
+	 CONCAT2(_TOKENIZED_TYPES_, TOKENIZED_NARGS(args))(args))
+
+/* Only there to check the format against the arguments */
+__attribute__((__format__(__printf__, 1, 2)))
+static inline void tokenized_check_format(const char *format, ...)
+{
+}
+
+/**
+ * Print a tokenized record, see cprints().
+ *
+ * @param channel	Output channel
+ * @param format	Format string, in the .tokenized_fmt section
+ * @param types		TOKENIZED_TYPES() of the arguments
+ *
+ * @return non-zero if output was truncated.
+ */
+int cprints_tokenized(enum console_channel channel, const char *format,
+		      uint32_t types, ...);
+
+#define cprints(channel, format, args...)				\
+	({								\
+		static const char __tokenized_fmt[]			\
+			__attribute__((section(".tokenized_fmt"))) = format; \
+		tokenized_check_format(format, ## args);		\
+		cprints_tokenized(channel, __tokenized_fmt,		\
+				  TOKENIZED_TYPES(args), ## args);	\
+	})
+#endif /* CONFIG_CONSOLE_TOKENIZED */
+
 /**
  * Flush the console output for all channels.
  */
@@ -257,6 +257,18 @@ int tcpci_tcpm_get_message_raw(int port, uint32_t *payload, int *head);
 int tcpci_tcpm_transmit(int port, enum tcpm_transmit_type type,
 			uint16_t header, const uint32_t *data);
 int tcpci_tcpm_release(int port);
+
+/**
+ * Write a command to the TCPC COMMAND register.
+ *
+ * A command may change any register of the TCPC, so the register cache of
+ * the port is dropped.
+ *
+ * @param port USB-C port number
+ * @param cmd TCPC_REG_COMMAND_... or a vendor command
+ * @return EC_SUCCESS or error
+ */
+int tcpci_write_command(int port, int cmd);
 #ifdef CONFIG_USB_PD_DUAL_ROLE_AUTO_TOGGLE
 int tcpci_set_role_ctrl(int port, enum tcpc_drp drp, enum tcpc_rp_value rp,
 	enum tcpc_cc_pull pull);
@@ -285,4 +297,19 @@ int tcpci_tcpm_set_src_ctrl(int port, int enable);
 
 int tcpci_tcpc_fast_role_swap_enable(int port, int enable);
 
+struct tcpci_rx_stats {
+	/* Messages read into the RX cache */
+	uint32_t processed;
+	/* Repeated messages dropped before reading their payload */
+	uint32_t dropped;
+};
+
+/**
+ * Get the counters of the RX fast path, see CONFIG_USB_PD_TCPCI_RX_FAST_PATH.
+ *
+ * @param port Type-C port number
+ * @param stats Filled with the counters of the port
+ */
+void tcpci_get_rx_stats(int port, struct tcpci_rx_stats *stats);
+
 #endif /* __CROS_EC_USB_PD_TCPM_TCPCI_H */
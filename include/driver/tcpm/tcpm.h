@@ -518,6 +518,21 @@ int tcpm_has_pending_message(int port);
  */
 void tcpm_clear_pending_messages(int port);
 
+/**
+ * Forget the MessageID of the last message received with a SOP* type, when
+ * the protocol layer resets it, so that the RX fast path does not drop the
+ * next message as a repeat.
+ *
+ * @param port Type-C port number
+ * @param sop SOP* type
+ */
+#ifdef CONFIG_USB_PD_TCPCI_RX_FAST_PATH
+void tcpm_reset_rx_msg_id(int port, enum tcpm_transmit_type sop);
+#else
+static inline void tcpm_reset_rx_msg_id(int port,
+					enum tcpm_transmit_type sop) { }
+#endif
+
 /**
  * Enable/Disable TCPC Fast Role Swap detection
  *
@@ -2566,6 +2566,14 @@ enum motionsense_command {
 	 */
 	MOTIONSENSE_CMD_GET_ACTIVITY = 20,
 
+	/*
+	 * Threshold window command is a setter/getter command for the width of
+	 * the interrupt window programmed around the last reading of a light
+	 * or proximity sensor. While the reading stays in the window, the
+	 * sensor is not polled.
+	 */
+	MOTIONSENSE_CMD_THRESHOLD_WINDOW = 21,
+
 	/* Number of motionsense sub-commands. */
 	MOTIONSENSE_NUM_CMDS
 };
@@ -2949,12 +2957,30 @@ struct ec_params_motion_sense {
 			uint8_t sensor_num;
 			uint8_t activity;  /* enum motionsensor_activity */
 		} get_activity;
+
+		/* Used for MOTIONSENSE_CMD_THRESHOLD_WINDOW. */
+		struct __ec_todo_unpacked {
+			uint8_t sensor_num;
+
+			/* Ignored, used for alignment. */
+			uint8_t reserved;
+
+			/*
+			 * Window width in percent of the last reading, 0 to
+			 * poll the sensor at its ODR, or
+			 * EC_MOTION_SENSE_NO_VALUE to read the current width.
+			 */
+			int16_t window;
+		} threshold_window;
 	};
 } __ec_todo_packed;
 
 enum motion_sense_cmd_info_flags {
 	/* The sensor supports online calibration */
 	MOTION_SENSE_CMD_INFO_FLAG_ONLINE_CALIB = BIT(0),
+
+	/* The sensor supports MOTIONSENSE_CMD_THRESHOLD_WINDOW */
+	MOTION_SENSE_CMD_INFO_FLAG_THRESHOLD = BIT(1),
 };
 
 struct ec_response_motion_sense {
@@ -3041,14 +3067,15 @@ struct ec_response_motion_sense {
 		 * Used for MOTIONSENSE_CMD_EC_RATE, MOTIONSENSE_CMD_SENSOR_ODR,
 		 * MOTIONSENSE_CMD_SENSOR_RANGE,
 		 * MOTIONSENSE_CMD_KB_WAKE_ANGLE,
-		 * MOTIONSENSE_CMD_FIFO_INT_ENABLE and
-		 * MOTIONSENSE_CMD_SPOOF.
+		 * MOTIONSENSE_CMD_FIFO_INT_ENABLE,
+		 * MOTIONSENSE_CMD_SPOOF and
+		 * MOTIONSENSE_CMD_THRESHOLD_WINDOW.
 		 */
 		struct __ec_todo_unpacked {
 			/* Current value of the parameter queried. */
 			int32_t ret;
 		} ec_rate, sensor_odr, sensor_range, kb_wake_angle,
-		  fifo_int_enable, spoof;
+		  fifo_int_enable, spoof, threshold_window;
 
 		/*
 		 * Used for MOTIONSENSE_CMD_SENSOR_OFFSET,
@@ -3735,6 +3762,13 @@ enum ec_mkbp_event {
 	/* New online calibration values are available. */
 	EC_MKBP_EVENT_ONLINE_CALIBRATION = 11,
 
+	/*
+	 * New console output is available, see EC_CMD_CONSOLE_READ version 2.
+	 * The event data is the sequence number of the next byte the EC will
+	 * write.
+	 */
+	EC_MKBP_EVENT_CONSOLE_DATA = 12,
+
 	/* Number of MKBP events */
 	EC_MKBP_EVENT_COUNT,
 };
@@ -3763,6 +3797,8 @@ union __ec_align_offset1 ec_response_get_next_data {
 
 	/* CEC events from enum mkbp_cec_event */
 	uint32_t cec_events;
+
+	uint32_t console_seq;
 };
 
 union __ec_align_offset1 ec_response_get_next_data_v1 {
@@ -3790,6 +3826,8 @@ union __ec_align_offset1 ec_response_get_next_data_v1 {
 	uint32_t cec_events;
 
 	uint8_t cec_message[16];
+
+	uint32_t console_seq;
 };
 BUILD_ASSERT(sizeof(union ec_response_get_next_data_v1) == 16);
 
@@ -4215,7 +4253,8 @@ struct ec_params_charge_control {
  * end of the previous snapshot.
  *
  * The params are only looked at in version >= 1 of this command. Prior
- * versions will just default to CONSOLE_READ_NEXT behavior.
+ * versions will just default to CONSOLE_READ_NEXT behavior. Version 2 does
+ * not use snapshots, see struct ec_params_console_read_v2.
  *
  * Response is null-terminated string.  Empty string, if there is no more
  * remaining output.
@@ -4231,6 +4270,38 @@ struct ec_params_console_read_v1 {
 	uint8_t subcmd; /* enum ec_console_read_subcmd */
 } __ec_align1;
 
+/*
+ * Version 2 reads the console output incrementally, without a snapshot. Each
+ * byte written to the console buffer has a sequence number: the host passes
+ * the one of the next byte it wants, and keeps next_seq of the response for
+ * its following read. Several readers can each keep their own position.
+ *
+ * The response holds as many bytes as fit, up to head_seq. It starts after
+ * the requested byte if that was overwritten, or with the oldest byte if the
+ * requested one is ahead of the output, e.g. after an EC reboot.
+ */
+struct ec_params_console_read_v2 {
+	/* Sequence number of the first byte to read */
+	uint32_t seq;
+	/*
+	 * Send EC_MKBP_EVENT_CONSOLE_DATA once the output is this many bytes
+	 * past next_seq, or 0 for no event. Each read replaces the watermark
+	 * of the previous one.
+	 */
+	uint32_t watermark;
+} __ec_align4;
+
+struct ec_response_console_read_v2 {
+	/* Sequence number of the first byte read */
+	uint32_t seq;
+	/* Sequence number to read from next */
+	uint32_t next_seq;
+	/* Sequence number of the next byte the EC will write */
+	uint32_t head_seq;
+	/* Console output, not null-terminated */
+	char data[];
+} __ec_align4;
+
 /*****************************************************************************/
 
 /*
@@ -6769,6 +6840,53 @@ enum pchg_state {
 	[PCHG_STATE_CHARGING] = "CHARGING", \
 	}
 
+/*****************************************************************************/
+/*
+ * Get the transfer statistics of an I2C port.
+ */
+#define EC_CMD_I2C_STATS 0x0136
+
+#define EC_I2C_STATS_HIST_BUCKETS 16
+#define EC_I2C_STATS_MAX_ADDRS 8
+
+/* Clear the statistics of the port once read. */
+#define EC_I2C_STATS_FLAG_RESET BIT(0)
+
+struct ec_params_i2c_stats {
+	uint8_t port;			/* I2C port, less than port_count */
+	uint8_t flags;			/* EC_I2C_STATS_FLAG_* */
+} __ec_align1;
+
+struct ec_i2c_stats_addr {
+	uint16_t addr_flags;
+	uint16_t reserved;
+	uint32_t xfers;
+	uint32_t bytes;
+	uint32_t errors;
+} __ec_align4;
+
+struct ec_response_i2c_stats {
+	uint8_t port_count;		/* Number of I2C ports */
+	uint8_t addr_count;		/* Valid entries of addrs[] */
+	uint16_t reserved;
+	uint32_t xfers;
+	uint32_t bytes_out;
+	uint32_t bytes_in;
+	uint32_t errors;		/* Failed transfers */
+	uint32_t retries;		/* Retries after a NACK */
+	uint32_t lock_count;
+	uint32_t lock_time_us;		/* Time the port was held locked */
+	uint32_t xfer_time_us;		/* Time spent in transfers */
+	/*
+	 * Histogram of the transfer durations: hist[0] counts the transfers
+	 * shorter than 1us, hist[i] the ones taking [2^(i-1), 2^i) us. The
+	 * last bucket also counts all longer transfers.
+	 */
+	uint32_t hist[EC_I2C_STATS_HIST_BUCKETS];
+	/* Per-device counters, for the first devices accessed. */
+	struct ec_i2c_stats_addr addrs[EC_I2C_STATS_MAX_ADDRS];
+} __ec_align4;
+
 /*****************************************************************************/
 /* The command range 0x200-0x2FF is reserved for Rotor. */
 
@@ -6965,6 +7083,25 @@ struct ec_params_fp_frame {
 	uint32_t size;
 } __ec_align4;
 
+/*
+ * Version 1 only returns the raw image (FP_FRAME_INDEX_RAW_IMAGE), encoded to
+ * take less time on the bus. size is the number of bytes of the image wanted
+ * from offset: the response holds as many of them as fit in it, which the
+ * host gets from its size field.
+ */
+#define FP_FRAME_ENCODING_RAW       0
+/* Pixel differences with run-length encoding, see fpsensor_frame_codec.h */
+#define FP_FRAME_ENCODING_DELTA_RLE 1
+
+struct ec_response_fp_frame_v1 {
+	/* Number of bytes of the image in data, once decoded */
+	uint32_t size;
+	/* One of FP_FRAME_ENCODING_* */
+	uint8_t encoding;
+	uint8_t reserved[3];
+	uint8_t data[];
+} __ec_align4;
+
 /* Load a template into the MCU */
 #define EC_CMD_FP_TEMPLATE 0x0405
 
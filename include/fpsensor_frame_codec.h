@@ -0,0 +1,46 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Lossless encoding of 8-bit grayscale fingerprint frames, used by version 1
+ * of EC_CMD_FP_FRAME. Shared by the FPMCU and ectool.
+ */
+
+#ifndef __CROS_EC_FPSENSOR_FRAME_CODEC_H
+#define __CROS_EC_FPSENSOR_FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Encode pixels, as many as fit in the output buffer.
+ *
+ * Each call starts a new encoding, so the pixels can be decoded without the
+ * ones of the previous calls.
+ *
+ * @param src      Pixels to encode
+ * @param src_size Number of pixels
+ * @param dst      Output buffer
+ * @param dst_size Size of the output buffer
+ * @param src_used Set to the number of pixels that were encoded
+ * @return the number of bytes written to dst
+ */
+size_t fp_frame_encode(const uint8_t *src, size_t src_size,
+		       uint8_t *dst, size_t dst_size, size_t *src_used);
+
+/**
+ * Decode pixels encoded by fp_frame_encode().
+ *
+ * @param src      Encoded data
+ * @param src_size Size of the encoded data
+ * @param dst      Output buffer for the pixels
+ * @param dst_size Size of the output buffer
+ * @return the number of pixels decoded, or -1 if the data is corrupted or
+ *         does not fit in dst
+ */
+int fp_frame_decode(const uint8_t *src, size_t src_size,
+		    uint8_t *dst, size_t dst_size);
+
+#endif /* __CROS_EC_FPSENSOR_FRAME_CODEC_H */
@@ -12,6 +12,7 @@
 #include "gpio.h"
 #include "host_command.h"
 #include "stddef.h"
+#include "task_id.h"
 
 /*
  * I2C Peripheral Address encoding
@@ -195,6 +196,98 @@ int i2c_xfer_unlocked(const int port,
 		      const uint8_t *out, int out_size,
 		      uint8_t *in, int in_size, int flags);
 
+/* One message of an asynchronous transaction, see i2c_xfer_async(). */
+struct i2c_async_msg {
+	uint16_t addr_flags;
+	const uint8_t *out;
+	int out_size;
+	uint8_t *in;
+	int in_size;
+};
+
+/* Asynchronous transaction: a list of messages sent back to back. */
+struct i2c_async_xfer {
+	int port;
+	const struct i2c_async_msg *msgs;
+	int count;
+
+	/*
+	 * Completion notification, both are optional: done() is called from
+	 * the task serving the port, then @event is set on @task if non-zero.
+	 */
+	void (*done)(struct i2c_async_xfer *xfer);
+	task_id_t task;
+	uint32_t event;
+
+	/* Result of the transaction, valid once completed. */
+	int rv;
+
+	/* Private to the queue. */
+	volatile uint8_t queued;
+	struct i2c_async_xfer *next;
+};
+
+/**
+ * Task running the transactions queued on one port.
+ *
+ * Boards declare one task per port used asynchronously, passing the port as
+ * the task parameter, so ports run concurrently and independently of the
+ * other tasks.
+ *
+ * @param u		I2C port, cast to a pointer
+ */
+void i2c_async_task(void *u);
+
+/**
+ * Queue a transaction and return immediately.
+ *
+ * Transactions are run by i2c_async_task() in submission order for a given
+ * port, each one with the port locked for its whole list of messages, so a
+ * list is atomic on the bus like an i2c_lock() section. Each message is an
+ * I2C_XFER_SINGLE transfer and the list stops at the first error.
+ *
+ * The transaction and the buffers it points to must stay valid until the
+ * completion is notified, or i2c_xfer_async_cancel() returns.
+ *
+ * @param xfer		Transaction to queue
+ * @return EC_SUCCESS, EC_ERROR_BUSY if @xfer is still queued or running, or
+ *	   EC_ERROR_INVAL for an unknown port.
+ */
+int i2c_xfer_async(struct i2c_async_xfer *xfer);
+
+/**
+ * Cancel a transaction queued with i2c_xfer_async().
+ *
+ * A transaction that did not reach the bus yet is dropped, without any
+ * completion notification. One already running is left to complete, and
+ * this blocks until it is notified. Either way, the transaction and its
+ * buffers are no longer used on return.
+ *
+ * Must not be called from the done() callback of @xfer.
+ *
+ * @param xfer		Transaction to cancel
+ * @return EC_SUCCESS if @xfer was dropped, EC_ERROR_BUSY if it was not
+ *	   queued anymore, or EC_ERROR_INVAL for an unknown port.
+ */
+int i2c_xfer_async_cancel(struct i2c_async_xfer *xfer);
+
+/**
+ * Wait for a transaction queued with i2c_xfer_async() to complete.
+ *
+ * Requires @xfer->event to be set on the calling task, and consumes it. Other
+ * events received meanwhile are preserved. On timeout, a transaction that
+ * did not reach the bus yet is cancelled, and one already running is waited
+ * for, so its buffers can be released whatever the result.
+ *
+ * Must not be called from the HOOK task, nor from the task serving the port.
+ *
+ * @param xfer		Transaction to wait for
+ * @param timeout_us	Maximum time to wait
+ * @return The transaction result, EC_ERROR_TIMEOUT if it was cancelled, or
+ *	   EC_ERROR_INVAL if @xfer->event is not set.
+ */
+int i2c_xfer_async_wait(struct i2c_async_xfer *xfer, int timeout_us);
+
 #define I2C_LINE_SCL_HIGH BIT(0)
 #define I2C_LINE_SDA_HIGH BIT(1)
 #define I2C_LINE_IDLE (I2C_LINE_SCL_HIGH | I2C_LINE_SDA_HIGH)
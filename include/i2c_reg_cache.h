@@ -0,0 +1,100 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* I2C register cache for slow-changing device registers */
+
+#ifndef __CROS_EC_I2C_REG_CACHE_H
+#define __CROS_EC_I2C_REG_CACHE_H
+
+#include "common.h"
+#include "stdint.h"
+
+/* Inclusive range of 8-bit registers. */
+struct i2c_reg_cache_range {
+	uint8_t first;
+	uint8_t last;
+};
+
+/*
+ * Cache of the 8-bit registers of one device.
+ *
+ * Only the registers listed in @ranges are cached: they must only change
+ * when the EC writes them. All other registers are volatile and always read
+ * from the device. Once registered, i2c_read8() of a cached register is
+ * served from memory after the first read, i2c_write8() is written through,
+ * so i2c_update8() and i2c_field_update8() cost a single write. Any other
+ * write to the device invalidates the registers it covers, a command (single
+ * byte write) all of them.
+ */
+struct i2c_reg_cache {
+	int port;
+	uint16_t addr_flags;
+	const struct i2c_reg_cache_range *ranges;
+	int range_count;
+
+	/* Storage, one entry per register of @ranges, in order. */
+	uint16_t *entries;
+	int entry_count;
+
+	/* Cached register reads served from memory and from the device. */
+	uint32_t hits;
+	uint32_t misses;
+
+	/* Private to the cache. */
+	struct i2c_reg_cache *next;
+};
+
+/**
+ * Start caching the registers of a device.
+ *
+ * Registering a cache again invalidates it.
+ *
+ * @param cache		Cache to register, must stay valid afterwards.
+ * @return EC_SUCCESS, EC_ERROR_INVAL if @entries is too small, or
+ *	   EC_ERROR_UNIMPLEMENTED for a device using PEC.
+ */
+int i2c_reg_cache_register(struct i2c_reg_cache *cache);
+
+/**
+ * Drop all cached values, to be called when the device is reset or may
+ * have lost its state.
+ *
+ * @param cache		Cache to invalidate.
+ */
+void i2c_reg_cache_invalidate(struct i2c_reg_cache *cache);
+
+/*
+ * Hooks used by the I2C controller code, the port must not be locked by the
+ * caller unless stated otherwise.
+ */
+
+/**
+ * Find the cache holding a register.
+ *
+ * @return The cache, or NULL if the register is not cached.
+ */
+struct i2c_reg_cache *i2c_reg_cache_find(int port, uint16_t addr_flags,
+					 int offset);
+
+/**
+ * Read a cached register, from memory if the value is known.
+ */
+int i2c_reg_cache_read8(struct i2c_reg_cache *cache, int offset, int *data);
+
+/**
+ * Write a cached register and remember its value.
+ */
+int i2c_reg_cache_write8(struct i2c_reg_cache *cache, int offset, int data);
+
+/**
+ * Invalidate the registers covered by a raw write, called with the port
+ * locked. A single byte write is a command which may change any register,
+ * it invalidates the whole cache of the device.
+ */
+void i2c_reg_cache_xfer(int port, uint16_t addr_flags,
+			const uint8_t *out, int out_size, int in_size,
+			int flags);
+
+#endif /* __CROS_EC_I2C_REG_CACHE_H */
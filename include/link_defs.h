@@ -23,6 +23,9 @@
 extern const struct console_command __cmds[];
 extern const struct console_command __cmds_end[];
 
+/* Format strings of tokenized console output; not loaded in the image. */
+extern const char __tokenized_fmt_start[];
+
 /* Extension commands. */
 extern const void *__extension_cmds;
 extern const void *__extension_cmds_end;
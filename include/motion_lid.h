@@ -34,6 +34,15 @@ enum ec_status host_cmd_motion_lid(struct host_cmd_handler_args *args);
 
 void motion_lid_calc(void);
 
+/**
+ * Get the number of lid angle evaluations since boot.
+ *
+ * @param computed Number of evaluations running the full calculation.
+ * @param skipped Number of evaluations reusing the last angle because the
+ * vectors did not move, see CONFIG_LID_ANGLE_GATE_MG.
+ */
+void motion_lid_get_calc_count(uint32_t *computed, uint32_t *skipped);
+
 #endif  /* __CROS_EC_MOTION_LID_H */
 
 
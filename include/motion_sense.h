@@ -243,6 +243,16 @@ struct motion_sensor_t {
 	 */
 	uint32_t collection_rate;
 
+	/*
+	 * For sensors with a set_threshold method, width in percent of the
+	 * interrupt window programmed around the last reading. While the
+	 * window is armed the sensor is not polled. 0 to always poll.
+	 */
+	uint8_t threshold_window;
+
+	/* Set while the sensor waits for a threshold interrupt. */
+	uint8_t threshold_armed;
+
 	/* Minimum supported sampling frequency in miliHertz for this sensor */
 	uint32_t min_frequency;
 
@@ -0,0 +1,50 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Batched register reads for polled motion sensors. */
+
+#ifndef __CROS_EC_MOTION_SENSE_READ_PLAN_H
+#define __CROS_EC_MOTION_SENSE_READ_PLAN_H
+
+#include "motion_sense.h"
+
+/** Largest register block a single burst may cover. */
+#define MOTION_READ_PLAN_MAX_LEN 32
+
+/**
+ * Execute the read plans of a set of sensors.
+ *
+ * For each I2C port, the port is locked once and the register blocks of the
+ * sensors behind the same device address are merged when they overlap or are
+ * contiguous, so each merged block costs a single transaction. Sensors whose
+ * driver does not provide a plan, or whose transfer failed, are left to their
+ * regular read() routine.
+ *
+ * Must be called from the motion sense task.
+ *
+ * @param sensor_mask Bit mask of the sensors about to be read.
+ */
+void motion_sense_read_plan_fetch(uint32_t sensor_mask);
+
+/**
+ * Decode the data fetched for a sensor by motion_sense_read_plan_fetch().
+ * The data is consumed: a second call returns EC_ERROR_NOT_HANDLED.
+ *
+ * @param s Pointer to the sensor.
+ * @param v Vector to store the reading.
+ * @return EC_ERROR_NOT_HANDLED when no data was fetched for the sensor,
+ *	   otherwise the return value of the driver decode_read_plan().
+ */
+int motion_sense_read_plan_decode(struct motion_sensor_t *s, intv3_t v);
+
+/**
+ * Get the read plan statistics.
+ *
+ * @param transfers Number of I2C transactions issued by the read plans.
+ * @param reads Number of sensor readings served by these transactions.
+ */
+void motion_sense_read_plan_get_stats(uint32_t *transfers, uint32_t *reads);
+
+#endif /* __CROS_EC_MOTION_SENSE_READ_PLAN_H */
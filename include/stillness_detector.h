@@ -9,6 +9,7 @@
 #include "common.h"
 #include "math_util.h"
 #include "stdbool.h"
+#include "stream_stats.h"
 #include <stdint.h>
 
 struct still_det {
@@ -32,9 +33,11 @@ struct still_det {
 	/** The number of samples in the current batch. */
 	uint16_t num_samples;
 
-	/** Accumulators used for calculating stillness. */
-	fp_t acc_x, acc_y, acc_z, acc_xx, acc_yy, acc_zz, mean_x, mean_y,
-		mean_z;
+	/** Per-axis accumulators used for calculating stillness. */
+	struct stream_stats stats[3];
+
+	/** Mean of the last batch that was found to be still. */
+	fp_t mean_x, mean_y, mean_z;
 };
 
 #define STILL_DET(VAR_THRES, MIN_BATCH_WIN, MAX_BATCH_WIN, MIN_BATCH_SIZE) \
@@ -44,12 +47,7 @@ struct still_det {
 		.max_batch_window = MAX_BATCH_WIN,                         \
 		.min_batch_size = MIN_BATCH_SIZE,                          \
 		.window_start_time = 0,                                    \
-		.acc_x = 0.0f,                                             \
-		.acc_y = 0.0f,                                             \
-		.acc_z = 0.0f,                                             \
-		.acc_xx = 0.0f,                                            \
-		.acc_yy = 0.0f,                                            \
-		.acc_zz = 0.0f,                                            \
+		.stats = {},                                               \
 		.mean_x = 0.0f,                                            \
 		.mean_y = 0.0f,                                            \
 		.mean_z = 0.0f,                                            \
@@ -0,0 +1,151 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Streaming mean/variance helpers shared by the motion detectors. */
+
+#ifndef __CROS_EC_STREAM_STATS_H
+#define __CROS_EC_STREAM_STATS_H
+
+#include "common.h"
+#include "math_util.h"
+#include "stdbool.h"
+#include <stdint.h>
+
+/**
+ * Single axis batch accumulator.
+ *
+ * Samples are accumulated relative to an assumed mean (the "shifted data" form
+ * of the one-pass algorithm). Picking the first sample of the batch as the
+ * shift keeps the squared terms small enough for the fixed-point build, while
+ * avoiding the per-sample division that a textbook Welford update needs.
+ */
+struct stream_stats {
+	/** Number of samples accumulated since the last reset. */
+	uint32_t count;
+
+	/** Assumed mean of the batch. */
+	fp_t shift;
+
+	/** sum(x - shift) */
+	fp_t sum;
+
+	/** sum((x - shift)^2) */
+	fp_t sum_sq;
+};
+
+/**
+ * Drop all accumulated samples and start a new batch.
+ *
+ * @param s The accumulator to reset.
+ * @param shift The assumed mean of the new batch, usually its first sample.
+ */
+void stream_stats_reset(struct stream_stats *s, fp_t shift);
+
+/**
+ * Add a sample to the accumulator.
+ *
+ * @param s The accumulator to update.
+ * @param x The new sample.
+ */
+void stream_stats_update(struct stream_stats *s, fp_t x);
+
+/**
+ * Compute the mean of the accumulated samples.
+ *
+ * @param s The accumulator to read.
+ * @return The mean, or the shift if no sample has been accumulated.
+ */
+fp_t stream_stats_mean(const struct stream_stats *s);
+
+/**
+ * Compute the population variance, sum((x - mean)^2) / n.
+ *
+ * @param s The accumulator to read.
+ * @return The variance, or 0 if no sample has been accumulated.
+ */
+fp_t stream_stats_variance(const struct stream_stats *s);
+
+/**
+ * Compute the sample variance, sum((x - mean)^2) / (n - 1).
+ *
+ * @param s The accumulator to read.
+ * @return The variance, or 0 if fewer than two samples were accumulated.
+ */
+fp_t stream_stats_sample_variance(const struct stream_stats *s);
+
+/**
+ * Integer sliding window with O(1) variance update.
+ *
+ * The window keeps the last @size samples in a caller-provided ring buffer,
+ * so the RAM cost is decided by the caller and the window length can be
+ * changed at runtime up to the buffer capacity. The window starts filled with
+ * zeros, which lets the eviction formula run from the very first sample.
+ */
+struct stream_window {
+	/** Ring buffer of @capacity samples, owned by the caller. */
+	int16_t *history;
+
+	/** Number of entries in @history. */
+	uint16_t capacity;
+
+	/** Current window length, 1 <= size <= capacity. */
+	uint16_t size;
+
+	/** Next entry of @history to be replaced. */
+	uint16_t idx;
+
+	/** Number of samples pushed since the last reset, saturated at size. */
+	uint16_t count;
+
+	/** sum(history) */
+	int32_t sum;
+
+	/** n^2 * var(history), kept as an integer to avoid any rounding. */
+	uint64_t n2_variance;
+};
+
+/**
+ * Attach a history buffer to a window and reset it to its full capacity.
+ *
+ * @param w The window to initialize.
+ * @param history Buffer of @capacity samples.
+ * @param capacity Number of samples in @history.
+ */
+void stream_window_init(struct stream_window *w, int16_t *history,
+			uint16_t capacity);
+
+/**
+ * Drop all samples and change the window length.
+ *
+ * @param w The window to reset.
+ * @param size The new window length, clamped to [1, capacity].
+ * @return The window length actually used.
+ */
+int stream_window_reset(struct stream_window *w, int size);
+
+/**
+ * Push a sample into the window, evicting the oldest one.
+ *
+ * Samples are saturated to 16 bits, the width of the motion sense FIFO.
+ *
+ * @param w The window to update.
+ * @param x The new sample.
+ */
+void stream_window_update(struct stream_window *w, int x);
+
+/**
+ * @return true once @size samples have been pushed since the last reset.
+ */
+static inline bool stream_window_full(const struct stream_window *w)
+{
+	return w->count >= w->size;
+}
+
+/**
+ * @return The population variance of the samples in the window.
+ */
+uint64_t stream_window_variance(const struct stream_window *w);
+
+#endif /* __CROS_EC_STREAM_STATS_H */
@@ -365,8 +365,20 @@ typedef struct k_mutex mutex_t;
 struct mutex {
 	uint32_t lock;
 	uint32_t waiters;
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+	/* Bitmap of the task holding the lock */
+	uint32_t owner;
+	/* Boost the owner while a higher priority task waits */
+	uint8_t prio_inherit;
+#endif
 };
 
+#ifdef CONFIG_TASK_PRIORITY_INHERITANCE
+#define MUTEX_PRIO_INHERIT_INIT { .prio_inherit = 1 }
+#else
+#define MUTEX_PRIO_INHERIT_INIT { 0 }
+#endif
+
 typedef struct mutex mutex_t;
 
 /**
@@ -185,6 +185,13 @@ void interrupt_generator_udelay(unsigned us);
 #ifdef EMU_BUILD
 void wait_for_task_started(void);
 void wait_for_task_started_nosleep(void);
+
+/*
+ * Save the content and protection of the emulated flash, and restore them,
+ * e.g. before each test case.
+ */
+void test_flash_snapshot(void);
+void test_flash_restore(void);
 #else
 static inline void wait_for_task_started(void) { }
 static inline void wait_for_task_started_nosleep(void) { }
@@ -172,6 +172,19 @@ int uart_rx_dma_head(void);
  */
 void uart_write_char(char c);
 
+/**
+ * Write a run of characters to the transmit FIFO, as many as it has room for
+ * without waiting.
+ *
+ * The default writes one character at a time while uart_tx_ready(). Chips
+ * which know how much room their FIFO has can fill it in one go.
+ *
+ * @param buf		Characters to send.
+ * @param len		Number of characters.
+ * @return		The number of characters written.
+ */
+__override_proto int uart_write_buf(const char *buf, int len);
+
 /**
  * Read one char from the UART data register.
  *
@@ -361,6 +374,36 @@ int uart_console_read_buffer(uint8_t type,
 			     uint16_t dest_size,
 			     uint16_t *write_count);
 
+/**
+ * Read the console output from a sequence number, without a snapshot.
+ *
+ * Each byte written to the console buffer gets the next sequence number, so
+ * each reader keeps its own position in the output.
+ *
+ * @param seq		sequence number of the first byte to read; reading
+ *			starts from the oldest byte still in the buffer if it
+ *			was overwritten, or if seq is ahead of the output.
+ * @param dest		output buffer, not null-terminated.
+ * @param dest_size	size of output buffer.
+ * @param write_count	number of bytes written.
+ * @param first_seq	sequence number of the first byte read.
+ * @param next_seq	sequence number to read from next time.
+ *
+ * @return result status (EC_RES_*)
+ */
+int uart_console_read_seq(uint32_t seq, char *dest, uint16_t dest_size,
+			  uint16_t *write_count, uint32_t *first_seq,
+			  uint32_t *next_seq);
+
+/**
+ * Send EC_MKBP_EVENT_CONSOLE_DATA once enough console output follows a
+ * sequence number. Only the last watermark set is kept.
+ *
+ * @param seq		sequence number the host read up to.
+ * @param watermark	number of bytes after seq, or 0 for no event.
+ */
+void uart_console_set_watermark(uint32_t seq, uint32_t watermark);
+
 /**
  * Initialize tx buffer head and tail
  */
@@ -24,7 +24,16 @@
  * go between PD port number and task ID. Assume that TASK_ID_PD_C0 is the
  * lowest task ID and IDs are on a continuous range.
  */
-#if defined(HAS_TASK_PD_C0) && defined(CONFIG_USB_PD_PORT_MAX_COUNT)
+#if defined(HAS_TASK_PD_C0) && defined(CONFIG_USB_PD_PORT_MAX_COUNT) && \
+	defined(CONFIG_USB_PD_SINGLE_TASK)
+/*
+ * All ports share the PD_C0 task, which reports the port it is currently
+ * running as its own.
+ */
+#define PD_PORT_TO_TASK_ID(port) TASK_ID_PD_C0
+#define TASK_ID_TO_PD_PORT(id) \
+	((id) == TASK_ID_PD_C0 ? pd_task_get_port() : -1)
+#elif defined(HAS_TASK_PD_C0) && defined(CONFIG_USB_PD_PORT_MAX_COUNT)
 #define PD_PORT_TO_TASK_ID(port) (TASK_ID_PD_C0 + (port))
 #define TASK_ID_TO_PD_PORT(id) ((id) - TASK_ID_PD_C0)
 #else
@@ -32,6 +41,29 @@
 #define TASK_ID_TO_PD_PORT(id) 0
 #endif /* CONFIG_USB_PD_PORT_MAX_COUNT && HAS_TASK_PD_C0 */
 
+#ifdef CONFIG_USB_PD_SINGLE_TASK
+/**
+ * Get the port the PD task is running.
+ *
+ * @return port number
+ */
+int pd_task_get_port(void);
+
+/**
+ * Set events for the state machines of one port.
+ *
+ * @param port USB-C port number
+ * @param event Events to set
+ */
+void pd_task_set_event(int port, uint32_t event);
+#else
+#define pd_task_set_event(port, event) \
+	task_set_event(PD_PORT_TO_TASK_ID(port), (event))
+#endif
+
+/* Wake the state machines of one port */
+#define pd_task_wake(port) pd_task_set_event((port), TASK_EVENT_WAKE)
+
 enum pd_rx_errors {
 	PD_RX_ERR_INVAL = -1,           /* Invalid packet */
 	PD_RX_ERR_HARD_RESET = -2,      /* Got a Hard-Reset packet */
@@ -66,8 +98,15 @@ enum pd_rx_errors {
 #define PD_EVENT_RX_HARD_RESET		TASK_EVENT_CUSTOM_BIT(11)
 /* MUX configured notification event */
 #define PD_EVENT_AP_MUX_DONE		TASK_EVENT_CUSTOM_BIT(12)
+#ifdef CONFIG_USB_PD_SINGLE_TASK
+/* Port events are pending, see CONFIG_USB_PD_SINGLE_TASK */
+#define PD_EVENT_PORT			TASK_EVENT_CUSTOM_BIT(13)
+/* First free event on PD task */
+#define PD_EVENT_FIRST_FREE_BIT		14
+#else
 /* First free event on PD task */
 #define PD_EVENT_FIRST_FREE_BIT		13
+#endif
 
 /* Ensure TCPC is out of low power mode before handling these events. */
 #define PD_EXIT_LOW_POWER_EVENT_MASK \
@@ -0,0 +1,124 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Cache of the SVIDs and modes discovered for port partners and cable plugs,
+ * keyed by their identity.
+ *
+ * On a hit, the SVIDs and modes of the partner are restored as soon as its
+ * identity is discovered, and the PE discovers them again in the background
+ * once the DPM is done with mode entry.
+ */
+
+#ifndef __CROS_EC_USB_PD_DISC_CACHE_H
+#define __CROS_EC_USB_PD_DISC_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "usb_pd.h"
+#include "usb_pd_tcpm.h"
+
+struct pd_disc_cache_stats {
+	/* Identities found in the cache */
+	uint32_t hits;
+	/* Identities not found in the cache */
+	uint32_t misses;
+	/* Revalidations that found the cached data stale */
+	uint32_t stale;
+	/* Entries dropped to make room for a new partner */
+	uint32_t evictions;
+};
+
+/*
+ * Looks up the partner or cable plug whose identity was just discovered. On a
+ * hit, its SVIDs and modes are restored into disc, so discovery is complete.
+ *
+ * @param port USB-C port number
+ * @param type Transmit type (SOP, SOP') of the discovery
+ * @param disc Discovery results, with the identity discovered
+ * @return     true if the SVIDs and modes were restored from the cache
+ */
+bool pd_disc_cache_restore(int port, enum tcpm_transmit_type type,
+			   struct pd_discovery *disc);
+
+/*
+ * Starts the revalidation of a discovery restored from the cache. The PE
+ * discovers the SVIDs and modes again into the discovery returned by
+ * pd_disc_cache_get_revalidation(), leaving disc untouched until
+ * pd_disc_cache_update(). A port revalidates one type at a time.
+ *
+ * @param port USB-C port number
+ * @param type Transmit type (SOP, SOP') of the discovery
+ * @param disc Discovery results, for the identity
+ * @return     true if revalidation started, false if there is nothing to
+ *             revalidate yet
+ */
+bool pd_disc_cache_revalidate(int port, enum tcpm_transmit_type type,
+			      const struct pd_discovery *disc);
+
+/*
+ * Returns the discovery that revalidation fills in, with the identity of the
+ * partner or cable plug and its SVIDs and modes to discover.
+ *
+ * @param port USB-C port number
+ * @param type Transmit type (SOP, SOP') of the discovery
+ * @return     NULL if type is not being revalidated
+ */
+struct pd_discovery *pd_disc_cache_get_revalidation(int port,
+		enum tcpm_transmit_type type);
+
+/*
+ * Returns true while the cache waits for the discovery of a port to complete,
+ * or for the DPM to revalidate a discovery restored from the cache.
+ *
+ * @param port USB-C port number
+ * @param type Transmit type (SOP, SOP') of the discovery
+ */
+bool pd_disc_cache_is_pending(int port, enum tcpm_transmit_type type);
+
+/*
+ * Returns true while the SVIDs and modes of a discovery restored from the
+ * cache are discovered again.
+ *
+ * @param port USB-C port number
+ * @param type Transmit type (SOP, SOP') of the discovery
+ */
+bool pd_disc_cache_is_revalidating(int port, enum tcpm_transmit_type type);
+
+/*
+ * Informs the cache that the discovery of the identity, SVIDs and modes is
+ * complete. A new partner is stored, replacing the least recently used entry
+ * when the cache is full. A revalidated one is compared to its entry, and the
+ * SVIDs and modes discovered again are copied into disc.
+ *
+ * @param port USB-C port number
+ * @param type Transmit type (SOP, SOP') of the discovery
+ * @param disc Discovery results
+ * @return     true if revalidation found that the cached data was stale; the
+ *             entry and disc are updated with what was discovered
+ */
+bool pd_disc_cache_update(int port, enum tcpm_transmit_type type,
+			  struct pd_discovery *disc);
+
+/*
+ * Forgets the partner and cable plug of a port, when discovery restarts.
+ *
+ * @param port USB-C port number
+ */
+void pd_disc_cache_init_port(int port);
+
+/*
+ * Drops all entries of the cache.
+ */
+void pd_disc_cache_clear(void);
+
+/*
+ * Returns the statistics of the cache.
+ *
+ * @param stats Filled with the statistics since boot or the last clear
+ */
+void pd_disc_cache_get_stats(struct pd_disc_cache_stats *stats);
+
+#endif /* __CROS_EC_USB_PD_DISC_CACHE_H */
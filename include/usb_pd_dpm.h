@@ -28,6 +28,14 @@ void dpm_init(int port);
  */
 void dpm_set_mode_exit_request(int port);
 
+/*
+ * Returns true once the DPM is done with alternate mode entry, whether a mode
+ * was entered or not.
+ *
+ * @param port USB-C port number
+ */
+bool dpm_is_mode_entry_done(int port);
+
 /*
  * Informs the DPM that a VDM ACK was received.
  *
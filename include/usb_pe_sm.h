@@ -158,6 +158,11 @@ bool pe_in_local_ams(int port);
  */
 const char *pe_get_current_state(int port);
 
+/**
+ * Prints the statistics of the PE states, see CONFIG_USB_SM_STATS
+ */
+void pe_print_sm_stats(void);
+
 /**
  * Returns the flag mask of the PE state machine
  *
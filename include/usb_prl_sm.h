@@ -37,6 +37,11 @@ bool prl_is_busy(int port);
  */
 void prl_set_debug_level(enum debug_level level);
 
+/**
+ * Prints the statistics of the PRL states, see CONFIG_USB_SM_STATS
+ */
+void prl_print_sm_stats(void);
+
 /**
  * Resets the Protocol Layer State Machine
  *
@@ -37,6 +37,9 @@ struct usb_state {
 
 typedef const struct usb_state *usb_state_ptr;
 
+/* Deepest supported state hierarchy, including the state itself */
+#define USB_SM_MAX_DEPTH 8
+
 /* Defines the current context of the usb statemachine. */
 struct sm_ctx {
 	usb_state_ptr current;
@@ -90,6 +93,31 @@ void set_state(int port, struct sm_ctx *ctx, usb_state_ptr new_state);
  */
 void run_state(int port, struct sm_ctx *ctx);
 
+/**
+ * Print the number of entries and the time spent in the functions of each
+ * state of a state machine. The time of a state includes the time of the
+ * transitions triggered from its functions. States never run are skipped.
+ *
+ * @param label      Name of the state machine
+ * @param base       Array of states of the state machine
+ * @param count      Number of states in base
+ * @param names      Names of the states, can be NULL
+ * @param names_size Number of entries in names
+ */
+void usb_sm_print_stats(const char *label, usb_state_ptr base, int count,
+			const char * const *names, int names_size);
+
+/**
+ * Print the number of transitions and the time spent in set_state() for each
+ * port.
+ */
+void usb_sm_print_port_stats(void);
+
+/**
+ * Clear all state machine statistics.
+ */
+void usb_sm_clear_stats(void);
+
 #ifdef TEST_BUILD
 /*
  * Struct for test builds that allow unit tests to easily iterate through
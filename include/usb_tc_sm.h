@@ -357,6 +357,11 @@ enum try_src_override_t tc_get_try_src_override(void);
  */
 const char *tc_get_current_state(int port);
 
+/**
+ * Prints the statistics of the typeC states, see CONFIG_USB_SM_STATS
+ */
+void tc_print_sm_stats(void);
+
 /**
  * Returns the flag mask of the typeC state machine
  *
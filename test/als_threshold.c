@@ -0,0 +1,383 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test threshold window mode of light sensors.
+ */
+
+#include "accelgyro.h"
+#include "common.h"
+#include "driver/als_opt3001.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "i2c.h"
+#include "motion_sense.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define LIGHT_INT_EVENT TASK_EVENT_MOTION_SENSOR_INTERRUPT(LIGHT)
+
+/* Collect one sample every 100ms when polled. */
+#define LIGHT_ODR 10000
+
+/*****************************************************************************/
+/* Mock functions */
+static int light_lux;
+static int light_rate;
+static int read_count;
+static int threshold_low;
+static int threshold_high = INT32_MAX;
+
+static int light_init(struct motion_sensor_t *s)
+{
+	return EC_SUCCESS;
+}
+
+static int light_read(const struct motion_sensor_t *s, intv3_t v)
+{
+	read_count++;
+	v[X] = light_lux;
+	v[Y] = 0;
+	v[Z] = 0;
+	return EC_SUCCESS;
+}
+
+static int light_set_range(struct motion_sensor_t *s, int range, int rnd)
+{
+	s->current_range = range;
+	return EC_SUCCESS;
+}
+
+static int light_set_data_rate(const struct motion_sensor_t *s, int rate,
+			       int rnd)
+{
+	light_rate = rate;
+	return EC_SUCCESS;
+}
+
+static int light_get_data_rate(const struct motion_sensor_t *s)
+{
+	return light_rate;
+}
+
+static int light_set_threshold(const struct motion_sensor_t *s,
+			       int low, int high)
+{
+	threshold_low = low;
+	threshold_high = high;
+	return EC_SUCCESS;
+}
+
+static int light_irq_handler(struct motion_sensor_t *s, uint32_t *event)
+{
+	if (!(*event & LIGHT_INT_EVENT))
+		return EC_ERROR_NOT_HANDLED;
+
+	return EC_SUCCESS;
+}
+
+const struct accelgyro_drv test_light_drv = {
+	.init = light_init,
+	.read = light_read,
+	.set_range = light_set_range,
+	.set_data_rate = light_set_data_rate,
+	.get_data_rate = light_get_data_rate,
+	.irq_handler = light_irq_handler,
+	.set_threshold = light_set_threshold,
+};
+
+/* Emulate the 16-bit big endian registers of an OPT3001 */
+static uint16_t opt3001_regs[0x80] = {
+	[OPT3001_REG_MAN_ID] = OPT3001_MANUFACTURER_ID,
+	[OPT3001_REG_DEV_ID] = OPT3001_DEVICE_ID,
+};
+
+static int opt3001_xfer(const int port, const uint16_t addr_flags,
+			const uint8_t *out, int out_size,
+			uint8_t *in, int in_size, int flags)
+{
+	int reg;
+
+	if (port != 0 || addr_flags != OPT3001_I2C_ADDR1_FLAGS)
+		return EC_ERROR_INVAL;
+	if (out_size < 1 || out[0] >= ARRAY_SIZE(opt3001_regs))
+		return EC_ERROR_INVAL;
+
+	reg = out[0];
+	if (out_size == 3)
+		opt3001_regs[reg] = (out[1] << 8) | out[2];
+	if (in_size == 2) {
+		in[0] = opt3001_regs[reg] >> 8;
+		in[1] = opt3001_regs[reg] & 0xff;
+	}
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(opt3001_xfer);
+
+static struct opt3001_drv_data_t opt3001_data;
+
+struct motion_sensor_t motion_sensors[] = {
+	[LIGHT] = {
+		.name = "light",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_OPT3001,
+		.type = MOTIONSENSE_TYPE_LIGHT,
+		.location = MOTIONSENSE_LOC_LID,
+		.drv = &test_light_drv,
+		.default_range = 0x10000,
+		.config = {
+			[SENSOR_CONFIG_EC_S0] = {
+				.odr = LIGHT_ODR,
+			},
+		},
+	},
+	[ALS_OPT3001] = {
+		.name = "opt3001",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_OPT3001,
+		.type = MOTIONSENSE_TYPE_LIGHT,
+		.location = MOTIONSENSE_LOC_LID,
+		.drv = &opt3001_drv,
+		.drv_data = &opt3001_data,
+		.port = 0,
+		.i2c_spi_addr_flags = OPT3001_I2C_ADDR1_FLAGS,
+		/* 1 lux is 100 units of the sensor */
+		.default_range = 0x10000,
+		.min_frequency = OPT3001_LIGHT_MIN_FREQ,
+		.max_frequency = OPT3001_LIGHT_MAX_FREQ,
+	},
+};
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+/*****************************************************************************/
+/* Test utilities */
+
+/* Change the light level, interrupting the EC like the sensor comparator. */
+static void set_lux(int lux)
+{
+	light_lux = lux;
+	if (lux < threshold_low || lux > threshold_high)
+		task_set_event(TASK_ID_MOTIONSENSE, LIGHT_INT_EVENT);
+}
+
+static int threshold_window(int window, int *ret)
+{
+	struct ec_params_motion_sense params = {
+		.cmd = MOTIONSENSE_CMD_THRESHOLD_WINDOW,
+		.threshold_window = {
+			.sensor_num = LIGHT,
+			.window = window,
+		},
+	};
+	struct ec_response_motion_sense resp;
+	int rv;
+
+	rv = test_send_host_command(EC_CMD_MOTION_SENSE_CMD, 1,
+				    &params, sizeof(params),
+				    &resp, sizeof(resp));
+	*ret = resp.threshold_window.ret;
+	return rv;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_info_flag(void)
+{
+	struct ec_params_motion_sense params = {
+		.cmd = MOTIONSENSE_CMD_INFO,
+		.info = { .sensor_num = LIGHT },
+	};
+	struct ec_response_motion_sense resp;
+
+	TEST_EQ(test_send_host_command(EC_CMD_MOTION_SENSE_CMD, 4,
+				       &params, sizeof(params),
+				       &resp, sizeof(resp)),
+		EC_RES_SUCCESS, "%d");
+	TEST_BITS_SET(resp.info_4.flags, MOTION_SENSE_CMD_INFO_FLAG_THRESHOLD);
+
+	return EC_SUCCESS;
+}
+
+static int test_polled(void)
+{
+	int window;
+
+	TEST_EQ(threshold_window(EC_MOTION_SENSE_NO_VALUE, &window),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(window, 0, "%d");
+
+	/* Without window, the sensor is read at its ODR. */
+	read_count = 0;
+	msleep(1000);
+	TEST_GE(read_count, 9, "%d");
+	TEST_LE(read_count, 11, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_window(void)
+{
+	int window;
+
+	TEST_EQ(threshold_window(10, &window), EC_RES_SUCCESS, "%d");
+	TEST_EQ(window, 10, "%d");
+
+	/* The window is programmed around the next reading. */
+	msleep(300);
+	TEST_EQ(threshold_low, 90, "%d");
+	TEST_EQ(threshold_high, 110, "%d");
+
+	/* No more reads while the light level is stable. */
+	read_count = 0;
+	msleep(1000);
+	TEST_EQ(read_count, 0, "%d");
+
+	set_lux(105);
+	msleep(1000);
+	TEST_EQ(read_count, 0, "%d");
+
+	/* Leaving the window triggers one read and moves the window. */
+	set_lux(200);
+	msleep(50);
+	TEST_EQ(read_count, 1, "%d");
+	TEST_EQ(motion_sensors[LIGHT].xyz[X], 200, "%d");
+	TEST_EQ(threshold_low, 180, "%d");
+	TEST_EQ(threshold_high, 220, "%d");
+
+	msleep(1000);
+	TEST_EQ(read_count, 1, "%d");
+
+	/* Low light still gets a window of at least one unit. */
+	set_lux(0);
+	msleep(50);
+	TEST_EQ(read_count, 2, "%d");
+	TEST_EQ(threshold_low, 0, "%d");
+	TEST_EQ(threshold_high, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_suspend(void)
+{
+	set_lux(100);
+	msleep(50);
+	TEST_EQ(threshold_low, 90, "%d");
+	TEST_EQ(threshold_high, 110, "%d");
+
+	/* Powering the sensor off masks its interrupt. */
+	hook_notify(HOOK_CHIPSET_SUSPEND);
+	msleep(50);
+	TEST_EQ(threshold_low, 0, "%d");
+	TEST_EQ(threshold_high, INT32_MAX, "%d");
+
+	/* Back on, the window is programmed around a new reading. */
+	hook_notify(HOOK_CHIPSET_RESUME);
+	msleep(300);
+	TEST_EQ(threshold_low, 90, "%d");
+	TEST_EQ(threshold_high, 110, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_disable(void)
+{
+	int window;
+
+	set_lux(100);
+	msleep(50);
+
+	TEST_EQ(threshold_window(0, &window), EC_RES_SUCCESS, "%d");
+	TEST_EQ(window, 0, "%d");
+	msleep(50);
+	TEST_EQ(threshold_low, 0, "%d");
+	TEST_EQ(threshold_high, INT32_MAX, "%d");
+
+	/* Back to polling. */
+	read_count = 0;
+	msleep(1000);
+	TEST_GE(read_count, 9, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_invalid(void)
+{
+	int window;
+
+	TEST_EQ(threshold_window(101, &window), EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(threshold_window(-2, &window), EC_RES_INVALID_PARAM, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* Program the OPT3001 window, return the limit registers */
+static void opt3001_limits(int low, int high, int *low_reg, int *high_reg)
+{
+	struct motion_sensor_t *s = &motion_sensors[ALS_OPT3001];
+
+	s->drv->set_threshold(s, low, high);
+	*low_reg = opt3001_regs[OPT3001_REG_INT_LIMIT_LSB];
+	*high_reg = opt3001_regs[OPT3001_REG_INT_LIMIT_MSB];
+}
+
+static int test_opt3001_encoding(void)
+{
+	int low, high;
+
+	TEST_EQ(opt3001_data.scale, 1, "%d");
+	TEST_EQ(opt3001_data.uscale, 0, "%d");
+
+	/* Up to 4095 units, the mantissa holds the value as is */
+	opt3001_limits(0, 40, &low, &high);
+	TEST_EQ(low, 0x0000, "0x%04x");
+	TEST_EQ(high, 0x0fa0, "0x%04x");
+
+	/* Past the mantissa, the smallest exponent which fits is used */
+	opt3001_limits(41, 81, &low, &high);
+	TEST_EQ(low, 0x1802, "0x%04x");	/* 4100 = 2050 << 1 */
+	TEST_EQ(high, 0x1fd2, "0x%04x");	/* 8100 = 4050 << 1 */
+	opt3001_limits(82, 163, &low, &high);
+	TEST_EQ(low, 0x2802, "0x%04x");	/* 8200 = 2050 << 2 */
+	TEST_EQ(high, 0x2feb, "0x%04x");	/* 16300 = 4075 << 2 */
+
+	/* Inexact limits are rounded outwards to keep the window */
+	opt3001_limits(171, 171, &low, &high);
+	TEST_EQ(low, 0x3859, "0x%04x");	/* 17100 > 2137 << 3 */
+	TEST_EQ(high, 0x385a, "0x%04x");	/* 17100 < 2138 << 3 */
+
+	/* The top of the range saturates */
+	opt3001_limits(83865, 83866, &low, &high);
+	TEST_EQ(low, 0xbffe, "0x%04x");	/* 8386500 > 4094 << 11 */
+	TEST_EQ(high, 0xbfff, "0x%04x");
+
+	/* Masking the interrupt programs the widest window */
+	opt3001_limits(0, INT32_MAX, &low, &high);
+	TEST_EQ(low, 0x0000, "0x%04x");
+	TEST_EQ(high, 0xbfff, "0x%04x");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	/* We don't have TASK_CHIP so simulate init ourselves */
+	hook_notify(HOOK_CHIPSET_SUSPEND);
+	hook_notify(HOOK_CHIPSET_RESUME);
+	set_lux(100);
+	msleep(50);
+
+	RUN_TEST(test_info_flag);
+	RUN_TEST(test_polled);
+	RUN_TEST(test_window);
+	RUN_TEST(test_suspend);
+	RUN_TEST(test_disable);
+	RUN_TEST(test_invalid);
+	RUN_TEST(test_opt3001_encoding);
+
+	test_print_result();
+}
@@ -13,6 +13,7 @@ test-list-host=$(TEST_LIST_HOST)
 else
 test-list-host = accel_cal
 test-list-host += aes
+test-list-host += als_threshold
 test-list-host += base32
 test-list-host += battery_get_params_smart
 test-list-host += bklight_lid
@@ -26,6 +27,8 @@ test-list-host += charge_manager_drp_charging
 test-list-host += charge_ramp
 test-list-host += compile_time_macros
 test-list-host += console_edit
+test-list-host += console_read
+test-list-host += console_tokenized
 test-list-host += crc
 test-list-host += entropy
 test-list-host += extpwr_gpio
@@ -35,11 +38,16 @@ test-list-host += float
 test-list-host += fp
 test-list-host += fpsensor
 test-list-host += fpsensor_crypto
+test-list-host += fpsensor_frame_codec
 test-list-host += fpsensor_state
 test-list-host += gyro_cal
 test-list-host += hooks
 test-list-host += host_command
+test-list-host += i2c_async
 test-list-host += i2c_bitbang
+test-list-host += i2c_emul
+test-list-host += i2c_reg_cache
+test-list-host += i2c_stats
 test-list-host += inductive_charging
 test-list-host += interrupt
 test-list-host += irq_locking
@@ -56,8 +64,11 @@ test-list-host += math_util
 test-list-host += motion_angle
 test-list-host += motion_angle_tablet
 test-list-host += motion_lid
+test-list-host += motion_read_plan
+test-list-host += motion_replay
 test-list-host += motion_sense_fifo
 test-list-host += mutex
+test-list-host += mutex_inversion
 test-list-host += newton_fit
 test-list-host += online_calibration
 test-list-host += online_calibration_spoof
@@ -77,10 +88,12 @@ test-list-host += static_if_error
 test-list-host += system
 test-list-host += thermal
 test-list-host += timer_dos
+test-list-host += uart_output
 test-list-host += uptime
 test-list-host += usb_common
 test-list-host += usb_pd_int
 test-list-host += usb_pd
+test-list-host += usb_pd_disc_cache
 test-list-host += usb_pd_giveback
 test-list-host += usb_pd_rev30
 test-list-host += usb_ppc
@@ -91,8 +104,11 @@ test-list-host += usb_sm_framework_h0
 test-list-host += usb_typec_vpd
 test-list-host += usb_typec_ctvpd
 test-list-host += usb_typec_drp_acc_trysrc
+test-list-host += usb_typec_drp_acc_trysrc_single
 test-list-host += usb_prl_old
 test-list-host += usb_tcpmv2_compliance
+test-list-host += usb_pd_bench
+test-list-host += usb_pd_bench_single
 test-list-host += usb_prl
 test-list-host += usb_prl_noextended
 test-list-host += usb_pe_drp_old
@@ -104,6 +120,7 @@ test-list-host += utils_str
 test-list-host += vboot
 test-list-host += x25519
 test-list-host += stillness_detector
+test-list-host += stream_stats
 endif
 
 # Build up the list of coverage test targets based on test-list-host, but
@@ -123,6 +140,7 @@ cov-test-list-host = $(filter-out $(cov-dont-test), $(test-list-host))
 
 accel_cal-y=accel_cal.o
 aes-y=aes.o
+als_threshold-y=als_threshold.o
 base32-y=base32.o
 battery_get_params_smart-y=battery_get_params_smart.o
 bklight_lid-y=bklight_lid.o
@@ -136,6 +154,8 @@ charge_manager_drp_charging-y=charge_manager.o
 charge_ramp-y+=charge_ramp.o
 compile_time_macros-y=compile_time_macros.o
 console_edit-y=console_edit.o
+console_read-y=console_read.o
+console_tokenized-y=console_tokenized.o
 crc-y=crc.o
 entropy-y=entropy.o
 extpwr_gpio-y=extpwr_gpio.o
@@ -145,11 +165,16 @@ flash_physical-y=flash_physical.o
 flash_write_protect-y=flash_write_protect.o
 fpsensor-y=fpsensor.o
 fpsensor_crypto-y=fpsensor_crypto.o
+fpsensor_frame_codec-y=fpsensor_frame_codec.o
 fpsensor_state-y=fpsensor_state.o
 gyro_cal-y=gyro_cal.o gyro_cal_init_for_test.o
 hooks-y=hooks.o
 host_command-y=host_command.o
+i2c_async-y=i2c_async.o
 i2c_bitbang-y=i2c_bitbang.o
+i2c_emul-y=i2c_emul.o
+i2c_reg_cache-y=i2c_reg_cache.o
+i2c_stats-y=i2c_stats.o
 inductive_charging-y=inductive_charging.o
 interrupt-y=interrupt.o
 irq_locking-y=irq_locking.o
@@ -163,13 +188,16 @@ mag_cal-y=mag_cal.o
 math_util-y=math_util.o
 motion_angle-y=motion_angle.o motion_angle_data_literals.o motion_common.o
 motion_angle_tablet-y=motion_angle_tablet.o motion_angle_data_literals_tablet.o motion_common.o
+motion_replay-y=motion_replay.o motion_angle_data_literals.o
 motion_lid-y=motion_lid.o
+motion_read_plan-y=motion_read_plan.o
 motion_sense_fifo-y=motion_sense_fifo.o
 online_calibration-y=online_calibration.o
 online_calibration_spoof-y=online_calibration_spoof.o gyro_cal_init_for_test.o
 kasa-y=kasa.o
 mpu-y=mpu.o
 mutex-y=mutex.o
+mutex_inversion-y=mutex_inversion.o
 newton_fit-y=newton_fit.o
 pingpong-y=pingpong.o
 power_button-y=power_button.o
@@ -194,10 +222,12 @@ system-y=system.o
 thermal-y=thermal.o
 timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
+uart_output-y=uart_output.o
 uptime-y=uptime.o
 usb_common-y=usb_common_test.o fake_battery.o
 usb_pd_int-y=usb_pd_int.o
 usb_pd-y=usb_pd.o
+usb_pd_disc_cache-y=usb_pd_disc_cache.o
 usb_pd_giveback-y=usb_pd.o
 usb_pd_rev30-y=usb_pd.o
 usb_ppc-y=usb_ppc.o
@@ -209,6 +239,8 @@ usb_typec_vpd-y=usb_typec_ctvpd.o vpd_api.o usb_sm_checks.o fake_usbc.o
 usb_typec_ctvpd-y=usb_typec_ctvpd.o vpd_api.o usb_sm_checks.o fake_usbc.o
 usb_typec_drp_acc_trysrc-y=usb_typec_drp_acc_trysrc.o vpd_api.o \
 	usb_sm_checks.o
+usb_typec_drp_acc_trysrc_single-y=usb_typec_drp_acc_trysrc.o vpd_api.o \
+	usb_sm_checks.o
 usb_prl_old-y=usb_prl_old.o usb_sm_checks.o fake_usbc.o
 usb_prl-y=usb_prl.o usb_sm_checks.o
 usb_prl_noextended-y=usb_prl_noextended.o usb_sm_checks.o fake_usbc.o
@@ -216,6 +248,8 @@ usb_pe_drp_old-y=usb_pe_drp_old.o usb_sm_checks.o fake_usbc.o
 usb_pe_drp_old_noextended-y=usb_pe_drp_old.o usb_sm_checks.o fake_usbc.o
 usb_pe_drp-y=usb_pe_drp.o usb_sm_checks.o
 usb_pe_drp_noextended-y=usb_pe_drp_noextended.o usb_sm_checks.o
+usb_pd_bench-y=usb_pd_bench.o
+usb_pd_bench_single-y=usb_pd_bench.o
 usb_tcpmv2_compliance-y=usb_tcpmv2_compliance.o usb_tcpmv2_compliance_common.o \
 	usb_tcpmv2_td_pd_ll_e3.o \
 	usb_tcpmv2_td_pd_ll_e4.o \
@@ -237,6 +271,7 @@ float-y=fp.o
 fp-y=fp.o
 x25519-y=x25519.o
 stillness_detector-y=stillness_detector.o
+stream_stats-y=stream_stats.o
 
 host-is_enabled_error: TEST_SCRIPT=is_enabled_error.sh
 is_enabled_error-y=is_enabled_error.o.cmd
@@ -0,0 +1,177 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test incremental reads of the console output.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+struct console_read {
+	struct ec_response_console_read_v2 r;
+	char data[CONFIG_UART_TX_BUF_SIZE];
+};
+
+static struct console_read resp;
+
+/* Returns the number of bytes read */
+static int read_console(uint32_t seq, uint32_t watermark, int size)
+{
+	struct ec_params_console_read_v2 p = {
+		.seq = seq,
+		.watermark = watermark,
+	};
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_CONSOLE_READ,
+		.version = 2,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = &resp,
+		.response_max = sizeof(resp.r) + size,
+	};
+
+	if (host_command_process(&args) != EC_RES_SUCCESS)
+		return -1;
+
+	return args.response_size - sizeof(resp.r);
+}
+
+/* Sequence number of the next byte of output */
+static uint32_t console_head(void)
+{
+	read_console(0, 0, 0);
+	return resp.r.head_seq;
+}
+
+static bool mkbp_console_event(void)
+{
+	struct ec_response_get_next_event event;
+
+	/* Let the deferred call send the event */
+	msleep(1);
+
+	return test_send_host_command(EC_CMD_GET_NEXT_EVENT, 0, NULL, 0,
+				      &event, sizeof(event)) ==
+			EC_RES_SUCCESS &&
+	       event.event_type == EC_MKBP_EVENT_CONSOLE_DATA;
+}
+
+test_static int test_read_new_output(void)
+{
+	uint32_t head = console_head();
+	int len;
+
+	ccprintf("abcdef\n");
+	cflush();
+	len = read_console(head, 0, sizeof(resp.data));
+
+	/* Only the new output is read */
+	TEST_EQ(len, 8, "%d");
+	TEST_ASSERT_ARRAY_EQ(resp.data, "abcdef\r\n", 8);
+	TEST_EQ(resp.r.seq, head, "%u");
+	TEST_EQ(resp.r.next_seq, head + 8, "%u");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_read_chunks(void)
+{
+	char out[32];
+	uint32_t seq = console_head();
+	int len, i = 0;
+
+	ccprintf("0123456789abcdefghij\n");
+	cflush();
+
+	/* Read back in chunks of 5 bytes */
+	while (i < 22) {
+		len = read_console(seq, 0, 5);
+		if (len <= 0 || i + len > sizeof(out))
+			break;
+		memcpy(out + i, resp.data, len);
+		i += len;
+		seq = resp.r.next_seq;
+	}
+
+	TEST_EQ(i, 22, "%d");
+	TEST_ASSERT_ARRAY_EQ(out, "0123456789abcdefghij\r\n", 22);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_overwritten(void)
+{
+	uint32_t seq = console_head();
+	int i, len;
+
+	/* Output more than the buffer holds */
+	for (i = 0; i < CONFIG_UART_TX_BUF_SIZE / 8; i++) {
+		ccprintf("%07d\n", i);
+		cflush();
+	}
+
+	/* The read starts at the oldest byte still in the buffer */
+	len = read_console(seq, 0, sizeof(resp.data));
+	TEST_EQ(len, CONFIG_UART_TX_BUF_SIZE - 1, "%d");
+	TEST_EQ(resp.r.next_seq, resp.r.head_seq, "%u");
+	TEST_EQ(resp.r.seq, resp.r.head_seq - len, "%u");
+	TEST_GT(resp.r.seq, seq, "%u");
+
+	/* So does a read ahead of the output, as after an EC reboot */
+	len = read_console(console_head() + 1000, 0, sizeof(resp.data));
+	TEST_EQ(len, CONFIG_UART_TX_BUF_SIZE - 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_watermark(void)
+{
+	bool early, late, disabled;
+	int i;
+
+	/* Ask for an event once 256 bytes follow the output read */
+	read_console(console_head(), 256, 0);
+	early = mkbp_console_event();
+
+	for (i = 0; i < 32; i++) {
+		ccprintf("%07d\n", i);
+		cflush();
+	}
+	late = mkbp_console_event();
+
+	/* A read without a watermark cancels the event */
+	read_console(console_head(), 16, 0);
+	read_console(console_head(), 0, 0);
+	for (i = 0; i < 4; i++)
+		ccprintf("%07d\n", i);
+	cflush();
+	disabled = mkbp_console_event();
+
+	TEST_ASSERT(!early);
+	TEST_ASSERT(late);
+	TEST_ASSERT(!disabled);
+
+	/* A watermark the output is already past sends the event now */
+	read_console(console_head() - 32, 8, 0);
+	TEST_ASSERT(mkbp_console_event());
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_read_new_output);
+	RUN_TEST(test_read_chunks);
+	RUN_TEST(test_overwritten);
+	RUN_TEST(test_watermark);
+
+	test_print_result();
+}
@@ -0,0 +1,209 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test tokenized console output.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "link_defs.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+static uint8_t record[128];
+static int record_len;
+static int pos;
+
+static int base64_value(char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A';
+	if (c >= 'a' && c <= 'z')
+		return c - 'a' + 26;
+	if (c >= '0' && c <= '9')
+		return c - '0' + 52;
+	if (c == '+')
+		return 62;
+	if (c == '/')
+		return 63;
+	return -1;
+}
+
+/* Decode the record in the console output captured */
+static int read_record(void)
+{
+	const char *out = test_get_captured_console();
+	uint32_t v = 0;
+	int bits = 0;
+	int d;
+
+	record_len = 0;
+	pos = 0;
+
+	if (*out++ != '$')
+		return EC_ERROR_UNKNOWN;
+
+	for (; *out != '\r' && *out != '='; out++) {
+		d = base64_value(*out);
+		if (d < 0)
+			return EC_ERROR_UNKNOWN;
+		v = (v << 6) | d;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			record[record_len++] = v >> bits;
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+static uint64_t get_varint(void)
+{
+	uint64_t v = 0;
+	int shift = 0;
+
+	while (pos < record_len) {
+		v |= (uint64_t)(record[pos] & 0x7f) << shift;
+		shift += 7;
+		if (!(record[pos++] & 0x80))
+			break;
+	}
+
+	return v;
+}
+
+static int64_t get_int(void)
+{
+	uint64_t v = get_varint();
+
+	return (v >> 1) ^ -(v & 1);
+}
+
+/* Check that the next bytes of the record are a string */
+static int check_bytes(const char *expected, int len)
+{
+	TEST_EQ((int)get_varint(), len, "%d");
+	TEST_LE(pos + len, record_len, "%d");
+	TEST_ASSERT_ARRAY_EQ(record + pos, (const uint8_t *)expected, len);
+	pos += len;
+
+	return EC_SUCCESS;
+}
+
+/* Check the token and time of the record */
+static int check_header(const char *format, uint64_t start)
+{
+	uint64_t token = get_varint();
+	int64_t time = get_int();
+
+	/* Bit 0 tells RO from RW, and host builds are RO */
+	TEST_EQ((int)(token & 1), 0, "%d");
+	TEST_ASSERT(!strncmp(__tokenized_fmt_start + (token >> 1), format,
+			     strlen(format) + 1));
+
+	TEST_GE((long long)time, (long long)start, "%lld");
+	TEST_LE((long long)time, (long long)get_time().val, "%lld");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_integers(void)
+{
+	uint64_t start = get_time().val;
+	int rv;
+
+	test_capture_console(1);
+	rv = cprints(CC_COMMAND, "%d %u %x %lld %c", -5, 300U, 0xffffffff,
+		     -(1LL << 40), 'z');
+	cflush();
+	test_capture_console(0);
+
+	TEST_EQ(rv, EC_SUCCESS, "%d");
+	TEST_EQ(read_record(), EC_SUCCESS, "%d");
+	TEST_EQ(check_header("%d %u %x %lld %c", start), EC_SUCCESS, "%d");
+	TEST_EQ((int)get_int(), -5, "%d");
+	TEST_EQ((int)get_int(), 300, "%d");
+	/* Sign extended from 32 bits, the detokenizer masks it back */
+	TEST_EQ((int)get_int(), -1, "%d");
+	TEST_EQ((long long)get_int(), -(1LL << 40), "%lld");
+	TEST_EQ((int)get_int(), 'z', "%d");
+	TEST_EQ(pos, record_len, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_pointers(void)
+{
+	const uint8_t buf[] = { 0x12, 0x34, 0xab };
+	uint64_t start = get_time().val;
+	uint64_t when = 1234567;
+	char str[] = "string";
+
+	test_capture_console(1);
+	cprints(CC_COMMAND, "%s %ph %pb %pT %pT", str, HEX_BUF(buf, 3),
+		BINARY_VALUE(5, 8), &when, PRINTF_TIMESTAMP_NOW);
+	cflush();
+	test_capture_console(0);
+
+	TEST_EQ(read_record(), EC_SUCCESS, "%d");
+	TEST_EQ(check_header("%s %ph %pb %pT %pT", start), EC_SUCCESS, "%d");
+	TEST_EQ(check_bytes("string", 6), EC_SUCCESS, "%d");
+	TEST_EQ(check_bytes("\x12\x34\xab", 3), EC_SUCCESS, "%d");
+	TEST_EQ((int)get_int(), 5, "%d");
+	TEST_EQ((int)get_int(), 8, "%d");
+	TEST_EQ((long long)get_int(), (long long)when, "%lld");
+	/* The detokenizer uses the time of the record */
+	TEST_EQ((int)get_int(), 0, "%d");
+	TEST_EQ(pos, record_len, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_truncated(void)
+{
+	const char *s = "0123456789abcdefghijklmnopqrstuvwxyz";
+	int rv;
+
+	/* Strings are cut to 32 bytes, and the record to 96 */
+	test_capture_console(1);
+	rv = cprints(CC_COMMAND, "%s %s %s %s", s, s, s, s);
+	cflush();
+	test_capture_console(0);
+
+	TEST_EQ(rv, EC_ERROR_OVERFLOW, "%d");
+	TEST_EQ(read_record(), EC_SUCCESS, "%d");
+	TEST_EQ(record_len, 96, "%d");
+	get_varint();
+	get_int();
+	TEST_EQ(check_bytes(s, 32), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_text_output(void)
+{
+	/* Only cprints() is tokenized */
+	test_capture_console(1);
+	cprintf(CC_COMMAND, "%d %s\n", 42, "text");
+	cflush();
+	test_capture_console(0);
+
+	TEST_ASSERT(!strncmp(test_get_captured_console(), "42 text\r\n", 10));
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_integers);
+	RUN_TEST(test_pointers);
+	RUN_TEST(test_truncated);
+	RUN_TEST(test_text_output);
+
+	test_print_result();
+}
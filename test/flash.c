@@ -334,6 +334,31 @@ static int test_overwrite_other(void)
 	return EC_SUCCESS;
 }
 
+static int test_snapshot_restore(void)
+{
+#ifdef EMU_BUILD
+	const char *data = "SnapshotData0000";
+	uint32_t offset = CONFIG_RW_STORAGE_OFF;
+	int size = strlen(data);
+
+	test_flash_snapshot();
+	record_flash(offset, size);
+
+	TEST_ASSERT(flash_physical_erase(offset, CONFIG_FLASH_ERASE_SIZE) ==
+		    EC_SUCCESS);
+	TEST_ASSERT(flash_physical_write(offset, size, data) == EC_SUCCESS);
+	TEST_ASSERT(verify_write(offset, size, data) == EC_SUCCESS);
+
+	/* The content before the snapshot is back */
+	test_flash_restore();
+	TEST_ASSERT(verify_flash(offset, size) == EC_SUCCESS);
+#else
+	ccprintf("Skip. Emulator only test.\n");
+#endif
+
+	return EC_SUCCESS;
+}
+
 static int test_op_failure(void)
 {
 	mock_flash_op_fail = EC_ERROR_UNKNOWN;
@@ -453,6 +478,7 @@ static void run_test_step1(void)
 	RUN_TEST(test_is_erased);
 	RUN_TEST(test_overwrite_current);
 	RUN_TEST(test_overwrite_other);
+	RUN_TEST(test_snapshot_restore);
 	RUN_TEST(test_op_failure);
 	RUN_TEST(test_flash_info);
 	RUN_TEST(test_region_info);
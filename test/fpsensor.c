@@ -7,9 +7,13 @@
 #include <stdbool.h>
 
 #include "ec_commands.h"
+#include "fpsensor_frame_codec.h"
+#include "fpsensor_state.h"
+#include "host_command.h"
 #include "mock/fpsensor_detect_mock.h"
 #include "string.h"
 #include "test_util.h"
+#include "util.h"
 #include "common/fpsensor/fpsensor_private.h"
 
 static const struct ec_response_get_protocol_info expected_info[] = {
@@ -84,6 +88,100 @@ test_static int test_host_command_protocol_info_spi(void)
 		FP_TRANSPORT_TYPE_SPI, &expected_info[FP_TRANSPORT_TYPE_SPI]);
 }
 
+/* Payload of each EC_CMD_FP_FRAME response, like a UART transport */
+#define FRAME_RESPONSE_DATA 248
+
+static struct {
+	struct ec_response_fp_frame_v1 r;
+	uint8_t data[FRAME_RESPONSE_DATA];
+} frame_resp;
+
+/*
+ * Fetch the raw frame with version 1 of EC_CMD_FP_FRAME and decode it.
+ * Return the number of commands, or -1 on errors.
+ */
+static int fetch_encoded_frame(uint8_t *frame, int *encoded_count)
+{
+	struct ec_params_fp_frame p;
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_FP_FRAME,
+		.version = 1,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = &frame_resp,
+		.response_max = sizeof(frame_resp),
+	};
+	uint32_t offset = 0;
+	int count = 0;
+	int len;
+
+	*encoded_count = 0;
+	while (offset < sizeof(fp_buffer)) {
+		p.offset = (FP_FRAME_INDEX_RAW_IMAGE << FP_FRAME_INDEX_SHIFT) |
+			   offset;
+		p.size = sizeof(fp_buffer) - offset;
+		if (host_command_process(&args) != EC_RES_SUCCESS)
+			return -1;
+		count++;
+
+		len = args.response_size - sizeof(frame_resp.r);
+		if (frame_resp.r.size == 0 || frame_resp.r.size > p.size)
+			return -1;
+
+		if (frame_resp.r.encoding == FP_FRAME_ENCODING_DELTA_RLE) {
+			if (fp_frame_decode(frame_resp.data, len,
+					    frame + offset,
+					    frame_resp.r.size) !=
+			    frame_resp.r.size)
+				return -1;
+			(*encoded_count)++;
+		} else if (frame_resp.r.encoding == FP_FRAME_ENCODING_RAW &&
+			   len == frame_resp.r.size) {
+			memcpy(frame + offset, frame_resp.data, len);
+		} else {
+			return -1;
+		}
+		offset += frame_resp.r.size;
+	}
+
+	return count;
+}
+
+test_static int test_fp_command_frame_encoded(void)
+{
+	static uint8_t frame[FP_SENSOR_IMAGE_SIZE];
+	const int raw_count = DIV_ROUND_UP(sizeof(fp_buffer),
+					   FRAME_RESPONSE_DATA);
+	int count, encoded_count;
+	int i;
+
+	/* Ridges: a slow wave with a flat area at the top of the frame */
+	for (i = 0; i < sizeof(fp_buffer); i++)
+		fp_buffer[i] = i < sizeof(fp_buffer) / 4 ? 0x80 :
+			       0x80 + ((i % 16) < 8 ? i % 8 : 8 - i % 8);
+
+	memset(frame, 0, sizeof(frame));
+	count = fetch_encoded_frame(frame, &encoded_count);
+	TEST_GT(count, 0, "%d");
+	TEST_LT(count, raw_count / 2, "%d");
+	TEST_GT(encoded_count, 0, "%d");
+	TEST_ASSERT_ARRAY_EQ(frame, fp_buffer, sizeof(fp_buffer));
+
+	/*
+	 * Noise does not compress, it is sent as it is. Only the last part
+	 * of the frame, shorter than a response, may fit encoded.
+	 */
+	for (i = 0; i < sizeof(fp_buffer); i++)
+		fp_buffer[i] = prng_no_seed() >> 24;
+
+	memset(frame, 0, sizeof(frame));
+	TEST_EQ(fetch_encoded_frame(frame, &encoded_count), raw_count, "%d");
+	TEST_LE(encoded_count, 1, "%d");
+	TEST_ASSERT_ARRAY_EQ(frame, fp_buffer, sizeof(fp_buffer));
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	if (IS_ENABLED(HAS_TASK_FPSENSOR)) {
@@ -94,6 +192,7 @@ void run_test(int argc, char **argv)
 		RUN_TEST(test_validate_fp_buffer_offset_success);
 		RUN_TEST(test_validate_fp_buffer_offset_failure_no_overflow);
 		RUN_TEST(test_validate_fp_buffer_offset_failure_overflow);
+		RUN_TEST(test_fp_command_frame_encoded);
 	}
 
 	/* The tests after this only work on device right now. */
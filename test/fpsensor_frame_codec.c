@@ -0,0 +1,172 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test encoding of fingerprint frames.
+ */
+
+#include "common.h"
+#include "fpsensor_frame_codec.h"
+#include "test_util.h"
+#include "util.h"
+
+/* Size of the FPC1025 image */
+#define WIDTH 160
+#define HEIGHT 160
+#define FRAME_SIZE (WIDTH * HEIGHT)
+
+/* Response size of EC_CMD_FP_FRAME over SPI, less the v1 header */
+#define CHUNK_SIZE (544 - 8)
+
+static uint8_t frame[FRAME_SIZE];
+static uint8_t encoded[FRAME_SIZE * 2];
+static uint8_t decoded[FRAME_SIZE];
+
+/* Ridges in the middle of the sensor, with some noise */
+static void make_finger(void)
+{
+	int x, y, d, ridge;
+
+	for (y = 0; y < HEIGHT; y++) {
+		for (x = 0; x < WIDTH; x++) {
+			d = (x - WIDTH / 2) * (x - WIDTH / 2) +
+			    (y - HEIGHT / 2) * (y - HEIGHT / 2);
+			if (d > (WIDTH / 3) * (WIDTH / 3)) {
+				frame[y * WIDTH + x] = 0xf0;
+				continue;
+			}
+			/* Ridges every 8 pixels */
+			ridge = (x + y) % 8 - 4;
+			frame[y * WIDTH + x] = 0x60 + 6 * MAX(ridge, -ridge) +
+					       prng_no_seed() % 3;
+		}
+	}
+}
+
+/*
+ * Encode the frame in chunks of at most max bytes, as the FPMCU does, and
+ * decode each of them.
+ */
+static int round_trip(size_t max, size_t *total)
+{
+	size_t offset = 0;
+	size_t len, used;
+
+	*total = 0;
+	memset(decoded, 0, sizeof(decoded));
+
+	while (offset < FRAME_SIZE) {
+		len = fp_frame_encode(frame + offset, FRAME_SIZE - offset,
+				      encoded, max, &used);
+		if (len > max || !used ||
+		    fp_frame_decode(encoded, len, decoded + offset,
+				    FRAME_SIZE - offset) != used) {
+			ccprintf("Chunk of %zu bytes at %zu failed\n", max,
+				 offset);
+			return EC_ERROR_UNKNOWN;
+		}
+		offset += used;
+		*total += len;
+	}
+
+	TEST_ASSERT_ARRAY_EQ(decoded, frame, FRAME_SIZE);
+	return EC_SUCCESS;
+}
+
+test_static int test_finger(void)
+{
+	size_t total;
+
+	make_finger();
+	TEST_ASSERT(round_trip(CHUNK_SIZE, &total) == EC_SUCCESS);
+	ccprintf("finger: %zu bytes encoded\n", total);
+
+	/* The transfer takes less than half the bytes of the raw frame */
+	TEST_LT(total, (size_t)FRAME_SIZE / 2, "%zu");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_flat(void)
+{
+	size_t total;
+
+	memset(frame, 0xf0, sizeof(frame));
+	TEST_ASSERT(round_trip(sizeof(encoded), &total) == EC_SUCCESS);
+
+	/* A first pixel, then repeats of up to 130 pixels */
+	TEST_EQ(total, (size_t)(2 + DIV_ROUND_UP(FRAME_SIZE - 1, 130) * 2),
+		"%zu");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_noise(void)
+{
+	size_t total;
+	int i;
+
+	for (i = 0; i < FRAME_SIZE; i++)
+		frame[i] = prng_no_seed();
+
+	/* Each literal run of 64 pixels takes a header */
+	TEST_ASSERT(round_trip(sizeof(encoded), &total) == EC_SUCCESS);
+	TEST_LE(total, (size_t)FRAME_SIZE + DIV_ROUND_UP(FRAME_SIZE, 64),
+		"%zu");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_small_chunks(void)
+{
+	size_t total, max;
+
+	make_finger();
+
+	/* Every run must be cut to fit */
+	for (max = 2; max < 40; max++)
+		TEST_ASSERT(round_trip(max, &total) == EC_SUCCESS);
+
+	/* A run needs a header and a byte */
+	TEST_EQ(fp_frame_encode(frame, FRAME_SIZE, encoded, 1, &max),
+		(size_t)0, "%zu");
+	TEST_EQ(max, (size_t)0, "%zu");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_corrupted(void)
+{
+	/* Truncated repeat, literal and nibble runs */
+	const uint8_t repeat[] = { 0x80 };
+	const uint8_t literal[] = { 0x02, 0x10, 0x10 };
+	const uint8_t nibble[] = { 0x41, 0x12 };
+	/* Runs longer than the output */
+	const uint8_t overflow[] = { 0xff, 0x01 };
+
+	TEST_EQ(fp_frame_decode(repeat, sizeof(repeat), decoded, 16), -1,
+		"%d");
+	TEST_EQ(fp_frame_decode(literal, sizeof(literal), decoded, 16), -1,
+		"%d");
+	TEST_EQ(fp_frame_decode(nibble, sizeof(nibble), decoded, 16), -1,
+		"%d");
+	TEST_EQ(fp_frame_decode(overflow, sizeof(overflow), decoded, 129), -1,
+		"%d");
+	TEST_EQ(fp_frame_decode(overflow, sizeof(overflow), decoded, 130), 130,
+		"%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_finger);
+	RUN_TEST(test_flat);
+	RUN_TEST(test_noise);
+	RUN_TEST(test_small_chunks);
+	RUN_TEST(test_corrupted);
+
+	test_print_result();
+}
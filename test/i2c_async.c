@@ -0,0 +1,308 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the asynchronous I2C transaction queue.
+ */
+
+#include "common.h"
+#include "hooks.h"
+#include "i2c.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define TEST_PORT 0
+#define TEST_ADDR_FLAGS 0x20
+#define TEST_EVENT TASK_EVENT_CUSTOM_BIT(0)
+#define TEST_OTHER_EVENT TASK_EVENT_CUSTOM_BIT(1)
+
+/* Emulated device: a write sets the register pointer, then data. */
+static uint8_t dev_regs[16];
+static int dev_xfer_count;
+/* Time each transfer takes on the bus. */
+static int dev_xfer_ms;
+
+static int dev_xfer(const int port, const uint16_t addr_flags,
+		    const uint8_t *out, int out_size,
+		    uint8_t *in, int in_size, int flags)
+{
+	int reg;
+
+	if (port != TEST_PORT || addr_flags != TEST_ADDR_FLAGS)
+		return EC_ERROR_INVAL;
+	if (out_size < 1 || out[0] + MAX(out_size - 1, in_size) >
+	    sizeof(dev_regs))
+		return EC_ERROR_INVAL;
+
+	dev_xfer_count++;
+	if (dev_xfer_ms)
+		msleep(dev_xfer_ms);
+	reg = out[0];
+	memcpy(&dev_regs[reg], &out[1], out_size - 1);
+	memcpy(in, &dev_regs[reg], in_size);
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(dev_xfer);
+
+static struct i2c_async_xfer *done_order[4];
+static int done_count;
+
+static void record_done(struct i2c_async_xfer *xfer)
+{
+	if (done_count < ARRAY_SIZE(done_order))
+		done_order[done_count] = xfer;
+	done_count++;
+}
+
+static int hook_ran;
+
+static void hook_run(void)
+{
+	hook_ran = 1;
+}
+DECLARE_DEFERRED(hook_run);
+
+static void reset(void)
+{
+	memset(dev_regs, 0, sizeof(dev_regs));
+	dev_xfer_count = 0;
+	dev_xfer_ms = 0;
+	done_count = 0;
+	task_wait_event_mask(TEST_EVENT, 1);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_order(void)
+{
+	const uint8_t wr[] = { 2, 0xaa, 0x55 };
+	const uint8_t reg = 2;
+	uint8_t rd[2];
+	const struct i2c_async_msg wr_msg = {
+		.addr_flags = TEST_ADDR_FLAGS, .out = wr, .out_size = sizeof(wr),
+	};
+	const struct i2c_async_msg rd_msg = {
+		.addr_flags = TEST_ADDR_FLAGS, .out = &reg, .out_size = 1,
+		.in = rd, .in_size = sizeof(rd),
+	};
+	struct i2c_async_xfer write = {
+		.port = TEST_PORT, .msgs = &wr_msg, .count = 1,
+		.done = record_done,
+	};
+	struct i2c_async_xfer read = {
+		.port = TEST_PORT, .msgs = &rd_msg, .count = 1,
+		.done = record_done,
+		.task = TASK_ID_TEST_RUNNER, .event = TEST_EVENT,
+	};
+
+	reset();
+	TEST_EQ(i2c_xfer_async(&write), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async(&read), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async_wait(&read, 100 * MSEC), EC_SUCCESS, "%d");
+
+	TEST_EQ(done_count, 2, "%d");
+	TEST_ASSERT(done_order[0] == &write);
+	TEST_ASSERT(done_order[1] == &read);
+	TEST_EQ(write.rv, EC_SUCCESS, "%d");
+	TEST_EQ(rd[0], 0xaa, "0x%x");
+	TEST_EQ(rd[1], 0x55, "0x%x");
+
+	return EC_SUCCESS;
+}
+
+static int test_list(void)
+{
+	const uint8_t wr0[] = { 0, 1 };
+	const uint8_t wr1[] = { 1, 2 };
+	const uint8_t wr2[] = { 2, 3 };
+	const struct i2c_async_msg msgs[] = {
+		{ .addr_flags = TEST_ADDR_FLAGS, .out = wr0, .out_size = 2 },
+		{ .addr_flags = TEST_ADDR_FLAGS + 1, .out = wr1, .out_size = 2 },
+		{ .addr_flags = TEST_ADDR_FLAGS, .out = wr2, .out_size = 2 },
+	};
+	struct i2c_async_xfer xfer = {
+		.port = TEST_PORT, .msgs = msgs, .count = ARRAY_SIZE(msgs),
+		.task = TASK_ID_TEST_RUNNER, .event = TEST_EVENT,
+	};
+
+	/* The list stops at the first failed message. */
+	reset();
+	TEST_EQ(i2c_xfer_async(&xfer), EC_SUCCESS, "%d");
+	TEST_NE(i2c_xfer_async_wait(&xfer, 100 * MSEC), EC_SUCCESS, "%d");
+	TEST_EQ(dev_xfer_count, 1, "%d");
+	TEST_EQ(dev_regs[0], 1, "%d");
+	TEST_EQ(dev_regs[2], 0, "%d");
+
+	/* Once completed, the transaction can be queued again. */
+	xfer.count = 1;
+	TEST_EQ(i2c_xfer_async(&xfer), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async_wait(&xfer, 100 * MSEC), EC_SUCCESS, "%d");
+	TEST_EQ(dev_xfer_count, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_port_busy(void)
+{
+	const uint8_t wr[] = { 4, 0x42 };
+	const struct i2c_async_msg msg = {
+		.addr_flags = TEST_ADDR_FLAGS, .out = wr, .out_size = 2,
+	};
+	struct i2c_async_xfer xfer = {
+		.port = TEST_PORT, .msgs = &msg, .count = 1,
+		.task = TASK_ID_TEST_RUNNER, .event = TEST_EVENT,
+	};
+
+	reset();
+
+	/*
+	 * While another user holds the port, the submitter and the HOOK task
+	 * keep running.
+	 */
+	hook_ran = 0;
+	i2c_lock(TEST_PORT, 1);
+	TEST_EQ(i2c_xfer_async(&xfer), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async(&xfer), EC_ERROR_BUSY, "%d");
+	hook_call_deferred(&hook_run_data, 0);
+	TEST_EQ(i2c_xfer_async_wait(&xfer, 10 * MSEC), EC_ERROR_TIMEOUT, "%d");
+	TEST_EQ(hook_ran, 1, "%d");
+	TEST_EQ(dev_xfer_count, 0, "%d");
+	i2c_lock(TEST_PORT, 0);
+
+	/* The transaction timed out, and never reaches the bus. */
+	msleep(10);
+	TEST_EQ(dev_xfer_count, 0, "%d");
+	TEST_EQ(dev_regs[4], 0, "0x%x");
+
+	TEST_EQ(i2c_xfer_async(&xfer), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async_wait(&xfer, 100 * MSEC), EC_SUCCESS, "%d");
+	TEST_EQ(dev_regs[4], 0x42, "0x%x");
+
+	return EC_SUCCESS;
+}
+
+static int test_cancel(void)
+{
+	const uint8_t wr[][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 } };
+	const struct i2c_async_msg msgs[] = {
+		{ .addr_flags = TEST_ADDR_FLAGS, .out = wr[0], .out_size = 2 },
+		{ .addr_flags = TEST_ADDR_FLAGS, .out = wr[1], .out_size = 2 },
+		{ .addr_flags = TEST_ADDR_FLAGS, .out = wr[2], .out_size = 2 },
+	};
+	struct i2c_async_xfer xfers[3];
+	int i;
+
+	memset(xfers, 0, sizeof(xfers));
+	for (i = 0; i < ARRAY_SIZE(xfers); i++) {
+		xfers[i].port = TEST_PORT;
+		xfers[i].msgs = &msgs[i];
+		xfers[i].count = 1;
+		xfers[i].done = record_done;
+	}
+	xfers[2].task = TASK_ID_TEST_RUNNER;
+	xfers[2].event = TEST_EVENT;
+
+	reset();
+	i2c_lock(TEST_PORT, 1);
+	for (i = 0; i < ARRAY_SIZE(xfers); i++)
+		TEST_EQ(i2c_xfer_async(&xfers[i]), EC_SUCCESS, "%d");
+	/* Dropped from the middle of the queue, without notification. */
+	TEST_EQ(i2c_xfer_async_cancel(&xfers[1]), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async_cancel(&xfers[1]), EC_ERROR_BUSY, "%d");
+	i2c_lock(TEST_PORT, 0);
+
+	TEST_EQ(i2c_xfer_async_wait(&xfers[2], 100 * MSEC), EC_SUCCESS, "%d");
+	TEST_EQ(done_count, 2, "%d");
+	TEST_ASSERT(done_order[0] == &xfers[0]);
+	TEST_ASSERT(done_order[1] == &xfers[2]);
+	TEST_EQ(dev_regs[0], 1, "%d");
+	TEST_EQ(dev_regs[1], 0, "%d");
+	TEST_EQ(dev_regs[2], 3, "%d");
+
+	/* Too late once completed. */
+	TEST_EQ(i2c_xfer_async_cancel(&xfers[2]), EC_ERROR_BUSY, "%d");
+
+	/* The tail of the queue can be dropped, then queued to again. */
+	i2c_lock(TEST_PORT, 1);
+	TEST_EQ(i2c_xfer_async(&xfers[0]), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async(&xfers[1]), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async_cancel(&xfers[1]), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_async(&xfers[2]), EC_SUCCESS, "%d");
+	i2c_lock(TEST_PORT, 0);
+
+	TEST_EQ(i2c_xfer_async_wait(&xfers[2], 100 * MSEC), EC_SUCCESS, "%d");
+	TEST_EQ(done_count, 4, "%d");
+	TEST_EQ(dev_regs[1], 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_running(void)
+{
+	const uint8_t wr[] = { 6, 0x24 };
+	const struct i2c_async_msg msg = {
+		.addr_flags = TEST_ADDR_FLAGS, .out = wr, .out_size = 2,
+	};
+	struct i2c_async_xfer xfer = {
+		.port = TEST_PORT, .msgs = &msg, .count = 1,
+		.done = record_done,
+		.task = TASK_ID_TEST_RUNNER, .event = TEST_EVENT,
+	};
+
+	/*
+	 * Timing out once on the bus, the wait lasts until completion, and
+	 * keeps other events.
+	 */
+	reset();
+	dev_xfer_ms = 10;
+	TEST_EQ(i2c_xfer_async(&xfer), EC_SUCCESS, "%d");
+	task_set_event(TASK_ID_TEST_RUNNER, TEST_OTHER_EVENT);
+	TEST_EQ(i2c_xfer_async_wait(&xfer, 2 * MSEC), EC_SUCCESS, "%d");
+	TEST_EQ(done_count, 1, "%d");
+	TEST_EQ(dev_regs[6], 0x24, "0x%x");
+	TEST_ASSERT(task_wait_event_mask(TEST_OTHER_EVENT, 1) &
+		    TEST_OTHER_EVENT);
+
+	/* The completion event was consumed by the wait. */
+	TEST_EQ(task_wait_event_mask(TEST_EVENT, 20 * MSEC), TASK_EVENT_TIMER,
+		"0x%x");
+
+	/* Cancelling blocks until the running transaction is notified. */
+	TEST_EQ(i2c_xfer_async(&xfer), EC_SUCCESS, "%d");
+	msleep(2);
+	TEST_EQ(dev_xfer_count, 2, "%d");
+	TEST_EQ(i2c_xfer_async_cancel(&xfer), EC_ERROR_BUSY, "%d");
+	TEST_EQ(done_count, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_invalid(void)
+{
+	struct i2c_async_xfer xfer = {
+		.port = I2C_PORT_COUNT,
+	};
+
+	TEST_EQ(i2c_xfer_async(&xfer), EC_ERROR_INVAL, "%d");
+	TEST_EQ(i2c_xfer_async_wait(&xfer, 0), EC_ERROR_INVAL, "%d");
+	TEST_EQ(i2c_xfer_async_cancel(&xfer), EC_ERROR_INVAL, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_order);
+	RUN_TEST(test_list);
+	RUN_TEST(test_port_busy);
+	RUN_TEST(test_cancel);
+	RUN_TEST(test_running);
+	RUN_TEST(test_invalid);
+
+	test_print_result();
+}
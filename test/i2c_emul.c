@@ -0,0 +1,306 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the host I2C device emulators, and the bus usage of drivers running
+ * against them.
+ */
+
+#include "accelgyro.h"
+#include "battery.h"
+#include "battery_smart.h"
+#include "common.h"
+#include "driver/accelgyro_bmi260.h"
+#include "driver/accelgyro_bmi_common.h"
+#include "i2c.h"
+#include "i2c_emul.h"
+#include "i2c_emul_bmi260.h"
+#include "motion_sense_fifo.h"
+#include "test_util.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+void battery_compensate_params(struct batt_params *batt)
+{
+}
+
+void board_battery_compensate_params(struct batt_params *batt)
+{
+}
+
+/*****************************************************************************/
+/* Smart battery: SMBus word registers. */
+
+static uint8_t sb_regs[(SB_MANUFACTURER_DATA + 1) * 2];
+static struct i2c_emul_regs sb_emul =
+	I2C_EMUL_REGS(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS, sb_regs, 2);
+
+/* Reads done by battery_get_params(), including the mAh mode checks. */
+#define SB_POLL_XFERS 11
+
+/*****************************************************************************/
+/* IMU: BMI260 register map, driven by the bmi260 driver. */
+
+/* Configuration file, defined along with the driver. */
+extern const unsigned char g_bmi260_config_tbin[];
+extern const unsigned int g_bmi260_config_tbin_len;
+
+static struct i2c_emul_bmi260 bmi260_emul;
+static struct bmi_drv_data_t bmi260_data;
+static struct mutex bmi260_mutex;
+
+struct motion_sensor_t motion_sensors[] = {
+	[BASE_ACCEL] = {
+		.name = "Base Accel",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_BMI260,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.location = MOTIONSENSE_LOC_BASE,
+		.drv = &bmi260_drv,
+		.mutex = &bmi260_mutex,
+		.drv_data = &bmi260_data,
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = BMI260_ADDR0_FLAGS,
+		.min_frequency = BMI_ACCEL_MIN_FREQ,
+		.max_frequency = BMI_ACCEL_MAX_FREQ,
+		.default_range = 4, /* g */
+	},
+	[BASE_GYRO] = {
+		.name = "Base Gyro",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_BMI260,
+		.type = MOTIONSENSE_TYPE_GYRO,
+		.location = MOTIONSENSE_LOC_BASE,
+		.drv = &bmi260_drv,
+		.mutex = &bmi260_mutex,
+		.drv_data = &bmi260_data,
+		.port = I2C_PORT_ACCEL,
+		.i2c_spi_addr_flags = BMI260_ADDR0_FLAGS,
+		.min_frequency = BMI_GYRO_MIN_FREQ,
+		.max_frequency = BMI_GYRO_MAX_FREQ,
+		.default_range = 1000, /* dps */
+	},
+};
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+/* Initialize the accelerometer, like motion sense does. */
+static int bmi260_init(void)
+{
+	struct motion_sensor_t *s = &motion_sensors[BASE_ACCEL];
+
+	s->current_range = s->default_range;
+	return s->drv->init(s);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_register(void)
+{
+	struct i2c_emul_regs dup =
+		I2C_EMUL_REGS(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS, sb_regs, 2);
+	int val;
+
+	TEST_EQ(i2c_emul_register(&sb_emul.emul), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_emul_register(&dup.emul), EC_ERROR_BUSY, "%d");
+	TEST_ASSERT(i2c_emul_find(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS) ==
+		    &sb_emul.emul);
+
+	/* The emulator answers instead of the board battery mock. */
+	i2c_emul_regs_set16(&sb_emul, SB_VOLTAGE, 7654);
+	TEST_EQ(i2c_read16(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS, SB_VOLTAGE,
+			   &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 7654, "%d");
+	TEST_EQ(sb_emul.emul.stats.xfers, 1, "%d");
+	TEST_EQ(sb_emul.emul.stats.bytes_out, 1, "%d");
+	TEST_EQ(sb_emul.emul.stats.bytes_in, 2, "%d");
+
+	TEST_EQ(i2c_write16(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS,
+			    SB_BATTERY_MODE, 0x1234), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_emul_regs_get16(&sb_emul, SB_BATTERY_MODE), 0x1234, "%x");
+
+	/* Out of the register map. */
+	TEST_NE(i2c_read16(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS,
+			   SB_MANUFACTURER_DATA + 1, &val), EC_SUCCESS, "%d");
+
+	i2c_emul_unregister(&sb_emul.emul);
+	TEST_ASSERT(i2c_emul_find(I2C_PORT_BATTERY, BATTERY_ADDR_FLAGS) ==
+		    NULL);
+
+	return EC_SUCCESS;
+}
+
+static int test_battery_poll(void)
+{
+	struct batt_params batt;
+	timestamp_t start;
+	uint32_t elapsed;
+
+	TEST_EQ(i2c_emul_register(&sb_emul.emul), EC_SUCCESS, "%d");
+	i2c_emul_regs_set16(&sb_emul, SB_BATTERY_MODE, 0);
+	i2c_emul_regs_set16(&sb_emul, SB_TEMPERATURE, 2981);
+	i2c_emul_regs_set16(&sb_emul, SB_RELATIVE_STATE_OF_CHARGE, 50);
+	i2c_emul_regs_set16(&sb_emul, SB_VOLTAGE, 7400);
+	i2c_emul_regs_set16(&sb_emul, SB_CURRENT, -500);
+	i2c_emul_regs_set16(&sb_emul, SB_CHARGING_VOLTAGE, 8400);
+	i2c_emul_regs_set16(&sb_emul, SB_CHARGING_CURRENT, 2000);
+	i2c_emul_regs_set16(&sb_emul, SB_REMAINING_CAPACITY, 2500);
+	i2c_emul_regs_set16(&sb_emul, SB_FULL_CHARGE_CAPACITY, 5000);
+
+	/* 100 kHz battery bus, 5 bytes (45 bits) per word read. */
+	i2c_emul_set_bus_timing(I2C_PORT_BATTERY, 1, 0);
+	start = get_time();
+	battery_get_params(&batt);
+	elapsed = time_since32(start);
+	i2c_emul_set_bus_timing(I2C_PORT_BATTERY, 0, 0);
+
+	TEST_ASSERT(batt.flags & BATT_FLAG_RESPONSIVE);
+	TEST_ASSERT(!(batt.flags & BATT_FLAG_BAD_ANY));
+	TEST_EQ(batt.temperature, 2981, "%d");
+	TEST_EQ(batt.voltage, 7400, "%d");
+	TEST_EQ(batt.current, -500, "%d");
+	TEST_EQ(batt.remaining_capacity, 2500, "%d");
+	TEST_EQ(batt.full_capacity, 5000, "%d");
+
+	ccprintf("battery poll: %d transfers, %d us of bus time\n",
+		 sb_emul.emul.stats.xfers, sb_emul.emul.stats.bus_time_us);
+	TEST_EQ(sb_emul.emul.stats.xfers, SB_POLL_XFERS, "%d");
+	TEST_EQ(sb_emul.emul.stats.bus_time_us, SB_POLL_XFERS * 450, "%d");
+	TEST_GE(elapsed, sb_emul.emul.stats.bus_time_us, "%d");
+
+	i2c_emul_unregister(&sb_emul.emul);
+
+	return EC_SUCCESS;
+}
+
+static int test_bmi260_init(void)
+{
+	struct i2c_emul *emul = &bmi260_emul.regs.emul;
+
+	i2c_emul_bmi260_init(&bmi260_emul, I2C_PORT_ACCEL, BMI260_ADDR0_FLAGS,
+			     g_bmi260_config_tbin, g_bmi260_config_tbin_len);
+	TEST_EQ(i2c_emul_register(emul), EC_SUCCESS, "%d");
+
+	TEST_EQ(bmi260_init(), EC_SUCCESS, "%d");
+	TEST_EQ(bmi260_emul.config_loaded, g_bmi260_config_tbin_len, "%d");
+	TEST_EQ(i2c_emul_regs_get8(&bmi260_emul.regs, BMI260_INTERNAL_STATUS),
+		BMI260_INIT_OK, "%d");
+	TEST_GE(emul->stats.bytes_out, g_bmi260_config_tbin_len, "%u");
+	ccprintf("bmi260 init: %d transfers, %d bytes\n",
+		 emul->stats.xfers, emul->stats.bytes_out);
+
+	/* A configuration file the chip rejects. */
+	bmi260_emul.config_size--;
+	TEST_EQ(bmi260_init(), EC_ERROR_INVALID_CONFIG, "%d");
+	TEST_EQ(i2c_emul_regs_get8(&bmi260_emul.regs, BMI260_INTERNAL_STATUS),
+		BMI260_INIT_ERR, "%d");
+	bmi260_emul.config_size++;
+
+	/* Not a BMI260. */
+	i2c_emul_regs_set8(&bmi260_emul.regs, BMI260_CHIP_ID, 0x24);
+	TEST_EQ(bmi260_init(), EC_ERROR_ACCESS_DENIED, "%d");
+
+	i2c_emul_unregister(emul);
+
+	return EC_SUCCESS;
+}
+
+static int test_bmi260_read(void)
+{
+	struct motion_sensor_t *s = &motion_sensors[BASE_ACCEL];
+	struct i2c_emul *emul = &bmi260_emul.regs.emul;
+	intv3_t v;
+
+	i2c_emul_bmi260_init(&bmi260_emul, I2C_PORT_ACCEL, BMI260_ADDR0_FLAGS,
+			     g_bmi260_config_tbin, g_bmi260_config_tbin_len);
+	TEST_EQ(i2c_emul_register(emul), EC_SUCCESS, "%d");
+	TEST_EQ(bmi260_init(), EC_SUCCESS, "%d");
+
+	i2c_emul_regs_set16(&bmi260_emul.regs, BMI260_ACC_X_L_G, 100);
+	i2c_emul_regs_set16(&bmi260_emul.regs, BMI260_ACC_X_L_G + 2, -200);
+	i2c_emul_regs_set16(&bmi260_emul.regs, BMI260_ACC_X_L_G + 4, 8192);
+	i2c_emul_regs_set8(&bmi260_emul.regs, BMI260_STATUS, BMI260_DRDY_ACC);
+
+	/* The status, then the 3 axes in one burst. */
+	i2c_emul_reset_stats(emul);
+	TEST_EQ(s->drv->read(s, v), EC_SUCCESS, "%d");
+	TEST_EQ(v[X], 100, "%d");
+	TEST_EQ(v[Y], -200, "%d");
+	TEST_EQ(v[Z], 8192, "%d");
+	TEST_EQ(emul->stats.xfers, 2, "%d");
+	TEST_EQ(emul->stats.bytes_in, 1 + 6, "%d");
+
+	i2c_emul_unregister(emul);
+
+	return EC_SUCCESS;
+}
+
+static int test_bmi260_fifo(void)
+{
+	struct motion_sensor_t *s = &motion_sensors[BASE_ACCEL];
+	struct i2c_emul *emul = &bmi260_emul.regs.emul;
+	struct ec_response_motion_sensor_data data[8];
+	uint32_t event = CONFIG_ACCELGYRO_BMI260_INT_EVENT;
+	/* 3 accel frames: a header, then X, Y and Z. */
+	const uint8_t frames[] = {
+		0x84, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00,
+		0x84, 0x04, 0x00, 0x05, 0x00, 0x06, 0x00,
+		0x84, 0x07, 0x00, 0x08, 0x00, 0x09, 0x00,
+	};
+	uint16_t bytes;
+	int i, count, n;
+
+	i2c_emul_bmi260_init(&bmi260_emul, I2C_PORT_ACCEL, BMI260_ADDR0_FLAGS,
+			     g_bmi260_config_tbin, g_bmi260_config_tbin_len);
+	TEST_EQ(i2c_emul_register(emul), EC_SUCCESS, "%d");
+	TEST_EQ(bmi260_init(), EC_SUCCESS, "%d");
+	TEST_EQ(s->drv->set_data_rate(s, 100000, 0), EC_SUCCESS, "%d");
+	/* The AP wants every sample. */
+	s->oversampling_ratio = 1;
+
+	TEST_EQ(i2c_emul_bmi260_push_fifo(&bmi260_emul, frames,
+					  sizeof(frames)), EC_SUCCESS, "%d");
+
+	/*
+	 * The interrupt status, the FIFO length, all the frames and an empty
+	 * one in a single burst, then the interrupt status again.
+	 */
+	i2c_emul_reset_stats(emul);
+	TEST_EQ(s->drv->irq_handler(s, &event), EC_SUCCESS, "%d");
+	TEST_EQ(emul->stats.xfers, 4, "%d");
+	TEST_EQ(emul->stats.bytes_in, 2 + 2 + (int)sizeof(frames) + 1 + 2,
+		"%d");
+	TEST_EQ(i2c_emul_regs_get16(&bmi260_emul.regs, BMI260_FIFO_LENGTH_0),
+		0, "%d");
+
+	count = motion_sense_fifo_read(sizeof(data), ARRAY_SIZE(data), data,
+				       &bytes);
+	for (i = 0, n = 0; i < count; i++) {
+		if (data[i].flags & MOTIONSENSE_SENSOR_FLAG_TIMESTAMP)
+			continue;
+		TEST_EQ(data[i].sensor_num, BASE_ACCEL, "%d");
+		TEST_EQ(data[i].data[X], 3 * n + 1, "%d");
+		TEST_EQ(data[i].data[Z], 3 * n + 3, "%d");
+		n++;
+	}
+	TEST_EQ(n, 3, "%d");
+
+	TEST_EQ(s->drv->set_data_rate(s, 0, 0), EC_SUCCESS, "%d");
+	i2c_emul_unregister(emul);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_register);
+	RUN_TEST(test_battery_poll);
+	RUN_TEST(test_bmi260_init);
+	RUN_TEST(test_bmi260_read);
+	RUN_TEST(test_bmi260_fifo);
+
+	test_print_result();
+}
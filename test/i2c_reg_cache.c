@@ -0,0 +1,226 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the I2C register cache.
+ */
+
+#include "common.h"
+#include "i2c.h"
+#include "i2c_reg_cache.h"
+#include "test_util.h"
+#include "util.h"
+
+#define TEST_PORT 0
+#define TEST_ADDR_FLAGS 0x30
+#define TEST_VOLATILE_REG 0x10
+
+/* Emulated device: a write sets the register pointer, then data. */
+static uint8_t dev_regs[256];
+static int dev_ptr;
+static int dev_reads;
+static int dev_writes;
+static int dev_fail;
+
+static int dev_xfer(const int port, const uint16_t addr_flags,
+		    const uint8_t *out, int out_size,
+		    uint8_t *in, int in_size, int flags)
+{
+	int reg;
+
+	if (port != TEST_PORT || addr_flags != TEST_ADDR_FLAGS)
+		return EC_ERROR_INVAL;
+	if (out_size)
+		dev_ptr = out[0];
+	if (dev_ptr + MAX(out_size - 1, in_size) > sizeof(dev_regs))
+		return EC_ERROR_INVAL;
+	if (dev_fail)
+		return EC_ERROR_UNKNOWN;
+
+	reg = dev_ptr;
+	if (out_size > 1)
+		dev_writes++;
+	if (in_size)
+		dev_reads++;
+	if (out_size > 1)
+		memcpy(&dev_regs[reg], &out[1], out_size - 1);
+	memcpy(in, &dev_regs[reg], in_size);
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(dev_xfer);
+
+static const struct i2c_reg_cache_range ranges[] = {
+	{ .first = 0x00, .last = 0x0f },
+	{ .first = 0x20, .last = 0x21 },
+};
+static uint16_t entries[18];
+static struct i2c_reg_cache cache = {
+	.port = TEST_PORT,
+	.addr_flags = TEST_ADDR_FLAGS,
+	.ranges = ranges,
+	.range_count = ARRAY_SIZE(ranges),
+	.entries = entries,
+	.entry_count = ARRAY_SIZE(entries),
+};
+
+static void reset(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(dev_regs); i++)
+		dev_regs[i] = i;
+	dev_reads = 0;
+	dev_writes = 0;
+	dev_fail = 0;
+	i2c_reg_cache_register(&cache);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_register(void)
+{
+	struct i2c_reg_cache small = cache;
+
+	small.entry_count = 17;
+	TEST_EQ(i2c_reg_cache_register(&small), EC_ERROR_INVAL, "%d");
+
+	small.entry_count = 18;
+	small.addr_flags |= I2C_FLAG_PEC;
+	TEST_EQ(i2c_reg_cache_register(&small), EC_ERROR_UNIMPLEMENTED, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_read(void)
+{
+	int val;
+
+	reset();
+
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x21, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x21, "0x%x");
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x21, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x21, "0x%x");
+	TEST_EQ(dev_reads, 1, "%d");
+	TEST_EQ(cache.hits, 1, "%d");
+	TEST_EQ(cache.misses, 1, "%d");
+
+	/* Volatile registers always come from the device. */
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, TEST_VOLATILE_REG, &val),
+		EC_SUCCESS, "%d");
+	dev_regs[TEST_VOLATILE_REG] = 0x55;
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, TEST_VOLATILE_REG, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x55, "0x%x");
+	TEST_EQ(dev_reads, 3, "%d");
+	TEST_EQ(cache.hits + cache.misses, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_update(void)
+{
+	int val;
+
+	reset();
+
+	/* The first update reads the register, the next ones only write. */
+	TEST_EQ(i2c_update8(TEST_PORT, TEST_ADDR_FLAGS, 0x03, 0x80, MASK_SET),
+		EC_SUCCESS, "%d");
+	TEST_EQ(i2c_update8(TEST_PORT, TEST_ADDR_FLAGS, 0x03, 0x01, MASK_CLR),
+		EC_SUCCESS, "%d");
+	TEST_EQ(i2c_field_update8(TEST_PORT, TEST_ADDR_FLAGS, 0x03, 0x70,
+				  0x40), EC_SUCCESS, "%d");
+	TEST_EQ(dev_reads, 1, "%d");
+	TEST_EQ(dev_writes, 3, "%d");
+	TEST_EQ(dev_regs[0x03], 0xc2, "0x%x");
+
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x03, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0xc2, "0x%x");
+	TEST_EQ(dev_reads, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_invalidate(void)
+{
+	int val;
+
+	reset();
+
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x01, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x02, &val),
+		EC_SUCCESS, "%d");
+
+	/* Other writes invalidate the registers they cover. */
+	TEST_EQ(i2c_write16(TEST_PORT, TEST_ADDR_FLAGS, 0x00, 0xbbaa),
+		EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x01, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0xbb, "0x%x");
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x02, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x02, "0x%x");
+	TEST_EQ(dev_reads, 3, "%d");
+
+	/* Device reset. */
+	dev_regs[0x02] = 0;
+	i2c_reg_cache_invalidate(&cache);
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x02, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0, "0x%x");
+
+	/* Register reads keep the cache, split or not. */
+	i2c_lock(TEST_PORT, 1);
+	TEST_EQ(i2c_xfer_unlocked(TEST_PORT, TEST_ADDR_FLAGS,
+				  (const uint8_t[]){ TEST_VOLATILE_REG }, 1,
+				  NULL, 0, I2C_XFER_START), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_unlocked(TEST_PORT, TEST_ADDR_FLAGS, NULL, 0,
+				  (uint8_t *)&val, 1, I2C_XFER_STOP),
+		EC_SUCCESS, "%d");
+	i2c_lock(TEST_PORT, 0);
+	dev_reads = 0;
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x02, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(dev_reads, 0, "%d");
+
+	/* A command may change any register. */
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x21, &val),
+		EC_SUCCESS, "%d");
+	dev_regs[0x21] = 0x42;
+	TEST_EQ(i2c_xfer(TEST_PORT, TEST_ADDR_FLAGS, (const uint8_t[]){ 0xff },
+			 1, NULL, 0), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x21, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x42, "0x%x");
+
+	/* A failed write leaves the register unknown. */
+	dev_fail = 1;
+	TEST_NE(i2c_write8(TEST_PORT, TEST_ADDR_FLAGS, 0x02, 0x12),
+		EC_SUCCESS, "%d");
+	dev_fail = 0;
+	dev_reads = 0;
+	TEST_EQ(i2c_read8(TEST_PORT, TEST_ADDR_FLAGS, 0x02, &val),
+		EC_SUCCESS, "%d");
+	TEST_EQ(val, 0, "0x%x");
+	TEST_EQ(dev_reads, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_register);
+	RUN_TEST(test_read);
+	RUN_TEST(test_update);
+	RUN_TEST(test_invalidate);
+
+	test_print_result();
+}
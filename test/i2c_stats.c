@@ -0,0 +1,129 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the I2C transfer statistics.
+ */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "i2c.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define TEST_PORT 0
+#define TEST_ADDR_FLAGS 0x40
+#define TEST_MISSING_ADDR_FLAGS 0x41
+
+/* Each transfer takes 100us. */
+#define TEST_XFER_US 100
+
+static int dev_xfer(const int port, const uint16_t addr_flags,
+		    const uint8_t *out, int out_size,
+		    uint8_t *in, int in_size, int flags)
+{
+	if (port != TEST_PORT)
+		return EC_ERROR_INVAL;
+	if (addr_flags == TEST_MISSING_ADDR_FLAGS)
+		return EC_ERROR_BUSY;
+	if (addr_flags != TEST_ADDR_FLAGS)
+		return EC_ERROR_INVAL;
+
+	usleep(TEST_XFER_US);
+	memset(in, 0x5a, in_size);
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(dev_xfer);
+
+static int get_stats(int port, int flags, struct ec_response_i2c_stats *r)
+{
+	struct ec_params_i2c_stats p = {
+		.port = port,
+		.flags = flags,
+	};
+
+	return test_send_host_command(EC_CMD_I2C_STATS, 0, &p, sizeof(p),
+				      r, sizeof(*r));
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_counters(void)
+{
+	struct ec_response_i2c_stats r;
+	uint32_t hist_total = 0;
+	int i, val;
+
+	TEST_EQ(get_stats(TEST_PORT, EC_I2C_STATS_FLAG_RESET, &r),
+		EC_RES_SUCCESS, "%d");
+
+	TEST_EQ(i2c_write8(TEST_PORT, TEST_ADDR_FLAGS, 1, 2), EC_SUCCESS,
+		"%d");
+	TEST_EQ(i2c_read16(TEST_PORT, TEST_ADDR_FLAGS, 1, &val), EC_SUCCESS,
+		"%d");
+	TEST_NE(i2c_read8(TEST_PORT, TEST_MISSING_ADDR_FLAGS, 1, &val),
+		EC_SUCCESS, "%d");
+
+	TEST_EQ(get_stats(TEST_PORT, 0, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.port_count, I2C_PORT_COUNT, "%d");
+	TEST_EQ(r.xfers, 3, "%d");
+	TEST_EQ(r.bytes_out, 4, "%d");
+	TEST_EQ(r.bytes_in, 3, "%d");
+	TEST_EQ(r.errors, 1, "%d");
+	TEST_EQ(r.lock_count, 3, "%d");
+	TEST_GE(r.xfer_time_us, 2 * TEST_XFER_US, "%d");
+	TEST_GE(r.lock_time_us, r.xfer_time_us, "%d");
+
+	for (i = 0; i < EC_I2C_STATS_HIST_BUCKETS; i++)
+		hist_total += r.hist[i];
+	TEST_EQ(hist_total, r.xfers, "%d");
+	/* 100us transfers land in [64, 128). */
+	TEST_GE(r.hist[7], 2, "%d");
+
+	TEST_EQ(r.addr_count, 2, "%d");
+	TEST_EQ(r.addrs[0].addr_flags, TEST_ADDR_FLAGS, "0x%x");
+	TEST_EQ(r.addrs[0].xfers, 2, "%d");
+	TEST_EQ(r.addrs[0].bytes, 5, "%d");
+	TEST_EQ(r.addrs[0].errors, 0, "%d");
+	TEST_EQ(r.addrs[1].addr_flags, TEST_MISSING_ADDR_FLAGS, "0x%x");
+	TEST_EQ(r.addrs[1].errors, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_reset_flag(void)
+{
+	struct ec_response_i2c_stats r;
+
+	TEST_EQ(get_stats(TEST_PORT, EC_I2C_STATS_FLAG_RESET, &r),
+		EC_RES_SUCCESS, "%d");
+	TEST_NE(r.xfers, 0, "%d");
+
+	TEST_EQ(get_stats(TEST_PORT, 0, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.xfers, 0, "%d");
+	TEST_EQ(r.addr_count, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_invalid_port(void)
+{
+	struct ec_response_i2c_stats r;
+
+	TEST_EQ(get_stats(I2C_PORT_COUNT, 0, &r), EC_RES_INVALID_PARAM, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_counters);
+	RUN_TEST(test_reset_flag);
+	RUN_TEST(test_invalid_port);
+
+	test_print_result();
+}
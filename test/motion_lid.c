@@ -319,12 +319,64 @@ static int test_lid_angle(void)
 	return EC_SUCCESS;
 }
 
+static int test_lid_angle_gate(void)
+{
+	struct motion_sensor_t *base = &motion_sensors[
+		CONFIG_LID_ANGLE_SENSOR_BASE];
+	struct motion_sensor_t *lid = &motion_sensors[
+		CONFIG_LID_ANGLE_SENSOR_LID];
+	uint32_t computed, skipped, last_computed, last_skipped;
+
+	/* Go to S0 state */
+	hook_notify(HOOK_CHIPSET_SUSPEND);
+	hook_notify(HOOK_CHIPSET_RESUME);
+	msleep(50);
+
+	/* Set lid open to 90 degrees. */
+	base->xyz[X] = 0;
+	base->xyz[Y] = 0;
+	base->xyz[Z] = ONE_G_MEASURED;
+	lid->xyz[X] = 0;
+	lid->xyz[Y] = ONE_G_MEASURED;
+	lid->xyz[Z] = 0;
+	gpio_set_level(GPIO_LID_OPEN, 1);
+	msleep(100);
+	wait_for_valid_sample();
+	TEST_ASSERT(motion_lid_get_angle() == 90);
+
+	/* Vectors do not move, the last angle is reused. */
+	motion_lid_get_calc_count(&last_computed, &last_skipped);
+	wait_for_valid_sample();
+	wait_for_valid_sample();
+	motion_lid_get_calc_count(&computed, &skipped);
+	TEST_EQ(computed, last_computed, "%u");
+	TEST_GT(skipped, last_skipped, "%u");
+	TEST_ASSERT(motion_lid_get_angle() == 90);
+
+	/* Noise below CONFIG_LID_ANGLE_GATE_MG is ignored as well. */
+	lid->xyz[Z] = ONE_G_MEASURED / 200;
+	wait_for_valid_sample();
+	motion_lid_get_calc_count(&computed, &skipped);
+	TEST_EQ(computed, last_computed, "%u");
+
+	/* Set lid open to 225. */
+	lid->xyz[X] = 0;
+	lid->xyz[Y] = -1 * ONE_G_MEASURED * 0.707106;
+	lid->xyz[Z] = ONE_G_MEASURED * 0.707106;
+	wait_for_valid_sample();
+	motion_lid_get_calc_count(&computed, &skipped);
+	TEST_GT(computed, last_computed, "%u");
+	TEST_ASSERT(motion_lid_get_angle() == 225);
+
+	return EC_SUCCESS;
+}
 
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_lid_angle);
+	RUN_TEST(test_lid_angle_gate);
 
 	test_print_result();
 }
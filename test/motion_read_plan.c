@@ -0,0 +1,314 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test batched register reads of polled motion sensors.
+ */
+
+#include "accelgyro.h"
+#include "common.h"
+#include "hooks.h"
+#include "i2c.h"
+#include "motion_sense.h"
+#include "motion_sense_read_plan.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Collect one sample every 100ms. */
+#define TEST_ODR 10000
+
+/*
+ * Emulate an accel/gyro combo chip: a status register followed by the
+ * gyro and accel output registers.
+ */
+#define CHIP_ADDR_FLAGS 0x6a
+#define CHIP_STATUS_REG 0x1e
+#define CHIP_GYRO_REG 0x22
+#define CHIP_ACCEL_REG 0x28
+#define CHIP_STATUS_XLDA BIT(0)
+#define CHIP_STATUS_GDA BIT(1)
+
+static uint8_t chip_regs[0x40];
+static int xfer_count;
+/* Fail the transfers longer than a single output block. */
+static int burst_fail;
+static int last_burst_reg;
+static int last_burst_len;
+
+/* Sensors that do not provide a read plan. */
+static uint32_t no_plan_mask;
+static int read_count;
+static int sensor_rate[2];
+
+static int chip_xfer(const int port, const uint16_t addr_flags,
+		     const uint8_t *out, int out_size,
+		     uint8_t *in, int in_size, int flags)
+{
+	if (port != 0 || addr_flags != CHIP_ADDR_FLAGS)
+		return EC_ERROR_INVAL;
+
+	if (out_size != 1 || out[0] + in_size > sizeof(chip_regs))
+		return EC_ERROR_INVAL;
+
+	xfer_count++;
+	if (burst_fail && in_size > 6)
+		return EC_ERROR_UNKNOWN;
+
+	if (in_size > 6) {
+		last_burst_reg = out[0];
+		last_burst_len = in_size;
+	}
+	memcpy(in, &chip_regs[out[0]], in_size);
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(chip_xfer);
+
+static void set_chip_xyz(int reg, int x, int y, int z)
+{
+	const int16_t v[] = { x, y, z };
+	int i;
+
+	for (i = X; i <= Z; i++) {
+		chip_regs[reg + i * 2] = v[i] & 0xff;
+		chip_regs[reg + i * 2 + 1] = (v[i] >> 8) & 0xff;
+	}
+}
+
+/*****************************************************************************/
+/* Mock functions */
+
+static int chip_xyz_reg(const struct motion_sensor_t *s)
+{
+	return s->type == MOTIONSENSE_TYPE_ACCEL ?
+		CHIP_ACCEL_REG : CHIP_GYRO_REG;
+}
+
+static void chip_decode(const uint8_t *raw, intv3_t v)
+{
+	int i;
+
+	for (i = X; i <= Z; i++)
+		v[i] = (int16_t)(raw[i * 2] | (raw[i * 2 + 1] << 8));
+}
+
+static int chip_init(struct motion_sensor_t *s)
+{
+	return EC_SUCCESS;
+}
+
+static int chip_read(const struct motion_sensor_t *s, intv3_t v)
+{
+	uint8_t raw[6];
+	int ret;
+
+	read_count++;
+	ret = i2c_read_block(s->port, s->i2c_spi_addr_flags,
+			     chip_xyz_reg(s), raw, sizeof(raw));
+	if (ret == EC_SUCCESS)
+		chip_decode(raw, v);
+	return ret;
+}
+
+static int chip_set_range(struct motion_sensor_t *s, int range, int rnd)
+{
+	s->current_range = range;
+	return EC_SUCCESS;
+}
+
+static int chip_set_data_rate(const struct motion_sensor_t *s, int rate,
+			      int rnd)
+{
+	sensor_rate[s - motion_sensors] = rate;
+	return EC_SUCCESS;
+}
+
+static int chip_get_data_rate(const struct motion_sensor_t *s)
+{
+	return sensor_rate[s - motion_sensors];
+}
+
+static int chip_get_read_plan(const struct motion_sensor_t *s,
+			      struct motion_read_plan *plan)
+{
+	if (no_plan_mask & BIT(s - motion_sensors))
+		return EC_ERROR_UNIMPLEMENTED;
+
+	plan->reg = CHIP_STATUS_REG;
+	plan->len = chip_xyz_reg(s) + 6 - CHIP_STATUS_REG;
+	return EC_SUCCESS;
+}
+
+static int chip_decode_read_plan(const struct motion_sensor_t *s,
+				 const uint8_t *data, intv3_t v)
+{
+	const uint8_t ready = s->type == MOTIONSENSE_TYPE_ACCEL ?
+		CHIP_STATUS_XLDA : CHIP_STATUS_GDA;
+
+	if (!(data[0] & ready)) {
+		memcpy(v, s->raw_xyz, sizeof(s->raw_xyz));
+		return EC_SUCCESS;
+	}
+
+	chip_decode(&data[chip_xyz_reg(s) - CHIP_STATUS_REG], v);
+	return EC_SUCCESS;
+}
+
+const struct accelgyro_drv test_chip_drv = {
+	.init = chip_init,
+	.read = chip_read,
+	.set_range = chip_set_range,
+	.set_data_rate = chip_set_data_rate,
+	.get_data_rate = chip_get_data_rate,
+	.get_read_plan = chip_get_read_plan,
+	.decode_read_plan = chip_decode_read_plan,
+};
+
+struct motion_sensor_t motion_sensors[] = {
+	[ACCEL] = {
+		.name = "accel",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_LSM6DSO,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.location = MOTIONSENSE_LOC_BASE,
+		.drv = &test_chip_drv,
+		.port = 0,
+		.i2c_spi_addr_flags = CHIP_ADDR_FLAGS,
+		.default_range = 2,
+		.config = {
+			[SENSOR_CONFIG_EC_S0] = {
+				.odr = TEST_ODR,
+			},
+		},
+	},
+	[GYRO] = {
+		.name = "gyro",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_LSM6DSO,
+		.type = MOTIONSENSE_TYPE_GYRO,
+		.location = MOTIONSENSE_LOC_BASE,
+		.drv = &test_chip_drv,
+		.port = 0,
+		.i2c_spi_addr_flags = CHIP_ADDR_FLAGS,
+		.default_range = 1000,
+		.config = {
+			[SENSOR_CONFIG_EC_S0] = {
+				.odr = TEST_ODR,
+			},
+		},
+	},
+};
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_burst(void)
+{
+	uint32_t transfers, reads;
+	uint32_t transfers_0, reads_0;
+
+	chip_regs[CHIP_STATUS_REG] = CHIP_STATUS_XLDA | CHIP_STATUS_GDA;
+	set_chip_xyz(CHIP_ACCEL_REG, 100, -200, 300);
+	set_chip_xyz(CHIP_GYRO_REG, -1, 2, -3);
+
+	motion_sense_read_plan_get_stats(&transfers_0, &reads_0);
+	xfer_count = 0;
+	read_count = 0;
+	msleep(1000);
+	motion_sense_read_plan_get_stats(&transfers, &reads);
+
+	/* One transaction serves both sensors. */
+	TEST_EQ(read_count, 0, "%d");
+	TEST_GE(xfer_count, 9, "%d");
+	TEST_LE(xfer_count, 11, "%d");
+	TEST_EQ(transfers - transfers_0, xfer_count, "%d");
+	TEST_EQ(reads - reads_0, 2 * xfer_count, "%d");
+
+	/* The burst covers the union of the two blocks. */
+	TEST_EQ(last_burst_reg, CHIP_STATUS_REG, "%d");
+	TEST_EQ(last_burst_len, CHIP_ACCEL_REG + 6 - CHIP_STATUS_REG, "%d");
+
+	TEST_EQ(motion_sensors[ACCEL].xyz[X], 100, "%d");
+	TEST_EQ(motion_sensors[ACCEL].xyz[Y], -200, "%d");
+	TEST_EQ(motion_sensors[ACCEL].xyz[Z], 300, "%d");
+	TEST_EQ(motion_sensors[GYRO].xyz[X], -1, "%d");
+	TEST_EQ(motion_sensors[GYRO].xyz[Y], 2, "%d");
+	TEST_EQ(motion_sensors[GYRO].xyz[Z], -3, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_not_ready(void)
+{
+	/* Only the gyro has a new sample. */
+	chip_regs[CHIP_STATUS_REG] = CHIP_STATUS_GDA;
+	set_chip_xyz(CHIP_ACCEL_REG, 1, 1, 1);
+	set_chip_xyz(CHIP_GYRO_REG, 4, 5, 6);
+	msleep(200);
+
+	TEST_EQ(motion_sensors[ACCEL].xyz[X], 100, "%d");
+	TEST_EQ(motion_sensors[ACCEL].xyz[Y], -200, "%d");
+	TEST_EQ(motion_sensors[ACCEL].xyz[Z], 300, "%d");
+	TEST_EQ(motion_sensors[GYRO].xyz[X], 4, "%d");
+	TEST_EQ(motion_sensors[GYRO].xyz[Y], 5, "%d");
+	TEST_EQ(motion_sensors[GYRO].xyz[Z], 6, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_no_plan(void)
+{
+	chip_regs[CHIP_STATUS_REG] = CHIP_STATUS_XLDA | CHIP_STATUS_GDA;
+	set_chip_xyz(CHIP_ACCEL_REG, 7, 8, 9);
+
+	/* The accel falls back to read(), the gyro keeps its own burst. */
+	no_plan_mask = BIT(ACCEL);
+	xfer_count = 0;
+	read_count = 0;
+	msleep(1000);
+	no_plan_mask = 0;
+
+	TEST_GE(read_count, 9, "%d");
+	TEST_LE(read_count, 11, "%d");
+	TEST_EQ(xfer_count, 2 * read_count, "%d");
+	TEST_EQ(last_burst_reg, CHIP_STATUS_REG, "%d");
+	TEST_EQ(last_burst_len, CHIP_GYRO_REG + 6 - CHIP_STATUS_REG, "%d");
+	TEST_EQ(motion_sensors[ACCEL].xyz[X], 7, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_bus_error(void)
+{
+	/* A failed burst is retried by each sensor read(). */
+	burst_fail = 1;
+	xfer_count = 0;
+	read_count = 0;
+	msleep(1000);
+	burst_fail = 0;
+
+	TEST_GE(read_count, 18, "%d");
+	TEST_LE(read_count, 22, "%d");
+	TEST_EQ(xfer_count, read_count + read_count / 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	/* We don't have TASK_CHIP so simulate init ourselves */
+	hook_notify(HOOK_CHIPSET_SUSPEND);
+	hook_notify(HOOK_CHIPSET_RESUME);
+	msleep(50);
+
+	RUN_TEST(test_burst);
+	RUN_TEST(test_not_ready);
+	RUN_TEST(test_no_plan);
+	RUN_TEST(test_bus_error);
+
+	test_print_result();
+}
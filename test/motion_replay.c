@@ -0,0 +1,523 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Replay a recorded sensor trace through the motion sense task, the FIFO,
+ * online calibration and lid angle, and report what it cost.
+ *
+ * The trace is read from the file named by MOTION_REPLAY_TRACE, either as CSV
+ * lines "time_us,sensor,x,y,z" (x, y, z in g, '#' starts a comment) or, if the
+ * name ends in ".bin", as an array of struct replay_record. Without it, the
+ * laptop mode data set from motion_angle_data_literals.c is replayed at
+ * 100 Hz. The sampling setup requested by the AP can be changed with
+ * MOTION_REPLAY_ODR (mHz) and MOTION_REPLAY_EC_RATE (ms).
+ *
+ * Time in the emulator is virtual and fast forwarded, so the CPU cost is
+ * measured with the host thread CPU clock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "accel_cal.h"
+#include "accelgyro.h"
+#include "common.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "motion_common.h"
+#include "motion_lid.h"
+#include "motion_sense.h"
+#include "motion_sense_fifo.h"
+#include "online_calibration.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Period of the built-in trace. */
+#define REPLAY_DEFAULT_PERIOD (10 * MSEC)
+#define REPLAY_DEFAULT_ODR 100000
+#define REPLAY_DEFAULT_EC_RATE 100
+
+/* One sample of a trace, also the record format of binary traces. */
+struct replay_record {
+	uint32_t time_us;
+	uint32_t sensor;
+	float xyz[3];
+};
+
+static struct replay_record *trace;
+static int trace_len;
+
+/* Sample currently exposed by each sensor. */
+static intv3_t replay_xyz[SENSOR_COUNT];
+static bool replay_consumed[SENSOR_COUNT];
+
+static struct {
+	int published;
+	int read;
+	int dropped;
+	int ap_wakeups;
+	int ap_reads;
+	int fifo_max;
+	uint64_t fifo_sum;
+	int fifo_samples;
+	uint64_t task_cpu_first_ns;
+	uint64_t task_cpu_last_ns;
+	int task_loops;
+} stats;
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*****************************************************************************/
+/* Mock functions */
+
+int mkbp_send_event(uint8_t event_type)
+{
+	if (event_type == EC_MKBP_EVENT_SENSOR_FIFO)
+		stats.ap_wakeups++;
+	return 1;
+}
+
+static int replay_init(struct motion_sensor_t *s)
+{
+	return sensor_init_done(s);
+}
+
+static int replay_read(const struct motion_sensor_t *s, intv3_t v)
+{
+	const int id = s - motion_sensors;
+
+	/* The base sensor is read first on every motion sense loop. */
+	if (id == BASE) {
+		uint64_t now = thread_cpu_ns();
+
+		if (stats.task_loops++ == 0)
+			stats.task_cpu_first_ns = now;
+		stats.task_cpu_last_ns = now;
+	}
+
+	if (!replay_consumed[id]) {
+		replay_consumed[id] = true;
+		stats.read++;
+	}
+	memcpy(v, replay_xyz[id], sizeof(intv3_t));
+	return EC_SUCCESS;
+}
+
+static int replay_read_temp(const struct motion_sensor_t *s, int *temp)
+{
+	*temp = 200;
+	return EC_SUCCESS;
+}
+
+static int replay_set_range(struct motion_sensor_t *s, int range, int rnd)
+{
+	s->current_range = range;
+	return EC_SUCCESS;
+}
+
+static int replay_get_resolution(const struct motion_sensor_t *s)
+{
+	return 16;
+}
+
+static int replay_data_rate[SENSOR_COUNT];
+
+static int replay_set_data_rate(const struct motion_sensor_t *s, int rate,
+				int rnd)
+{
+	replay_data_rate[s - motion_sensors] = rate;
+	return EC_SUCCESS;
+}
+
+static int replay_get_data_rate(const struct motion_sensor_t *s)
+{
+	return replay_data_rate[s - motion_sensors];
+}
+
+static const struct accelgyro_drv replay_drv = {
+	.init = replay_init,
+	.read = replay_read,
+	.read_temp = replay_read_temp,
+	.set_range = replay_set_range,
+	.get_resolution = replay_get_resolution,
+	.set_data_rate = replay_set_data_rate,
+	.get_data_rate = replay_get_data_rate,
+};
+
+static struct accel_cal_algo base_cal_algos[] = { {
+	.newton_fit = NEWTON_FIT(4, 15, FLOAT_TO_FP(0.01f), FLOAT_TO_FP(0.25f),
+				 FLOAT_TO_FP(1.0e-8f), 100),
+} };
+
+static struct accel_cal base_cal = {
+	.still_det =
+		STILL_DET(FLOAT_TO_FP(0.00025f), 800 * MSEC, 1200 * MSEC, 5),
+	.algos = base_cal_algos,
+	.num_temp_windows = ARRAY_SIZE(base_cal_algos),
+};
+
+static struct accel_cal_algo lid_cal_algos[] = { {
+	.newton_fit = NEWTON_FIT(4, 15, FLOAT_TO_FP(0.01f), FLOAT_TO_FP(0.25f),
+				 FLOAT_TO_FP(1.0e-8f), 100),
+} };
+
+static struct accel_cal lid_cal = {
+	.still_det =
+		STILL_DET(FLOAT_TO_FP(0.00025f), 800 * MSEC, 1200 * MSEC, 5),
+	.algos = lid_cal_algos,
+	.num_temp_windows = ARRAY_SIZE(lid_cal_algos),
+};
+
+struct motion_sensor_t motion_sensors[] = {
+	[BASE] = {
+		.name = "base",
+		.active_mask = SENSOR_ACTIVE_S0_S3_S5,
+		.chip = MOTIONSENSE_CHIP_LSM6DS0,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.location = MOTIONSENSE_LOC_BASE,
+		.drv = &replay_drv,
+		.default_range = 2,
+		.min_frequency = 12500,
+		.max_frequency = 400000,
+		.online_calib_data[0] = {
+			.type_specific_data = &base_cal,
+		},
+	},
+	[LID] = {
+		.name = "lid",
+		.active_mask = SENSOR_ACTIVE_S0,
+		.chip = MOTIONSENSE_CHIP_KXCJ9,
+		.type = MOTIONSENSE_TYPE_ACCEL,
+		.location = MOTIONSENSE_LOC_LID,
+		.drv = &replay_drv,
+		.default_range = 2,
+		.min_frequency = 12500,
+		.max_frequency = 400000,
+		.online_calib_data[0] = {
+			.type_specific_data = &lid_cal,
+		},
+	},
+};
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+/*****************************************************************************/
+/* Trace loading */
+
+static int trace_append(const struct replay_record *r)
+{
+	static int capacity;
+
+	if (r->sensor >= SENSOR_COUNT)
+		return EC_ERROR_INVAL;
+
+	if (trace_len == capacity) {
+		struct replay_record *bigger;
+
+		capacity = capacity ? capacity * 2 : 1024;
+		bigger = realloc(trace, capacity * sizeof(*trace));
+		if (!bigger)
+			return EC_ERROR_OVERFLOW;
+		trace = bigger;
+	}
+	trace[trace_len++] = *r;
+	return EC_SUCCESS;
+}
+
+static int trace_load_csv(FILE *f)
+{
+	char line[256];
+	struct replay_record r;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%u,%u,%f,%f,%f", &r.time_us, &r.sensor,
+			   &r.xyz[X], &r.xyz[Y], &r.xyz[Z]) != 5)
+			continue;
+		if (trace_append(&r))
+			return EC_ERROR_INVAL;
+	}
+	return EC_SUCCESS;
+}
+
+static int trace_load_bin(FILE *f)
+{
+	struct replay_record r;
+
+	while (fread(&r, sizeof(r), 1, f) == 1)
+		if (trace_append(&r))
+			return EC_ERROR_INVAL;
+	return EC_SUCCESS;
+}
+
+static int trace_load_default(void)
+{
+	struct replay_record r;
+	int i, j;
+
+	/* Groups of 6 values: base X, Y, Z then lid X, Y, Z. */
+	for (i = 0; i + 6 <= kAccelerometerLaptopModeTestDataLength; i += 6) {
+		for (j = 0; j < 2; j++) {
+			r.time_us = (i / 6) * REPLAY_DEFAULT_PERIOD;
+			r.sensor = j ? LID : BASE;
+			r.xyz[X] = kAccelerometerLaptopModeTestData[i + 3 * j];
+			r.xyz[Y] = kAccelerometerLaptopModeTestData[i + 3 * j + 1];
+			r.xyz[Z] = kAccelerometerLaptopModeTestData[i + 3 * j + 2];
+			if (trace_append(&r))
+				return EC_ERROR_INVAL;
+		}
+	}
+	return EC_SUCCESS;
+}
+
+static int trace_load(void)
+{
+	const char *path = getenv("MOTION_REPLAY_TRACE");
+	size_t len;
+	FILE *f;
+	int rv;
+
+	if (!path)
+		return trace_load_default();
+
+	f = fopen(path, "rb");
+	if (!f) {
+		ccprintf("Cannot open %s\n", path);
+		return EC_ERROR_INVAL;
+	}
+	len = strlen(path);
+	if (len > 4 && !strcmp(path + len - 4, ".bin"))
+		rv = trace_load_bin(f);
+	else
+		rv = trace_load_csv(f);
+	fclose(f);
+	return rv;
+}
+
+static int env_int(const char *name, int def)
+{
+	const char *v = getenv(name);
+
+	return v ? atoi(v) : def;
+}
+
+/*****************************************************************************/
+/* AP side */
+
+static int ap_set_rates(int odr, int ec_rate)
+{
+	struct ec_params_motion_sense params;
+	struct ec_response_motion_sense resp;
+	int i, rv;
+
+	for (i = 0; i < SENSOR_COUNT; i++) {
+		params.cmd = MOTIONSENSE_CMD_SENSOR_ODR;
+		params.sensor_odr.sensor_num = i;
+		params.sensor_odr.roundup = 1;
+		params.sensor_odr.data = odr;
+		rv = test_send_host_command(EC_CMD_MOTION_SENSE_CMD, 1,
+					    &params, sizeof(params),
+					    &resp, sizeof(resp));
+		if (rv != EC_RES_SUCCESS)
+			return rv;
+
+		params.cmd = MOTIONSENSE_CMD_EC_RATE;
+		params.ec_rate.sensor_num = i;
+		params.ec_rate.data = ec_rate;
+		rv = test_send_host_command(EC_CMD_MOTION_SENSE_CMD, 1,
+					    &params, sizeof(params),
+					    &resp, sizeof(resp));
+		if (rv != EC_RES_SUCCESS)
+			return rv;
+	}
+
+	params.cmd = MOTIONSENSE_CMD_FIFO_INT_ENABLE;
+	params.fifo_int_enable.enable = 1;
+	return test_send_host_command(EC_CMD_MOTION_SENSE_CMD, 1,
+				      &params, sizeof(params),
+				      &resp, sizeof(resp));
+}
+
+/* Drain the FIFO like the kernel driver does on a sensor event. */
+static void ap_drain_fifo(void)
+{
+	struct ec_params_motion_sense params = {
+		.cmd = MOTIONSENSE_CMD_FIFO_READ,
+		.fifo_read.max_data_vector = CONFIG_ACCEL_FIFO_SIZE,
+	};
+	uint8_t buf[512];
+	struct ec_response_motion_sense *resp = (void *)buf;
+	struct ec_response_motion_sense_fifo_info info;
+
+	motion_sense_fifo_get_info(&info, 0);
+	stats.fifo_max = MAX(stats.fifo_max, info.count);
+	stats.fifo_sum += info.count;
+	stats.fifo_samples++;
+
+	do {
+		if (test_send_host_command(EC_CMD_MOTION_SENSE_CMD, 1,
+					   &params, sizeof(params),
+					   buf, sizeof(buf)) != EC_RES_SUCCESS)
+			return;
+		stats.ap_reads++;
+	} while (resp->fifo_read.number_data > 0);
+}
+
+/*****************************************************************************/
+/* Benchmarks */
+
+static void publish(const struct replay_record *r)
+{
+	struct motion_sensor_t *s = &motion_sensors[r->sensor];
+	int i;
+
+	if (!replay_consumed[r->sensor] && stats.published)
+		stats.dropped++;
+	for (i = X; i <= Z; i++)
+		replay_xyz[r->sensor][i] =
+			r->xyz[i] * MOTION_SCALING_FACTOR / s->current_range;
+	replay_consumed[r->sensor] = false;
+	stats.published++;
+}
+
+static void print_stage(const char *name, uint64_t ns, int count)
+{
+	ccprintf("  %-12s %6lld ns/sample\n", name,
+		 (long long)(count ? ns / count : 0));
+}
+
+/*
+ * Time each stage of the pipeline on its own, calling it from this task with
+ * the samples of the trace.
+ */
+static void bench_stages(void)
+{
+	struct ec_response_motion_sensor_data vector;
+	uint64_t t0, fifo_ns = 0, calib_ns = 0, lid_ns = 0;
+	int i, n = 0, lid_count = 0;
+
+	for (i = 0; i < trace_len; i++) {
+		struct motion_sensor_t *s = &motion_sensors[trace[i].sensor];
+		const uint32_t ts = trace[i].time_us;
+
+		publish(&trace[i]);
+		vector.flags = 0;
+		vector.sensor_num = trace[i].sensor;
+		ec_motion_sensor_fill_values(&vector,
+					     replay_xyz[trace[i].sensor]);
+
+		t0 = thread_cpu_ns();
+		online_calibration_process_data(&vector, s, ts);
+		calib_ns += thread_cpu_ns() - t0;
+
+		t0 = thread_cpu_ns();
+		motion_sense_fifo_stage_data(&vector, s, 3, ts);
+		motion_sense_fifo_commit_data();
+		fifo_ns += thread_cpu_ns() - t0;
+		n++;
+
+		if (trace[i].sensor == LID) {
+			t0 = thread_cpu_ns();
+			motion_lid_calc();
+			lid_ns += thread_cpu_ns() - t0;
+			lid_count++;
+		}
+	}
+	motion_sense_fifo_init();
+
+	ccprintf("Per stage CPU time:\n");
+	print_stage("online_cal", calib_ns, n);
+	/* Staging runs online calibration again. */
+	print_stage("fifo+cal", fifo_ns, n);
+	print_stage("lid_angle", lid_ns, lid_count);
+}
+
+static int test_replay(void)
+{
+	const int odr = env_int("MOTION_REPLAY_ODR", REPLAY_DEFAULT_ODR);
+	const int ec_rate = env_int("MOTION_REPLAY_EC_RATE",
+				    REPLAY_DEFAULT_EC_RATE);
+	struct ec_response_motion_sense_fifo_info info;
+	uint32_t start, elapsed, offset;
+	uint64_t task_ns;
+	uint32_t lid_computed, lid_skipped;
+	int i;
+
+	TEST_EQ(trace_load(), EC_SUCCESS, "%d");
+	TEST_ASSERT(trace_len > 0);
+
+	/* We don't have TASK_CHIP so simulate init ourselves */
+	hook_notify(HOOK_CHIPSET_SUSPEND);
+	hook_notify(HOOK_CHIPSET_RESUME);
+	msleep(50);
+	TEST_EQ(ap_set_rates(odr, ec_rate), EC_RES_SUCCESS, "%d");
+	msleep(50);
+	ap_drain_fifo();
+	memset(&stats, 0, sizeof(stats));
+
+	start = get_time().le.lo;
+	for (i = 0; i < trace_len; i++) {
+		offset = trace[i].time_us - trace[0].time_us;
+		elapsed = get_time().le.lo - start;
+		if (offset > elapsed)
+			usleep(offset - elapsed);
+		publish(&trace[i]);
+		if (stats.ap_wakeups > stats.fifo_samples)
+			ap_drain_fifo();
+	}
+	/* Let the last batch reach the AP. */
+	msleep(2 * ec_rate);
+	ap_drain_fifo();
+
+	motion_sense_fifo_get_info(&info, 0);
+	task_ns = stats.task_cpu_last_ns - stats.task_cpu_first_ns;
+
+	ccprintf("Replayed %d samples over %d ms, ODR %d mHz, EC rate %d ms\n",
+		 trace_len,
+		 (trace[trace_len - 1].time_us - trace[0].time_us) / MSEC,
+		 odr, ec_rate);
+	ccprintf("  sensor reads     %d\n", stats.read);
+	ccprintf("  dropped samples  %d (not read), %d (FIFO lost)\n",
+		 stats.dropped, info.total_lost);
+	ccprintf("  AP wakeups       %d, FIFO reads %d\n", stats.ap_wakeups,
+		 stats.ap_reads);
+	ccprintf("  FIFO occupancy   max %d, avg %d / %d\n", stats.fifo_max,
+		 (int)(stats.fifo_samples ?
+		       stats.fifo_sum / stats.fifo_samples : 0),
+		 info.size);
+	ccprintf("  motion task      %d loops, %lld ns/loop\n",
+		 stats.task_loops,
+		 (long long)(stats.task_loops > 1 ?
+			     task_ns / (stats.task_loops - 1) : 0));
+	motion_lid_get_calc_count(&lid_computed, &lid_skipped);
+	ccprintf("  lid angle        %d, %u computed, %u skipped\n",
+		 motion_lid_get_angle(), lid_computed, lid_skipped);
+
+	bench_stages();
+
+	TEST_ASSERT(stats.read > 0);
+	TEST_ASSERT(stats.ap_wakeups > 0);
+	/* Nothing should be lost when the AP keeps up with the EC rate. */
+	TEST_EQ(info.total_lost, 0, "%u");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_replay);
+
+	test_print_result();
+}
@@ -0,0 +1,164 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Priority inversion on mutexes: a low priority task holds a lock wanted by
+ * a high priority task while a medium priority task hogs the CPU.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "i2c.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Time the low priority task holds the lock, in slices of work and sleep. */
+#define HOLD_SLICES 10
+#define HOLD_SLICE_US 100
+
+/* Time the medium priority task keeps the CPU busy. */
+#define HOG_US (20 * MSEC)
+
+#define ITERATIONS 5
+
+static struct mutex plain_mtx;
+/* Lock the I2C port, or the plain mutex if false. */
+static int use_i2c;
+
+static int low_locked;
+static int high_done;
+static int high_wait_us;
+
+static void lock(int lock)
+{
+	if (use_i2c)
+		i2c_lock(I2C_PORT_EEPROM, lock);
+	else if (lock)
+		mutex_lock(&plain_mtx);
+	else
+		mutex_unlock(&plain_mtx);
+}
+
+/* Battery or thermal task polling a shared bus. */
+int low_task(void *unused)
+{
+	int i;
+
+	while (1) {
+		task_wait_event(-1);
+
+		lock(1);
+		low_locked = 1;
+		for (i = 0; i < HOLD_SLICES; i++) {
+			udelay(HOLD_SLICE_US);
+			usleep(HOLD_SLICE_US);
+		}
+		low_locked = 0;
+		lock(0);
+	}
+
+	return EC_SUCCESS;
+}
+
+/* Unrelated work that never blocks, but still lets higher tasks run. */
+int med_task(void *unused)
+{
+	timestamp_t start;
+
+	while (1) {
+		task_wait_event(-1);
+
+		start = get_time();
+		while (time_since32(start) < HOG_US) {
+			udelay(100);
+			task_set_event(TASK_ID_MED, TASK_EVENT_WAKE);
+			task_wait_event(-1);
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+/* PD task handling a TCPC alert on the shared bus. */
+int high_task(void *unused)
+{
+	timestamp_t start;
+
+	while (1) {
+		task_wait_event(-1);
+
+		start = get_time();
+		lock(1);
+		high_wait_us = time_since32(start);
+		lock(0);
+		high_done = 1;
+	}
+
+	return EC_SUCCESS;
+}
+
+/* Run one inversion scenario and return the wait of the high task. */
+static int run_inversion(void)
+{
+	high_done = 0;
+
+	task_wake(TASK_ID_LOW);
+	msleep(1);
+	if (!low_locked)
+		return -1;
+
+	task_wake(TASK_ID_MED);
+	task_wake(TASK_ID_HIGH);
+	while (!high_done)
+		msleep(1);
+
+	/* Let the medium task finish before the next run. */
+	msleep(HOG_US / MSEC);
+
+	return high_wait_us;
+}
+
+static int test_plain_mutex(void)
+{
+	int wait;
+
+	use_i2c = 0;
+	wait = run_inversion();
+	ccprintf("plain mutex: high task waited %d us\n", wait);
+
+	/* Without inheritance, the high task waits for the medium one. */
+	TEST_GE(wait, HOG_US, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_i2c_port_lock(void)
+{
+	int i, wait, worst = 0;
+
+	use_i2c = 1;
+	for (i = 0; i < ITERATIONS; i++) {
+		wait = run_inversion();
+		TEST_GE(wait, 0, "%d");
+		worst = MAX(worst, wait);
+	}
+	ccprintf("i2c port lock: worst-case high task wait %d us\n", worst);
+
+	/* The wait is bounded by the time the low task holds the bus. */
+	TEST_LT(worst, HOG_US / 4, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_plain_mutex);
+	RUN_TEST(test_i2c_port_lock);
+
+	test_print_result();
+}
@@ -6,6 +6,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <time.h>
 
 #include "common.h"
 #include "printf.h"
@@ -177,11 +178,24 @@ test_static int test_vsnprintf_int(void)
 	T(expect_success("123",        "%u",    123));
 	T(expect_success("4294967295", "%u",   -1));
 	T(expect_success("18446744073709551615", "%llu", (uint64_t)-1));
+	T(expect_success("4294967296", "%llu", 1ULL << 32));
+	T(expect_success("1000000000000000000", "%llu", 1000000000000000000ULL));
+	T(expect_success("-9223372036854775808", "%lld", INT64_MIN));
+	T(expect_success("-2147483648", "%d",   INT32_MIN));
+	T(expect_success("99",         "%d",    99));
+	T(expect_success("100",        "%d",    100));
+
+	T(expect_success("0.",        "%.0d",    0));
+	T(expect_success("1.000000000", "%.9d",  1000000000));
+	T(expect_success("0.0000000001", "%.10d", 1));
+	T(expect_success("12345678901.234567890", "%.9llu",
+			 12345678901234567890ULL));
 
 	T(expect_success("0",         "%x",     0));
 	T(expect_success("0",         "%X",     0));
 	T(expect_success("5e",        "%x",     0X5E));
 	T(expect_success("5E",        "%X",     0X5E));
+	T(expect_success("FEDCBA9876543210", "%llX", 0xfedcba9876543210ULL));
 
 	/*
 	 * %l is deprecated on 32-bit systems (see crbug.com/984041), but is
@@ -277,6 +291,8 @@ test_static int test_vsnprintf_timestamps(void)
 	T(expect_success("0.123456",       "%pT",      &ts));
 	ts = 9999999000000;
 	T(expect_success("9999999.000000", "%pT",      &ts));
+	ts = 18446744073709551615ULL;
+	T(expect_success("18446744073709.551615", "%pT", &ts));
 	return EC_SUCCESS;
 }
 
@@ -297,6 +313,172 @@ test_static int test_vsnprintf_combined(void)
 	return EC_SUCCESS;
 }
 
+/* Lines like those of the console, and the output they take */
+static const struct {
+	const char *format;
+	const char *expect;
+} bench_lines[] = {
+	{ "[%pT C%d: %s 0x%04x]\n", "[1234.567890 C1: SNK_READY 0x1b2c]\n" },
+	{ "%s: %d mV %d mA %d%%\n", "charger: 13200 mV -1500 mA 87%\n" },
+	{ "%lld %llu %ph\n", "-1099511627776 18446744073709551615 005e\n" },
+};
+
+static int bench_print(char *buf, int size, int line)
+{
+	const char bytes[] = {0x00, 0x5E};
+	uint64_t ts = 1234567890;
+
+	switch (line) {
+	case 0:
+		return snprintf(buf, size, bench_lines[0].format, &ts, 1,
+				"SNK_READY", 0x1b2c);
+	case 1:
+		return snprintf(buf, size, bench_lines[1].format, "charger",
+				13200, -1500, 87);
+	default:
+		return snprintf(buf, size, bench_lines[2].format,
+				-(1LL << 40), (uint64_t)-1, HEX_BUF(bytes, 2));
+	}
+}
+
+/* Context for the vfnprintf() output, a character at a time */
+struct addchar_context {
+	char *str;
+	int size;
+};
+
+static int addchar(void *context, int c)
+{
+	struct addchar_context *ctx = context;
+
+	if (!ctx->size)
+		return 1;
+	*ctx->str++ = c;
+	ctx->size--;
+	return 0;
+}
+
+static int addchar_print(char *buf, int size, const char *format, ...)
+{
+	struct addchar_context ctx = { buf, size - 1 };
+	va_list args;
+	int rv;
+
+	va_start(args, format);
+	rv = vfnprintf(addchar, &ctx, format, args);
+	va_end(args);
+	*ctx.str = '\0';
+
+	return rv;
+}
+
+test_static int test_vfnprintf_addchar(void)
+{
+	char buf[16];
+
+	/* Without a run of characters at once, the output is the same */
+	TEST_EQ(addchar_print(output, sizeof(output), "abc %d|%-4s|%.3d %%",
+			      42, "x", 1234), EC_SUCCESS, "%d");
+	TEST_ASSERT(!strncmp(output, "abc 42|x   |1.234 %", sizeof(output)));
+
+	/* The output stops where the space runs out */
+	TEST_EQ(addchar_print(buf, sizeof(buf), "0123456789%s", "abcdefghij"),
+		EC_ERROR_OVERFLOW, "%d");
+	TEST_ASSERT(!strncmp(buf, "0123456789abcde", sizeof(buf)));
+	TEST_EQ(snprintf(buf, sizeof(buf), "0123456789%s", "abcdefghij"),
+		-EC_ERROR_OVERFLOW, "%d");
+	TEST_ASSERT(!strncmp(buf, "0123456789abcde", sizeof(buf)));
+
+	return EC_SUCCESS;
+}
+
+/* Context for the vfnprintf_str() output, counting the runs */
+struct addstr_context {
+	struct addchar_context out;
+	int runs;
+};
+
+static int addstr(void *context, const char *str, int len)
+{
+	struct addstr_context *ctx = context;
+
+	ctx->runs++;
+	for (; len > 0; len--)
+		if (addchar(&ctx->out, *str++))
+			return 1;
+	return 0;
+}
+
+static int addstr_print(struct addstr_context *ctx, const char *format, ...)
+{
+	va_list args;
+	int rv;
+
+	va_start(args, format);
+	rv = vfnprintf_str(addchar, addstr, ctx, format, args);
+	va_end(args);
+
+	return rv;
+}
+
+test_static int test_vfnprintf_str(void)
+{
+	char buf[16];
+	struct addstr_context ctx = { { output, sizeof(output) - 1 } };
+
+	/* Literal text and each field are sent as one run */
+	TEST_EQ(addstr_print(&ctx, "abc %d|%s|%.3d", 12345, "xyz", 1234),
+		EC_SUCCESS, "%d");
+	*ctx.out.str = '\0';
+	TEST_ASSERT(!strncmp(output, "abc 12345|xyz|1.234", sizeof(output)));
+	TEST_LE(ctx.runs, 9, "%d");
+
+	/* The output stops at the run which does not fit */
+	ctx.out.str = buf;
+	ctx.out.size = sizeof(buf) - 1;
+	TEST_EQ(addstr_print(&ctx, "0123456789%s", "abcdefghij"),
+		EC_ERROR_OVERFLOW, "%d");
+	*ctx.out.str = '\0';
+	TEST_ASSERT(!strncmp(buf, "0123456789abcde", sizeof(buf)));
+
+	return EC_SUCCESS;
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Microbenchmark of the formatting, in host CPU time. Only the output is
+ * checked, the time depends on the machine running the test.
+ */
+test_static int test_vsnprintf_benchmark(void)
+{
+	const int count = 100000;
+	uint64_t start;
+	int line, i;
+
+	for (line = 0; line < ARRAY_SIZE(bench_lines); line++) {
+		TEST_EQ(bench_print(output, sizeof(output), line),
+			(int)strlen(bench_lines[line].expect), "%d");
+		TEST_ASSERT(!strncmp(output, bench_lines[line].expect,
+				     sizeof(output)));
+
+		start = thread_cpu_ns();
+		for (i = 0; i < count; i++)
+			bench_print(output, sizeof(output), line);
+		ccprintf("line %d: %d ns\n", line,
+			 (int)((thread_cpu_ns() - start) / count));
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -309,6 +491,9 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_vsnprintf_timestamps);
 	RUN_TEST(test_vsnprintf_hexdump);
 	RUN_TEST(test_vsnprintf_combined);
+	RUN_TEST(test_vfnprintf_addchar);
+	RUN_TEST(test_vfnprintf_str);
+	RUN_TEST(test_vsnprintf_benchmark);
 
 	test_print_result();
 }
@@ -0,0 +1,166 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common.h"
+#include "motion_sense.h"
+#include "stream_stats.h"
+#include "test_util.h"
+#include <stdio.h>
+
+/*
+ * Need to define motion sensor globals just to compile.
+ * We include motion task to force the inclusion of math_util.c
+ */
+struct motion_sensor_t motion_sensors[] = {};
+const unsigned int motion_sensor_count = ARRAY_SIZE(motion_sensors);
+
+#define WINDOW_CAPACITY 8
+
+static int test_stats_empty(void)
+{
+	struct stream_stats s;
+
+	stream_stats_reset(&s, 1.5f);
+
+	TEST_EQ(s.count, 0, "%u");
+	TEST_NEAR(stream_stats_mean(&s), 1.5f, 0.000001f, "%f");
+	TEST_NEAR(stream_stats_variance(&s), 0.0f, 0.000001f, "%f");
+	TEST_NEAR(stream_stats_sample_variance(&s), 0.0f, 0.000001f, "%f");
+
+	return EC_SUCCESS;
+}
+
+static int test_stats_mean_variance(void)
+{
+	const float data[] = { 2.0f, 4.0f, 4.0f, 4.0f, 5.0f, 5.0f, 7.0f, 9.0f };
+	struct stream_stats s;
+	int i;
+
+	stream_stats_reset(&s, data[0]);
+	for (i = 0; i < ARRAY_SIZE(data); ++i)
+		stream_stats_update(&s, data[i]);
+
+	TEST_EQ(s.count, (uint32_t)ARRAY_SIZE(data), "%u");
+	TEST_NEAR(stream_stats_mean(&s), 5.0f, 0.000001f, "%f");
+	TEST_NEAR(stream_stats_variance(&s), 4.0f, 0.000001f, "%f");
+	TEST_NEAR(stream_stats_sample_variance(&s), 32.0f / 7.0f, 0.000001f,
+		  "%f");
+
+	return EC_SUCCESS;
+}
+
+static int test_stats_shift_invariant(void)
+{
+	struct stream_stats shifted, raw;
+	int i;
+
+	stream_stats_reset(&shifted, 1000.0f);
+	stream_stats_reset(&raw, 0.0f);
+	for (i = 0; i < 10; ++i) {
+		stream_stats_update(&shifted, 1000.0f + i * 0.01f);
+		stream_stats_update(&raw, 1000.0f + i * 0.01f);
+	}
+
+	/* The shifted accumulator keeps the precision of the small deltas. */
+	TEST_NEAR(stream_stats_mean(&shifted), 1000.045f, 0.0001f, "%f");
+	TEST_NEAR(stream_stats_variance(&shifted), 0.000825f, 0.000001f, "%f");
+	TEST_NEAR(stream_stats_mean(&raw), 1000.045f, 0.001f, "%f");
+
+	return EC_SUCCESS;
+}
+
+static uint64_t brute_force_variance(const int *data, int count, int size)
+{
+	int64_t sum = 0, sum_sq = 0;
+	int i;
+
+	for (i = count - size; i < count; ++i) {
+		sum += data[i];
+		sum_sq += (int64_t)data[i] * data[i];
+	}
+	return (size * sum_sq - sum * sum) / size / size;
+}
+
+static int test_window_variance(void)
+{
+	const int data[] = { 10, -3, 7, 250, -1000, 42, 42, 42,
+			     17, 0, -5, 300, 12, 1, 8, -60 };
+	int16_t history[WINDOW_CAPACITY];
+	struct stream_window w;
+	int i;
+
+	stream_window_init(&w, history, WINDOW_CAPACITY);
+	TEST_EQ(stream_window_reset(&w, 4), 4, "%d");
+
+	for (i = 0; i < ARRAY_SIZE(data); ++i) {
+		stream_window_update(&w, data[i]);
+		TEST_EQ(stream_window_full(&w), i >= 3, "%d");
+		if (!stream_window_full(&w))
+			continue;
+		TEST_ASSERT(stream_window_variance(&w) ==
+			    brute_force_variance(data, i + 1, 4));
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_window_resize(void)
+{
+	int16_t history[WINDOW_CAPACITY];
+	struct stream_window w;
+	int i;
+
+	stream_window_init(&w, history, WINDOW_CAPACITY);
+	TEST_EQ(w.size, WINDOW_CAPACITY, "%u");
+
+	TEST_EQ(stream_window_reset(&w, 0), 1, "%d");
+	TEST_EQ(stream_window_reset(&w, WINDOW_CAPACITY + 1), WINDOW_CAPACITY,
+		"%d");
+
+	for (i = 0; i < WINDOW_CAPACITY; ++i)
+		stream_window_update(&w, i & 1 ? 100 : -100);
+	TEST_ASSERT(stream_window_full(&w));
+	TEST_ASSERT(stream_window_variance(&w) == 10000);
+
+	/* Resetting drops all the history. */
+	stream_window_reset(&w, 2);
+	TEST_ASSERT(!stream_window_full(&w));
+	TEST_EQ(w.sum, 0, "%d");
+	TEST_ASSERT(w.n2_variance == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_window_saturates(void)
+{
+	int16_t history[WINDOW_CAPACITY];
+	struct stream_window w;
+
+	stream_window_init(&w, history, WINDOW_CAPACITY);
+	stream_window_reset(&w, 2);
+
+	stream_window_update(&w, 100000);
+	stream_window_update(&w, -100000);
+
+	TEST_EQ(history[0], INT16_MAX, "%d");
+	TEST_EQ(history[1], INT16_MIN, "%d");
+	TEST_EQ(w.sum, -1, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_stats_empty);
+	RUN_TEST(test_stats_mean_variance);
+	RUN_TEST(test_stats_shift_invariant);
+	RUN_TEST(test_window_variance);
+	RUN_TEST(test_window_resize);
+	RUN_TEST(test_window_saturates);
+
+	test_print_result();
+}
@@ -49,6 +49,19 @@
 #define CONFIG_MALLOC
 #endif
 
+#ifdef TEST_CONSOLE_READ
+#define CONFIG_CONSOLE_ENABLE_READ_V2
+/* Keep the host commands of the test out of the console output */
+#undef CONFIG_HOSTCMD_DEBUG_MODE
+#define CONFIG_HOSTCMD_DEBUG_MODE HCDEBUG_OFF
+#define CONFIG_MKBP_EVENT
+#define CONFIG_MKBP_USE_GPIO
+#endif
+
+#ifdef TEST_CONSOLE_TOKENIZED
+#define CONFIG_CONSOLE_TOKENIZED
+#endif
+
 #ifdef TEST_KB_8042
 #define CONFIG_KEYBOARD_PROTOCOL_8042
 #endif
@@ -81,6 +94,13 @@
 #define CONFIG_MKBP_USE_GPIO
 #endif
 
+#ifdef TEST_STREAM_STATS
+#define CONFIG_FPU
+#define CONFIG_ONLINE_CALIB
+#define CONFIG_MKBP_EVENT
+#define CONFIG_MKBP_USE_GPIO
+#endif
+
 #ifdef TEST_FLOAT
 #define CONFIG_FPU
 #define CONFIG_MAG_CALIBRATE
@@ -99,12 +119,50 @@
 #define CONFIG_SHA256
 #endif
 
+#if defined(TEST_FPSENSOR) || defined(TEST_FPSENSOR_FRAME_CODEC)
+#define CONFIG_FP_FRAME_COMPRESSION
+#endif
+
+#ifdef TEST_FPSENSOR
+/* Room for a frame to fetch with EC_CMD_FP_FRAME */
+#define FP_SENSOR_IMAGE_SIZE (64 * 64)
+#endif
+
+#ifdef TEST_ALS_THRESHOLD
+enum sensor_id {
+	LIGHT,
+	ALS_OPT3001,
+	SENSOR_COUNT,
+};
+
+#define CONFIG_ACCEL_FORCE_MODE_MASK BIT(LIGHT)
+#define CONFIG_ACCEL_INTERRUPTS
+#define CONFIG_ALS_OPT3001
+#define CONFIG_ALS_OPT3001_INT_EVENT \
+	TASK_EVENT_MOTION_SENSOR_INTERRUPT(ALS_OPT3001)
+#endif
+
+#ifdef TEST_MOTION_READ_PLAN
+enum sensor_id {
+	ACCEL,
+	GYRO,
+	SENSOR_COUNT,
+};
+
+#define CONFIG_ACCEL_FORCE_MODE_MASK (BIT(ACCEL) | BIT(GYRO))
+#define CONFIG_ACCEL_READ_PLAN
+#endif
+
 #ifdef TEST_MOTION_SENSE_FIFO
 #define CONFIG_ACCEL_FIFO
 #define CONFIG_ACCEL_FIFO_SIZE 256
 #define CONFIG_ACCEL_FIFO_THRES 10
 #endif
 
+#ifdef TEST_MUTEX_INVERSION
+#define CONFIG_TASK_PRIORITY_INHERITANCE
+#endif
+
 #ifdef TEST_KASA
 #define CONFIG_FPU
 #define CONFIG_ONLINE_CALIB
@@ -167,6 +225,7 @@
 	defined(TEST_MOTION_ANGLE) || \
 	defined(TEST_MOTION_ANGLE_TABLET) || \
 	defined(TEST_MOTION_LID) || \
+	defined(TEST_MOTION_REPLAY) || \
 	defined(TEST_MOTION_SENSE_FIFO)
 enum sensor_id {
 	BASE,
@@ -196,6 +255,23 @@ enum sensor_id {
 	 (1 << CONFIG_LID_ANGLE_SENSOR_LID))
 #endif
 
+#if defined(TEST_MOTION_LID)
+#define CONFIG_LID_ANGLE_GATE_MG 10
+#endif
+
+#if defined(TEST_MOTION_REPLAY)
+#define CONFIG_ACCEL_FORCE_MODE_MASK \
+	((1 << CONFIG_LID_ANGLE_SENSOR_BASE) | \
+	 (1 << CONFIG_LID_ANGLE_SENSOR_LID))
+#define CONFIG_ACCEL_FIFO
+#define CONFIG_ACCEL_FIFO_SIZE 256
+#define CONFIG_ACCEL_FIFO_THRES 10
+#define CONFIG_FPU
+#define CONFIG_ONLINE_CALIB
+#define CONFIG_MKBP_EVENT
+#define CONFIG_MKBP_USE_GPIO
+#endif
+
 #if defined(TEST_BODY_DETECTION)
 #define CONFIG_BODY_DETECTION
 #define CONFIG_BODY_DETECTION_SENSOR BASE
@@ -323,6 +399,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_ALS_LIGHTBAR_DIMMING 0
 #endif
 
+#ifdef TEST_UART_OUTPUT
+#define CONFIG_UART_STATS
+#endif
+
 #ifdef TEST_USB_COMMON
 #define CONFIG_USB_POWER_DELIVERY
 #define CONFIG_USB_PD_TCPMV1
@@ -333,6 +413,13 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_SW_CRC
 #endif
 
+#ifdef TEST_USB_PD_DISC_CACHE
+#define CONFIG_TEST_USB_PD_DISC_CACHE
+#define CONFIG_USB_PD_DISCOVERY_CACHE
+#define CONFIG_USB_PD_DECODE_SOP
+#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+#endif
+
 #if defined(TEST_USB_SM_FRAMEWORK_H3) || \
 	defined(TEST_USB_SM_FRAMEWORK_H2) || \
 	defined(TEST_USB_SM_FRAMEWORK_H1) || \
@@ -456,13 +543,13 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_CTVPD
 #endif
 
-#ifdef TEST_USB_TYPEC_DRP_ACC_TRYSRC
+#if defined(TEST_USB_TYPEC_DRP_ACC_TRYSRC) || \
+	defined(TEST_USB_TYPEC_DRP_ACC_TRYSRC_SINGLE)
 #define CONFIG_USB_DRP_ACC_TRYSRC
 #define CONFIG_USB_PD_DUAL_ROLE
 #define CONFIG_USB_PD_TRY_SRC
 #define CONFIG_USB_TYPEC_SM
 #define CONFIG_USB_PD_TCPMV2
-#define CONFIG_USB_PD_PORT_MAX_COUNT 1
 #define CONFIG_USBC_SS_MUX
 #define CONFIG_USB_PD_DUAL_ROLE_AUTO_TOGGLE
 #define CONFIG_USB_PD_VBUS_DETECT_TCPC
@@ -470,6 +557,12 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #undef CONFIG_USB_PRL_SM
 #undef CONFIG_USB_PE_SM
 #undef CONFIG_USB_PD_HOST_CMD
+#ifdef TEST_USB_TYPEC_DRP_ACC_TRYSRC_SINGLE
+#define CONFIG_USB_PD_SINGLE_TASK
+#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+#else
+#define CONFIG_USB_PD_PORT_MAX_COUNT 1
+#endif
 #endif
 
 #ifdef TEST_USB_TCPMV2_COMPLIANCE
@@ -491,17 +584,50 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_PID 0x5036
 #define PD_VCONN_SWAP_DELAY 5000 /* us */
 #define CONFIG_USB_PD_TCPM_TCPCI
+#define CONFIG_USB_POWER_DELIVERY
+#define CONFIG_USB_PD_TCPCI_RX_FAST_PATH
+#define CONFIG_USB_PD_DISCOVERY_CACHE
 #define CONFIG_I2C
 #define CONFIG_I2C_CONTROLLER
+#define CONFIG_I2C_REG_CACHE
 #define CONFIG_BATTERY
 #define CONFIG_NUM_FIXED_BATTERIES 1
 #define I2C_PORT_HOST_TCPC 0
 #define CONFIG_USB_PD_DEBUG_LEVEL 3
 #define CONFIG_USB_PD_EXTENDED_MESSAGES
+#define CONFIG_USB_SM_STATS
 #define CONFIG_USB_PD_DECODE_SOP
 #define CONFIG_USB_PD_3A_PORTS 0 /* Host does not define a 3.0 A PDO */
 #endif
 
+#if defined(TEST_USB_PD_BENCH) || defined(TEST_USB_PD_BENCH_SINGLE)
+#define CONFIG_USB_DRP_ACC_TRYSRC
+#define CONFIG_USB_PD_DUAL_ROLE
+#define CONFIG_USB_PD_DUAL_ROLE_AUTO_TOGGLE
+#define CONFIG_USB_PD_REV30
+#define CONFIG_USB_PD_TCPC_LOW_POWER
+#define CONFIG_USB_PD_TCPMV2
+#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+#define CONFIG_USBC_SS_MUX
+#define CONFIG_USB_PD_VBUS_DETECT_TCPC
+#define CONFIG_USB_POWER_DELIVERY
+#define CONFIG_USB_PD_ALT_MODE_DFP
+#define CONFIG_USB_PID 0x5036
+#define CONFIG_USB_PD_TCPM_TCPCI
+#define CONFIG_USB_POWER_DELIVERY
+#define CONFIG_USB_PD_TCPCI_RX_FAST_PATH
+#define CONFIG_USB_PD_DECODE_SOP
+#define CONFIG_I2C
+#define CONFIG_I2C_CONTROLLER
+#define I2C_PORT_HOST_TCPC 0
+#define CONFIG_USB_PD_3A_PORTS 0
+#define CONFIG_USB_MUX_VIRTUAL
+#define CONFIG_USB_MUX_AP_ACK_REQUEST
+#ifdef TEST_USB_PD_BENCH_SINGLE
+#define CONFIG_USB_PD_SINGLE_TASK
+#endif
+#endif
+
 #ifdef TEST_USB_PD_INT
 #define CONFIG_USB_POWER_DELIVERY
 #define CONFIG_USB_PD_TCPMV1
@@ -592,6 +718,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_CURVE25519
 #endif /* TEST_X25519 */
 
+#ifdef TEST_I2C_ASYNC
+#define CONFIG_I2C_ASYNC
+#endif
+
 #ifdef TEST_I2C_BITBANG
 #define CONFIG_I2C
 #define CONFIG_I2C_CONTROLLER
@@ -599,5 +729,37 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define I2C_BITBANG_PORT_COUNT 1
 #endif
 
+#ifdef TEST_I2C_EMUL
+enum sensor_id {
+	BASE_ACCEL,
+	BASE_GYRO,
+	SENSOR_COUNT,
+};
+
+#define CONFIG_ACCEL_FIFO
+#define CONFIG_ACCEL_FIFO_SIZE 256
+#define CONFIG_ACCEL_FIFO_THRES 10
+#define CONFIG_ACCEL_INTERRUPTS
+#define CONFIG_ACCELGYRO_BMI260
+#define CONFIG_ACCELGYRO_BMI260_INT_EVENT \
+	TASK_EVENT_MOTION_SENSOR_INTERRUPT(BASE_ACCEL)
+#define CONFIG_BATTERY_MOCK
+#define CONFIG_BATTERY_SMART
+#define CONFIG_CHARGER_INPUT_CURRENT 4032
+#define CONFIG_I2C
+#define CONFIG_I2C_CONTROLLER
+#define I2C_PORT_ACCEL 0
+#define I2C_PORT_BATTERY 0
+#define I2C_PORT_CHARGER 0
+#endif
+
+#ifdef TEST_I2C_REG_CACHE
+#define CONFIG_I2C_REG_CACHE
+#endif
+
+#ifdef TEST_I2C_STATS
+#define CONFIG_I2C_STATS
+#endif
+
 #endif  /* TEST_BUILD */
 #endif  /* __TEST_TEST_CONFIG_H */
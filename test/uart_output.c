@@ -0,0 +1,138 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test draining of the UART output buffer and its statistics.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "uart.h"
+#include "util.h"
+
+static char text[CONFIG_UART_TX_BUF_SIZE * 2];
+
+/* Run the uartstats command, and read one of its counters */
+static int read_stat(const char *name)
+{
+	const char *out;
+
+	test_capture_console(1);
+	UART_INJECT("uartstats\n");
+	msleep(100);
+	cflush();
+	test_capture_console(0);
+
+	out = strstr(test_get_captured_console(), name);
+	if (!out)
+		return -1;
+	return strtoi(out + strlen(name), NULL, 10);
+}
+
+static void reset_stats(void)
+{
+	UART_INJECT("uartstats reset\n");
+	msleep(100);
+	cflush();
+}
+
+static void fill_text(int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		text[i] = 'a' + i % 26;
+	text[len] = '\0';
+}
+
+test_static int test_wrap(void)
+{
+	const int len = 300;
+	const char *out;
+	int i;
+
+	fill_text(len);
+
+	/*
+	 * Hold the output in the buffer, so that it is drained in runs
+	 * across the end of the buffer.
+	 */
+	test_capture_console(1);
+	for (i = 0; i < 5; i++) {
+		interrupt_disable();
+		uart_put(text, len);
+		interrupt_enable();
+		cflush();
+	}
+	test_capture_console(0);
+
+	out = test_get_captured_console();
+	for (i = 0; i < 5; i++)
+		TEST_ASSERT_ARRAY_EQ(out + i * len, text, len);
+	TEST_EQ(out[5 * len], '\0', "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_printf(void)
+{
+	const int len = 100;
+	const char *out;
+	int rv_put, rv_printf;
+
+	fill_text(len);
+
+	/* The formatted runs go to the buffer with '\n' translated */
+	test_capture_console(1);
+	interrupt_disable();
+	rv_put = uart_put(text, 10);
+	rv_printf = uart_printf("\n%s|%d\n", text, -42);
+	interrupt_enable();
+	cflush();
+	test_capture_console(0);
+
+	TEST_EQ(rv_put, EC_SUCCESS, "%d");
+	TEST_EQ(rv_printf, EC_SUCCESS, "%d");
+	out = test_get_captured_console();
+	TEST_ASSERT_ARRAY_EQ(out, text, 10);
+	TEST_ASSERT_ARRAY_EQ(out + 10, "\r\n", 2);
+	TEST_ASSERT_ARRAY_EQ(out + 12, text, len);
+	TEST_ASSERT_ARRAY_EQ(out + 12 + len, "|-42\r\n", 7);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_dropped(void)
+{
+	const int len = sizeof(text) - 1;
+
+	fill_text(len);
+	reset_stats();
+
+	/* Nothing is sent while interrupts are off, so the buffer fills */
+	interrupt_disable();
+	TEST_EQ(uart_put(text, len), EC_ERROR_OVERFLOW, "%d");
+	interrupt_enable();
+	cflush();
+
+	/* Other tasks may have printed too */
+	TEST_GE(read_stat("Dropped: "), 1, "%d");
+	TEST_GE(read_stat("Written: "), CONFIG_UART_TX_BUF_SIZE - 1, "%d");
+	TEST_GT(read_stat("IRQ:     "), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_wrap);
+	RUN_TEST(test_printf);
+	RUN_TEST(test_dropped);
+
+	test_print_result();
+}
@@ -0,0 +1,624 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * USB PD benchmark: two TCPMv2 ports negotiating with each other.
+ *
+ * Both ports run the TCPCI driver against emulated TCPCs that are wired back
+ * to back: a message transmitted by one TCPC is received by the other one,
+ * and the CC and VBUS lines are shared. Each scenario plugs the ports
+ * together and reports the time to an explicit contract, the wakes of the PD
+ * tasks, the I2C traffic and the worst time a port took to respond to a
+ * request. The test fails when these go over budget.
+ */
+
+#include "common.h"
+#include "host_task.h"
+#include "i2c_emul_tcpci.h"
+#include "mock/usb_mux_mock.h"
+#include "task.h"
+#include "tcpm/tcpci.h"
+#include "test_util.h"
+#include "timer.h"
+#include "usb_common.h"
+#include "usb_mux.h"
+#include "usb_pd.h"
+#include "usb_pd_tcpm.h"
+#include "usb_pe_sm.h"
+#include "util.h"
+
+#define BENCH_TCPC_ADDR_FLAGS(port) (0x4e + (port))
+
+/* tReceiverResponse: time for a port to answer a request */
+#define T_RECEIVER_RESPONSE (15 * MSEC)
+
+/*
+ * Budgets, from plug to explicit contract. The first Source_Capabilities
+ * goes out after tCCDebounce and tFirstSourceCap; the contract then only
+ * waits for the messages and for the source to turn VBUS on.
+ *
+ * The ports take about 240 ms, 110 wakes and 320 I2C transfers, with one or
+ * two PD tasks; the budgets leave some margin for changes in the stack.
+ */
+#define BUDGET_CONTRACT (300 * MSEC)
+#define BUDGET_WAKES 150
+#define BUDGET_I2C_XFERS 380
+
+struct bench_tcpc {
+	struct i2c_emul_tcpci tcpci;
+
+	/* Toggling, and what the toggle resolved to */
+	bool looking;
+	enum tcpc_cc_pull drp_pull;
+
+	bool vbus_source;
+
+	/* Request received, while the response is pending */
+	uint64_t request_time;
+	uint16_t request;
+
+	/* Messages acknowledged by the partner, and not acknowledged */
+	int tx_msgs;
+	int tx_failed;
+	int hard_resets;
+	/* Worst time to respond to a request, and the request */
+	int worst_response;
+	uint16_t worst_request;
+};
+
+static struct bench_tcpc emul[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+/* The ports are plugged together */
+static bool plugged;
+static uint64_t plug_time;
+static uint64_t src_cap_time;
+static uint64_t ps_rdy_time;
+
+/* Enter safe mode when turning VBUS on, and when it was entered */
+static bool safe_mode_on_power;
+static uint64_t safe_mode_start;
+static uint64_t safe_mode_end;
+
+#define BENCH_TCPC_CONFIG(_port)					\
+	[_port] = {							\
+		.bus_type = EC_BUS_TYPE_I2C,				\
+		.i2c_info = {						\
+			.port = I2C_PORT_HOST_TCPC,			\
+			.addr_flags = BENCH_TCPC_ADDR_FLAGS(_port),	\
+		},							\
+		.drv = &tcpci_tcpm_drv,					\
+		.flags = TCPC_FLAGS_TCPCI_REV2_0 |			\
+			 TCPC_FLAGS_TCPCI_REV2_0_NO_VSAFE0V,		\
+	}
+
+const struct tcpc_config_t tcpc_config[CONFIG_USB_PD_PORT_MAX_COUNT] = {
+	BENCH_TCPC_CONFIG(0),
+	BENCH_TCPC_CONFIG(1),
+};
+
+/* The AP acknowledges the safe mode transitions of the first port */
+const struct usb_mux usb_muxes[CONFIG_USB_PD_PORT_MAX_COUNT] = {
+	[0] = {
+		.usb_port = 0,
+		.driver = &virtual_usb_mux_driver,
+		.hpd_update = &virtual_hpd_update,
+	},
+	[1] = {
+		.usb_port = 1,
+		.driver = &mock_usb_mux_driver,
+	},
+};
+
+/*****************************************************************************/
+/* Emulated TCPCs */
+
+static int port_of(struct i2c_emul_tcpci *t)
+{
+	return (struct bench_tcpc *)t - emul;
+}
+
+/* Register of the TCPC of a port */
+static uint8_t *reg_of(int port, int reg)
+{
+	return &emul[port].tcpci.map[reg];
+}
+
+uint16_t tcpc_get_alert_status(void)
+{
+	uint16_t status = 0;
+	int port;
+
+	for (port = 0; port < ARRAY_SIZE(emul); port++) {
+		struct i2c_emul_regs *r = &emul[port].tcpci.regs;
+
+		if (i2c_emul_regs_get16(r, TCPC_REG_ALERT) &
+		    i2c_emul_regs_get16(r, TCPC_REG_ALERT_MASK))
+			status |= PD_STATUS_TCPC_ALERT_0 << port;
+	}
+
+	return status;
+}
+
+/* Termination presented on CC1, the only CC wire of the cable */
+static enum tcpc_cc_pull get_pull(int port)
+{
+	struct bench_tcpc *t = &emul[port];
+	int role = *reg_of(port, TCPC_REG_ROLE_CTRL);
+
+	if (TCPC_REG_ROLE_CTRL_DRP(role))
+		return t->looking ? TYPEC_CC_OPEN : t->drp_pull;
+
+	return TCPC_REG_ROLE_CTRL_CC1(role);
+}
+
+static void resolve_toggle(int port)
+{
+	struct bench_tcpc *t = &emul[port];
+	struct bench_tcpc *partner = &emul[!port];
+	enum tcpc_cc_pull pull;
+
+	if (!t->looking || !plugged)
+		return;
+
+	/* Two toggling ports settle on the first one being the source */
+	if (TCPC_REG_ROLE_CTRL_DRP(*reg_of(!port, TCPC_REG_ROLE_CTRL)) &&
+	    partner->looking)
+		pull = port == 0 ? TYPEC_CC_RP : TYPEC_CC_RD;
+	else if (get_pull(!port) == TYPEC_CC_RD)
+		pull = TYPEC_CC_RP;
+	else if (get_pull(!port) == TYPEC_CC_RP)
+		pull = TYPEC_CC_RD;
+	else
+		return;
+
+	t->looking = false;
+	t->drp_pull = pull;
+}
+
+static void update_cc(int port)
+{
+	struct bench_tcpc *t = &emul[port];
+	enum tcpc_cc_pull pull, partner_pull;
+	int cc = 0;
+	int status;
+
+	resolve_toggle(port);
+	pull = get_pull(port);
+	partner_pull = get_pull(!port);
+
+	if (plugged && pull == TYPEC_CC_RP) {
+		if (partner_pull == TYPEC_CC_RD)
+			cc = 2;
+		else if (partner_pull == TYPEC_CC_RA)
+			cc = 1;
+	} else if (plugged && pull == TYPEC_CC_RD &&
+		   partner_pull == TYPEC_CC_RP) {
+		/* SNK.Default, SNK.Power1.5 or SNK.Power3.0 */
+		cc = TCPC_REG_ROLE_CTRL_RP(*reg_of(!port, TCPC_REG_ROLE_CTRL)) +
+		     1;
+	}
+
+	status = TCPC_REG_CC_STATUS_SET(pull == TYPEC_CC_RD, cc, 0);
+	if (t->looking)
+		status |= TCPC_REG_CC_STATUS_LOOK4CONNECTION_MASK;
+
+	i2c_emul_tcpci_set_status(&t->tcpci, TCPC_REG_CC_STATUS, status);
+}
+
+static void update_all_cc(void)
+{
+	/* Twice, for the second port to see how the first one resolved */
+	update_cc(0);
+	update_cc(1);
+	update_cc(0);
+}
+
+static void update_vbus(void)
+{
+	int port;
+
+	for (port = 0; port < ARRAY_SIZE(emul); port++) {
+		struct bench_tcpc *t = &emul[port];
+		bool present = t->vbus_source ||
+			       (plugged && emul[!port].vbus_source);
+		uint8_t status = *reg_of(port, TCPC_REG_POWER_STATUS);
+
+		if (present)
+			status |= TCPC_REG_POWER_STATUS_VBUS_PRES;
+		else
+			status &= ~TCPC_REG_POWER_STATUS_VBUS_PRES;
+
+		i2c_emul_tcpci_set_status(&t->tcpci, TCPC_REG_POWER_STATUS,
+					  status);
+	}
+}
+
+/* Messages a port must answer within tReceiverResponse */
+static bool is_request(uint16_t header, uint32_t vdm_header)
+{
+	int type = PD_HEADER_TYPE(header);
+
+	if (PD_HEADER_EXT(header))
+		return type == PD_EXT_GET_BATTERY_CAP ||
+		       type == PD_EXT_GET_BATTERY_STATUS ||
+		       type == PD_EXT_GET_MANUFACTURER_INFO;
+
+	if (PD_HEADER_CNT(header) == 0) {
+		switch (type) {
+		case PD_CTRL_GET_SOURCE_CAP:
+		case PD_CTRL_GET_SINK_CAP:
+		case PD_CTRL_DR_SWAP:
+		case PD_CTRL_PR_SWAP:
+		case PD_CTRL_VCONN_SWAP:
+		case PD_CTRL_SOFT_RESET:
+		case PD_CTRL_GET_SOURCE_CAP_EXT:
+		case PD_CTRL_GET_STATUS:
+		case PD_CTRL_GET_PPS_STATUS:
+		case PD_CTRL_GET_COUNTRY_CODES:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	if (type == PD_DATA_VENDOR_DEF)
+		return PD_VDO_SVDM(vdm_header) &&
+		       PD_VDO_CMDT(vdm_header) == CMDT_INIT;
+
+	return type == PD_DATA_SOURCE_CAP || type == PD_DATA_REQUEST;
+}
+
+/* Record the timing of a message the partner acknowledged */
+static void trace_msg(int port)
+{
+	struct bench_tcpc *t = &emul[port];
+	uint16_t header = UINT16_FROM_BYTE_ARRAY_LE(t->tcpci.tx, 1);
+	uint32_t vdm_header = UINT32_FROM_BYTE_ARRAY_LE(t->tcpci.tx, 3);
+	uint64_t now = get_time().val;
+
+	if (t->request_time) {
+		int response = now - t->request_time;
+
+		if (response > t->worst_response) {
+			t->worst_response = response;
+			t->worst_request = t->request;
+		}
+		t->request_time = 0;
+	}
+
+	if (is_request(header, vdm_header)) {
+		emul[!port].request_time = now;
+		emul[!port].request = header;
+	}
+
+	if (PD_HEADER_CNT(header) == 0 &&
+	    PD_HEADER_TYPE(header) == PD_CTRL_PS_RDY && !ps_rdy_time)
+		ps_rdy_time = now;
+	if (PD_HEADER_CNT(header) != 0 &&
+	    PD_HEADER_TYPE(header) == PD_DATA_SOURCE_CAP && !src_cap_time)
+		src_cap_time = now;
+}
+
+static void bench_alert(struct i2c_emul_tcpci *tcpci)
+{
+	schedule_deferred_pd_interrupt(port_of(tcpci));
+}
+
+static void bench_control(struct i2c_emul_tcpci *tcpci, int reg, uint8_t val)
+{
+	struct bench_tcpc *t = &emul[port_of(tcpci)];
+
+	if (reg == TCPC_REG_ROLE_CTRL) {
+		if (!TCPC_REG_ROLE_CTRL_DRP(val))
+			t->looking = false;
+	} else if (val == TCPC_REG_COMMAND_LOOK4CONNECTION &&
+		   TCPC_REG_ROLE_CTRL_DRP(tcpci->map[TCPC_REG_ROLE_CTRL])) {
+		t->looking = true;
+	} else {
+		return;
+	}
+
+	update_all_cc();
+}
+
+static void bench_transmit(struct i2c_emul_tcpci *tcpci, uint8_t transmit)
+{
+	int port = port_of(tcpci);
+	struct bench_tcpc *t = &emul[port];
+	struct bench_tcpc *partner = &emul[!port];
+	int type = TCPC_REG_TRANSMIT_TYPE(transmit);
+
+	if (type == TCPC_TX_HARD_RESET) {
+		t->hard_resets++;
+		if (plugged)
+			i2c_emul_tcpci_receive_hard_reset(&partner->tcpci);
+		i2c_emul_tcpci_alert(tcpci, TCPC_REG_ALERT_TX_COMPLETE);
+		return;
+	}
+
+	/*
+	 * Only SOP reaches the partner, there is no cable plug. The partner
+	 * receives the message before sending GoodCRC.
+	 */
+	if (!plugged || type != TCPC_TX_SOP ||
+	    i2c_emul_tcpci_receive(&partner->tcpci, type, &tcpci->tx[1],
+				   tcpci->tx[0])) {
+		t->tx_failed++;
+		i2c_emul_tcpci_alert(tcpci, TCPC_REG_ALERT_TX_FAILED);
+		return;
+	}
+
+	t->tx_msgs++;
+	trace_msg(port);
+
+	i2c_emul_tcpci_alert(tcpci, TCPC_REG_ALERT_TX_SUCCESS);
+}
+
+static const struct i2c_emul_tcpci_ops bench_tcpc_ops = {
+	.control = bench_control,
+	.transmit = bench_transmit,
+	.alert = bench_alert,
+};
+
+void test_init(void)
+{
+	int port;
+
+	/* The TCPCs must answer when the PD tasks start */
+	for (port = 0; port < ARRAY_SIZE(emul); port++) {
+		struct i2c_emul_tcpci *tcpci = &emul[port].tcpci;
+
+		i2c_emul_tcpci_init(tcpci, I2C_PORT_HOST_TCPC,
+				    BENCH_TCPC_ADDR_FLAGS(port),
+				    &bench_tcpc_ops);
+		i2c_emul_regs_set16(&tcpci->regs, TCPC_REG_VENDOR_ID,
+				    USB_VID_GOOGLE);
+		i2c_emul_register(&tcpci->regs.emul);
+	}
+	i2c_emul_set_bus_timing(I2C_PORT_HOST_TCPC, 1, 0);
+}
+
+/*****************************************************************************/
+/* Board */
+
+int pd_set_power_supply_ready(int port)
+{
+	if (safe_mode_on_power && port == 0) {
+		safe_mode_start = get_time().val;
+		usb_mux_set_safe_mode(port);
+		safe_mode_end = get_time().val;
+	}
+
+	emul[port].vbus_source = true;
+	update_vbus();
+	return EC_SUCCESS;
+}
+
+void pd_power_supply_reset(int port)
+{
+	emul[port].vbus_source = false;
+	update_vbus();
+}
+
+int pd_snk_is_vbus_provided(int port)
+{
+	return !!(*reg_of(port, TCPC_REG_POWER_STATUS) &
+		  TCPC_REG_POWER_STATUS_VBUS_PRES);
+}
+
+bool vboot_allow_usb_pd(void)
+{
+	return 1;
+}
+
+void board_reset_pd_mcu(void) {}
+
+/*****************************************************************************/
+/* Benchmark */
+
+struct bench_result {
+	/* Times from plug, in us */
+	int src_cap;
+	int contract;
+	/* Until both ports are in an explicit contract */
+	uint32_t wakes;
+	uint32_t i2c_xfers;
+	uint32_t i2c_bytes;
+	uint32_t i2c_bus_time;
+	int msgs;
+	/* Over both ports */
+	int worst_response;
+	uint16_t worst_request;
+	int tx_failed;
+	int hard_resets;
+};
+
+static uint32_t pd_task_wakes(void)
+{
+	uint32_t wakes = 0;
+
+	wakes += task_get_wake_count(TASK_ID_PD_C0);
+#ifdef HAS_TASK_PD_C1
+	wakes += task_get_wake_count(TASK_ID_PD_C1);
+#endif
+	wakes += task_get_wake_count(TASK_ID_PD_INT_C0);
+	wakes += task_get_wake_count(TASK_ID_PD_INT_C1);
+
+	return wakes;
+}
+
+static void set_plugged(bool plug)
+{
+	plugged = plug;
+	update_all_cc();
+	update_vbus();
+}
+
+static int bench_attach(enum pd_dual_role_states role0,
+			enum pd_dual_role_states role1,
+			struct bench_result *res)
+{
+	uint64_t deadline;
+	uint32_t wakes;
+	int port;
+
+	pd_set_dual_role(0, role0);
+	pd_set_dual_role(1, role1);
+	task_wait_event(SECOND);
+
+	for (port = 0; port < ARRAY_SIZE(emul); port++) {
+		struct bench_tcpc *t = &emul[port];
+
+		i2c_emul_reset_stats(&t->tcpci.regs.emul);
+		t->request_time = 0;
+		t->tx_msgs = 0;
+		t->tx_failed = 0;
+		t->hard_resets = 0;
+		t->worst_response = 0;
+	}
+	src_cap_time = 0;
+	ps_rdy_time = 0;
+	wakes = pd_task_wakes();
+
+	plug_time = get_time().val;
+	set_plugged(true);
+
+	deadline = plug_time + 2 * SECOND;
+	while (!pe_is_explicit_contract(0) || !pe_is_explicit_contract(1)) {
+		TEST_ASSERT(get_time().val < deadline);
+		task_wait_event(MSEC);
+	}
+
+	memset(res, 0, sizeof(*res));
+	res->src_cap = src_cap_time - plug_time;
+	res->contract = ps_rdy_time - plug_time;
+	res->wakes = pd_task_wakes() - wakes;
+	for (port = 0; port < ARRAY_SIZE(emul); port++) {
+		struct bench_tcpc *t = &emul[port];
+		struct i2c_emul_stats *stats = &t->tcpci.regs.emul.stats;
+
+		res->i2c_xfers += stats->xfers;
+		res->i2c_bytes += stats->bytes_out + stats->bytes_in;
+		res->i2c_bus_time += stats->bus_time_us;
+		res->msgs += t->tx_msgs;
+		res->tx_failed += t->tx_failed;
+		res->hard_resets += t->hard_resets;
+		if (t->worst_response > res->worst_response) {
+			res->worst_response = t->worst_response;
+			res->worst_request = t->worst_request;
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+static int bench_detach(void)
+{
+	set_plugged(false);
+	task_wait_event(SECOND);
+
+	TEST_ASSERT(!pd_is_connected(0));
+	TEST_ASSERT(!pd_is_connected(1));
+
+	return EC_SUCCESS;
+}
+
+static int bench_run(const char *name, enum pd_dual_role_states role0,
+		     enum pd_dual_role_states role1)
+{
+	struct bench_result res;
+
+	TEST_EQ(bench_attach(role0, role1, &res), EC_SUCCESS, "%d");
+
+	ccprintf("%s: Source_Capabilities %d ms, contract %d ms, %d msgs\n",
+		 name, res.src_cap / MSEC, res.contract / MSEC, res.msgs);
+	ccprintf("%s: %u PD task wakes, %u I2C xfers (%u bytes, %u us)\n",
+		 name, res.wakes, res.i2c_xfers, res.i2c_bytes,
+		 res.i2c_bus_time);
+	ccprintf("%s: worst response %d us, to header 0x%04x\n",
+		 name, res.worst_response, res.worst_request);
+
+	TEST_EQ(res.hard_resets, 0, "%d");
+	TEST_EQ(res.tx_failed, 0, "%d");
+	TEST_LE(res.worst_response, T_RECEIVER_RESPONSE, "%d");
+	TEST_LE(res.contract, BUDGET_CONTRACT, "%d");
+	TEST_LE(res.wakes, BUDGET_WAKES, "%u");
+	TEST_LE(res.i2c_xfers, BUDGET_I2C_XFERS, "%u");
+
+	TEST_EQ(bench_detach(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_src_snk(void)
+{
+	return bench_run("src-snk", PD_DRP_FORCE_SOURCE, PD_DRP_FORCE_SINK);
+}
+
+static int test_snk_src(void)
+{
+	return bench_run("snk-src", PD_DRP_FORCE_SINK, PD_DRP_FORCE_SOURCE);
+}
+
+static int test_drp_drp(void)
+{
+	return bench_run("drp-drp", PD_DRP_TOGGLE_ON, PD_DRP_TOGGLE_ON);
+}
+
+static int test_mux_ack(void)
+{
+	struct ec_params_usb_pd_mux_ack ack = { .port = 0 };
+	uint64_t deadline;
+	int wait;
+
+	safe_mode_on_power = true;
+	safe_mode_start = 0;
+	safe_mode_end = 0;
+	pd_set_dual_role(0, PD_DRP_FORCE_SOURCE);
+	pd_set_dual_role(1, PD_DRP_FORCE_SINK);
+	task_wait_event(SECOND);
+
+	set_plugged(true);
+
+	/* The PD task waits for the AP in safe mode */
+	deadline = get_time().val + 2 * SECOND;
+	while (!safe_mode_start) {
+		TEST_ASSERT(get_time().val < deadline);
+		task_wait_event(MSEC);
+	}
+	TEST_EQ(test_send_host_command(EC_CMD_USB_PD_MUX_ACK, 0, &ack,
+				       sizeof(ack), NULL, 0),
+		EC_RES_SUCCESS, "%d");
+
+	while (!pe_is_explicit_contract(0) || !pe_is_explicit_contract(1)) {
+		TEST_ASSERT(get_time().val < deadline);
+		task_wait_event(MSEC);
+	}
+	safe_mode_on_power = false;
+
+	/* The ack ended the wait, rather than its 100 ms timeout */
+	TEST_ASSERT(safe_mode_end);
+	wait = safe_mode_end - safe_mode_start;
+	ccprintf("mux-ack: safe mode entered in %d us\n", wait);
+	TEST_LT(wait, 50 * MSEC, "%d");
+
+	/* Leaving safe mode on detach is not acknowledged */
+	TEST_EQ(bench_detach(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	/* Events sent before the PD tasks start are lost */
+	task_wait_event(SECOND);
+
+	RUN_TEST(test_src_snk);
+	RUN_TEST(test_snk_src);
+	RUN_TEST(test_drp_drp);
+	RUN_TEST(test_mux_ack);
+
+	test_print_result();
+}
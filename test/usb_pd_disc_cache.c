@@ -0,0 +1,267 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test USB PD discovery cache.
+ */
+#include "common.h"
+#include "test_util.h"
+#include "usb_pd.h"
+#include "usb_pd_disc_cache.h"
+#include "util.h"
+
+#define PORT0 0
+#define PORT1 1
+
+#define DOCK_VID 0x18d1
+#define DOCK_PID 0x5040
+
+static struct pd_discovery disc;
+
+/* Discover the identity of a partner, as dfp_consume_identity() does */
+static void discover_identity(uint16_t vid, uint16_t pid, uint16_t bcd)
+{
+	memset(&disc, 0, sizeof(disc));
+	disc.identity.idh.usb_vendor_id = vid;
+	disc.identity.idh.modal_support = 1;
+	disc.identity.cert.xid = 0x1234;
+	disc.identity.product.product_id = pid;
+	disc.identity.product.bcd_device = bcd;
+	disc.identity_cnt = 3;
+	disc.identity_discovery = PD_DISC_COMPLETE;
+}
+
+/* Discover the SVIDs and modes of a partner into d */
+static void discover_modes(struct pd_discovery *d, int svid_cnt,
+			   uint32_t mode_vdo)
+{
+	int i;
+
+	for (i = 0; i < svid_cnt; i++) {
+		d->svids[i].svid = USB_SID_DISPLAYPORT + i;
+		d->svids[i].mode_cnt = 1;
+		d->svids[i].mode_vdo[0] = mode_vdo;
+		d->svids[i].discovery = PD_DISC_COMPLETE;
+	}
+	d->svid_cnt = svid_cnt;
+	d->svid_idx = svid_cnt;
+	d->svids_discovery = PD_DISC_COMPLETE;
+}
+
+/* Connect a partner, which is stored on a miss */
+static int connect(int port, uint16_t vid, uint16_t pid)
+{
+	discover_identity(vid, pid, 0x0100);
+	if (pd_disc_cache_restore(port, TCPC_TX_SOP, &disc))
+		return true;
+
+	discover_modes(&disc, 1, 0x000c0045);
+	pd_disc_cache_update(port, TCPC_TX_SOP, &disc);
+	return false;
+}
+
+static int test_miss_then_hit(void)
+{
+	struct pd_disc_cache_stats stats;
+
+	discover_identity(DOCK_VID, DOCK_PID, 0x0100);
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(pd_disc_cache_is_pending(PORT0, TCPC_TX_SOP));
+
+	discover_modes(&disc, 2, 0x000c0045);
+	TEST_ASSERT(!pd_disc_cache_update(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(!pd_disc_cache_is_pending(PORT0, TCPC_TX_SOP));
+
+	/* Reconnect: the SVIDs and modes come back with the identity */
+	pd_disc_cache_init_port(PORT0);
+	discover_identity(DOCK_VID, DOCK_PID, 0x0100);
+	TEST_ASSERT(pd_disc_cache_restore(PORT0, TCPC_TX_SOP, &disc));
+	TEST_EQ(disc.svids_discovery, PD_DISC_COMPLETE, "%d");
+	TEST_EQ(disc.svid_cnt, 2, "%d");
+	TEST_EQ(disc.svid_idx, 2, "%d");
+	TEST_EQ(disc.svids[0].svid, USB_SID_DISPLAYPORT, "0x%x");
+	TEST_EQ(disc.svids[1].mode_vdo[0], 0x000c0045, "0x%x");
+	TEST_EQ(disc.svids[1].discovery, PD_DISC_COMPLETE, "%d");
+
+	/* The partner of another port is not affected */
+	TEST_ASSERT(!pd_disc_cache_is_pending(PORT1, TCPC_TX_SOP));
+
+	pd_disc_cache_get_stats(&stats);
+	TEST_EQ(stats.hits, 1, "%d");
+	TEST_EQ(stats.misses, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_key(void)
+{
+	TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID));
+
+	/* A firmware update changes bcdDevice */
+	discover_identity(DOCK_VID, DOCK_PID, 0x0200);
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP, &disc));
+
+	/* The cable plug of the same product is a different entry */
+	discover_identity(DOCK_VID, DOCK_PID, 0x0100);
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP_PRIME, &disc));
+
+	/* Partners without a VID or a Product VDO are not cached */
+	discover_identity(0, DOCK_PID, 0x0100);
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(!pd_disc_cache_is_pending(PORT0, TCPC_TX_SOP));
+
+	discover_identity(DOCK_VID, DOCK_PID, 0x0100);
+	disc.identity_cnt = 2;
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(!pd_disc_cache_is_pending(PORT0, TCPC_TX_SOP));
+
+	return EC_SUCCESS;
+}
+
+static int test_lru_eviction(void)
+{
+	struct pd_disc_cache_stats stats;
+	int i;
+
+	for (i = 0; i < CONFIG_USB_PD_DISCOVERY_CACHE_SIZE; i++)
+		TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID + i));
+
+	/* Use the oldest entry, so the second one is the least recent */
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID + i));
+
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID + 1));
+
+	pd_disc_cache_get_stats(&stats);
+	TEST_EQ(stats.evictions, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_revalidate(void)
+{
+	struct pd_disc_cache_stats stats;
+	struct pd_discovery *reval;
+
+	TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+
+	/* Nothing is stored until the restored data is revalidated */
+	TEST_ASSERT(pd_disc_cache_is_pending(PORT0, TCPC_TX_SOP));
+	TEST_ASSERT(!pd_disc_cache_update(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(!pd_disc_cache_is_revalidating(PORT0, TCPC_TX_SOP));
+	TEST_ASSERT(!pd_disc_cache_get_revalidation(PORT0, TCPC_TX_SOP));
+
+	TEST_ASSERT(pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(pd_disc_cache_is_revalidating(PORT0, TCPC_TX_SOP));
+	TEST_ASSERT(!pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP, &disc));
+
+	/* Discovery runs again on a copy with the same identity */
+	reval = pd_disc_cache_get_revalidation(PORT0, TCPC_TX_SOP);
+	TEST_ASSERT(reval && reval != &disc);
+	TEST_EQ(reval->identity.idh.usb_vendor_id, DOCK_VID, "0x%x");
+	TEST_EQ(reval->svids_discovery, PD_DISC_NEEDED, "%d");
+	TEST_EQ(reval->svid_cnt, 0, "%d");
+	TEST_EQ(reval->svids[0].discovery, PD_DISC_NEEDED, "%d");
+
+	/* The restored modes stay readable meanwhile */
+	TEST_EQ(disc.svids_discovery, PD_DISC_COMPLETE, "%d");
+	TEST_EQ(disc.svid_cnt, 1, "%d");
+	TEST_EQ(disc.svids[0].mode_vdo[0], 0x000c0045, "0x%x");
+
+	/* The partner answers as cached */
+	discover_modes(reval, 1, 0x000c0045);
+	TEST_ASSERT(!pd_disc_cache_update(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(!pd_disc_cache_is_pending(PORT0, TCPC_TX_SOP));
+	TEST_EQ(disc.svids[0].mode_vdo[0], 0x000c0045, "0x%x");
+
+	/* The partner now has different modes, which replace the restored */
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP, &disc));
+	reval = pd_disc_cache_get_revalidation(PORT0, TCPC_TX_SOP);
+	discover_modes(reval, 1, 0x00080045);
+	TEST_EQ(disc.svids[0].mode_vdo[0], 0x000c0045, "0x%x");
+	TEST_ASSERT(pd_disc_cache_update(PORT0, TCPC_TX_SOP, &disc));
+	TEST_EQ(disc.svids[0].mode_vdo[0], 0x00080045, "0x%x");
+
+	/* The entry was updated */
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_EQ(disc.svids[0].mode_vdo[0], 0x00080045, "0x%x");
+
+	pd_disc_cache_get_stats(&stats);
+	TEST_EQ(stats.stale, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_too_many_svids(void)
+{
+	TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP, &disc));
+
+	/* The partner grew more SVIDs than an entry holds */
+	discover_modes(pd_disc_cache_get_revalidation(PORT0, TCPC_TX_SOP),
+		       SVID_DISCOVERY_MAX, 0x000c0045);
+	TEST_ASSERT(pd_disc_cache_update(PORT0, TCPC_TX_SOP, &disc));
+	TEST_EQ(disc.svid_cnt, SVID_DISCOVERY_MAX, "%d");
+
+	/* And is not restored anymore */
+	discover_identity(DOCK_VID, DOCK_PID, 0x0100);
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP, &disc));
+
+	return EC_SUCCESS;
+}
+
+static int test_revalidate_one_type(void)
+{
+	struct pd_discovery cable;
+
+	TEST_ASSERT(!connect(PORT0, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(connect(PORT0, DOCK_VID, DOCK_PID));
+	cable = disc;
+	TEST_ASSERT(!pd_disc_cache_restore(PORT0, TCPC_TX_SOP_PRIME, &cable));
+	discover_modes(&cable, 1, 0x00000001);
+	pd_disc_cache_update(PORT0, TCPC_TX_SOP_PRIME, &cable);
+	TEST_ASSERT(pd_disc_cache_restore(PORT0, TCPC_TX_SOP_PRIME, &cable));
+
+	/* The cable plug waits for the partner to be revalidated */
+	TEST_ASSERT(pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(!pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP_PRIME,
+					      &cable));
+	TEST_ASSERT(!pd_disc_cache_get_revalidation(PORT0, TCPC_TX_SOP_PRIME));
+
+	discover_modes(pd_disc_cache_get_revalidation(PORT0, TCPC_TX_SOP), 1,
+		       0x000c0045);
+	TEST_ASSERT(!pd_disc_cache_update(PORT0, TCPC_TX_SOP, &disc));
+	TEST_ASSERT(pd_disc_cache_revalidate(PORT0, TCPC_TX_SOP_PRIME,
+					     &cable));
+
+	/* Another port revalidates on its own */
+	TEST_ASSERT(connect(PORT1, DOCK_VID, DOCK_PID));
+	TEST_ASSERT(pd_disc_cache_revalidate(PORT1, TCPC_TX_SOP, &disc));
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	pd_disc_cache_clear();
+	pd_disc_cache_init_port(PORT0);
+	pd_disc_cache_init_port(PORT1);
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_miss_then_hit);
+	RUN_TEST(test_key);
+	RUN_TEST(test_lru_eviction);
+	RUN_TEST(test_revalidate);
+	RUN_TEST(test_revalidate_one_type);
+	RUN_TEST(test_too_many_svids);
+
+	test_print_result();
+}
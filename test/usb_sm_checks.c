@@ -52,6 +52,9 @@ test_static int test_no_parent_cycles(const struct test_sm_data * const sm_data)
 
 		if (depth > sm_data->size)
 			break;
+
+		/* set_state() only supports so many nested states. */
+		TEST_LE(depth, USB_SM_MAX_DEPTH, "%d");
 	}
 
 	/* Ensure all states end, otherwise the ith state has a cycle. */
@@ -54,6 +54,10 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_connect_as_nonpd_sink);
 	RUN_TEST(test_retry_count_sop);
 	RUN_TEST(test_retry_count_hard_reset);
+	RUN_TEST(test_rx_repeat_dropped);
+	RUN_TEST(test_rx_read_failure);
+	RUN_TEST(test_tcpci_reg_cache);
+	RUN_TEST(test_discovery_cache);
 
 	test_print_result();
 }
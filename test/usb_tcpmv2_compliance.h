@@ -59,6 +59,8 @@ void partner_send_msg(enum pd_msg_type sop,
 		      uint16_t cnt,
 		      uint16_t ext,
 		      uint32_t *payload);
+/* Send the last message again, as if our GoodCRC was lost */
+void partner_resend_msg(void);
 
 
 int handle_attach_expected_msgs(enum pd_data_role data_role);
@@ -94,5 +96,9 @@ int test_td_pd_snk3_e12(void);
 int test_connect_as_nonpd_sink(void);
 int test_retry_count_sop(void);
 int test_retry_count_hard_reset(void);
+int test_rx_repeat_dropped(void);
+int test_rx_read_failure(void);
+int test_tcpci_reg_cache(void);
+int test_discovery_cache(void);
 
 #endif /* USB_TCPMV2_COMPLIANCE_H */
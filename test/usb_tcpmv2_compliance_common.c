@@ -125,6 +125,10 @@ void partner_tx_msg_id_reset(int sop)
 		partner_tx_id[sop] = 0;
 }
 
+static enum pd_msg_type partner_last_sop;
+static uint16_t partner_last_header;
+static uint32_t partner_last_payload[7];
+
 void partner_send_msg(enum pd_msg_type sop,
 		      uint16_t type,
 		      uint16_t cnt,
@@ -143,11 +147,25 @@ void partner_send_msg(enum pd_msg_type sop,
 			partner_get_pd_rev(),
 			ext);
 
+	partner_last_sop = sop;
+	partner_last_header = header;
+	if (cnt > 0)
+		memcpy(partner_last_payload, payload,
+		       MIN(cnt, ARRAY_SIZE(partner_last_payload)) *
+		       sizeof(*payload));
+
 	mock_tcpci_receive(sop, header, payload);
 	++partner_tx_id[sop];
 	mock_set_alert(TCPC_REG_ALERT_RX_STATUS);
 }
 
+void partner_resend_msg(void)
+{
+	mock_tcpci_receive(partner_last_sop, partner_last_header,
+			   partner_last_payload);
+	mock_set_alert(TCPC_REG_ALERT_RX_STATUS);
+}
+
 
 /*****************************************************************************
  * TCPCI clean power up
@@ -11,6 +11,7 @@
 #include "usb_tcpmv2_compliance.h"
 #include "usb_tc_sm.h"
 #include "usb_prl_sm.h"
+#include "usb_pd_disc_cache.h"
 
 int test_connect_as_nonpd_sink(void)
 {
@@ -105,3 +106,289 @@ int test_retry_count_hard_reset(void)
 
 	return EC_SUCCESS;
 }
+
+int test_rx_repeat_dropped(void)
+{
+	struct tcpci_rx_stats before, after;
+	struct possible_tx possible[2];
+	int found_index;
+
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+		EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e3(), EC_SUCCESS, "%d");
+
+	tcpci_get_rx_stats(PORT0, &before);
+
+	/* The Tester sends a Get_Sink_Cap message, and the UUT replies. */
+	partner_send_msg(PD_MSG_SOP, PD_CTRL_GET_SINK_CAP, 0, 0, NULL);
+
+	possible[0].tx_type = TCPC_TX_SOP;
+	possible[0].ctrl_msg = PD_CTRL_NOT_SUPPORTED;
+	possible[0].data_msg = 0;
+
+	possible[1].tx_type = TCPC_TX_SOP;
+	possible[1].ctrl_msg = 0;
+	possible[1].data_msg = PD_DATA_SINK_CAP;
+
+	TEST_EQ(verify_tcpci_possible_tx(possible, 2, &found_index,
+					 NULL, 0, NULL, 0),
+		EC_SUCCESS, "%d");
+	mock_set_alert(TCPC_REG_ALERT_TX_SUCCESS);
+	task_wait_event(10 * MSEC);
+
+	/*
+	 * The Tester sends the message again, as if the GoodCRC of the TCPC
+	 * was lost. The repeat is dropped by the TCPM, so the UUT does not
+	 * reply again.
+	 */
+	partner_resend_msg();
+	task_wait_event(50 * MSEC);
+	TEST_EQ(mock_tcpci_get_reg(TCPC_REG_TRANSMIT), 0, "%d");
+
+	tcpci_get_rx_stats(PORT0, &after);
+	TEST_EQ(after.processed - before.processed, 1, "%d");
+	TEST_EQ(after.dropped - before.dropped, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+#define DOCK_VID 0x18d1
+#define DOCK_PID 0x5040
+
+/* Answer a VDM request of the UUT as a dock with DisplayPort alt mode */
+static void partner_reply_vdm(uint32_t vdm)
+{
+	uint32_t payload[4];
+	int cnt;
+
+	switch (PD_VDO_CMD(vdm)) {
+	case CMD_DISCOVER_IDENT:
+		payload[1] = VDO_IDH(0, 1, IDH_PTYPE_HUB, 1, DOCK_VID);
+		payload[2] = VDO_CSTAT(0);
+		payload[3] = VDO_PRODUCT(DOCK_PID, 0x0100);
+		cnt = 4;
+		break;
+	case CMD_DISCOVER_SVID:
+		payload[1] = VDO_SVID(USB_SID_DISPLAYPORT, 0);
+		cnt = 2;
+		break;
+	case CMD_DISCOVER_MODES:
+		payload[1] = VDO_MODE_DP(MODE_DP_PIN_C, 0, 1,
+					 CABLE_RECEPTACLE, MODE_DP_V13,
+					 MODE_DP_SNK);
+		cnt = 2;
+		break;
+	default:
+		partner_send_msg(PD_MSG_SOP, PD_CTRL_NOT_SUPPORTED, 0, 0,
+				 NULL);
+		return;
+	}
+
+	payload[0] = (vdm & ~VDO_CMDT_MASK) | VDO_CMDT(CMDT_RSP_ACK);
+	partner_send_msg(PD_MSG_SOP, PD_DATA_VENDOR_DEF, cnt, 0, payload);
+}
+
+/*
+ * Attach the dock, answering the UUT until it asks for the Sink
+ * Capabilities.
+ *
+ * @param vdm_cmds Set to the bitmask of VDM commands sent by the UUT in the
+ *                 meantime.
+ */
+static int attach_dock(uint32_t *vdm_cmds)
+{
+	struct possible_tx possible[5];
+	uint8_t data[32];
+	int found_index;
+	int msg_len;
+
+	*vdm_cmds = 0;
+
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+		EC_SUCCESS, "%d");
+
+	memset(possible, 0, sizeof(possible));
+	possible[0].tx_type = TCPC_TX_SOP_PRIME;
+	possible[0].ctrl_msg = PD_CTRL_SOFT_RESET;
+	possible[1].tx_type = TCPC_TX_SOP_PRIME;
+	possible[1].data_msg = PD_DATA_VENDOR_DEF;
+	possible[2].tx_type = TCPC_TX_SOP;
+	possible[2].data_msg = PD_DATA_VENDOR_DEF;
+	possible[3].tx_type = TCPC_TX_SOP;
+	possible[3].ctrl_msg = PD_CTRL_GET_SOURCE_CAP;
+	possible[4].tx_type = TCPC_TX_SOP;
+	possible[4].ctrl_msg = PD_CTRL_GET_SINK_CAP;
+
+	do {
+		TEST_EQ(verify_tcpci_possible_tx(possible, ARRAY_SIZE(possible),
+						 &found_index, data,
+						 sizeof(data), &msg_len, 0),
+			EC_SUCCESS, "%d");
+		mock_set_alert(TCPC_REG_ALERT_TX_SUCCESS);
+		task_wait_event(10 * MSEC);
+
+		switch (found_index) {
+		case 0:
+		case 1:
+			partner_send_msg(PD_MSG_SOP_PRIME,
+					 PD_CTRL_NOT_SUPPORTED, 0, 0, NULL);
+			break;
+		case 2: {
+			/* Byte count and message header come first */
+			uint32_t vdm = UINT32_FROM_BYTE_ARRAY_LE(data, 3);
+
+			*vdm_cmds |= BIT(PD_VDO_CMD(vdm));
+			partner_reply_vdm(vdm);
+			break;
+		}
+		case 3:
+			partner_send_msg(PD_MSG_SOP, PD_DATA_SOURCE_CAP, 1, 0,
+					 &pdo);
+			break;
+		case 4:
+			partner_send_msg(PD_MSG_SOP, PD_DATA_SINK_CAP, 1, 0,
+					 &pdo);
+			break;
+		}
+	} while (found_index != 4);
+
+	return EC_SUCCESS;
+}
+
+int test_discovery_cache(void)
+{
+	struct pd_disc_cache_stats before, after;
+	uint32_t vdm_cmds;
+
+	pd_disc_cache_clear();
+
+	/* The first time, the UUT discovers everything */
+	TEST_EQ(attach_dock(&vdm_cmds), EC_SUCCESS, "%d");
+	TEST_NE(vdm_cmds & BIT(CMD_DISCOVER_IDENT), 0, "0x%x");
+	TEST_NE(vdm_cmds & BIT(CMD_DISCOVER_SVID), 0, "0x%x");
+	TEST_NE(vdm_cmds & BIT(CMD_DISCOVER_MODES), 0, "0x%x");
+	TEST_EQ(pd_get_svid_count(PORT0, TCPC_TX_SOP), 1, "%d");
+
+	pd_disc_cache_get_stats(&before);
+
+	/* Unplug the dock, as between two tests */
+	before_test();
+
+	/* On reconnection, the SVIDs and modes come from the cache */
+	TEST_EQ(attach_dock(&vdm_cmds), EC_SUCCESS, "%d");
+	TEST_NE(vdm_cmds & BIT(CMD_DISCOVER_IDENT), 0, "0x%x");
+	TEST_EQ(vdm_cmds & BIT(CMD_DISCOVER_SVID), 0, "0x%x");
+	TEST_EQ(vdm_cmds & BIT(CMD_DISCOVER_MODES), 0, "0x%x");
+	TEST_EQ(pd_get_svids_discovery(PORT0, TCPC_TX_SOP), PD_DISC_COMPLETE,
+		"%d");
+	TEST_EQ(pd_get_svid(PORT0, 0, TCPC_TX_SOP), USB_SID_DISPLAYPORT,
+		"0x%x");
+	TEST_ASSERT(pd_is_mode_discovered_for_svid(PORT0, TCPC_TX_SOP,
+						   USB_SID_DISPLAYPORT));
+
+	pd_disc_cache_get_stats(&after);
+	TEST_EQ(after.hits - before.hits, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+int test_rx_read_failure(void)
+{
+	struct possible_tx possible[2];
+	int found_index;
+
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+		EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e3(), EC_SUCCESS, "%d");
+
+	/* The Tester sends a Get_Sink_Cap message, and the UUT replies. */
+	partner_send_msg(PD_MSG_SOP, PD_CTRL_GET_SINK_CAP, 0, 0, NULL);
+
+	possible[0].tx_type = TCPC_TX_SOP;
+	possible[0].ctrl_msg = PD_CTRL_NOT_SUPPORTED;
+	possible[0].data_msg = 0;
+
+	possible[1].tx_type = TCPC_TX_SOP;
+	possible[1].ctrl_msg = 0;
+	possible[1].data_msg = PD_DATA_SINK_CAP;
+
+	TEST_EQ(verify_tcpci_possible_tx(possible, 2, &found_index,
+					 NULL, 0, NULL, 0),
+		EC_SUCCESS, "%d");
+
+	/*
+	 * The reply completes along with an RX status whose message cannot be
+	 * read, as the RX buffer is empty. The TX complete is still handled,
+	 * so the UUT does not time out and send a Soft_Reset.
+	 */
+	mock_set_alert(TCPC_REG_ALERT_TX_SUCCESS | TCPC_REG_ALERT_RX_STATUS);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(mock_tcpci_get_reg(TCPC_REG_ALERT), 0, "0x%x");
+	task_wait_event(200 * MSEC);
+	TEST_EQ(mock_tcpci_get_reg(TCPC_REG_TRANSMIT), 0, "%d");
+
+	/* Likewise, a power status change is not lost with a failed read. */
+	mock_tcpci_set_reg(TCPC_REG_POWER_STATUS, 0);
+	mock_set_alert(TCPC_REG_ALERT_POWER_STATUS | TCPC_REG_ALERT_RX_STATUS);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(mock_tcpci_get_reg(TCPC_REG_ALERT), 0, "0x%x");
+	TEST_ASSERT(!tcpm_check_vbus_level(PORT0, VBUS_PRESENT));
+
+	mock_tcpci_set_reg(TCPC_REG_POWER_STATUS,
+			   TCPC_REG_POWER_STATUS_VBUS_PRES);
+	mock_set_alert(TCPC_REG_ALERT_POWER_STATUS | TCPC_REG_ALERT_RX_STATUS);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(mock_tcpci_get_reg(TCPC_REG_ALERT), 0, "0x%x");
+	TEST_ASSERT(tcpm_check_vbus_level(PORT0, VBUS_PRESENT));
+
+	return EC_SUCCESS;
+}
+
+int test_tcpci_reg_cache(void)
+{
+	int val, cached;
+
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+		EC_SUCCESS, "%d");
+
+	/* Control registers are only read once from the TCPC */
+	TEST_EQ(tcpc_read(PORT0, TCPC_REG_FAULT_CTRL, &cached), EC_SUCCESS,
+		"%d");
+	mock_tcpci_set_reg(TCPC_REG_FAULT_CTRL, cached ^ 0x80);
+	TEST_EQ(tcpc_read(PORT0, TCPC_REG_FAULT_CTRL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, cached, "0x%x");
+
+	/* Status registers always are */
+	mock_tcpci_set_reg(TCPC_REG_FAULT_STATUS, 0x40);
+	TEST_EQ(tcpc_read(PORT0, TCPC_REG_FAULT_STATUS, &val), EC_SUCCESS,
+		"%d");
+	TEST_EQ(val, 0x40, "0x%x");
+	mock_tcpci_set_reg(TCPC_REG_FAULT_STATUS, 0);
+
+	/* A command may change any register, they are read again */
+	TEST_EQ(tcpci_write_command(PORT0,
+				    TCPC_REG_COMMAND_ENABLE_VBUS_DETECT),
+		EC_SUCCESS, "%d");
+	TEST_EQ(tcpc_read(PORT0, TCPC_REG_FAULT_CTRL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, cached ^ 0x80, "0x%x");
+	mock_tcpci_set_reg(TCPC_REG_FAULT_CTRL, cached);
+	TEST_EQ(tcpc_read(PORT0, TCPC_REG_FAULT_CTRL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, cached ^ 0x80, "0x%x");
+
+	/*
+	 * The TCPC resets, which shows in its masks. The TCPM initializes it
+	 * again, reading the registers from the TCPC.
+	 */
+	mock_tcpci_set_reg(TCPC_REG_POWER_STATUS_MASK,
+			   TCPC_REG_POWER_STATUS_MASK_ALL);
+	mock_set_alert(TCPC_REG_ALERT_CC_STATUS);
+	task_wait_event(10 * MSEC);
+	TEST_EQ(tcpc_read(PORT0, TCPC_REG_FAULT_CTRL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, cached, "0x%x");
+
+	return EC_SUCCESS;
+}
@@ -27,11 +27,26 @@
 /* Unreachable time in future */
 #define TIMER_DISABLED 0xffffffffffffffff
 
-/* Install Mock TCPC and MUX drivers */
+/* Each PD task has its own stack */
+#ifdef CONFIG_USB_PD_SINGLE_TASK
+#define PD_TASK_COUNT 1
+#else
+#define PD_TASK_COUNT CONFIG_USB_PD_PORT_MAX_COUNT
+#endif
+
+/*
+ * Install Mock TCPC and MUX drivers. Any second port stays unattached, to
+ * check that it does not disturb port 0 when the ports share a PD task.
+ */
 const struct tcpc_config_t tcpc_config[CONFIG_USB_PD_PORT_MAX_COUNT] = {
 	{
 		.drv = &mock_tcpc_driver,
 	},
+#if CONFIG_USB_PD_PORT_MAX_COUNT > 1
+	{
+		.drv = &mock_tcpc_driver,
+	},
+#endif
 };
 
 const struct usb_mux usb_muxes[CONFIG_USB_PD_PORT_MAX_COUNT] = {
@@ -58,7 +73,7 @@ __maybe_unused static int test_mux_con_dis_as_src(void)
 	/* Update CC lines send state machine event to process */
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RD;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 	pd_set_dual_role(0, PD_DRP_TOGGLE_ON);
 
 	/* This wait trainsitions through AttachWait.SRC then Attached.SRC */
@@ -70,7 +85,7 @@ __maybe_unused static int test_mux_con_dis_as_src(void)
 
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* This wait will go through TryWait.SNK then to Unattached.SNK */
 	task_wait_event(10 * SECOND);
@@ -91,7 +106,7 @@ __maybe_unused static int test_mux_con_dis_as_snk(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* This wait will go through AttachWait.SNK to Attached.SNK */
 	task_wait_event(5 * SECOND);
@@ -105,7 +120,7 @@ __maybe_unused static int test_mux_con_dis_as_snk(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.vbus_level = 0;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* This wait will go through TryWait.SNK then to Unattached.SNK */
 	task_wait_event(10 * SECOND);
@@ -130,7 +145,7 @@ __maybe_unused static int test_power_role_set(void)
 	/* Update CC lines send state machine event to process */
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RD;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 	task_wait_event(10 * SECOND);
 
 	/* We are in Attached.SRC now */
@@ -162,7 +177,7 @@ __maybe_unused static int test_polarity_cc1_default(void)
 	 */
 	mock_tcpc.last.polarity = POLARITY_COUNT;
 
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -178,7 +193,7 @@ __maybe_unused static int test_polarity_cc1_1A5(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_1_5;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -194,7 +209,7 @@ __maybe_unused static int test_polarity_cc1_3A0(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -210,7 +225,7 @@ __maybe_unused static int test_polarity_cc2_default(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_DEF;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -226,7 +241,7 @@ __maybe_unused static int test_polarity_cc2_1A5(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_1_5;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -242,7 +257,7 @@ __maybe_unused static int test_polarity_cc2_3A0(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -258,7 +273,7 @@ __maybe_unused static int test_polarity_dts_cc1_default(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_1_5;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -274,7 +289,7 @@ __maybe_unused static int test_polarity_dts_cc1_1A5(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_1_5;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_DEF;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -290,7 +305,7 @@ __maybe_unused static int test_polarity_dts_cc1_3A0(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_DEF;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -306,7 +321,7 @@ __maybe_unused static int test_polarity_dts_cc2_default(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_1_5;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -322,7 +337,7 @@ __maybe_unused static int test_polarity_dts_cc2_1A5(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_DEF;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_1_5;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -338,7 +353,7 @@ __maybe_unused static int test_polarity_dts_cc2_3A0(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_DEF;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Before tCCDebounce elapses, we should SRC */
 	task_wait_event(PD_T_CC_DEBOUNCE + FUDGE);
@@ -368,7 +383,7 @@ __maybe_unused static int test_try_src_disabled(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Wait a long time past many potential transitions */
 	task_wait_event(10 * SECOND);
@@ -407,7 +422,7 @@ static int switch_to_opposite_role(int port, int pull)
 		ccprints("[Test] Partner presents SRC with Vbus ON");
 	}
 
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	return EC_SUCCESS;
 };
@@ -422,7 +437,7 @@ __maybe_unused static int test_try_src_partner_switches(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* We are in AttachWait.SNK now */
 	/* Before tCCDebounce elapses, we should still be a SNK */
@@ -468,7 +483,7 @@ static int dumb_src_charger_cc_response(int port, int pull)
 
 	ccprints("[Test] Partner presents SRC with Vbus ON");
 
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	return EC_SUCCESS;
 };
@@ -483,7 +498,7 @@ __maybe_unused static int test_try_src_partner_does_not_switch_vbus(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* We are in AttachWait.SNK now */
 	/* Before tCCDebounce elapses, we should still be a SNK */
@@ -539,7 +554,7 @@ static int src_charger_drops_vbus_cc_response(int port, int pull)
 		ccprints("[Test] Partner presents SRC with Vbus ON");
 	}
 
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	return EC_SUCCESS;
 };
@@ -554,7 +569,7 @@ __maybe_unused static int test_try_src_partner_does_not_switch_no_vbus(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* We are in AttachWait.SNK now */
 	/* Before tCCDebounce elapses, we should still be a SNK */
@@ -690,7 +705,7 @@ __maybe_unused static int test_auto_toggle_delay_early_connect(void)
 	mock_tcpc.cc1 = TYPEC_CC_VOLT_OPEN;
 	mock_tcpc.cc2 = TYPEC_CC_VOLT_RP_3_0;
 	mock_tcpc.vbus_level = 1;
-	task_set_event(TASK_ID_PD_C0, PD_EVENT_CC);
+	pd_task_set_event(PORT0, PD_EVENT_CC);
 
 	/* Ensure the auto toggle enable was never called */
 	task_wait_event(SECOND);
@@ -704,6 +719,41 @@ __maybe_unused static int test_auto_toggle_delay_early_connect(void)
 	return EC_SUCCESS;
 }
 
+/*
+ * Time how long a connection takes to reach Attached.SNK, to compare the
+ * per-port PD tasks with CONFIG_USB_PD_SINGLE_TASK.
+ */
+__maybe_unused static int test_attach_latency(void)
+{
+	uint64_t start;
+	int latency;
+
+	tc_try_src_override(TRY_SRC_OVERRIDE_OFF);
+
+	ccprints("[Test] Partner connects as SRC");
+	mock_tcpc.cc1 = TYPEC_CC_VOLT_RP_3_0;
+	mock_tcpc.cc2 = TYPEC_CC_VOLT_OPEN;
+	mock_tcpc.vbus_level = 1;
+	start = get_time().val;
+	pd_task_set_event(PORT0, PD_EVENT_CC);
+
+	while (!tc_is_attached_snk(PORT0) && get_time().val - start < SECOND)
+		task_wait_event(MSEC);
+	latency = get_time().val - start;
+
+	ccprints("[Test] Attached.SNK after %d us, %d PD task(s) for %d port(s)",
+		 latency, PD_TASK_COUNT, CONFIG_USB_PD_PORT_MAX_COUNT);
+	TEST_EQ(tc_is_attached_snk(PORT0), true, "%d");
+	TEST_LE(latency, PD_T_CC_DEBOUNCE + FUDGE, "%d");
+#if CONFIG_USB_PD_PORT_MAX_COUNT > 1
+	/* The event was for port 0 only */
+	TEST_EQ(tc_is_attached_snk(1), false, "%d");
+	TEST_EQ(tc_is_attached_src(1), false, "%d");
+#endif
+
+	return EC_SUCCESS;
+}
+
 /* TODO(b/153071799): test as SNK monitor for Vbus disconnect (not CC line) */
 /* TODO(b/153071799): test as SRC monitor for CC line state change */
 
@@ -754,6 +804,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_cc_rd_on_por_reset);
 	RUN_TEST(test_auto_toggle_delay);
 	RUN_TEST(test_auto_toggle_delay_early_connect);
+	RUN_TEST(test_attach_latency);
 
 	/* Do basic state machine validity checks last. */
 	RUN_TEST(test_tc_no_parent_cycles);
@@ -124,28 +124,15 @@ static int ec_readmem_dev(int offset, int bytes, void *dest)
 
 /* New ioctl format, used by Chrome OS 4.4 and later as well as upstream 4.0+ */
 
-static int ec_command_dev_v2(int command, int version,
-			     const void *outdata, int outsize,
-			     void *indata, int insize)
+/*
+ * Send the command set up in s_cmd, and copy the response to indata.  s_cmd
+ * must have room for insize bytes of response.
+ */
+static int ec_xfer_dev_v2(struct cros_ec_command_v2 *s_cmd,
+			  void *indata, int insize)
 {
-	struct cros_ec_command_v2 *s_cmd;
 	int r;
 
-	assert(outsize == 0 || outdata != NULL);
-	assert(insize == 0 || indata != NULL);
-
-	s_cmd = malloc(sizeof(struct cros_ec_command_v2) +
-		       MAX(outsize, insize));
-	if (s_cmd == NULL)
-		return -EC_RES_ERROR;
-
-	s_cmd->command = command;
-	s_cmd->version = version;
-	s_cmd->result = 0xff;
-	s_cmd->outsize = outsize;
-	s_cmd->insize = insize;
-	memcpy(s_cmd->data, outdata, outsize);
-
 	r = ioctl(fd, CROS_EC_DEV_IOCXCMD_V2, s_cmd);
 	if (r < 0) {
 		fprintf(stderr, "ioctl %d, errno %d (%s), EC result %d (%s)\n",
@@ -153,7 +140,7 @@ static int ec_command_dev_v2(int command, int version,
 			strresult(s_cmd->result));
 		if (errno == EAGAIN && s_cmd->result == EC_RES_IN_PROGRESS) {
 			s_cmd->command = EC_CMD_RESEND_RESPONSE;
-			r = ioctl(fd, CROS_EC_DEV_IOCXCMD_V2, &s_cmd);
+			r = ioctl(fd, CROS_EC_DEV_IOCXCMD_V2, s_cmd);
 			fprintf(stderr,
 				"ioctl %d, errno %d (%s), EC result %d (%s)\n",
 				r, errno, strerror(errno), s_cmd->result,
@@ -167,11 +154,79 @@ static int ec_command_dev_v2(int command, int version,
 			r =  -EECRESULT - s_cmd->result;
 		}
 	}
+
+	return r;
+}
+
+static int ec_command_dev_v2(int command, int version,
+			     const void *outdata, int outsize,
+			     void *indata, int insize)
+{
+	struct cros_ec_command_v2 *s_cmd;
+	int r;
+
+	assert(outsize == 0 || outdata != NULL);
+	assert(insize == 0 || indata != NULL);
+
+	s_cmd = malloc(sizeof(struct cros_ec_command_v2) +
+		       MAX(outsize, insize));
+	if (s_cmd == NULL)
+		return -EC_RES_ERROR;
+
+	s_cmd->command = command;
+	s_cmd->version = version;
+	s_cmd->result = 0xff;
+	s_cmd->outsize = outsize;
+	s_cmd->insize = insize;
+	memcpy(s_cmd->data, outdata, outsize);
+
+	r = ec_xfer_dev_v2(s_cmd, indata, insize);
 	free(s_cmd);
 
 	return r;
 }
 
+/* Send all the commands with a single ioctl buffer */
+static int ec_command_batch_dev_v2(struct ec_command_req *reqs, int count,
+				   int command_offset)
+{
+	struct cros_ec_command_v2 *s_cmd;
+	int size = 0;
+	int i;
+
+	if (count <= 0)
+		return 0;
+
+	for (i = 0; i < count; i++)
+		size = MAX(size, MAX(reqs[i].outsize, reqs[i].insize));
+
+	s_cmd = malloc(sizeof(struct cros_ec_command_v2) + size);
+	if (s_cmd == NULL) {
+		reqs[0].rv = -EC_RES_ERROR;
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		assert(reqs[i].outsize == 0 || reqs[i].outdata != NULL);
+		assert(reqs[i].insize == 0 || reqs[i].indata != NULL);
+
+		s_cmd->command = command_offset + reqs[i].command;
+		s_cmd->version = reqs[i].version;
+		s_cmd->result = 0xff;
+		s_cmd->outsize = reqs[i].outsize;
+		s_cmd->insize = reqs[i].insize;
+		memcpy(s_cmd->data, reqs[i].outdata, reqs[i].outsize);
+
+		reqs[i].rv = ec_xfer_dev_v2(s_cmd, reqs[i].indata,
+					    reqs[i].insize);
+		if (reqs[i].rv < 0)
+			break;
+	}
+	free(s_cmd);
+
+	return i;
+}
+
 static int ec_readmem_dev_v2(int offset, int bytes, void *dest)
 {
 	struct cros_ec_readmem_v2 s_mem;
@@ -272,6 +327,7 @@ int comm_init_dev(const char *device_name)
 
 	if (ec_dev_is_v2()) {
 		ec_command_proto = ec_command_dev_v2;
+		ec_command_batch_proto = ec_command_batch_dev_v2;
 		ec_cmd_readmem = ec_readmem_dev_v2;
 	} else {
 		ec_command_proto = ec_command_dev;
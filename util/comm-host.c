@@ -20,6 +20,9 @@ int (*ec_command_proto)(int command, int version,
 			const void *outdata, int outsize,
 			void *indata, int insize);
 
+int (*ec_command_batch_proto)(struct ec_command_req *reqs, int count,
+			      int command_offset);
+
 int (*ec_readmem)(int offset, int bytes, void *dest);
 
 int (*ec_pollevent)(unsigned long mask, void *buffer, size_t buf_size,
@@ -83,6 +86,24 @@ int ec_command(int command, int version,
 				indata, insize);
 }
 
+int ec_command_batch(struct ec_command_req *reqs, int count)
+{
+	int i;
+
+	if (ec_command_batch_proto)
+		return ec_command_batch_proto(reqs, count, command_offset);
+
+	for (i = 0; i < count; i++) {
+		reqs[i].rv = ec_command(reqs[i].command, reqs[i].version,
+					reqs[i].outdata, reqs[i].outsize,
+					reqs[i].indata, reqs[i].insize);
+		if (reqs[i].rv < 0)
+			break;
+	}
+
+	return i;
+}
+
 int comm_init_alt(int interfaces, const char *device_name, int i2c_bus)
 {
 	bool dev_is_cros_ec;
@@ -66,6 +66,27 @@ int ec_command(int command, int version,
 	       const void *outdata, int outsize,   /* to the EC */
 	       void *indata, int insize);	   /* from the EC */
 
+/* A command sent by ec_command_batch() */
+struct ec_command_req {
+	int command;
+	int version;
+	const void *outdata;	/* to the EC */
+	int outsize;
+	void *indata;		/* from the EC */
+	int insize;
+	int rv;			/* Set to the return value of ec_command() */
+};
+
+/**
+ * Send several commands to the EC, in order, stopping at the first one that
+ * fails.  The EC handles one command at a time, but the transport can set up
+ * the whole batch at once instead of once per command.
+ *
+ * Returns the number of commands that succeeded; the rv of the next one, if
+ * any, holds its error.
+ */
+int ec_command_batch(struct ec_command_req *reqs, int count);
+
 /**
  * Set the offset to be applied to the command number when ec_command() calls
  * ec_command_proto().
@@ -82,6 +103,16 @@ extern int (*ec_command_proto)(int command, int version,
 			       const void *outdata, int outsize, /* to EC */
 			       void *indata, int insize);        /* from EC */
 
+/**
+ * Send several commands to the EC, with command_offset added to each command
+ * number.  Optional low-level interface for the protocol-specific driver;
+ * ec_command_batch() sends the commands one by one with ec_command_proto()
+ * when NULL.  DO NOT call this directly from anywhere but
+ * ec_command_batch().
+ */
+extern int (*ec_command_batch_proto)(struct ec_command_req *reqs, int count,
+				     int command_offset);
+
 /**
  * Return the content of the EC information area mapped as "memory".
  * The offsets are defined by the EC_MEMMAP_ constants. Returns the number
@@ -30,6 +30,7 @@ import traceback
 
 import six
 
+import detokenizer
 import interpreter
 import threadproc_shim
 
@@ -138,6 +139,8 @@ class Console(object):
     raw_debug: Flag to indicate whether per interrupt data should be logged to
       debug
     output_line_log_buffer: buffer for lines coming from the EC to log to debug
+    detokenizer: A Detokenizer object to decode the output of EC images built
+      with CONFIG_CONSOLE_TOKENIZED, or None.
   """
 
   def __init__(self, master_pty, user_pty, interface_pty, cmd_pipe, dbg_pipe,
@@ -186,6 +189,7 @@ class Console(object):
     self.look_buffer = b''
     self.raw_debug = False
     self.output_line_log_buffer = []
+    self.detokenizer = None
 
   def __str__(self):
     """Show internal state of Console object as a string."""
@@ -1025,6 +1029,10 @@ def StartLoop(console, command_active, shutdown_pipe=None):
             console.logger.debug('ec3po console received EOF from dbg_pipe')
             continue_looping = False
           else:
+            if console.detokenizer:
+              data = console.detokenizer.Process(data)
+              if not data:
+                continue
             if console.interrogation_mode == b'auto':
               # Search look buffer for enhanced EC image string.
               console.CheckBufferForEnhancedImage(data)
@@ -1103,6 +1111,9 @@ def main(argv):
   parser.add_argument('--log-level',
                       default='info',
                       help='info, debug, warning, error, or critical')
+  parser.add_argument('--tokenized-elf', nargs='+', metavar='ELF',
+                      help=('ELF files of the RO and RW images, to decode '
+                            'tokenized console output'))
 
   # Parse arguments.
   opts = parser.parse_args(argv)
@@ -1153,6 +1164,9 @@ def main(argv):
   # Create a console.
   console = Console(master_pty, os.ttyname(user_pty), cmd_pipe_interactive,
                     dbg_pipe_interactive)
+  if opts.tokenized_elf:
+    console.detokenizer = detokenizer.Detokenizer.FromElf(
+        *opts.tokenized_elf[:2])
   # Start serving the console.
   v = threadproc_shim.Value(ctypes.c_bool, False)
   StartLoop(console, v)
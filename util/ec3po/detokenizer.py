@@ -0,0 +1,337 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""EC-3PO tokenized console output decoder
+
+With CONFIG_CONSOLE_TOKENIZED, the EC prints each cprints() call as a line of
+'$' and the base64 of a binary record, see common/console_output.c.  The
+format strings are left out of the image, in the .tokenized_fmt section of
+the ELF files.  The detokenizer looks them up and formats the arguments the
+way the EC printf() would.
+
+It can also be run on a saved log:
+  detokenizer.py ec.RO.elf [ec.RW.elf] < log
+"""
+
+# Note: This is a py2/3 compatible file.
+
+from __future__ import print_function
+
+import argparse
+import base64
+import binascii
+import re
+import struct
+import sys
+
+TOKENIZED_SECTION = b'.tokenized_fmt'
+
+# A record, up to the end of the line.  Records usually start a line, but
+# follow any cprintf() output not ended by a newline.
+RECORD_RE = re.compile(br'\$([A-Za-z0-9+/=]+)')
+
+# Longest line with a record: '$', the base64 of 96 bytes and "\r\n".
+RECORD_LINE_MAX = 1 + 128 + 2
+# Text held before a record, in case it follows cprintf() output.
+CONSOLE_LINE_MAX = 80
+
+# A printf() conversion, as parsed by vfnprintf() in common/printf.c.
+CONVERSION_RE = re.compile(r'%(?:(%)|(c)|(-?)(\+?)(0?)(\*|[0-9]*)'
+                           r'(?:\.(\*|[0-9]*))?(ll|l|z)?(p.|[sdiuxX]))')
+
+
+def ReadElfSection(path, name=TOKENIZED_SECTION):
+  """Read a section of an ELF file.
+
+  Args:
+    path: Path to the ELF file.
+    name: Name of the section, as bytes.
+
+  Returns:
+    A tuple of the section contents and whether the ELF file is 64-bit, or
+    None for the contents if there is no such section.
+  """
+  with open(path, 'rb') as f:
+    elf = f.read()
+
+  if elf[:4] != b'\x7fELF':
+    raise ValueError('%s is not an ELF file' % path)
+  is_64 = elf[4:5] == b'\x02'
+  endian = '<' if elf[5:6] == b'\x01' else '>'
+
+  if is_64:
+    shoff, = struct.unpack_from(endian + 'Q', elf, 0x28)
+    shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', elf, 0x3a)
+    header = endian + 'IIQQQQ'
+  else:
+    shoff, = struct.unpack_from(endian + 'I', elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', elf, 0x2e)
+    header = endian + 'IIIIII'
+
+  sections = [struct.unpack_from(header, elf, shoff + i * shentsize)
+              for i in range(shnum)]
+  # Name, type, flags, address, offset and size of each section.
+  names_offset = sections[shstrndx][4]
+  for sh_name, _, _, _, offset, size in sections:
+    start = names_offset + sh_name
+    if elf[start:elf.index(b'\0', start)] == name:
+      return elf[offset:offset + size], is_64
+
+  return None, is_64
+
+
+class Detokenizer(object):
+  """Turns tokenized records back into text.
+
+  Attributes:
+    strings: A list of the .tokenized_fmt section of the RO and RW images.
+    long_64: Whether long is 64-bit on the EC, as in host builds.
+    verbose_time: Whether timestamps are printed in us, with
+      CONFIG_CONSOLE_VERBOSE, rather than in ms.
+    pending: Partial record held until the end of its line, in Process().
+  """
+
+  def __init__(self, ro_strings, rw_strings=None, long_64=False,
+               verbose_time=True):
+    """Initialises a Detokenizer with the format strings of the images.
+
+    Args:
+      ro_strings: Contents of the .tokenized_fmt section of the RO image.
+      rw_strings: Same for the RW image, or None to use the RO one.
+      long_64: Whether long is 64-bit on the EC.
+      verbose_time: Whether timestamps are printed in us.
+    """
+    self.strings = [ro_strings,
+                    rw_strings if rw_strings is not None else ro_strings]
+    self.long_64 = long_64
+    self.verbose_time = verbose_time
+    self.pending = b''
+
+  @classmethod
+  def FromElf(cls, ro_elf, rw_elf=None, verbose_time=True):
+    """Creates a Detokenizer from the ELF files of the images."""
+    ro_strings, long_64 = ReadElfSection(ro_elf)
+    if ro_strings is None:
+      raise ValueError('%s has no tokenized strings' % ro_elf)
+    rw_strings = None
+    if rw_elf:
+      rw_strings, _ = ReadElfSection(rw_elf)
+    return cls(ro_strings, rw_strings, long_64, verbose_time)
+
+  def DecodeRecord(self, record):
+    """Formats a record.
+
+    Args:
+      record: The record, after base64 decoding.
+
+    Returns:
+      The text cprints() would have printed, without the end of line.
+
+    Raises:
+      ValueError: The record does not match any format string.
+    """
+    reader = _RecordReader(bytearray(record))
+    token = reader.Varint()
+    strings = self.strings[token & 1]
+    offset = token >> 1
+    if offset >= len(strings):
+      raise ValueError('Unknown token %d' % token)
+    end = strings.find(b'\0', offset)
+    if end < 0:
+      raise ValueError('Unknown token %d' % token)
+    fmt = strings[offset:end].decode('utf-8', 'replace')
+
+    time = reader.Int()
+    text = self._Format(fmt, reader, time)
+    return '[%s %s]' % (self._FormatTime(time), text)
+
+  def DecodeLine(self, line):
+    """Replaces the record in a line of console output with its text.
+
+    Lines which are not valid records are left as they are.
+
+    Args:
+      line: A line of console output, as bytes.
+
+    Returns:
+      The line, as bytes.
+    """
+    match = RECORD_RE.search(line)
+    if not match:
+      return line
+    try:
+      record = base64.b64decode(match.group(1))
+      text = self.DecodeRecord(record)
+    except (ValueError, TypeError, binascii.Error):
+      return line
+    return (line[:match.start()] + text.encode('utf-8') +
+            line[match.end():])
+
+  def Process(self, data):
+    """Decodes the records in a chunk of console output.
+
+    Records cut between two chunks are held until the rest of their line
+    arrives.
+
+    Args:
+      data: Console output, as bytes.
+
+    Returns:
+      The output with the records decoded, as bytes.
+    """
+    data = self.pending + data
+    self.pending = b''
+    out = []
+    start = 0
+    while start < len(data):
+      end = data.find(b'\n', start)
+      if end < 0:
+        # Hold a partial record, but print anything else right away.
+        if (b'$' in data[start:] and
+            len(data) - start < RECORD_LINE_MAX + CONSOLE_LINE_MAX):
+          self.pending = data[start:]
+        else:
+          out.append(data[start:])
+        break
+      out.append(self.DecodeLine(data[start:end + 1]))
+      start = end + 1
+    return b''.join(out)
+
+  def _FormatTime(self, us):
+    if self.verbose_time:
+      return _FixedPoint(us, 6)
+    return _FixedPoint(us // 1000, 3)
+
+  def _Format(self, fmt, reader, time):
+    """Formats the arguments of a record like vfnprintf()."""
+    out = []
+    pos = 0
+    for match in CONVERSION_RE.finditer(fmt):
+      out.append(fmt[pos:match.start()])
+      pos = match.end()
+      (percent, char, left, plus, zero, width, precision, length,
+       conversion) = match.groups()
+
+      if percent:
+        out.append('%')
+        continue
+      if char:
+        out.append(chr(reader.Int() & 0xff))
+        continue
+
+      width = reader.Int() if width == '*' else int(width or 0)
+      if precision is None:
+        precision = -1
+      elif precision == '*':
+        precision = reader.Int()
+      else:
+        precision = int(precision or 0)
+
+      is_64 = length == 'll' or (length in ('l', 'z') and self.long_64)
+      if conversion == 's':
+        value = reader.Bytes().decode('utf-8', 'replace')
+      elif conversion == 'ph':
+        out.append(binascii.hexlify(reader.Bytes()).decode())
+        continue
+      elif conversion == 'pb':
+        value = bin(reader.Int() & 0xffffffff)[2:]
+        width = reader.Int()
+        zero = '0'
+      elif conversion == 'pT':
+        value = self._FormatTime(reader.Int() or time)
+      elif conversion == 'pP':
+        value = '%x' % (reader.Int() & (2**64 - 1 if self.long_64 else
+                                        2**32 - 1))
+      elif conversion.startswith('p'):
+        # vfnprintf() fails the whole line here.
+        return ''.join(out) + 'ERROR'
+      else:
+        value = reader.Int()
+        if conversion in 'di':
+          sign = '-' if value < 0 else ('+' if plus else '')
+          value = sign + _FixedPoint(abs(value), precision)
+        else:
+          value &= 2**64 - 1 if is_64 else 2**32 - 1
+          if conversion == 'u':
+            value = _FixedPoint(value, precision)
+          else:
+            value = '%x' % value
+            if conversion == 'X':
+              value = value.upper()
+        # The precision was used for the fixed point.
+        precision = -1
+
+      # No padding strings to wider than the precision.
+      if precision >= 0:
+        width = min(width, precision)
+        value = value[:precision]
+      pad = ('0' if zero else ' ') * (width - len(value))
+      out.append(value + pad.replace('0', ' ') if left else pad + value)
+
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+def _FixedPoint(value, precision):
+  """Prints an unsigned integer with precision digits after the point."""
+  if precision <= 0:
+    return str(value) + ('.' if precision == 0 else '')
+  digits = str(value).rjust(precision + 1, '0')
+  return digits[:-precision] + '.' + digits[-precision:]
+
+
+class _RecordReader(object):
+  """Reads the fields of a record."""
+
+  def __init__(self, data):
+    self.data = data
+    self.pos = 0
+
+  def Varint(self):
+    value = 0
+    shift = 0
+    while True:
+      if self.pos >= len(self.data):
+        raise ValueError('Record too short')
+      byte = self.data[self.pos]
+      self.pos += 1
+      value |= (byte & 0x7f) << shift
+      shift += 7
+      if not byte & 0x80:
+        return value
+
+  def Int(self):
+    value = self.Varint()
+    return (value >> 1) ^ -(value & 1)
+
+  def Bytes(self):
+    length = self.Varint()
+    if self.pos + length > len(self.data):
+      raise ValueError('Record too short')
+    value = bytes(self.data[self.pos:self.pos + length])
+    self.pos += length
+    return value
+
+
+def main(argv):
+  parser = argparse.ArgumentParser(description='Decode tokenized EC console '
+                                   'output read from stdin.')
+  parser.add_argument('ro_elf', help='ELF file of the RO image')
+  parser.add_argument('rw_elf', nargs='?', help='ELF file of the RW image')
+  parser.add_argument('--ms', action='store_true',
+                      help='Timestamps in ms, without CONFIG_CONSOLE_VERBOSE')
+  opts = parser.parse_args(argv)
+
+  detokenizer = Detokenizer.FromElf(opts.ro_elf, opts.rw_elf,
+                                    verbose_time=not opts.ms)
+  stdin = getattr(sys.stdin, 'buffer', sys.stdin)
+  stdout = getattr(sys.stdout, 'buffer', sys.stdout)
+  for line in stdin:
+    stdout.write(detokenizer.Process(line))
+  stdout.write(detokenizer.pending)
+
+
+if __name__ == '__main__':
+  main(sys.argv[1:])
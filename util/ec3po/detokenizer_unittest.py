@@ -0,0 +1,115 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Unit tests for the EC-3PO detokenizer."""
+
+# Note: This is a py2/3 compatible file.
+
+from __future__ import print_function
+
+import base64
+import unittest
+
+import detokenizer
+
+
+FORMATS = [b'%d %u %x %lld %c', b'%s %ph %pb %pT %pT', b'%5d|%-4s|%05x|%.3d',
+           b'%*d %.*s %%']
+
+
+def Varint(value):
+  out = bytearray()
+  while True:
+    out.append((value & 0x7f) | (0x80 if value > 0x7f else 0))
+    value >>= 7
+    if not value:
+      return bytes(out)
+
+
+def Int(value):
+  return Varint((value << 1) ^ (value >> 63))
+
+
+def Bytes(value):
+  return Varint(len(value)) + value
+
+
+class TestDetokenizer(unittest.TestCase):
+  """Test case to verify the decoding of tokenized records."""
+
+  def setUp(self):
+    """Setup the test harness."""
+    self.strings = b''
+    self.tokens = []
+    for fmt in FORMATS:
+      self.tokens.append(len(self.strings) << 1)
+      self.strings += fmt + b'\0'
+    self.detokenizer = detokenizer.Detokenizer(self.strings)
+
+  def Line(self, index, time, *args):
+    """Returns the console line of a record."""
+    record = Varint(self.tokens[index]) + Int(time) + b''.join(args)
+    return b'$' + base64.b64encode(record) + b'\r\n'
+
+  def test_Integers(self):
+    """Verify that integers are printed like the EC does."""
+    line = self.Line(0, 1234567, Int(-5), Int(300), Int(-1), Int(-(1 << 40)),
+                     Int(ord('z')))
+    self.assertEqual(self.detokenizer.DecodeLine(line),
+                     b'[1.234567 -5 300 ffffffff -1099511627776 z]\r\n')
+
+  def test_Pointers(self):
+    """Verify strings, hex buffers, binary values and timestamps."""
+    line = self.Line(1, 17, Bytes(b'string'), Bytes(b'\x12\x34\xab'), Int(5),
+                     Int(8), Int(1234567), Int(0))
+    self.assertEqual(self.detokenizer.DecodeLine(line),
+                     b'[0.000017 string 1234ab 00000101 1.234567 0.000017]'
+                     b'\r\n')
+
+  def test_Padding(self):
+    """Verify the width, precision and flags of the conversions."""
+    line = self.Line(2, 0, Int(42), Bytes(b'ab'), Int(0xbeef), Int(-1234))
+    self.assertEqual(self.detokenizer.DecodeLine(line),
+                     b'[0.000000    42|ab  |0beef|-1.234]\r\n')
+    line = self.Line(3, 0, Int(4), Int(7), Int(3), Bytes(b'abcdef'))
+    self.assertEqual(self.detokenizer.DecodeLine(line),
+                     b'[0.000000    7 abc %]\r\n')
+
+  def test_TimeInMs(self):
+    """Verify timestamps without CONFIG_CONSOLE_VERBOSE."""
+    self.detokenizer.verbose_time = False
+    line = self.Line(1, 1234567, Bytes(b''), Bytes(b''), Int(0), Int(0),
+                     Int(0), Int(0))
+    self.assertEqual(self.detokenizer.DecodeLine(line),
+                     b'[1.234   0 1.234 1.234]\r\n')
+
+  def test_RwImage(self):
+    """Verify that bit 0 of the token selects the RW strings."""
+    self.detokenizer = detokenizer.Detokenizer(b'RO\0', b'RW\0')
+    self.assertEqual(self.detokenizer.DecodeLine(
+        b'$' + base64.b64encode(Varint(1) + Int(0)) + b'\n'),
+                     b'[0.000000 RW]\n')
+
+  def test_InvalidRecords(self):
+    """Verify that anything but valid records is left as it is."""
+    for line in [b'text\r\n', b'$$$\r\n', b'$AAAA\r\n',
+                 b'$' + base64.b64encode(Varint(1000) + Int(0)) + b'\r\n',
+                 self.Line(0, 0, Int(1))]:
+      self.assertEqual(self.detokenizer.DecodeLine(line), line)
+
+  def test_Process(self):
+    """Verify that records split across chunks are decoded."""
+    line = self.Line(0, 0, Int(1), Int(2), Int(3), Int(4), Int(ord('a')))
+    data = b'> ' + b'text\r\n' + line + b'text, then ' + line
+    out = b''
+    for i in range(0, len(data), 7):
+      out += self.detokenizer.Process(data[i:i + 7])
+    decoded = b'[0.000000 1 2 3 4 a]\r\n'
+    self.assertEqual(out, b'> text\r\n' + decoded + b'text, then ' + decoded)
+    self.assertEqual(self.detokenizer.pending, b'')
+
+
+if __name__ == '__main__':
+  unittest.main()
@@ -19,24 +19,46 @@ static const int FLASH_ERASE_BUSY_RV = -EECRESULT - EC_RES_BUSY;
 
 int ec_flash_read(uint8_t *buf, int offset, int size)
 {
-	struct ec_params_flash_read p;
-	int rv;
+	int count = (size + ec_max_insize - 1) / ec_max_insize;
+	struct ec_params_flash_read *p;
+	struct ec_command_req *reqs;
+	int done;
+	int rv = 0;
 	int i;
 
-	/* Read data in chunks */
-	for (i = 0; i < size; i += ec_max_insize) {
-		p.offset = offset + i;
-		p.size = MIN(size - i, ec_max_insize);
-		rv = ec_command(EC_CMD_FLASH_READ, 0,
-				&p, sizeof(p), ec_inbuf, p.size);
-		if (rv < 0) {
-			fprintf(stderr, "Read error at offset %d\n", i);
-			return rv;
-		}
-		memcpy(buf + i, ec_inbuf, p.size);
+	if (!count)
+		return 0;
+
+	p = calloc(count, sizeof(*p));
+	reqs = calloc(count, sizeof(*reqs));
+	if (!p || !reqs) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		rv = -1;
+		goto exit;
 	}
 
-	return 0;
+	/* Read data in chunks, straight to the caller's buffer */
+	for (i = 0; i < count; i++) {
+		p[i].offset = offset + i * ec_max_insize;
+		p[i].size = MIN(size - i * ec_max_insize, ec_max_insize);
+		reqs[i].command = EC_CMD_FLASH_READ;
+		reqs[i].outdata = &p[i];
+		reqs[i].outsize = sizeof(p[i]);
+		reqs[i].indata = buf + i * ec_max_insize;
+		reqs[i].insize = p[i].size;
+	}
+
+	done = ec_command_batch(reqs, count);
+	if (done < count) {
+		fprintf(stderr, "Read error at offset %d\n",
+			done * ec_max_insize);
+		rv = reqs[done].rv;
+	}
+
+exit:
+	free(reqs);
+	free(p);
+	return rv;
 }
 
 int ec_flash_verify(const uint8_t *buf, int offset, int size)
@@ -132,15 +154,22 @@ static int get_flash_write_size(void)
 	return write_size;
 }
 
+/* Number of FLASH_WRITE commands sent at once by ec_flash_write() */
+#define FLASH_WRITE_BATCH 16
+
 int ec_flash_write(const uint8_t *buf, int offset, int size)
 {
-	struct ec_params_flash_write *p =
-		(struct ec_params_flash_write *)ec_outbuf;
+	struct ec_params_flash_write *p;
+	struct ec_command_req reqs[FLASH_WRITE_BATCH];
+	uint8_t *params;
 	int write_size;
 	int pdata_max_size = (int)(ec_max_outsize - sizeof(*p));
 	int step;
-	int rv;
-	int i;
+	int stride;
+	int count;
+	int done;
+	int pos;
+	int rv = 0;
 
 	/*
 	 * Determine whether we can use version 1 of the EC_CMD_FLASH_WRITE
@@ -171,19 +200,40 @@ int ec_flash_write(const uint8_t *buf, int offset, int size)
 	/* Write data in chunks */
 	printf("Write size %d...\n", step);
 
-	for (i = 0; i < size; i += step) {
-		p->offset = offset + i;
-		p->size = MIN(size - i, step);
-		memcpy(p + 1, buf + i, p->size);
-		rv = ec_command(EC_CMD_FLASH_WRITE, 0, p, sizeof(*p) + p->size,
-				NULL, 0);
-		if (rv < 0) {
-			fprintf(stderr, "Write error at offset %d\n", i);
-			return rv;
+	/* Keep the params of each command aligned */
+	stride = (sizeof(*p) + step + 3) & ~3;
+	params = malloc(FLASH_WRITE_BATCH * stride);
+	if (!params) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		return -1;
+	}
+
+	/* Send up to FLASH_WRITE_BATCH commands at once */
+	for (pos = 0; pos < size; pos += count * step) {
+		memset(reqs, 0, sizeof(reqs));
+		for (count = 0; count < FLASH_WRITE_BATCH &&
+		     pos + count * step < size; count++) {
+			p = (struct ec_params_flash_write *)
+				(params + count * stride);
+			p->offset = offset + pos + count * step;
+			p->size = MIN(size - pos - count * step, step);
+			memcpy(p + 1, buf + pos + count * step, p->size);
+			reqs[count].command = EC_CMD_FLASH_WRITE;
+			reqs[count].outdata = p;
+			reqs[count].outsize = sizeof(*p) + p->size;
+		}
+
+		done = ec_command_batch(reqs, count);
+		if (done < count) {
+			fprintf(stderr, "Write error at offset %d\n",
+				pos + done * step);
+			rv = reqs[done].rv;
+			break;
 		}
 	}
 
-	return 0;
+	free(params);
+	return rv;
 }
 
 int ec_flash_erase(int offset, int size)
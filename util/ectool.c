@@ -25,6 +25,7 @@
 #include "ec_flash.h"
 #include "ec_version.h"
 #include "ectool.h"
+#include "fpsensor_frame_codec.h"
 #include "i2c.h"
 #include "lightbar.h"
 #include "lock/gec_lock.h"
@@ -78,6 +79,8 @@ const char help_str[] =
 	"      Cut off battery output power\n"
 	"  batteryparam\n"
 	"      Read or write board-specific battery parameter\n"
+	"  bench [count]\n"
+	"      Measure the speed of host commands over the current interface\n"
 	"  boardversion\n"
 	"      Prints the board version\n"
 	"  button [vup|vdown|rec] <Delay-ms>\n"
@@ -96,7 +99,7 @@ const char help_str[] =
 	"      Prints chip info\n"
 	"  cmdversions <cmd>\n"
 	"      Prints supported version mask for a command number\n"
-	"  console\n"
+	"  console [follow]\n"
 	"      Prints the last output to the EC debug console\n"
 	"  cec\n"
 	"      Read or write CEC messages and settings\n"
@@ -148,8 +151,10 @@ const char help_str[] =
 	"      Sets the fingerprint sensor context\n"
 	"  fpencstatus\n"
 	"      Prints status of Fingerprint sensor encryption engine\n"
-	"  fpframe\n"
-	"      Retrieve the finger image as a PGM image\n"
+	"  fpframe [raw|bench [count]]\n"
+	"      Retrieve the finger image as a PGM image, or the raw frame.\n"
+	"      bench times the download of the raw frame count times, with\n"
+	"      and without compression\n"
 	"  fpinfo\n"
 	"      Prints information about the Fingerprint sensor\n"
 	"  fpmode [capture|deepsleep|fingerdown|fingerup]\n"
@@ -178,6 +183,8 @@ const char help_str[] =
 	"      Protect EC's I2C bus\n"
 	"  i2cread\n"
 	"      Read I2C bus\n"
+	"  i2cstats [port] [reset]\n"
+	"      Print I2C bus transfer statistics\n"
 	"  i2cwrite\n"
 	"      Write I2C bus\n"
 	"  i2cxfer <port> <slave_addr> <read_count> [write bytes...]\n"
@@ -1080,6 +1087,101 @@ exit:
 }
 
 
+static double time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Send the same command count times, one by one or as a batch */
+static double bench_command(int count, int batch, struct ec_command_req *req)
+{
+	struct ec_command_req *reqs;
+	double start, ms = -1;
+	int i;
+
+	reqs = calloc(count, sizeof(*reqs));
+	if (!reqs) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		return -1;
+	}
+	for (i = 0; i < count; i++)
+		reqs[i] = *req;
+
+	start = time_ms();
+	if (batch) {
+		i = ec_command_batch(reqs, count);
+	} else {
+		for (i = 0; i < count; i++) {
+			reqs[i].rv = ec_command(req->command, req->version,
+						req->outdata, req->outsize,
+						req->indata, req->insize);
+			if (reqs[i].rv < 0)
+				break;
+		}
+	}
+	if (i == count)
+		ms = time_ms() - start;
+	else
+		fprintf(stderr, "Command 0x%x failed: %d\n", req->command,
+			reqs[i].rv);
+
+	free(reqs);
+	return ms;
+}
+
+int cmd_bench(int argc, char *argv[])
+{
+	struct ec_params_hello hello_p = { .in_data = 0xa0b0c0d0 };
+	struct ec_response_hello hello_r;
+	struct ec_params_flash_read read_p = { .offset = 0 };
+	struct ec_command_req req = { 0 };
+	int count = 1000;
+	double ms;
+	char *e;
+	int batch;
+
+	if (argc > 1) {
+		count = strtol(argv[1], &e, 0);
+		if ((e && *e) || count <= 0) {
+			fprintf(stderr, "Usage: %s [count]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	/* Round trips of the smallest command */
+	req.command = EC_CMD_HELLO;
+	req.outdata = &hello_p;
+	req.outsize = sizeof(hello_p);
+	req.indata = &hello_r;
+	req.insize = sizeof(hello_r);
+	for (batch = 0; batch <= 1; batch++) {
+		ms = bench_command(count, batch, &req);
+		if (ms < 0)
+			return -1;
+		printf("hello%s: %d commands in %.1f ms, %.0f commands/s, "
+		       "%.1f us per command\n", batch ? " (batch)" : "",
+		       count, ms, count * 1000 / ms, ms * 1000 / count);
+	}
+
+	/* Throughput of the largest responses */
+	read_p.size = ec_max_insize;
+	req.command = EC_CMD_FLASH_READ;
+	req.outdata = &read_p;
+	req.outsize = sizeof(read_p);
+	req.indata = ec_inbuf;
+	req.insize = read_p.size;
+	ms = bench_command(count, 1, &req);
+	if (ms < 0)
+		return -1;
+	printf("flashread (batch): %d x %d bytes in %.1f ms, %.0f bytes/s\n",
+	       count, read_p.size, ms, (double)count * read_p.size * 1000 / ms);
+
+	return 0;
+}
+
 int cmd_read_test(int argc, char *argv[])
 {
 	struct ec_params_read_test p;
@@ -1910,6 +2012,73 @@ int cmd_apreset(int argc, char *argv[])
 
 #define FP_FRAME_INDEX_SIMPLE_IMAGE -1
 
+/* Host commands and bytes received by the last fp_download_frame() */
+static struct {
+	int commands;
+	size_t bytes;
+} fp_frame_stats;
+
+static int fp_frame_command(int version, struct ec_params_fp_frame *p,
+			    void *resp, int resp_size)
+{
+	const int max_attempts = 3;
+	int num_attempts = 0;
+	int rv = 0;
+
+	while (num_attempts < max_attempts) {
+		num_attempts++;
+		rv = ec_command(EC_CMD_FP_FRAME, version, p, sizeof(*p),
+				resp, resp_size);
+		if (rv >= 0)
+			break;
+		if (rv == -EECRESULT - EC_RES_ACCESS_DENIED)
+			break;
+		usleep(100000);
+	}
+	if (rv >= 0) {
+		fp_frame_stats.commands++;
+		fp_frame_stats.bytes += rv;
+	}
+
+	return rv;
+}
+
+/*
+ * Get a chunk of the raw image with version 1 of EC_CMD_FP_FRAME, and
+ * decode it.
+ *
+ * @returns the number of bytes of the image written to ptr, or < 0 on error.
+ */
+static int fp_download_encoded(struct ec_params_fp_frame *p, uint8_t *ptr,
+			       size_t size)
+{
+	struct ec_response_fp_frame_v1 *r = ec_inbuf;
+	int rv;
+
+	p->size = size;
+	rv = fp_frame_command(1, p, r, ec_max_insize);
+	if (rv < 0)
+		return rv;
+	if (rv < sizeof(*r) || !r->size || r->size > size)
+		return -1;
+	rv -= sizeof(*r);
+
+	switch (r->encoding) {
+	case FP_FRAME_ENCODING_RAW:
+		if (rv != r->size)
+			return -1;
+		memcpy(ptr, r->data, rv);
+		return rv;
+	case FP_FRAME_ENCODING_DELTA_RLE:
+		if (fp_frame_decode(r->data, rv, ptr, r->size) != r->size)
+			return -1;
+		return r->size;
+	default:
+		fprintf(stderr, "Unknown frame encoding %d\n", r->encoding);
+		return -1;
+	}
+}
+
 /*
  * Download a frame buffer from the FPMCU.
  *
@@ -1921,12 +2090,15 @@ int cmd_apreset(int argc, char *argv[])
  *  -1 (aka FP_FRAME_INDEX_SIMPLE_IMAGE) for the a single grayscale image.
  *   0  (aka FP_FRAME_INDEX_RAW_IMAGE) for the full vendor raw finger image.
  *   1..n for a finger template.
+ * @param frame_ver version of EC_CMD_FP_FRAME to use for images; templates
+ * always use version 0.
  *
  * @returns a pointer to the buffer allocated to contain the frame or NULL
  * if case of error. The caller must call free() once it no longer needs the
  * buffer.
  */
-static void *fp_download_frame(struct ec_response_fp_info *info, int index)
+static void *fp_download_frame(struct ec_response_fp_info *info, int index,
+			       int frame_ver)
 {
 	struct ec_params_fp_frame p;
 	int rv = 0;
@@ -1936,8 +2108,6 @@ static void *fp_download_frame(struct ec_response_fp_info *info, int index)
 	int cmdver = ec_cmd_version_supported(EC_CMD_FP_INFO, 1) ? 1 : 0;
 	int rsize = cmdver == 1 ? sizeof(*info)
 				: sizeof(struct ec_response_fp_info_v0);
-	const int max_attempts = 3;
-	int num_attempts;
 
 	/* templates not supported in command v0 */
 	if (index > 0 && cmdver == 0)
@@ -1954,6 +2124,7 @@ static void *fp_download_frame(struct ec_response_fp_info *info, int index)
 		size = info->frame_size;
 	} else {
 		size = info->template_size;
+		frame_ver = 0;
 	}
 
 	buffer = malloc(size);
@@ -1962,21 +2133,17 @@ static void *fp_download_frame(struct ec_response_fp_info *info, int index)
 		return NULL;
 	}
 
+	memset(&fp_frame_stats, 0, sizeof(fp_frame_stats));
 	ptr = buffer;
 	p.offset = index << FP_FRAME_INDEX_SHIFT;
 	while (size) {
-		stride = MIN(ec_max_insize, size);
-		p.size = stride;
-		num_attempts = 0;
-		while (num_attempts < max_attempts) {
-			num_attempts++;
-			rv = ec_command(EC_CMD_FP_FRAME, 0, &p, sizeof(p),
-					ptr, stride);
-			if (rv >= 0)
-				break;
-			if (rv == -EECRESULT - EC_RES_ACCESS_DENIED)
-				break;
-			usleep(100000);
+		if (frame_ver == 1) {
+			rv = fp_download_encoded(&p, ptr, size);
+			stride = rv;
+		} else {
+			stride = MIN(ec_max_insize, size);
+			p.size = stride;
+			rv = fp_frame_command(0, &p, ptr, stride);
 		}
 		if (rv < 0) {
 			free(buffer);
@@ -1990,6 +2157,12 @@ static void *fp_download_frame(struct ec_response_fp_info *info, int index)
 	return buffer;
 }
 
+/* Version of EC_CMD_FP_FRAME to download images with */
+static int fp_frame_version(void)
+{
+	return ec_cmd_version_supported(EC_CMD_FP_FRAME, 1) ? 1 : 0;
+}
+
 int cmd_fp_mode(int argc, char *argv[])
 {
 	struct ec_params_fp_mode p;
@@ -2227,15 +2400,76 @@ int cmd_fp_enc_status(int argc, char *argv[])
 	return rv;
 }
 
+/* Compare the download of the raw image with each version of the command */
+static int cmd_fp_frame_bench(int count)
+{
+	struct ec_response_fp_info r;
+	void *frame[2] = { NULL, NULL };
+	double start, ms;
+	int ver, i;
+	int rv = -1;
+
+	for (ver = 0; ver <= fp_frame_version(); ver++) {
+		start = time_ms();
+		for (i = 0; i < count; i++) {
+			free(frame[ver]);
+			frame[ver] = fp_download_frame(
+				&r, FP_FRAME_INDEX_RAW_IMAGE, ver);
+			if (!frame[ver]) {
+				fprintf(stderr, "Failed to get FP sensor "
+					"frame with version %d\n", ver);
+				goto bench_done;
+			}
+		}
+		ms = (time_ms() - start) / count;
+
+		printf("v%d: %d bytes in %d commands, %.1f ms per frame",
+		       ver, (int)fp_frame_stats.bytes, fp_frame_stats.commands,
+		       ms);
+		if (ver)
+			printf(", %d%% of the frame size",
+			       (int)(fp_frame_stats.bytes * 100 /
+				     r.frame_size));
+		printf("\n");
+	}
+
+	if (frame[1] && memcmp(frame[0], frame[1], r.frame_size)) {
+		fprintf(stderr, "Decoded frame differs from the raw frame\n");
+		goto bench_done;
+	}
+	rv = 0;
+
+bench_done:
+	free(frame[0]);
+	free(frame[1]);
+	return rv;
+}
+
 int cmd_fp_frame(int argc, char *argv[])
 {
 	struct ec_response_fp_info r;
 	int idx = (argc == 2 && !strcasecmp(argv[1], "raw")) ?
 		FP_FRAME_INDEX_RAW_IMAGE : FP_FRAME_INDEX_SIMPLE_IMAGE;
-	void *buffer = fp_download_frame(&r, idx);
-	uint8_t *ptr = buffer;
+	void *buffer;
+	uint8_t *ptr;
 	int x, y;
+	char *e;
+
+	if (argc >= 2 && !strcasecmp(argv[1], "bench")) {
+		int count = 10;
+
+		if (argc > 2) {
+			count = strtol(argv[2], &e, 0);
+			if ((e && *e) || count <= 0) {
+				fprintf(stderr, "Bad count\n");
+				return -1;
+			}
+		}
+		return cmd_fp_frame_bench(count);
+	}
 
+	buffer = fp_download_frame(&r, idx, fp_frame_version());
+	ptr = buffer;
 	if (!buffer) {
 		fprintf(stderr, "Failed to get FP sensor frame\n");
 		return -1;
@@ -2281,7 +2515,7 @@ int cmd_fp_template(int argc, char *argv[])
 
 	idx = strtol(argv[1], &e, 0);
 	if (!(e && *e)) {
-		buffer = fp_download_frame(&r, idx + 1);
+		buffer = fp_download_frame(&r, idx + 1, 0);
 		if (!buffer) {
 			fprintf(stderr, "Failed to get FP template %d\n", idx);
 			return -1;
@@ -4985,6 +5219,7 @@ static const struct {
 	ST_BOTH_SIZES(sensor_scale),
 	ST_BOTH_SIZES(online_calib_read),
 	ST_BOTH_SIZES(get_activity),
+	ST_BOTH_SIZES(threshold_window),
 };
 BUILD_ASSERT(ARRAY_SIZE(ms_command_sizes) == MOTIONSENSE_NUM_CMDS);
 
@@ -5008,6 +5243,8 @@ static int ms_help(const char *cmd)
 		cmd);
 	printf("  %s offset NUM [-- X Y Z [TEMP]] - set/get sensor offset\n",
 		cmd);
+	printf("  %s threshold NUM [PERCENT]      - set/get threshold "
+		"window\n", cmd);
 	printf("  %s kb_wake NUM                  - set/get KB wake ang\n",
 		cmd);
 	printf("  %s fifo_info                    - print fifo info\n", cmd);
@@ -5378,6 +5615,35 @@ static int cmd_motionsense(int argc, char **argv)
 		return 0;
 	}
 
+	if (argc > 2 && argc < 5 && !strcasecmp(argv[1], "threshold")) {
+		param.cmd = MOTIONSENSE_CMD_THRESHOLD_WINDOW;
+		param.threshold_window.window = EC_MOTION_SENSE_NO_VALUE;
+
+		param.threshold_window.sensor_num = strtol(argv[2], &e, 0);
+		if (e && *e) {
+			fprintf(stderr, "Bad %s arg.\n", argv[2]);
+			return -1;
+		}
+
+		if (argc == 4) {
+			param.threshold_window.window = strtol(argv[3], &e, 0);
+			if (e && *e) {
+				fprintf(stderr, "Bad %s arg.\n", argv[3]);
+				return -1;
+			}
+		}
+
+		rv = ec_command(EC_CMD_MOTION_SENSE_CMD, 1,
+				&param, ms_command_sizes[param.cmd].outsize,
+				resp, ms_command_sizes[param.cmd].insize);
+
+		if (rv < 0)
+			return rv;
+
+		printf("%d\n", resp->threshold_window.ret);
+		return 0;
+	}
+
 	if (argc < 4 && !strcasecmp(argv[1], "kb_wake")) {
 		param.cmd = MOTIONSENSE_CMD_KB_WAKE_ANGLE;
 		param.kb_wake_angle.data = EC_MOTION_SENSE_NO_VALUE;
@@ -7035,6 +7301,72 @@ int cmd_i2c_protect(int argc, char *argv[])
 }
 
 
+static void print_i2c_stats(int port, const struct ec_response_i2c_stats *r)
+{
+	int i;
+
+	printf("I2C port %d: %u xfers, %u bytes out, %u bytes in, "
+	       "%u errors, %u retries\n", port, r->xfers, r->bytes_out,
+	       r->bytes_in, r->errors, r->retries);
+	printf("  locked %u times for %u us, %u us in transfers\n",
+	       r->lock_count, r->lock_time_us, r->xfer_time_us);
+
+	for (i = 0; i < EC_I2C_STATS_HIST_BUCKETS; i++) {
+		if (!r->hist[i])
+			continue;
+		if (i == EC_I2C_STATS_HIST_BUCKETS - 1)
+			printf("  >= %6u us: %u\n", 1U << (i - 1), r->hist[i]);
+		else
+			printf("  <  %6u us: %u\n", 1U << i, r->hist[i]);
+	}
+
+	for (i = 0; i < r->addr_count && i < EC_I2C_STATS_MAX_ADDRS; i++)
+		printf("  addr 0x%02x: %u xfers, %u bytes, %u errors\n",
+		       r->addrs[i].addr_flags, r->addrs[i].xfers,
+		       r->addrs[i].bytes, r->addrs[i].errors);
+}
+
+int cmd_i2c_stats(int argc, char *argv[])
+{
+	struct ec_params_i2c_stats p = { 0 };
+	struct ec_response_i2c_stats r;
+	int port = -1, port_count;
+	char *e;
+	int rv;
+
+	if (argc > 1 && strcmp(argv[1], "reset")) {
+		port = strtol(argv[1], &e, 0);
+		if ((e && *e) || port < 0) {
+			fprintf(stderr, "Bad port.\n");
+			return -1;
+		}
+		argc--;
+		argv++;
+	}
+	if (argc > 1) {
+		if (strcmp(argv[1], "reset")) {
+			fprintf(stderr, "Usage: i2cstats [port] [reset]\n");
+			return -1;
+		}
+		p.flags = EC_I2C_STATS_FLAG_RESET;
+	}
+
+	p.port = port < 0 ? 0 : port;
+	do {
+		rv = ec_command(EC_CMD_I2C_STATS, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0)
+			return rv;
+
+		print_i2c_stats(p.port, &r);
+		port_count = r.port_count;
+		p.port++;
+	} while (port < 0 && p.port < port_count);
+
+	return 0;
+}
+
+
 int do_i2c_xfer(unsigned int port, unsigned int addr,
 		uint8_t *write_buf, int write_len,
 		uint8_t **read_buf, int read_len) {
@@ -8552,11 +8884,58 @@ int cmd_rtc_get_alarm(int argc, char *argv[])
 	return 0;
 }
 
+/* Print the console output as it comes, until interrupted */
+static int console_follow(void)
+{
+	struct ec_params_console_read_v2 p;
+	struct ec_response_console_read_v2 *r = ec_inbuf;
+	struct ec_response_get_next_event_v1 event;
+	int rv;
+
+	if (!ec_cmd_version_supported(EC_CMD_CONSOLE_READ, 2)) {
+		fprintf(stderr, "EC does not support incremental reads\n");
+		return -1;
+	}
+
+	/* Start with the oldest output in the buffer */
+	p.seq = 0;
+	/* Ask for an event as soon as there is new output */
+	p.watermark = ec_pollevent ? 1 : 0;
+
+	while (1) {
+		rv = ec_command(EC_CMD_CONSOLE_READ, 2, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < sizeof(*r))
+			return -1;
+
+		fwrite(r->data, 1, rv - sizeof(*r), stdout);
+		p.seq = r->next_seq;
+		if (r->next_seq != r->head_seq)
+			continue;
+
+		fflush(stdout);
+		if (!ec_pollevent ||
+		    ec_pollevent(1 << EC_MKBP_EVENT_CONSOLE_DATA, &event,
+				 sizeof(event), 1000) < 0)
+			usleep(100000);
+	}
+}
+
 int cmd_console(int argc, char *argv[])
 {
 	char *out = (char *)ec_inbuf;
 	int rv;
 
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "follow")) {
+			fprintf(stderr, "Usage: %s [follow]\n", argv[0]);
+			return -1;
+		}
+		return console_follow();
+	}
+
 	/* Snapshot the EC console */
 	rv = ec_command(EC_CMD_CONSOLE_SNAPSHOT, 0, NULL, 0, NULL, 0);
 	if (rv < 0)
@@ -10297,6 +10676,7 @@ const struct command commands[] = {
 	{"battery", cmd_battery},
 	{"batterycutoff", cmd_battery_cut_off},
 	{"batteryparam", cmd_battery_vendor_param},
+	{"bench", cmd_bench},
 	{"boardversion", cmd_board_version},
 	{"button", cmd_button},
 	{"cbi", cmd_cbi},
@@ -10348,6 +10728,7 @@ const struct command commands[] = {
 	{"locatechip", cmd_locate_chip},
 	{"i2cprotect", cmd_i2c_protect},
 	{"i2cread", cmd_i2c_read},
+	{"i2cstats", cmd_i2c_stats},
 	{"i2cwrite", cmd_i2c_write},
 	{"i2cxfer", cmd_i2c_xfer},
 	{"infopddev", cmd_pd_device_info},
@@ -119,6 +119,8 @@ struct iteflash_config {
 	int usb_vid;
 	int usb_pid;
 	int verify;  /* boolean */
+	int skip_unchanged;  /* boolean */
+	int dry_run;  /* boolean */
 	char *usb_serial;
 	char *i2c_dev_path;
 	const struct i2c_interface *i2c_if;
@@ -186,8 +188,15 @@ static void config_release(struct iteflash_config *conf)
 	null_and_free((void **)&conf->i2c_dev_path);
 }
 
-/* number of bytes to send consecutively before checking for ACKs */
-#define FTDI_TX_BUFFER_LIMIT	32
+/*
+ * Number of bytes to send consecutively before checking for ACKs.  Each byte
+ * takes 12 bytes of MPSSE commands, all sent in one USB transfer, so this
+ * sets how many round trips a block write takes.
+ */
+#define FTDI_TX_BUFFER_LIMIT	128
+
+/* The commands of a batch and the START condition fit in the buffer. */
+BUILD_ASSERT(FTDI_TX_BUFFER_LIMIT * 12 + 18 <= FTDI_CMD_BUF_SIZE);
 
 static inline int i2c_byte_transfer(struct common_hnd *chnd, uint8_t addr,
 				    uint8_t *data, int write, int numbytes)
@@ -1609,45 +1618,18 @@ static int write_flash(struct common_hnd *chnd, const char *filename,
 }
 
 /*
- * Return zero on success, a negative error value on failures.
- *
- * Change the program command to match the ITE Download
- * The original flow may not work on the DX chip.
+ * Program size bytes at address with the AAI word program command, in
+ * blocks of block_write_size bytes.
  *
+ * Return zero on success, a negative error value on failures.
  */
-static int write_flash2(struct common_hnd *chnd, const char *filename,
-			uint32_t offset)
+static int command_write_aai(struct common_hnd *chnd, uint32_t address,
+			     uint32_t size, uint8_t *buffer)
 {
-	int res;
 	int block_write_size = chnd->conf.block_write_size;
-	FILE *hnd;
-	int size = chnd->flash_size;
+	uint32_t remaining = size;
 	int cnt, two_bytes_sent, ret;
 	uint8_t addr_h, addr_m, addr_l, data_ff = 0xff;
-	uint8_t *buffer = malloc(size);
-
-	if (!buffer) {
-		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
-			size);
-		return -ENOMEM;
-	}
-
-	hnd = fopen(filename, "r");
-	if (!hnd) {
-		fprintf(stderr, "%s: Cannot open file %s for reading\n",
-			__func__, filename);
-		free(buffer);
-		return -EIO;
-	}
-	res = fread(buffer, 1, size, hnd);
-	if (res <= 0) {
-		fprintf(stderr, "%s: Failed to read %d bytes from %s with "
-			"ferror() %d\n", __func__, size, filename, ferror(hnd));
-		fclose(hnd);
-		free(buffer);
-		return -EIO;
-	}
-	fclose(hnd);
 
 	/* Enter follow mode */
 	if (spi_flash_follow_mode(chnd, "AAI write") < 0) {
@@ -1655,12 +1637,10 @@ static int write_flash2(struct common_hnd *chnd, const char *filename,
 		goto failed_enter_mode;
 	}
 
-	printf("Writing %d bytes at 0x%08x.......\n", res, offset);
-
 __send_aai_cmd:
-	addr_h = (offset >> 16) & 0xff;
-	addr_m = (offset >> 8) & 0xff;
-	addr_l = offset & 0xff;
+	addr_h = (address >> 16) & 0xff;
+	addr_m = (address >> 8) & 0xff;
+	addr_l = address & 0xff;
 
 	/* write enable command */
 	ret = spi_flash_command_short(chnd, SPI_CMD_WRITE_ENABLE, "SPI WE");
@@ -1671,11 +1651,12 @@ __send_aai_cmd:
 	ret |= i2c_byte_transfer(chnd, I2C_DATA_ADDR, &addr_m, 1, 1);
 	ret |= i2c_byte_transfer(chnd, I2C_DATA_ADDR, &addr_l, 1, 1);
 	/* Send first two bytes of buffe */
-	ret |= i2c_byte_transfer(chnd, I2C_DATA_ADDR, &buffer[offset], 1, 1);
-	ret |= i2c_byte_transfer(chnd, I2C_DATA_ADDR, &buffer[offset+1], 1, 1);
+	ret |= i2c_byte_transfer(chnd, I2C_DATA_ADDR, &buffer[0], 1, 1);
+	ret |= i2c_byte_transfer(chnd, I2C_DATA_ADDR, &buffer[1], 1, 1);
 	/* we had sent two bytes */
-	offset += 2;
-	res -= 2;
+	address += 2;
+	buffer += 2;
+	remaining -= 2;
 	two_bytes_sent = 1;
 	/* Wait until not busy */
 	if (spi_poll_busy(chnd, "wait busy bit cleared at AAI write ") < 0) {
@@ -1687,25 +1668,27 @@ __send_aai_cmd:
 	if (ret < 0)
 		goto failed_write;
 
-	while (res) {
-		cnt = (res > block_write_size) ? block_write_size : res;
+	while (remaining) {
+		cnt = (remaining > block_write_size) ?
+			block_write_size : remaining;
 		/* we had sent two bytes */
 		if (two_bytes_sent) {
 			two_bytes_sent = 0;
 			cnt -= 2;
 		}
-		if (i2c_byte_transfer(chnd, I2C_BLOCK_ADDR, &buffer[offset],
+		if (i2c_byte_transfer(chnd, I2C_BLOCK_ADDR, buffer,
 			1, cnt) < 0) {
 			ret = -EIO;
 			goto failed_write;
 		}
 
-		res -= cnt;
-		offset += cnt;
-		draw_spinner(res, res + offset);
+		remaining -= cnt;
+		address += cnt;
+		buffer += cnt;
+		draw_spinner(remaining, size);
 
 		/* We need to resend aai write command at 256KB boundary. */
-		if (!(offset % 0x40000) && res) {
+		if (!(address % 0x40000) && remaining) {
 			/* disable quick AAI mode */
 			i2c_byte_transfer(chnd, I2C_DATA_ADDR, &data_ff, 1, 1);
 			i2c_write_byte(chnd, 0x10, 0x00);
@@ -1727,13 +1710,6 @@ failed_enter_mode:
 	/* exit follow mode */
 	spi_flash_follow_mode_exit(chnd, "AAI write");
 
-	if (ret < 0)
-		printf("\n\rWriting Failed.\n");
-	else
-		printf("\n\rWriting Done.\n");
-
-	free(buffer);
-
 	return ret;
 }
 
@@ -1744,17 +1720,16 @@ failed_enter_mode:
  * The original flow may not work on the DX chip.
  *
  */
-static int write_flash3(struct common_hnd *chnd, const char *filename,
+static int write_flash2(struct common_hnd *chnd, const char *filename,
 			uint32_t offset)
 {
-	int res, ret = 0;
-	int block_write_size = chnd->conf.block_write_size;
+	int res;
 	FILE *hnd;
 	int size = chnd->flash_size;
-	int cnt;
-	uint8_t *buf = malloc(size);
+	int ret;
+	uint8_t *buffer = malloc(size);
 
-	if (!buf) {
+	if (!buffer) {
 		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
 			size);
 		return -ENOMEM;
@@ -1764,20 +1739,44 @@ static int write_flash3(struct common_hnd *chnd, const char *filename,
 	if (!hnd) {
 		fprintf(stderr, "%s: Cannot open file %s for reading\n",
 			__func__, filename);
-		free(buf);
+		free(buffer);
 		return -EIO;
 	}
-	res = fread(buf, 1, size, hnd);
+	res = fread(buffer, 1, size, hnd);
 	if (res <= 0) {
 		fprintf(stderr, "%s: Failed to read %d bytes from %s with "
 			"ferror() %d\n", __func__, size, filename, ferror(hnd));
 		fclose(hnd);
-		free(buf);
+		free(buffer);
 		return -EIO;
 	}
 	fclose(hnd);
 
 	printf("Writing %d bytes at 0x%08x.......\n", res, offset);
+	ret = command_write_aai(chnd, offset, res, buffer);
+
+	if (ret < 0)
+		printf("\n\rWriting Failed.\n");
+	else
+		printf("\n\rWriting Done.\n");
+
+	free(buffer);
+
+	return ret;
+}
+
+/*
+ * Program size bytes at address with the page program command, which
+ * allows up to 256 bytes at a time.
+ *
+ * Return zero on success, a negative error value on failures.
+ */
+static int command_write_pages_pp(struct common_hnd *chnd, uint32_t address,
+				  uint32_t size, uint8_t *buffer)
+{
+	int block_write_size = chnd->conf.block_write_size;
+	uint32_t remaining = size;
+	int cnt, ret;
 
 	/* Enter follow mode */
 	ret = spi_flash_follow_mode(chnd, "Page program");
@@ -1788,23 +1787,71 @@ static int write_flash3(struct common_hnd *chnd, const char *filename,
 	if (block_write_size > 256)
 		block_write_size = 256;
 
-	while (res) {
-		cnt = (res > block_write_size) ? block_write_size : res;
-		if (command_write_pages3(chnd, offset, cnt, &buf[offset]) < 0) {
+	while (remaining) {
+		cnt = (remaining > block_write_size) ?
+			block_write_size : remaining;
+		if (command_write_pages3(chnd, address, cnt, buffer) < 0) {
 			ret = -EIO;
 			goto failed_write;
 		}
 
-		res -= cnt;
-		offset += cnt;
-		draw_spinner(res, res + offset);
+		remaining -= cnt;
+		address += cnt;
+		buffer += cnt;
+		draw_spinner(remaining, size);
 	}
 
 failed_write:
-	free(buf);
 	spi_flash_command_short(chnd, SPI_CMD_WRITE_DISABLE,
 		"SPI write disable");
 	spi_flash_follow_mode_exit(chnd, "Page program");
+
+	return ret;
+}
+
+/*
+ * Return zero on success, a negative error value on failures.
+ *
+ * Change the program command to match the ITE Download
+ * The original flow may not work on the DX chip.
+ *
+ */
+static int write_flash3(struct common_hnd *chnd, const char *filename,
+			uint32_t offset)
+{
+	int res, ret = 0;
+	FILE *hnd;
+	int size = chnd->flash_size;
+	uint8_t *buf = malloc(size);
+
+	if (!buf) {
+		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
+			size);
+		return -ENOMEM;
+	}
+
+	hnd = fopen(filename, "r");
+	if (!hnd) {
+		fprintf(stderr, "%s: Cannot open file %s for reading\n",
+			__func__, filename);
+		free(buf);
+		return -EIO;
+	}
+	res = fread(buf, 1, size, hnd);
+	if (res <= 0) {
+		fprintf(stderr, "%s: Failed to read %d bytes from %s with "
+			"ferror() %d\n", __func__, size, filename, ferror(hnd));
+		fclose(hnd);
+		free(buf);
+		return -EIO;
+	}
+	fclose(hnd);
+
+	printf("Writing %d bytes at 0x%08x.......\n", res, offset);
+
+	ret = command_write_pages_pp(chnd, offset, res, buf);
+
+	free(buf);
 	if (ret < 0)
 		fprintf(stderr, "%s: Error writing to flash\n", __func__);
 	else
@@ -1813,6 +1860,252 @@ failed_write:
 	return ret;
 }
 
+/*
+ * Program size bytes at address with the command the flash supports, without
+ * leaving or entering DBGR mode.
+ *
+ * Return zero on success, a negative error value on failures.
+ */
+static int program_range(struct common_hnd *chnd, uint32_t address,
+			 uint32_t size, uint8_t *buffer)
+{
+	if (!chnd->flash_cmd_v2) {
+		if (command_write_pages(chnd, address, size, buffer) != size)
+			return -EIO;
+		return 0;
+	}
+
+	switch (eflash_type) {
+	case EFLASH_TYPE_8315:
+		return command_write_aai(chnd, address, size, buffer);
+	case EFLASH_TYPE_KGD:
+		return command_write_pages_pp(chnd, address, size, buffer);
+	default:
+		printf("Invalid EFLASH TYPE!");
+		return -EINVAL;
+	}
+}
+
+/*
+ * Erase the sectors covering len bytes at off, which must both be multiples
+ * of the sector size.
+ *
+ * Return zero on success, a negative error value on failures.
+ */
+static int command_erase_sectors(struct common_hnd *chnd, uint32_t len,
+				 uint32_t off)
+{
+	int res = -EIO;
+	int page = off / PAGE_SIZE;
+	uint32_t remaining = len;
+
+	if (spi_flash_follow_mode(chnd, "erase") < 0)
+		goto failed_erase;
+
+	while (remaining) {
+		if (spi_flash_command_short(chnd, SPI_CMD_WRITE_ENABLE,
+			"write enable for erase") < 0)
+			goto failed_erase;
+
+		if (spi_check_write_enable(chnd, "erase") < 0)
+			goto failed_erase;
+
+		if (spi_flash_command_short(chnd, spi_cmd_sector_erase,
+			"sector erase") < 0)
+			goto failed_erase;
+
+		if (spi_flash_set_erase_page(chnd, page, "sector erase") < 0)
+			goto failed_erase;
+
+		if (spi_poll_busy(chnd, "erase") < 0)
+			goto failed_erase;
+
+		if (spi_flash_command_short(chnd, SPI_CMD_WRITE_DISABLE,
+			"write disable for erase") < 0)
+			goto failed_erase;
+
+		page += sector_erase_pages;
+		remaining -= sector_erase_pages * PAGE_SIZE;
+	}
+
+	/* No error so far */
+	res = 0;
+
+failed_erase:
+	if (spi_flash_command_short(chnd, SPI_CMD_WRITE_DISABLE,
+		"write disable exit erase") < 0)
+		res = -EIO;
+
+	if (spi_flash_follow_mode_exit(chnd, "erase") < 0)
+		res = -EIO;
+
+	return res;
+}
+
+/*
+ * Return len, less the pages at its end which are all 0xff: they are left
+ * as they are by the erase, and need no programming.
+ */
+static uint32_t trim_erased_pages(const uint8_t *buffer, uint32_t len)
+{
+	uint32_t i;
+
+	while (len) {
+		for (i = len - PAGE_SIZE; i < len; i++) {
+			if (buffer[i] != 0xff)
+				return len;
+		}
+		len -= PAGE_SIZE;
+	}
+
+	return 0;
+}
+
+/* Return the number of changed sectors in a row, from first */
+static int changed_run(const uint8_t *changed, int first, int sectors)
+{
+	int n = 0;
+
+	while (first + n < sectors && changed[first + n])
+		n++;
+
+	return n;
+}
+
+/*
+ * Write the image in filename, only erasing and programming the sectors which
+ * differ from the flash content: reading the flash back takes a fraction of
+ * the time erasing and programming it does.  The rest of the flash is
+ * compared with 0xff, as after a full chip erase.  With dry_run, only report
+ * the sectors that would be written.
+ *
+ * Return zero on success, a negative error value on failures.
+ */
+static int write_flash_changed(struct common_hnd *chnd, const char *filename)
+{
+	uint32_t sector_size = sector_erase_pages * PAGE_SIZE;
+	int size = chnd->flash_size;
+	int sectors = size / sector_size;
+	int i, n, res, ret = -ENOMEM;
+	int changed_count = 0;
+	uint32_t address, len, program_bytes = 0;
+	FILE *hnd;
+	uint8_t *image = malloc(size);
+	uint8_t *flash = malloc(size);
+	uint8_t *changed = calloc(sectors, 1);
+
+	if (!image || !flash || !changed) {
+		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
+			size);
+		goto exit;
+	}
+
+	hnd = fopen(filename, "r");
+	if (!hnd) {
+		fprintf(stderr, "%s: Cannot open file %s for reading\n",
+			__func__, filename);
+		ret = -EIO;
+		goto exit;
+	}
+	res = fread(image, 1, size, hnd);
+	if (res <= 0) {
+		fprintf(stderr, "%s: Failed to read %d bytes from %s with "
+			"ferror() %d\n", __func__, size, filename, ferror(hnd));
+		fclose(hnd);
+		ret = -EIO;
+		goto exit;
+	}
+	fclose(hnd);
+	memset(image + res, 0xff, size - res);
+
+	printf("Reading %d bytes to compare with %s\n", size, filename);
+	if (command_read_pages(chnd, 0, size, flash) != size) {
+		fprintf(stderr, "%s: Error reading flash\n", __func__);
+		ret = -EIO;
+		goto exit;
+	}
+
+	for (i = 0; i < sectors; i++) {
+		address = i * sector_size;
+		if (!memcmp(image + address, flash + address, sector_size))
+			continue;
+		changed[i] = 1;
+		changed_count++;
+	}
+	for (i = 0; i < sectors; i += n ? n : 1) {
+		n = changed_run(changed, i, sectors);
+		program_bytes += trim_erased_pages(image + i * sector_size,
+						   n * sector_size);
+	}
+
+	printf("\n\r%s%d of %d sectors changed, %u bytes to program.\n",
+		chnd->conf.dry_run ? "Dry run: " : "", changed_count, sectors,
+		program_bytes);
+	if (chnd->conf.dry_run || !changed_count) {
+		ret = 0;
+		goto exit;
+	}
+
+	printf("Erasing %d sectors...\n", changed_count);
+	for (i = 0; i < sectors; i += n ? n : 1) {
+		n = changed_run(changed, i, sectors);
+		if (!n)
+			continue;
+		draw_spinner(sectors - i, sectors);
+		ret = command_erase_sectors(chnd, n * sector_size,
+					    i * sector_size);
+		if (ret < 0)
+			goto exit;
+	}
+	printf("\n\rErasing Done.\n");
+	/* Call DBGR Rest to clear the EC lock status after erasing */
+	dbgr_reset(chnd, RSTS_VCCDO_PW_ON|RSTS_HGRST|RSTS_GRST);
+
+	/*
+	 * Program each run of changed sectors, then read it back before the
+	 * next one: a failure stops the write early, and the verification
+	 * only reads the sectors written.
+	 */
+	printf("Writing %u bytes.......\n", program_bytes);
+	for (i = 0; i < sectors; i += n ? n : 1) {
+		n = changed_run(changed, i, sectors);
+		if (!n)
+			continue;
+		address = i * sector_size;
+		len = trim_erased_pages(image + address, n * sector_size);
+		if (len) {
+			ret = program_range(chnd, address, len,
+					    image + address);
+			if (ret < 0) {
+				fprintf(stderr, "%s: Error writing to flash\n",
+					__func__);
+				goto exit;
+			}
+		}
+
+		if (!chnd->conf.verify)
+			continue;
+
+		len = n * sector_size;
+		if (command_read_pages(chnd, address, len, flash + address) !=
+		    len || memcmp(image + address, flash + address, len)) {
+			printf("\n\rVerify Failed at 0x%08x!\n", address);
+			ret = -EIO;
+			goto exit;
+		}
+	}
+	printf("\n\rWriting Done.\n");
+	if (chnd->conf.verify)
+		printf("Verify Done.\n");
+	ret = 0;
+
+exit:
+	free(image);
+	free(flash);
+	free(changed);
+	return ret;
+}
+
 
 
 /* Return zero on success, a non-zero value on failures. */
@@ -2050,6 +2343,7 @@ static int strdup_with_errmsg(const char *source, char **dest, const char *name)
 static const struct option longopts[] = {
 	{"block-write-size", 1, 0, 'b'},
 	{"debug", 0, 0, 'd'},
+	{"dry-run", 0, 0, 'N'},
 	{"erase", 0, 0, 'e'},
 	{"help", 0, 0, 'h'},
 	{"i2c-dev-path", 1, 0, 'D'},
@@ -2064,6 +2358,7 @@ static const struct option longopts[] = {
 	{"read", 1, 0, 'r'},
 	{"send-waveform", 1, 0, 'W'},
 	{"serial", 1, 0, 's'},
+	{"skip-unchanged", 0, 0, 'u'},
 	{"vendor", 1, 0, 'v'},
 	{"write", 1, 0, 'w'},
 	{NULL, 0, 0, 0}
@@ -2074,7 +2369,7 @@ static void display_usage(const char *program)
 	fprintf(stderr, "Usage: %s [-d] [-v <VID>] [-p <PID>] \\\n"
 		"\t[-c <linux|ccd|ftdi>] [-D /dev/i2c-<N>] [-i <1|2>] [-S] \\\n"
 		"\t[-s <serial>] [-e] [-r <file>] [-W <0|1|false|true>] \\\n"
-		"\t[-w <file>] [-R base[:size]] [-m] [-b <size>]\n",
+		"\t[-w <file>] [-R base[:size]] [-m] [-b <size>] [-u] [-N]\n",
 		program);
 	fprintf(stderr, "-d, --debug : Output debug traces.\n");
 	fprintf(stderr, "-e, --erase : Erase all the flash content.\n");
@@ -2088,6 +2383,8 @@ static void display_usage(const char *program)
 	fprintf(stderr, "-m, --i2c-mux : Enable i2c-mux (to EC).\n"
 		"\tSpecify this flag only if the board has an I2C MUX and\n"
 		"\tyou are not using servod.\n");
+	fprintf(stderr, "-N, --dry-run : With --write, only report how many\n"
+		"\tsectors differ from <file> and would be written.\n");
 	fprintf(stderr, "-n, --noverify : Don't auto verify.\n");
 	fprintf(stderr, "-b, --block-write-size <size> : Perform writes in\n"
 		"\tblocks of this many bytes.\n");
@@ -2100,6 +2397,9 @@ static void display_usage(const char *program)
 	fprintf(stderr, "-r, --read <file> : Read the flash content and"
 			" write it into <file>.\n");
 	fprintf(stderr, "-s, --serial <serialname> : USB serial string\n");
+	fprintf(stderr, "-u, --skip-unchanged : With --write, read the flash\n"
+		"\tfirst and only erase, program and verify the sectors\n"
+		"\twhich differ from <file>. --erase is ignored.\n");
 	fprintf(stderr, "-v, --vendor <0x1234> : USB vendor ID\n");
 	fprintf(stderr, "-W, --send-waveform <0|1|false|true> : Send the"
 		" special waveform.\n"
@@ -2153,7 +2453,7 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 	int opt, idx, ret = 0;
 
 	while (!ret &&
-	       (opt = getopt_long(argc, argv, "?b:c:D:dehi:mp:R:r:s:uv:W:w:Zz",
+	       (opt = getopt_long(argc, argv, "?b:c:D:dehi:mNp:R:r:s:uv:W:w:Zz",
 				  longopts, &idx)) != -1) {
 		switch (opt) {
 		case 'b':
@@ -2193,6 +2493,10 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 		case 'm':
 			conf->i2c_mux = 1;
 			break;
+		case 'N':
+			conf->dry_run = 1;
+			conf->skip_unchanged = 1;
+			break;
 		case 'n':
 			conf->verify = 0;
 			break;
@@ -2210,6 +2514,9 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 			ret = strdup_with_errmsg(optarg, &conf->usb_serial,
 				"-s / --serial");
 			break;
+		case 'u':
+			conf->skip_unchanged = 1;
+			break;
 		case 'v':
 			conf->usb_vid = strtol(optarg, NULL, 16);
 			break;
@@ -2357,6 +2664,11 @@ int main(int argc, char **argv)
 	if (ret)
 		goto return_after_init;
 
+	if (chnd.conf.output_filename && chnd.conf.skip_unchanged) {
+		ret = write_flash_changed(&chnd, chnd.conf.output_filename);
+		goto return_after_init;
+	}
+
 	if (chnd.conf.erase) {
 		if (chnd.flash_cmd_v2)
 			/* Do Normal Erase Function */
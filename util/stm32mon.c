@@ -301,6 +301,7 @@ enum {
 	FLAG_GO             = 0x04,
 	FLAG_READ_UNPROTECT = 0x08,
 	FLAG_CR50_MODE	    = 0x10,
+	FLAG_SKIP_IDENTICAL = 0x20,
 };
 
 typedef struct {
@@ -346,6 +347,25 @@ enum {
 
 BUILD_ASSERT(ARRAY_SIZE(stat_resp) == MAX_EVENT_IDX);
 
+/* Time spent in each step of the flashing, for the summary at the end. */
+static struct {
+	double erase;
+	double read;
+	double write;
+	uint32_t bytes_read;
+	uint32_t bytes_written;
+	uint32_t pages_erased;
+	uint32_t pages_skipped;
+} timing;
+
+static double get_time_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 /*
  * Print data into the log file, in hex, 16 bytes per line, prefix the first
  * line with the value supplied by the caller (usually 'r' or 'w' for
@@ -877,9 +897,16 @@ int command_get_commands(int fd, struct stm32_def *chip)
 static int use_progressbar;
 static int windex;
 static const char wheel[] = {'|', '/', '-', '\\' };
+static int last_percent = -1;
 static void draw_spinner(uint32_t remaining, uint32_t size)
 {
 	int percent = (size - remaining)*100/size;
+
+	/* Only redraw when the progress changes */
+	if (percent == last_percent)
+		return;
+	last_percent = percent;
+
 	if (use_progressbar) {
 		int dots = percent / 4;
 
@@ -904,7 +931,9 @@ int command_read_mem(int fd, uint32_t address, uint32_t size, uint8_t *buffer)
 		{4, (uint8_t *)&addr_be},
 		{1, &cnt}
 	};
+	double start = get_time_s();
 
+	last_percent = -1;
 	while (remaining) {
 		uint32_t bytes = MIN(remaining, PAGE_SIZE);
 
@@ -923,6 +952,8 @@ int command_read_mem(int fd, uint32_t address, uint32_t size, uint8_t *buffer)
 		remaining -= bytes;
 	}
 
+	timing.read += get_time_s() - start;
+	timing.bytes_read += size;
 	return size;
 }
 
@@ -938,7 +969,9 @@ int command_write_mem(int fd, uint32_t address, uint32_t size, uint8_t *buffer)
 		{4, (uint8_t *)&addr_be},
 		{sizeof(outbuf), outbuf}
 	};
+	double start = get_time_s();
 
+	last_percent = -1;
 	while (remaining) {
 		cnt = MIN(remaining, PAGE_SIZE);
 		/* skip empty blocks to save time */
@@ -956,12 +989,14 @@ int command_write_mem(int fd, uint32_t address, uint32_t size, uint8_t *buffer)
 					   NULL, 0, 1);
 			if (IS_STM32_ERROR(res))
 				return STM32_EIO;
+			timing.bytes_written += cnt;
 		}
 		buffer += cnt;
 		address += cnt;
 		remaining -= cnt;
 	}
 
+	timing.write += get_time_s() - start;
 	return size;
 }
 
@@ -1350,9 +1385,107 @@ int read_flash(int fd, struct stm32_def *chip, const char *filename,
 	return IS_STM32_ERROR(res) ? res : STM32_SUCCESS;
 }
 
+/*
+ * Erase pages of the main flash memory, at most 128 at a time.
+ * Return zero on success, a negative error value on failures.
+ */
+static int erase_pages(int fd, int start, int count)
+{
+	double t = get_time_s();
+	int res = STM32_SUCCESS;
+	int i;
+
+	for (i = 0; i < count && !IS_STM32_ERROR(res); i += 128)
+		res = erase(fd, MIN(128, count - i), start + i);
+
+	timing.erase += get_time_s() - t;
+	timing.pages_erased += count;
+	return IS_STM32_ERROR(res) ? res : STM32_SUCCESS;
+}
+
+/*
+ * Whether the pages of the chip all have the same size. The F4, F7 and H7
+ * have sectors of different sizes instead, and page_size does not describe
+ * them.
+ */
+static int has_uniform_pages(const struct stm32_def *chip)
+{
+	return chip->page_size <= 2048;
+}
+
+/*
+ * Read back the flash under the image, erase only the pages which differ
+ * from it, and blank the identical ones in the image so that
+ * command_write_mem() skips them.
+ *
+ * When the image ends partway through a page, the rest of that page is
+ * copied from the flash into 'buffer' and '*size' is extended to the page
+ * boundary, so that erasing the page does not lose what follows the image.
+ *
+ * Return zero on success, a negative error value on failures.
+ */
+static int skip_identical_pages(int fd, struct stm32_def *chip,
+				uint32_t offset, uint8_t *buffer, int *size)
+{
+	uint32_t page_size = chip->page_size;
+	int first_page = (offset - STM32_MAIN_MEMORY_ADDR) / page_size;
+	int page_count = (*size + page_size - 1) / page_size;
+	int full_size = page_count * page_size;
+	int erase_start = -1;
+	uint8_t *current;
+	int res, i;
+
+	current = malloc(full_size);
+	if (!current) {
+		fprintf(stderr, "Cannot allocate %d bytes\n", full_size);
+		return STM32_ENOMEM;
+	}
+
+	printf("Reading back %d bytes at 0x%08x\n", full_size, offset);
+	res = command_read_mem(fd, offset, full_size, current);
+	if (res != full_size) {
+		fprintf(stderr, "Error reading back flash\n");
+		free(current);
+		return STM32_EIO;
+	}
+	printf("\r   %d bytes read.\n", res);
+
+	/* Keep the flash content following the image in its last page */
+	memcpy(buffer + *size, current + *size, full_size - *size);
+	*size = full_size;
+
+	/* Erase each run of pages with differences */
+	for (i = 0; i <= page_count; i++) {
+		uint32_t start = i * page_size;
+
+		if (i < page_count &&
+		    memcmp(buffer + start, current + start, page_size)) {
+			if (erase_start < 0)
+				erase_start = i;
+			continue;
+		}
+
+		if (i < page_count) {
+			memset(buffer + start, 0xff, page_size);
+			timing.pages_skipped++;
+		}
+
+		if (erase_start >= 0) {
+			res = erase_pages(fd, first_page + erase_start,
+					  i - erase_start);
+			if (IS_STM32_ERROR(res))
+				break;
+			erase_start = -1;
+		}
+	}
+
+	free(current);
+	return IS_STM32_ERROR(res) ? res : STM32_SUCCESS;
+}
+
 /* Return zero on success, a negative error value on failures. */
 int write_flash(int fd, struct stm32_def *chip, const char *filename,
-		uint32_t offset)
+		uint32_t offset, int skip_identical)
 {
 	int res, written;
 	FILE *hnd;
@@ -1381,6 +1514,15 @@ int write_flash(int fd, struct stm32_def *chip, const char *filename,
 		return STM32_EIO;
 	}
 
+	if (skip_identical) {
+		int ret = skip_identical_pages(fd, chip, offset, buffer, &res);
+
+		if (IS_STM32_ERROR(ret)) {
+			free(buffer);
+			return ret;
+		}
+	}
+
 	/* faster write: skip empty trailing space */
 	while (res && buffer[res - 1] == 0xff)
 		res--;
@@ -1415,6 +1557,7 @@ static const struct option longopts[] = {
 	{"progressbar", 0, 0, 'p'},
 	{"read", 1, 0, 'r'},
 	{"retries", 1, 0, 'R'},
+	{"skip-identical", 0, 0, 'S'},
 	{"spi", 1, 0, 's'},
 	{"unprotect", 0, 0, 'u'},
 	{"version", 0, 0, 'v'},
@@ -1428,7 +1571,7 @@ void display_usage(char *program)
 		"Usage: %s [-a <i2c_adapter> [-l address ]] | [-s]"
 		" [-d <tty>] [-b <baudrate>]] [-u] [-e] [-U]"
 		" [-r <file>] [-w <file>] [-o offset] [-n length] [-g] [-p]"
-		" [-L <log_file>] [-c] [-v]\n",
+		" [-L <log_file>] [-c] [-S] [-v]\n",
 		program);
 	fprintf(stderr, "Can access the controller via serial port or i2c\n");
 	fprintf(stderr, "Serial port mode:\n");
@@ -1453,6 +1596,8 @@ void display_usage(char *program)
 	fprintf(stderr, "--p[rogressbar] : use a progress bar instead of "
 			"the spinner\n");
 	fprintf(stderr, "--R[etries] <num> : limit connect retries to num\n");
+	fprintf(stderr, "--S[kip-identical] : only erase and write the pages "
+			"which differ\n\tfrom the image, read back first\n");
 	fprintf(stderr, "-L[ogfile] <file> : save all communications exchange "
 		"in a log file\n");
 	fprintf(stderr, "-c[r50_mode] : consider device to be a Cr50 interface,"
@@ -1496,7 +1641,7 @@ int parse_parameters(int argc, char **argv)
 	int flags = 0;
 	const char *log_file_name = NULL;
 
-	while ((opt = getopt_long(argc, argv, "a:l:b:cd:eghL:n:o:pr:R:s:w:uUv?",
+	while ((opt = getopt_long(argc, argv, "a:l:b:cd:eghL:n:o:pr:R:s:Sw:uUv?",
 				  longopts, &idx)) != -1) {
 		switch (opt) {
 		case 'a':
@@ -1548,6 +1693,9 @@ int parse_parameters(int argc, char **argv)
 			spi_adapter = optarg;
 			mode = MODE_SPI;
 			break;
+		case 'S':
+			flags |= FLAG_SKIP_IDENTICAL;
+			break;
 		case 'w':
 			output_filename = optarg;
 			break;
@@ -1587,6 +1735,26 @@ static void display_stat_response(void)
 	printf("--\n");
 }
 
+static void display_timing(void)
+{
+	if (timing.erase <= 0 && timing.read <= 0 && timing.write <= 0)
+		return;
+
+	printf("Erase: %.2f s", timing.erase);
+	if (timing.pages_erased)
+		printf(", %d pages", timing.pages_erased);
+	if (timing.pages_skipped)
+		printf(" (%d identical pages skipped)", timing.pages_skipped);
+	printf("\n");
+	if (timing.bytes_read && timing.read > 0)
+		printf("Read:  %.2f s, %d bytes, %.0f bytes/s\n", timing.read,
+		       timing.bytes_read, timing.bytes_read / timing.read);
+	if (timing.bytes_written && timing.write > 0)
+		printf("Write: %.2f s, %d bytes, %.0f bytes/s\n", timing.write,
+		       timing.bytes_written,
+		       timing.bytes_written / timing.write);
+}
+
 int main(int argc, char **argv)
 {
 	int ser;
@@ -1597,6 +1765,7 @@ int main(int argc, char **argv)
 	uint16_t flash_size_kbytes = 0;
 	uint8_t unique_device_id[STM32_UNIQUE_ID_SIZE_BYTES] = { 0 };
 	uint16_t package_data_reg = 0;
+	int skip_identical;
 
 	/* Parse command line options */
 	flags = parse_parameters(argc, argv);
@@ -1657,21 +1826,35 @@ int main(int argc, char **argv)
 	if (flags & FLAG_UNPROTECT)
 		command_write_unprotect(ser);
 
-	if (flags & FLAG_ERASE || output_filename) {
+	/*
+	 * Skipping identical pages erases them one by one, which needs pages
+	 * of a known size, aligned with the offset.
+	 */
+	skip_identical = output_filename && (flags & FLAG_SKIP_IDENTICAL) &&
+			 !(flags & FLAG_ERASE);
+	if (skip_identical && (!has_uniform_pages(chip) ||
+			       offset < STM32_MAIN_MEMORY_ADDR ||
+			       (offset - STM32_MAIN_MEMORY_ADDR) %
+			       chip->page_size)) {
+		fprintf(stderr, "Cannot skip identical pages, erasing all\n");
+		skip_identical = 0;
+	}
+
+	if (flags & FLAG_ERASE || (output_filename && !skip_identical)) {
 		if ((!strncmp("STM32L15", chip->name, 8)) ||
 		    (!strncmp("STM32F411", chip->name, 9))) {
 			/* Mass erase is not supported on these chips*/
-			int i, page_count = chip->flash_size / chip->page_size;
-			for (i = 0; i < page_count; i += 128) {
-				int count = MIN(128, page_count - i);
-				ret = erase(ser, count, i);
-				if (IS_STM32_ERROR(ret))
-					goto terminate;
-			}
+			ret = erase_pages(ser, 0,
+					  chip->flash_size / chip->page_size);
+			if (IS_STM32_ERROR(ret))
+				goto terminate;
 		} else {
+			double start = get_time_s();
+
 			ret = erase(ser, 0xFFFF, 0);
 			if (IS_STM32_ERROR(ret))
 				goto terminate;
+			timing.erase += get_time_s() - start;
 		}
 	}
 
@@ -1682,7 +1865,8 @@ int main(int argc, char **argv)
 	}
 
 	if (output_filename) {
-		ret = write_flash(ser, chip, output_filename, offset);
+		ret = write_flash(ser, chip, output_filename, offset,
+				  skip_identical);
 		if (IS_STM32_ERROR(ret))
 			goto terminate;
 	}
@@ -1703,6 +1887,8 @@ terminate:
 	if (retry_on_damaged_ack)
 		display_stat_response();
 
+	display_timing();
+
 	if (IS_STM32_ERROR(ret)) {
 		fprintf(stderr, "Failed: %d\n", ret);
 		return 1;